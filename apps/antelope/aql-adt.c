@@ -86,6 +86,8 @@ aql_clear(aql_adt_t *adt)
   adt->relation_count = 0;
   adt->attribute_count = 0;
   adt->value_count = 0;
+  adt->parameter_count = 0;
+  adt->group_count = 0;
   adt->flags = 0;
   memset(adt->aggregators, 0, sizeof(adt->aggregators));
 }
@@ -147,3 +149,45 @@ aql_add_value(aql_adt_t *adt, domain_t domain, void *value_ptr)
 
   return DB_OK;
 }
+
+db_result_t
+aql_add_parameter(aql_adt_t *adt, uint8_t type, unsigned position)
+{
+  aql_parameter_t *parameter;
+
+  if(adt->parameter_count == AQL_PARAMETER_LIMIT || position > UINT8_MAX) {
+    return DB_LIMIT_ERROR;
+  }
+
+  parameter = &adt->parameters[adt->parameter_count++];
+  parameter->type = type;
+  parameter->position = position;
+
+  return DB_OK;
+}
+
+db_result_t
+aql_add_group(aql_adt_t *adt, char *name, long divisor)
+{
+  aql_attribute_t *attr;
+  aql_group_t *group;
+
+  if(adt->group_count == AQL_GROUP_LIMIT || divisor <= 0) {
+    return DB_LIMIT_ERROR;
+  }
+
+  attr = get_attribute(adt, name);
+  if(attr == NULL) {
+    /* The attribute is only used for grouping. */
+    if(DB_ERROR(aql_add_attribute(adt, name, DOMAIN_UNSPECIFIED, 0, 1))) {
+      return DB_LIMIT_ERROR;
+    }
+    attr = &adt->attributes[adt->attribute_count - 1];
+  }
+
+  group = &adt->groups[adt->group_count++];
+  group->attribute = attr - adt->attributes;
+  group->divisor = divisor;
+
+  return DB_OK;
+}
@@ -45,6 +45,7 @@
 #include "net/ip/uip-debug.h"
 
 #include "index.h"
+#include "lvm.h"
 #include "relation.h"
 #include "result.h"
 #include "aql.h"
@@ -112,7 +113,9 @@ aql_execute(db_handle_t *handle, aql_adt_t *adt)
     result = index_create(AQL_GET_INDEX_TYPE(adt), rel, relattr);
     break;
   case AQL_TYPE_CREATE_RELATION:
-    if(relation_create(adt->relations[0], DB_STORAGE) != NULL) {
+    if(relation_create(adt->relations[0], DB_STORAGE,
+                       AQL_GET_FLAGS(adt) & AQL_FLAG_SERIES ?
+                       RELATION_FLAG_SERIES : 0) != NULL) {
       result = DB_OK;
     }
     break;
@@ -210,6 +213,96 @@ db_query(db_handle_t *handle, const char *format, ...)
   return aql_execute(handle, &adt);
 }
 
+db_result_t
+db_prepare(db_statement_t *stmt, const char *format, ...)
+{
+  va_list ap;
+  char query_string[AQL_MAX_QUERY_LENGTH];
+  lvm_instance_t *lvm_instance;
+  attribute_value_t *value;
+  size_t length;
+  size_t offset;
+
+  va_start(ap, format);
+  vsnprintf(query_string, sizeof(query_string), format, ap);
+  va_end(ap);
+
+  if(AQL_ERROR(aql_parse(&stmt->adt, query_string))) {
+    return DB_PARSING_ERROR;
+  }
+
+  /* The parser keeps the bytecode and the string values in buffers
+     that are reused for the next query, so the statement needs its
+     own copies of them. */
+  lvm_instance = stmt->adt.lvm_instance;
+  if(lvm_instance != NULL) {
+    lvm_clone(&stmt->lvm_instance, lvm_instance);
+    memcpy(stmt->code, lvm_instance->code, lvm_instance->end);
+    stmt->lvm_instance.code = stmt->code;
+    stmt->lvm_instance.size = sizeof(stmt->code);
+    AQL_SET_CONDITION(&stmt->adt, &stmt->lvm_instance);
+    lvm_save_variables(&stmt->variables);
+  }
+
+  offset = 0;
+  for(value = stmt->adt.values;
+      value < stmt->adt.values + stmt->adt.value_count;
+      value++) {
+    if(value->domain == DOMAIN_STRING) {
+      length = strlen((char *)VALUE_STRING(value)) + 1;
+      memcpy(stmt->strings + offset, VALUE_STRING(value), length);
+      VALUE_STRING(value) = stmt->strings + offset;
+      offset += length;
+    }
+  }
+
+  stmt->flags = AQL_GET_FLAGS(&stmt->adt);
+
+  PRINTF("DB: Prepared a query with %u parameters\n",
+         (unsigned)AQL_PARAMETER_COUNT(&stmt->adt));
+
+  return DB_OK;
+}
+
+db_result_t
+db_bind(db_statement_t *stmt, unsigned index, long value)
+{
+  aql_parameter_t *parameter;
+
+  if(index >= AQL_PARAMETER_COUNT(&stmt->adt)) {
+    return DB_ARGUMENT_ERROR;
+  }
+
+  parameter = &stmt->adt.parameters[index];
+  if(parameter->type == AQL_PARAMETER_VALUE) {
+    VALUE_LONG(&stmt->adt.values[parameter->position]) = value;
+    return DB_OK;
+  }
+
+  if(LVM_ERROR(lvm_replace_long(&stmt->lvm_instance,
+                                parameter->position, value))) {
+    return DB_IMPLEMENTATION_ERROR;
+  }
+  return DB_OK;
+}
+
+db_result_t
+db_execute(db_handle_t *handle, db_statement_t *stmt)
+{
+  if(handle != NULL) {
+    clear_handle(handle);
+  }
+
+  /* Other queries may have registered their own variables in the LVM
+     since the statement was prepared. */
+  if(stmt->adt.lvm_instance != NULL) {
+    lvm_restore_variables(&stmt->variables);
+  }
+  stmt->adt.flags = stmt->flags;
+
+  return aql_execute(handle, &stmt->adt);
+}
+
 db_result_t
 db_process(db_handle_t *handle)
 {
@@ -107,6 +107,10 @@ static aql_adt_t *adt;
 static lvm_instance_t p;
 static unsigned char vmcode[DB_VM_BYTECODE_SIZE];
 
+/* The number of operands in the bytecode, which identifies the
+   operands that are parameter placeholders. */
+static unsigned operand_count;
+
 /* Parsing functions for AQL. */
 PARSER_TOKEN(cmp)
 {
@@ -241,6 +245,8 @@ PARSER(relations)
 
 PARSER(values)
 {
+  long zero;
+
   /* Parse comma-separated attribute values. */
   NEXT;
   switch(TOKEN) {
@@ -250,6 +256,14 @@ PARSER(values)
   case INTEGER_VALUE:
     AQL_ADD_VALUE(adt, DOMAIN_INT, VALUE);
     break;
+  case PARAMETER:
+    if(DB_ERROR(AQL_ADD_PARAMETER(adt, AQL_PARAMETER_VALUE,
+                                  adt->value_count))) {
+      RETURN(SYNTAX_ERROR);
+    }
+    zero = 0;
+    AQL_ADD_VALUE(adt, DOMAIN_INT, &zero);
+    break;
   default:
     RETURN(SYNTAX_ERROR);
   }
@@ -272,6 +286,7 @@ PARSER(operand)
     lvm_register_variable(VALUE, LVM_LONG);
     lvm_set_variable(&p, VALUE);
     AQL_ADD_PROCESSING_ATTRIBUTE(adt, VALUE);
+    operand_count++;
     break;
   case STRING_VALUE:
     break;
@@ -279,6 +294,15 @@ PARSER(operand)
     break;
   case INTEGER_VALUE:
     lvm_set_long(&p, *(long *)lexer->value);
+    operand_count++;
+    break;
+  case PARAMETER:
+    if(DB_ERROR(AQL_ADD_PARAMETER(adt, AQL_PARAMETER_OPERAND,
+                                  operand_count))) {
+      RETURN(SYNTAX_ERROR);
+    }
+    lvm_set_long(&p, 0);
+    operand_count++;
     break;
   default:
     RETURN(SYNTAX_ERROR);
@@ -479,8 +503,44 @@ PARSER(join)
   RETURN(OK);
 }
 
+#if DB_FEATURE_GROUP
+PARSER(group)
+{
+  char name[ATTRIBUTE_NAME_LENGTH + 1];
+  long divisor;
+
+  /* Parse comma-separated attributes, each of which may be divided
+     into intervals of values, such as "time / 3600". */
+  CONSUME(IDENTIFIER);
+  strncpy(name, VALUE, sizeof(name) - 1);
+  name[sizeof(name) - 1] = '\0';
+
+  divisor = 1;
+  NEXT;
+  if(TOKEN == DIV) {
+    CONSUME(INTEGER_VALUE);
+    divisor = *(long *)lexer->value;
+    NEXT;
+  }
+
+  PRINTF("group by: %s / %ld\n", name, divisor);
+  if(DB_ERROR(AQL_ADD_GROUP(adt, name, divisor))) {
+    RETURN(SYNTAX_ERROR);
+  }
+
+  if(TOKEN == COMMA) {
+    return PARSE(group) ? OK : SYNTAX_ERROR;
+  }
+  REWIND;
+
+  RETURN(OK);
+}
+#endif /* DB_FEATURE_GROUP */
+
 PARSER(select)
 {
+  int clauses;
+
   AQL_SET_TYPE(adt, AQL_TYPE_SELECT);
 
   /* projection attributes... */
@@ -493,6 +553,7 @@ PARSER(select)
     RETURN(SYNTAX_ERROR);
   }
 
+  clauses = 0;
   NEXT;
   if(TOKEN == WHERE) {
     lvm_reset(&p, vmcode, sizeof(vmcode));
@@ -502,8 +563,26 @@ PARSER(select)
     }
 
     AQL_SET_CONDITION(adt, &p);
+    clauses++;
+  } else {
+    REWIND;
+  }
+
+#if DB_FEATURE_GROUP
+  NEXT;
+  if(TOKEN == GROUP) {
+    CONSUME(BY);
+
+    if(!PARSE(group)) {
+      RETURN(SYNTAX_ERROR);
+    }
+    clauses++;
   } else {
     REWIND;
+  }
+#endif /* DB_FEATURE_GROUP */
+
+  if(clauses == 0) {
     RETURN(OK);
   }
 
@@ -642,6 +721,9 @@ PARSER_TOKEN(index_type)
   case MAXHEAP:
     type = INDEX_MAXHEAP;
     break;
+  case BTREE:
+    type = INDEX_BTREE;
+    break;
   case MEMHASH:
     type = INDEX_MEMHASH;
     break;
@@ -682,6 +764,14 @@ PARSER(create_relation)
   AQL_SET_TYPE(adt, AQL_TYPE_CREATE_RELATION);
   AQL_ADD_RELATION(adt, VALUE);
 
+  NEXT;
+  if(TOKEN == TYPE) {
+    CONSUME(SERIES);
+    AQL_SET_FLAG(adt, AQL_FLAG_SERIES);
+  } else {
+    REWIND;
+  }
+
   RETURN(OK);
 }
 
@@ -789,6 +879,7 @@ aql_parse(aql_adt_t *external_adt, char *input_string)
   adt = external_adt;
   AQL_CLEAR(adt);
   AQL_SET_CONDITION(adt, NULL);
+  operand_count = 0;
 
   lexer_start(&lex, input_string, &token, &value);
 
@@ -42,6 +42,7 @@
 
 #include "db-options.h"
 #include "index.h"
+#include "lvm.h"
 #include "relation.h"
 #include "result.h"
 
@@ -104,6 +105,11 @@ enum token {
   MEMHASH = 46,
   RELATION = 47,
   ATTRIBUTE = 48,
+  BTREE = 49,
+  SERIES = 50,
+  PARAMETER = 51,
+  GROUP = 52,
+  BY = 53,
 
   INTEGER_VALUE = 251,
   FLOAT_VALUE = 252,
@@ -145,15 +151,39 @@ struct aql_attribute {
 };
 typedef struct aql_attribute aql_attribute_t;
 
+/* A placeholder for a value that is bound after the query has been
+   parsed. The position is either an index in the value array or
+   the number of the operand in the LVM bytecode. */
+struct aql_parameter {
+  uint8_t type;
+  uint8_t position;
+};
+typedef struct aql_parameter aql_parameter_t;
+
+#define AQL_PARAMETER_VALUE		0
+#define AQL_PARAMETER_OPERAND		1
+
+/* An attribute in the GROUP BY clause. The rows are grouped by the
+   value of the attribute divided by the divisor, rounded down. */
+struct aql_group {
+  long divisor;
+  uint8_t attribute;
+};
+typedef struct aql_group aql_group_t;
+
 struct aql_adt {
   char relations[AQL_RELATION_LIMIT][RELATION_NAME_LENGTH + 1];
   aql_attribute_t attributes[AQL_ATTRIBUTE_LIMIT];
   aql_aggregator_t aggregators[AQL_ATTRIBUTE_LIMIT];
   attribute_value_t values[AQL_ATTRIBUTE_LIMIT];
+  aql_parameter_t parameters[AQL_PARAMETER_LIMIT];
+  aql_group_t groups[AQL_GROUP_LIMIT];
   index_type_t index_type;
   uint8_t relation_count;
   uint8_t attribute_count;
   uint8_t value_count;
+  uint8_t parameter_count;
+  uint8_t group_count;
   uint8_t optype;
   uint8_t flags;
   void *lvm_instance;
@@ -179,6 +209,7 @@ typedef struct aql_adt aql_adt_t;
 #define AQL_FLAG_AGGREGATE		1
 #define AQL_FLAG_ASSIGN			2
 #define AQL_FLAG_INVERSE_LOGIC		4
+#define AQL_FLAG_SERIES			8
 
 #define AQL_CLEAR(adt)			aql_clear(adt)
 #define AQL_SET_TYPE(adt, type)	(((adt))->optype = (type))
@@ -204,6 +235,29 @@ typedef struct aql_adt aql_adt_t;
 #define AQL_SET_CONDITION(adt, cond)	((adt)->lvm_instance = (cond))
 #define AQL_ADD_VALUE(adt, domain, value)				\
     aql_add_value((adt), (domain), (value))
+#define AQL_ADD_PARAMETER(adt, type, position)				\
+    aql_add_parameter((adt), (type), (position))
+#define AQL_PARAMETER_COUNT(adt)	((adt)->parameter_count)
+#define AQL_ADD_GROUP(adt, attr, divisor)				\
+    aql_add_group((adt), (attr), (divisor))
+#define AQL_GROUP_COUNT(adt)		((adt)->group_count)
+
+/*
+ * A prepared statement keeps the result of parsing a query, so that
+ * it can be executed many times without lexing, parsing, and
+ * compiling the query again. Values are bound to the placeholders
+ * ("?") in the query before each execution.
+ */
+struct db_statement {
+  aql_adt_t adt;
+  lvm_instance_t lvm_instance;
+  struct lvm_variables variables;
+  unsigned char code[DB_VM_BYTECODE_SIZE];
+  unsigned char strings[DB_MAX_CHAR_SIZE_PER_ROW];
+  /* The flags of the query are changed when the result is processed. */
+  uint8_t flags;
+};
+typedef struct db_statement db_statement_t;
 
 int lexer_start(lexer_t *, char *, token_t *, value_t *);
 int lexer_next(lexer_t *);
@@ -215,7 +269,12 @@ db_result_t aql_add_attribute(aql_adt_t *adt, char *name,
                                domain_t domain, unsigned element_size,
                                int processed_only);
 db_result_t aql_add_value(aql_adt_t *adt, domain_t domain, void *value);
+db_result_t aql_add_parameter(aql_adt_t *adt, uint8_t type, unsigned position);
+db_result_t aql_add_group(aql_adt_t *adt, char *name, long divisor);
 db_result_t db_query(db_handle_t *handle, const char *format, ...);
+db_result_t db_prepare(db_statement_t *stmt, const char *format, ...);
+db_result_t db_bind(db_statement_t *stmt, unsigned index, long value);
+db_result_t db_execute(db_handle_t *handle, db_statement_t *stmt);
 db_result_t db_process(db_handle_t *handle);
 
 #endif /* !AQL_H */
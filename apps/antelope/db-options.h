@@ -69,6 +69,21 @@
 #define DB_FEATURE_INTEGRITY		0
 #endif /* DB_FEATURE_INTEGRITY */
 
+/* Support compressed, append-only relations for time series. */
+#ifndef DB_FEATURE_SERIES
+#define DB_FEATURE_SERIES		1
+#endif /* DB_FEATURE_SERIES */
+
+/* Support the grouping of aggregates with GROUP BY. */
+#ifndef DB_FEATURE_GROUP
+#define DB_FEATURE_GROUP		1
+#endif /* DB_FEATURE_GROUP */
+
+/* Support B+-tree indexes. */
+#ifndef DB_FEATURE_BTREE
+#define DB_FEATURE_BTREE		1
+#endif /* DB_FEATURE_BTREE */
+
 /*----------------------------------------------------------------------------*/
 
 /* Configuration parameters that may be trimmed to save space. */
@@ -104,6 +119,50 @@
 #endif /* DB_MAX_ELEMENT_SIZE */
 
 
+/* The size of the buffer used to read several rows at a time
+   when scanning a relation. */
+#ifndef DB_SCAN_BUFFER_SIZE
+#define DB_SCAN_BUFFER_SIZE		256
+#endif /* DB_SCAN_BUFFER_SIZE */
+
+/* The size of a block of rows in a series relation. Each block has a
+   summary of the value ranges of its attributes. */
+#ifndef DB_SERIES_BLOCK_SIZE
+#define DB_SERIES_BLOCK_SIZE		256
+#endif /* DB_SERIES_BLOCK_SIZE */
+
+/* The size of the buffer that the hash join and the sort-merge join
+   use to hold rows in memory. */
+#ifndef DB_JOIN_BUFFER_SIZE
+#define DB_JOIN_BUFFER_SIZE		512
+#endif /* DB_JOIN_BUFFER_SIZE */
+
+/* The size of the hash table that holds the groups of a selection
+   with GROUP BY. Groups that do not fit are spilled into a file. */
+#ifndef DB_GROUP_BUFFER_SIZE
+#define DB_GROUP_BUFFER_SIZE		512
+#endif /* DB_GROUP_BUFFER_SIZE */
+
+/* The number of partitions that the hash join spills the rows into
+   when the smaller relation does not fit in the join buffer. The
+   spilled blocks of DB_JOIN_BUFFER_SIZE / DB_JOIN_PARTITIONS bytes
+   are read back into the scan buffer, so DB_SCAN_BUFFER_SIZE must be
+   at least that large, or such joins fail with DB_LIMIT_ERROR. */
+#ifndef DB_JOIN_PARTITIONS
+#define DB_JOIN_PARTITIONS		4
+#endif /* DB_JOIN_PARTITIONS */
+
+/* The number of buckets in the hash table of the hash join. */
+#ifndef DB_JOIN_HASH_BUCKETS
+#define DB_JOIN_HASH_BUCKETS		32
+#endif /* DB_JOIN_HASH_BUCKETS */
+
+/* The join method: 0 to choose by the estimated cost, 1 for the
+   index join, 2 for the hash join, and 3 for the sort-merge join. */
+#ifndef DB_JOIN_METHOD
+#define DB_JOIN_METHOD			0
+#endif /* DB_JOIN_METHOD */
+
 /* The maximum size of the LVM bytecode compiled from a
    single database query. */
 #ifndef DB_VM_BYTECODE_SIZE
@@ -133,6 +192,16 @@
 #define AQL_ATTRIBUTE_LIMIT    		5
 #endif /* AQL_ATTRIBUTE_LIMIT */
 
+/* The maximum number of attributes in the GROUP BY clause of a query. */
+#ifndef AQL_GROUP_LIMIT
+#define AQL_GROUP_LIMIT    		2
+#endif /* AQL_GROUP_LIMIT */
+
+/* The maximum number of parameter placeholders in a prepared query. */
+#ifndef AQL_PARAMETER_LIMIT
+#define AQL_PARAMETER_LIMIT    		4
+#endif /* AQL_PARAMETER_LIMIT */
+
 /*----------------------------------------------------------------------------*/
 
 /*
@@ -152,6 +221,12 @@
 #define DB_MAX_CHAR_SIZE_PER_ROW	64
 #endif /* DB_MAX_CHAR_SIZE_PER_ROW */
 
+/* Scan reads are made to end at multiples of this size, which should
+   match the flash page size of the file system. */
+#ifndef DB_SCAN_PAGE_SIZE
+#define DB_SCAN_PAGE_SIZE		256
+#endif /* DB_SCAN_PAGE_SIZE */
+
 /* The maximum file name length to use for creating various database file. */
 #ifndef DB_MAX_FILENAME_LENGTH
 #define DB_MAX_FILENAME_LENGTH		16
@@ -206,6 +281,27 @@
 #define DB_HEAP_CACHE_LIMIT		1
 #endif /* DB_HEAP_CACHE_LIMIT */
 
+/* The maximum number of B+-tree indexes. */
+#ifndef DB_BTREE_INDEX_LIMIT
+#define DB_BTREE_INDEX_LIMIT		1
+#endif /* DB_BTREE_INDEX_LIMIT */
+
+/* The size of a B+-tree node in flash memory. */
+#ifndef DB_BTREE_NODE_SIZE
+#define DB_BTREE_NODE_SIZE		256
+#endif /* DB_BTREE_NODE_SIZE */
+
+/* The maximum number of B+-tree nodes cached in RAM, shared by all
+   B+-tree indexes. */
+#ifndef DB_BTREE_CACHE_LIMIT
+#define DB_BTREE_CACHE_LIMIT		4
+#endif /* DB_BTREE_CACHE_LIMIT */
+
+/* The space reserved for a B+-tree file when it is created. */
+#ifndef DB_BTREE_FILE_SIZE
+#define DB_BTREE_FILE_SIZE		16384
+#endif /* DB_BTREE_FILE_SIZE */
+
 /*----------------------------------------------------------------------------*/
 
 /* LVM options. */
@@ -0,0 +1,423 @@
+/*
+ * Copyright (c) 2015, EasyRF.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *	Hash aggregation for selections with GROUP BY. The groups are kept
+ *	in a fixed-size table, and partial groups that do not fit in it
+ *	are spilled into a CFS file that is merged after the input ends.
+ */
+
+#include <string.h>
+
+#include "cfs/cfs.h"
+
+#include "aql.h"
+#include "db-options.h"
+#include "group.h"
+#include "storage.h"
+
+#define DEBUG DEBUG_NONE
+#include "net/ip/uip-debug.h"
+
+#if DB_FEATURE_GROUP
+
+/*
+ * Each group is stored as a record consisting of the number of rows in
+ * the group, the group keys, and one partial result per aggregator. The
+ * records are kept in an open addressing hash table with linear
+ * probing, in which a row count of zero marks an empty slot.
+ *
+ * When a row of a new group does not fit in the table, all groups in
+ * the table are written as partial records to a spill file, and the
+ * table is emptied. Input rows that are clustered by group, such as
+ * rows in time order grouped by time intervals, thereby spill few
+ * records. After all input rows have been added, the spill file is read
+ * back into the table, and the partial records of each group are
+ * merged. Groups that do not fit in the table during this merge are
+ * spilled into another file, without evicting groups from the table.
+ * The groups in the table are then emitted, and the merge repeats with
+ * the new spill file until no records have been spilled.
+ */
+
+/* The number of spilled records that group_next() merges before
+   yielding. */
+#define ROWS_PER_STEP		32
+
+#define MAX_SLOTS		0xff
+
+enum group_phase {
+  PHASE_BUILD,
+  PHASE_EMIT,
+  PHASE_MERGE
+};
+
+enum {
+  FILE_IN,
+  FILE_OUT
+};
+
+static long table[DB_GROUP_BUFFER_SIZE / sizeof(long)];
+static long record[DB_GROUP_BUFFER_SIZE / sizeof(long)];
+
+static uint8_t phase;
+static uint8_t key_count;
+static uint8_t aggregator_count;
+static uint8_t aggregators[AQL_ATTRIBUTE_LIMIT];
+static unsigned record_length;
+static unsigned capacity;
+static unsigned limit;
+static unsigned slots;
+static unsigned slot;
+static unsigned long file_size;
+
+static db_storage_id_t files[2] = {-1, -1};
+static char filenames[2][DB_MAX_FILENAME_LENGTH];
+static unsigned long records[2];
+static unsigned long position;
+/*---------------------------------------------------------------------------*/
+static unsigned
+key_hash(const long *keys)
+{
+  unsigned long hash;
+  unsigned i;
+
+  for(hash = 0, i = 0; i < key_count; i++) {
+    hash = hash * 31 + (unsigned long)keys[i];
+  }
+
+  hash ^= hash >> 16;
+  hash *= 0x45d9f3bUL;
+  hash ^= hash >> 16;
+  return hash % capacity;
+}
+/*---------------------------------------------------------------------------*/
+static void
+close_file(int i)
+{
+  if(files[i] >= 0) {
+    storage_close(files[i]);
+    files[i] = -1;
+  }
+  if(filenames[i][0] != '\0') {
+    cfs_remove(filenames[i]);
+    filenames[i][0] = '\0';
+  }
+  records[i] = 0;
+}
+/*---------------------------------------------------------------------------*/
+static db_result_t
+spill(const long *rec)
+{
+  char *filename;
+
+  if(files[FILE_OUT] < 0) {
+    filename = storage_generate_file("group", file_size);
+    if(filename == NULL) {
+      return DB_STORAGE_ERROR;
+    }
+    strncpy(filenames[FILE_OUT], filename, sizeof(filenames[FILE_OUT]) - 1);
+    filenames[FILE_OUT][sizeof(filenames[FILE_OUT]) - 1] = '\0';
+
+    files[FILE_OUT] = storage_open(filenames[FILE_OUT]);
+    if(files[FILE_OUT] < 0) {
+      close_file(FILE_OUT);
+      return DB_STORAGE_ERROR;
+    }
+  }
+
+  if(DB_ERROR(storage_write(files[FILE_OUT], (void *)rec,
+                            records[FILE_OUT] * record_length * sizeof(long),
+                            record_length * sizeof(long)))) {
+    return DB_STORAGE_ERROR;
+  }
+  records[FILE_OUT]++;
+
+  return DB_OK;
+}
+/*---------------------------------------------------------------------------*/
+static void
+merge(long *to, const long *from)
+{
+  unsigned i;
+
+  to[0] += from[0];
+  to += 1 + key_count;
+  from += 1 + key_count;
+
+  for(i = 0; i < aggregator_count; i++) {
+    switch(aggregators[i]) {
+    case AQL_MIN:
+      if(from[i] < to[i]) {
+        to[i] = from[i];
+      }
+      break;
+    case AQL_MAX:
+      if(from[i] > to[i]) {
+        to[i] = from[i];
+      }
+      break;
+    default:
+      to[i] += from[i];
+      break;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Add a record to the group with the same keys in the table. Fails
+   if the group is not in the table and the table is full. */
+static db_result_t
+insert(const long *rec)
+{
+  long *ptr;
+  unsigned i;
+
+  for(i = key_hash(rec + 1);; i = (i + 1) % capacity) {
+    ptr = &table[i * record_length];
+    if(ptr[0] == 0) {
+      break;
+    }
+    if(memcmp(ptr + 1, rec + 1, key_count * sizeof(long)) == 0) {
+      merge(ptr, rec);
+      return DB_OK;
+    }
+  }
+
+  if(slots == limit) {
+    return DB_LIMIT_ERROR;
+  }
+
+  memcpy(ptr, rec, record_length * sizeof(long));
+  slots++;
+  return DB_OK;
+}
+/*---------------------------------------------------------------------------*/
+static db_result_t
+spill_table(void)
+{
+  long *ptr;
+
+  for(ptr = table; slots > 0; ptr += record_length) {
+    if(ptr[0] != 0) {
+      if(DB_ERROR(spill(ptr))) {
+        return DB_STORAGE_ERROR;
+      }
+      ptr[0] = 0;
+      slots--;
+    }
+  }
+  return DB_OK;
+}
+/*---------------------------------------------------------------------------*/
+static db_result_t
+emit(long *keys, long *results)
+{
+  long *ptr;
+  unsigned i;
+
+  for(; slot < capacity; slot++) {
+    ptr = &table[slot * record_length];
+    if(ptr[0] == 0) {
+      continue;
+    }
+
+    memcpy(keys, ptr + 1, key_count * sizeof(long));
+    for(i = 0; i < aggregator_count; i++) {
+      results[i] = ptr[1 + key_count + i];
+      if(aggregators[i] == AQL_MEAN) {
+        results[i] /= ptr[0];
+      }
+    }
+
+    ptr[0] = 0;
+    slots--;
+    slot++;
+    return DB_GOT_ROW;
+  }
+
+  if(records[FILE_OUT] == 0) {
+    /* All groups have been emitted. Accept new rows. */
+    close_file(FILE_IN);
+    phase = PHASE_BUILD;
+    return DB_FINISHED;
+  }
+
+  /* Read the spilled groups back into the table. */
+  close_file(FILE_IN);
+  files[FILE_IN] = files[FILE_OUT];
+  memcpy(filenames[FILE_IN], filenames[FILE_OUT], sizeof(filenames[FILE_IN]));
+  records[FILE_IN] = records[FILE_OUT];
+  files[FILE_OUT] = -1;
+  filenames[FILE_OUT][0] = '\0';
+  records[FILE_OUT] = 0;
+
+  PRINTF("DB: Merging %lu spilled groups\n", records[FILE_IN]);
+  position = 0;
+  phase = PHASE_MERGE;
+  return DB_OK;
+}
+/*---------------------------------------------------------------------------*/
+static db_result_t
+merge_spilled(void)
+{
+  unsigned i;
+
+  for(i = 0; i < ROWS_PER_STEP && position < records[FILE_IN]; i++) {
+    if(DB_ERROR(storage_read(files[FILE_IN], record,
+                             position * record_length * sizeof(long),
+                             record_length * sizeof(long)))) {
+      return DB_STORAGE_ERROR;
+    }
+    position++;
+
+    if(insert(record) == DB_LIMIT_ERROR && DB_ERROR(spill(record))) {
+      return DB_STORAGE_ERROR;
+    }
+  }
+
+  if(position == records[FILE_IN]) {
+    slot = 0;
+    phase = PHASE_EMIT;
+  }
+  return DB_OK;
+}
+/*---------------------------------------------------------------------------*/
+db_result_t
+group_init(unsigned keys, const uint8_t *aggregator_list, unsigned count,
+           unsigned long size_hint)
+{
+  unsigned i;
+
+  group_release();
+
+  for(i = 0; i < count; i++) {
+    if(aggregator_list[i] == AQL_MEDIAN) {
+      PRINTF("DB: The median cannot be computed for groups\n");
+      return DB_TYPE_ERROR;
+    }
+  }
+
+  record_length = 1 + keys + count;
+  if(count > sizeof(aggregators) || record_length > sizeof(record) / sizeof(long)) {
+    return DB_LIMIT_ERROR;
+  }
+
+  key_count = keys;
+  aggregator_count = count;
+  memcpy(aggregators, aggregator_list, count);
+
+  capacity = (sizeof(table) / sizeof(long)) / record_length;
+  if(capacity > MAX_SLOTS) {
+    capacity = MAX_SLOTS;
+  }
+  /* Keep a quarter of the slots empty to bound the probe lengths. */
+  limit = capacity - capacity / 4;
+  if(limit == 0) {
+    return DB_LIMIT_ERROR;
+  }
+
+  file_size = size_hint * record_length * sizeof(long);
+  if(file_size == 0) {
+    file_size = 1;
+  }
+
+  memset(table, 0, sizeof(table));
+  slots = 0;
+  phase = PHASE_BUILD;
+
+  PRINTF("DB: Grouping with %u slots of %u bytes\n",
+         capacity, record_length * (unsigned)sizeof(long));
+
+  return DB_OK;
+}
+/*---------------------------------------------------------------------------*/
+db_result_t
+group_add(const long *keys, const long *values)
+{
+  long *values_ptr;
+  unsigned i;
+
+  record[0] = 1;
+  memcpy(record + 1, keys, key_count * sizeof(long));
+
+  values_ptr = record + 1 + key_count;
+  for(i = 0; i < aggregator_count; i++) {
+    values_ptr[i] = aggregators[i] == AQL_COUNT ? 1 : values[i];
+  }
+
+  if(insert(record) == DB_OK) {
+    return DB_OK;
+  }
+
+  PRINTF("DB: Spilling %u groups\n", slots);
+  if(DB_ERROR(spill_table())) {
+    return DB_STORAGE_ERROR;
+  }
+  return insert(record);
+}
+/*---------------------------------------------------------------------------*/
+db_result_t
+group_finish(void)
+{
+  if(records[FILE_OUT] > 0) {
+    /* Merge the groups in the table with their spilled records. */
+    if(DB_ERROR(spill_table())) {
+      return DB_STORAGE_ERROR;
+    }
+  }
+  slot = 0;
+  phase = PHASE_EMIT;
+  return DB_OK;
+}
+/*---------------------------------------------------------------------------*/
+db_result_t
+group_next(long *keys, long *results)
+{
+  switch(phase) {
+  case PHASE_EMIT:
+    return emit(keys, results);
+  case PHASE_MERGE:
+    return merge_spilled();
+  default:
+    return DB_FINISHED;
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+group_release(void)
+{
+  close_file(FILE_IN);
+  close_file(FILE_OUT);
+  phase = PHASE_BUILD;
+}
+/*---------------------------------------------------------------------------*/
+#endif /* DB_FEATURE_GROUP */
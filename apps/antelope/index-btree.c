@@ -0,0 +1,754 @@
+/*
+ * Copyright (c) 2015, EasyRF.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *     A log-structured B+-tree index for flash memory.
+ *
+ *     The nodes of the tree are stored in fixed-size slots of a single
+ *     file. A slot starts with the entries of the node in sorted order,
+ *     followed by room for a log of updates: new entries in a leaf, and
+ *     new or changed child pointers in an inner node. Updates are
+ *     appended to the log of a node until the slot is full. The node is
+ *     then written in sorted order to a new slot at the end of the file,
+ *     or split into two new slots, and the parent is updated in the same
+ *     way. Hence, written bytes are never overwritten, which suits the
+ *     append semantics of Coffee. When the keys are inserted in
+ *     increasing order, a full node is left as it is, and the tree grows
+ *     by adding a node to its right.
+ *
+ *     Entries are ordered by the key and the tuple ID, so that duplicate
+ *     keys can span several leaves. Leaves are not linked to each other;
+ *     range iterations instead keep the path from the root to the leaf.
+ *     The root is the last node written at the top level of the tree,
+ *     and each node records the height of the tree when it was written.
+ *     Recently used nodes are kept in an LRU cache, in which the log of
+ *     a node has already been merged with its sorted entries.
+ */
+
+#include <limits.h>
+#include <string.h>
+
+#include "cfs/cfs.h"
+#include "lib/memb.h"
+
+#include "db-options.h"
+#include "index.h"
+#include "result.h"
+#include "storage.h"
+
+#define DEBUG DEBUG_NONE
+#include "net/ip/uip-debug.h"
+
+#if DB_FEATURE_BTREE
+
+#define NODE_SIZE               DB_BTREE_NODE_SIZE
+#define NODE_HEADER_SIZE        4
+#define NODE_MAGIC              0xb7
+#define MAX_DEPTH               8
+
+#define LEAF_RECORD_SIZE        8
+#define INNER_RECORD_SIZE       12
+#define LEAF_CAPACITY           ((NODE_SIZE - NODE_HEADER_SIZE) / LEAF_RECORD_SIZE)
+#define INNER_CAPACITY          ((NODE_SIZE - NODE_HEADER_SIZE) / INNER_RECORD_SIZE)
+
+#define RECORD_SIZE(level)      ((level) == 0 ? LEAF_RECORD_SIZE : INNER_RECORD_SIZE)
+#define CAPACITY(level)         ((level) == 0 ? LEAF_CAPACITY : INNER_CAPACITY)
+/* Leave a third of a rewritten node for its log. */
+#define SPLIT_LIMIT(level)      (CAPACITY(level) * 2 / 3)
+
+#define NO_NODE                 ((uint32_t)-1)
+
+#if INNER_CAPACITY < 6 || LEAF_CAPACITY > 255
+#error "DB_BTREE_NODE_SIZE is out of range."
+#endif
+
+typedef int32_t btree_key_t;
+
+#define KEY_MIN                 INT32_MIN
+#define KEY_MAX                 INT32_MAX
+
+struct btree_entry {
+  btree_key_t key;
+  tuple_id_t tuple_id;
+  /* The slot of the child node, in inner nodes only. */
+  uint32_t child;
+};
+
+struct node_header {
+  uint8_t magic;
+  uint8_t level;
+  uint8_t height;
+  uint8_t count;
+};
+
+struct btree {
+  db_storage_id_t storage;
+  uint32_t root;
+  uint32_t next_slot;
+  uint8_t height;
+};
+typedef struct btree btree_t;
+
+struct node_cache {
+  btree_t *tree;
+  uint32_t slot;
+  uint16_t last_used;
+  uint8_t level;
+  /* The number of entries in the node. */
+  uint8_t count;
+  /* The number of records stored in the slot of the node. */
+  uint8_t used;
+  struct btree_entry entries[LEAF_CAPACITY];
+};
+
+/* The slots of the nodes on a path from the root to a leaf, and
+   the position of the path in each inner node. */
+struct btree_path {
+  uint32_t slots[MAX_DEPTH];
+  uint8_t positions[MAX_DEPTH];
+};
+
+static struct node_cache node_cache[DB_BTREE_CACHE_LIMIT];
+static uint16_t cache_clock;
+static uint8_t node_buf[NODE_SIZE];
+static struct btree_entry scratch[LEAF_CAPACITY + 2];
+static struct btree_path insert_path;
+
+MEMB(trees, btree_t, DB_BTREE_INDEX_LIMIT);
+
+static db_result_t create(index_t *);
+static db_result_t destroy(index_t *);
+static db_result_t load(index_t *);
+static db_result_t release(index_t *);
+static db_result_t insert(index_t *, attribute_value_t *, tuple_id_t);
+static db_result_t delete(index_t *, attribute_value_t *);
+static tuple_id_t get_next(index_iterator_t *);
+
+index_api_t index_btree = {
+  INDEX_BTREE,
+  INDEX_API_EXTERNAL | INDEX_API_RANGE_QUERIES | INDEX_API_ORDERED,
+  create,
+  destroy,
+  load,
+  release,
+  insert,
+  delete,
+  get_next
+};
+
+static int
+compare(const struct btree_entry *entry, btree_key_t key, tuple_id_t tuple_id)
+{
+  if(entry->key != key) {
+    return entry->key < key ? -1 : 1;
+  }
+  if(entry->tuple_id != tuple_id) {
+    return entry->tuple_id < tuple_id ? -1 : 1;
+  }
+  return 0;
+}
+
+/* Finds the first entry that is not less than (key, tuple_id). */
+static int
+lower_bound(const struct btree_entry *entries, int count,
+            btree_key_t key, tuple_id_t tuple_id)
+{
+  int low;
+  int high;
+  int mid;
+
+  for(low = 0, high = count; low < high;) {
+    mid = low + (high - low) / 2;
+    if(compare(&entries[mid], key, tuple_id) < 0) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return low;
+}
+
+/* Adds an entry to a sorted array of entries. An entry with the same
+   key and tuple ID is replaced, which updates a child pointer in an
+   inner node. */
+static int
+add_entry(struct btree_entry *entries, int count,
+          const struct btree_entry *entry)
+{
+  int i;
+
+  i = lower_bound(entries, count, entry->key, entry->tuple_id);
+  if(i < count && compare(&entries[i], entry->key, entry->tuple_id) == 0) {
+    entries[i].child = entry->child;
+    return count;
+  }
+
+  memmove(&entries[i + 1], &entries[i], (count - i) * sizeof(entries[0]));
+  entries[i] = *entry;
+  return count + 1;
+}
+
+/*
+ * Records are stored with the tuple ID plus one in leaves, and the
+ * child slot plus one in inner nodes, so that an unwritten record
+ * reads as zero.
+ */
+static void
+encode_record(uint8_t level, uint8_t *ptr, const struct btree_entry *entry)
+{
+  uint32_t word;
+
+  memcpy(ptr, &entry->key, 4);
+  if(level == 0) {
+    word = entry->tuple_id + 1;
+    memcpy(ptr + 4, &word, 4);
+  } else {
+    memcpy(ptr + 4, &entry->tuple_id, 4);
+    word = entry->child + 1;
+    memcpy(ptr + 8, &word, 4);
+  }
+}
+
+static int
+decode_record(uint8_t level, const uint8_t *ptr, struct btree_entry *entry)
+{
+  uint32_t word;
+
+  memcpy(&entry->key, ptr, 4);
+  if(level == 0) {
+    memcpy(&word, ptr + 4, 4);
+    entry->tuple_id = word - 1;
+    entry->child = 0;
+  } else {
+    memcpy(&entry->tuple_id, ptr + 4, 4);
+    memcpy(&word, ptr + 8, 4);
+    entry->child = word - 1;
+  }
+  return word != 0;
+}
+
+static void
+node_forget(btree_t *tree, uint32_t slot)
+{
+  int i;
+
+  for(i = 0; i < DB_BTREE_CACHE_LIMIT; i++) {
+    if(node_cache[i].tree == tree &&
+       (node_cache[i].slot == slot || slot == NO_NODE)) {
+      node_cache[i].tree = NULL;
+    }
+  }
+}
+
+static struct node_cache *
+node_get(btree_t *tree, uint32_t slot)
+{
+  struct node_cache *node;
+  struct node_cache *victim;
+  struct node_header header;
+  struct btree_entry entry;
+  uint8_t *ptr;
+  int i;
+
+  victim = NULL;
+  for(i = 0; i < DB_BTREE_CACHE_LIMIT; i++) {
+    node = &node_cache[i];
+    if(node->tree == tree && node->slot == slot) {
+      node->last_used = ++cache_clock;
+      return node;
+    }
+    if(victim == NULL ||
+       (victim->tree != NULL &&
+        (node->tree == NULL ||
+         (uint16_t)(cache_clock - node->last_used) >
+         (uint16_t)(cache_clock - victim->last_used)))) {
+      /* Replace a free node, or else the least recently used node. */
+      victim = node;
+    }
+  }
+
+  node = victim;
+  node->tree = NULL;
+  if(DB_ERROR(storage_read(tree->storage, node_buf,
+                           (unsigned long)slot * NODE_SIZE, NODE_SIZE))) {
+    PRINTF("DB: Failed to read B+-tree node %lu\n", (unsigned long)slot);
+    return NULL;
+  }
+
+  memcpy(&header, node_buf, sizeof(header));
+  if(header.magic != NODE_MAGIC || header.count > CAPACITY(header.level)) {
+    PRINTF("DB: Invalid B+-tree node %lu\n", (unsigned long)slot);
+    return NULL;
+  }
+
+  /* Merge the log of the node into its sorted entries. */
+  node->level = header.level;
+  ptr = node_buf + NODE_HEADER_SIZE;
+  for(i = 0; i < header.count; i++) {
+    decode_record(header.level, ptr, &node->entries[i]);
+    ptr += RECORD_SIZE(header.level);
+  }
+  node->count = header.count;
+  for(; i < CAPACITY(header.level); i++) {
+    if(!decode_record(header.level, ptr, &entry)) {
+      break;
+    }
+    node->count = add_entry(node->entries, node->count, &entry);
+    ptr += RECORD_SIZE(header.level);
+  }
+  node->used = i;
+
+  node->tree = tree;
+  node->slot = slot;
+  node->last_used = ++cache_clock;
+  return node;
+}
+
+/* Writes a node with sorted entries to a new slot at the end of the file. */
+static uint32_t
+node_write(btree_t *tree, uint8_t level,
+           const struct btree_entry *entries, int count)
+{
+  struct node_header header;
+  uint8_t *ptr;
+  int i;
+
+  header.magic = NODE_MAGIC;
+  header.level = level;
+  header.height = tree->height;
+  header.count = count;
+
+  memset(node_buf, 0, sizeof(node_buf));
+  memcpy(node_buf, &header, sizeof(header));
+  ptr = node_buf + NODE_HEADER_SIZE;
+  for(i = 0; i < count; i++) {
+    encode_record(level, ptr, &entries[i]);
+    ptr += RECORD_SIZE(level);
+  }
+
+  if(DB_ERROR(storage_write(tree->storage, node_buf,
+                            (unsigned long)tree->next_slot * NODE_SIZE,
+                            NODE_SIZE))) {
+    PRINTF("DB: Failed to write B+-tree node %lu\n",
+           (unsigned long)tree->next_slot);
+    return NO_NODE;
+  }
+
+  return tree->next_slot++;
+}
+
+/* Appends a record to the log of a node. */
+static int
+node_append(btree_t *tree, struct node_cache *node,
+            const struct btree_entry *entry)
+{
+  uint8_t record[INNER_RECORD_SIZE];
+
+  encode_record(node->level, record, entry);
+  if(DB_ERROR(storage_write(tree->storage, record,
+                            (unsigned long)node->slot * NODE_SIZE +
+                            NODE_HEADER_SIZE +
+                            node->used * RECORD_SIZE(node->level),
+                            RECORD_SIZE(node->level)))) {
+    return 0;
+  }
+
+  node->used++;
+  node->count = add_entry(node->entries, node->count, entry);
+  return 1;
+}
+
+/* Finds the leaf in which (key, tuple_id) belongs, and the path to it. */
+static struct node_cache *
+descend(btree_t *tree, btree_key_t key, tuple_id_t tuple_id,
+        struct btree_path *path)
+{
+  struct node_cache *node;
+  uint32_t slot;
+  int level;
+  int i;
+
+  slot = tree->root;
+  for(level = tree->height - 1;; level--) {
+    node = node_get(tree, slot);
+    if(node == NULL || node->level != level) {
+      return NULL;
+    }
+    path->slots[level] = slot;
+    if(level == 0) {
+      return node;
+    }
+
+    /* Take the last child whose lowest entry is not greater than
+       (key, tuple_id). */
+    i = lower_bound(node->entries, node->count, key, tuple_id);
+    if(i == node->count || compare(&node->entries[i], key, tuple_id) > 0) {
+      i = i > 0 ? i - 1 : 0;
+    }
+    path->positions[level] = i;
+    slot = node->entries[i].child;
+  }
+}
+
+/* Moves a path to the first leaf after the current one. */
+static struct node_cache *
+next_leaf(btree_t *tree, struct btree_path *path)
+{
+  struct node_cache *node;
+  uint32_t slot;
+  int level;
+
+  for(level = 1; level < tree->height; level++) {
+    node = node_get(tree, path->slots[level]);
+    if(node == NULL) {
+      return NULL;
+    }
+    if(path->positions[level] + 1 < node->count) {
+      slot = node->entries[++path->positions[level]].child;
+      for(level--;; level--) {
+        node = node_get(tree, slot);
+        if(node == NULL) {
+          return NULL;
+        }
+        path->slots[level] = slot;
+        if(level == 0) {
+          return node;
+        }
+        path->positions[level] = 0;
+        slot = node->entries[0].child;
+      }
+    }
+  }
+  return NULL;
+}
+
+/* Applies records to the node at the given level of the insert path. */
+static int
+update(btree_t *tree, uint8_t level, const struct btree_entry *records, int n)
+{
+  struct node_cache *node;
+  struct btree_entry up[2];
+  struct btree_entry right_entry;
+  uint32_t left;
+  uint32_t right;
+  int count;
+  int i;
+
+  node = node_get(tree, insert_path.slots[level]);
+  if(node == NULL) {
+    return 0;
+  }
+
+  if(node->used + n <= CAPACITY(level)) {
+    for(i = 0; i < n; i++) {
+      if(!node_append(tree, node, &records[i])) {
+        return 0;
+      }
+    }
+    return 1;
+  }
+
+  count = node->count;
+  right = NO_NODE;
+  if(n == 1 && count == CAPACITY(level) &&
+     compare(&node->entries[count - 1],
+             records[0].key, records[0].tuple_id) < 0) {
+    /* The keys are increasing: leave the full node as it is, and put
+       the new entry in a new node to its right. */
+    left = insert_path.slots[level];
+    right_entry = records[0];
+    right = node_write(tree, level, records, 1);
+    if(right == NO_NODE) {
+      return 0;
+    }
+  } else {
+    memcpy(scratch, node->entries, count * sizeof(scratch[0]));
+    for(i = 0; i < n; i++) {
+      count = add_entry(scratch, count, &records[i]);
+    }
+    node_forget(tree, insert_path.slots[level]);
+
+    if(count > SPLIT_LIMIT(level)) {
+      left = node_write(tree, level, scratch, count / 2);
+      right_entry = scratch[count / 2];
+      right = node_write(tree, level, &scratch[count / 2], count - count / 2);
+      if(right == NO_NODE) {
+        return 0;
+      }
+    } else {
+      left = node_write(tree, level, scratch, count);
+    }
+    if(left == NO_NODE) {
+      return 0;
+    }
+  }
+
+  if(level == tree->height - 1) {
+    if(right == NO_NODE) {
+      tree->root = left;
+      return 1;
+    }
+
+    /* Grow the tree with a new root. */
+    if(tree->height == MAX_DEPTH) {
+      PRINTF("DB: The B+-tree is too deep\n");
+      return 0;
+    }
+    up[0].key = KEY_MIN;
+    up[0].tuple_id = 0;
+    up[0].child = left;
+    up[1] = right_entry;
+    up[1].child = right;
+    tree->height++;
+    tree->root = node_write(tree, level + 1, up, 2);
+    return tree->root != NO_NODE;
+  }
+
+  /* Point the parent to the new nodes. */
+  n = 0;
+  if(left != insert_path.slots[level]) {
+    node = node_get(tree, insert_path.slots[level + 1]);
+    if(node == NULL) {
+      return 0;
+    }
+    up[n] = node->entries[insert_path.positions[level + 1]];
+    up[n++].child = left;
+  }
+  if(right != NO_NODE) {
+    up[n] = right_entry;
+    up[n++].child = right;
+  }
+  return update(tree, level + 1, up, n);
+}
+
+static db_result_t
+create(index_t *index)
+{
+  char *filename;
+  btree_t *tree;
+
+  filename = storage_generate_file("btree", DB_BTREE_FILE_SIZE);
+  if(filename == NULL) {
+    PRINTF("DB: Failed to generate a B+-tree file\n");
+    return DB_INDEX_ERROR;
+  }
+  memcpy(index->descriptor_file, filename, sizeof(index->descriptor_file));
+
+  index->opaque_data = tree = memb_alloc(&trees);
+  if(tree == NULL) {
+    PRINTF("DB: Failed to allocate a B+-tree\n");
+    cfs_remove(index->descriptor_file);
+    index->descriptor_file[0] = '\0';
+    return DB_ALLOCATION_ERROR;
+  }
+
+  tree->next_slot = 0;
+  tree->height = 1;
+  tree->storage = storage_open(index->descriptor_file);
+  if(tree->storage < 0 ||
+     (tree->root = node_write(tree, 0, NULL, 0)) == NO_NODE) {
+    storage_close(tree->storage);
+    memb_free(&trees, tree);
+    cfs_remove(index->descriptor_file);
+    index->descriptor_file[0] = '\0';
+    return DB_STORAGE_ERROR;
+  }
+
+  PRINTF("DB: Created a B+-tree index in %s\n", index->descriptor_file);
+  return DB_OK;
+}
+
+static db_result_t
+destroy(index_t *index)
+{
+  char filename[DB_MAX_FILENAME_LENGTH];
+
+  memcpy(filename, index->descriptor_file, sizeof(filename));
+  release(index);
+  cfs_remove(filename);
+  return DB_OK;
+}
+
+static db_result_t
+load(index_t *index)
+{
+  btree_t *tree;
+  struct node_header header;
+  cfs_offset_t end;
+  uint32_t slot;
+
+  index->opaque_data = tree = memb_alloc(&trees);
+  if(tree == NULL) {
+    PRINTF("DB: Failed to allocate a B+-tree\n");
+    return DB_ALLOCATION_ERROR;
+  }
+
+  tree->storage = storage_open(index->descriptor_file);
+  if(tree->storage < 0) {
+    memb_free(&trees, tree);
+    return DB_STORAGE_ERROR;
+  }
+
+  /* The unused log at the end of the last node may not be counted
+     in the file size. */
+  end = cfs_seek(tree->storage, 0, CFS_SEEK_END);
+  tree->next_slot = end <= 0 ? 0 : (end + NODE_SIZE - 1) / NODE_SIZE;
+
+  /* The last node written has the current height of the tree, and
+     the root is the last node written at the top level. */
+  tree->height = 0;
+  for(slot = tree->next_slot; slot-- > 0;) {
+    if(DB_ERROR(storage_read(tree->storage, &header,
+                             (unsigned long)slot * NODE_SIZE,
+                             sizeof(header))) ||
+       header.magic != NODE_MAGIC) {
+      break;
+    }
+    if(tree->height == 0) {
+      tree->height = header.height;
+    }
+    if(header.level == tree->height - 1) {
+      tree->root = slot;
+      PRINTF("DB: Loaded a B+-tree of height %u with root node %lu\n",
+             (unsigned)tree->height, (unsigned long)slot);
+      return DB_OK;
+    }
+  }
+
+  PRINTF("DB: Failed to find the root of the B+-tree in %s\n",
+         index->descriptor_file);
+  storage_close(tree->storage);
+  memb_free(&trees, tree);
+  return DB_STORAGE_ERROR;
+}
+
+static db_result_t
+release(index_t *index)
+{
+  btree_t *tree;
+
+  tree = index->opaque_data;
+  node_forget(tree, NO_NODE);
+  storage_close(tree->storage);
+  memb_free(&trees, tree);
+  return DB_OK;
+}
+
+static db_result_t
+insert(index_t *index, attribute_value_t *value, tuple_id_t tuple_id)
+{
+  btree_t *tree;
+  struct btree_entry entry;
+
+  tree = index->opaque_data;
+
+  entry.key = db_value_to_long(value);
+  entry.tuple_id = tuple_id;
+  entry.child = 0;
+
+  if(descend(tree, entry.key, tuple_id, &insert_path) == NULL ||
+     !update(tree, 0, &entry, 1)) {
+    PRINTF("DB: Failed to insert key %ld into a B+-tree index\n",
+           (long)entry.key);
+    return DB_INDEX_ERROR;
+  }
+  return DB_OK;
+}
+
+static db_result_t
+delete(index_t *index, attribute_value_t *value)
+{
+  return DB_INDEX_ERROR;
+}
+
+/* Limits a bound of a search range to the range of the keys. */
+static btree_key_t
+range_bound(attribute_value_t *value)
+{
+  long l;
+
+  l = db_value_to_long(value);
+  return l < KEY_MIN ? KEY_MIN : l > KEY_MAX ? KEY_MAX : l;
+}
+
+static tuple_id_t
+get_next(index_iterator_t *iterator)
+{
+  static index_iterator_t *current_iterator;
+  static struct btree_path path;
+  btree_t *tree;
+  struct node_cache *leaf;
+  struct btree_entry *entry;
+  btree_key_t min;
+  btree_key_t max;
+
+  tree = (btree_t *)iterator->index->opaque_data;
+  min = range_bound(&iterator->min_value);
+  max = range_bound(&iterator->max_value);
+
+  if(current_iterator != iterator || iterator->next_item_no == 0) {
+    /* Find the first entry of the range for a new iteration. */
+    current_iterator = iterator;
+    leaf = descend(tree, min, 0, &path);
+    if(leaf == NULL) {
+      current_iterator = NULL;
+      return INVALID_TUPLE;
+    }
+    path.positions[0] = lower_bound(leaf->entries, leaf->count, min, 0);
+  } else {
+    leaf = node_get(tree, path.slots[0]);
+  }
+
+  while(leaf != NULL && path.positions[0] == leaf->count) {
+    leaf = next_leaf(tree, &path);
+    if(leaf != NULL) {
+      /* Keep the path at the end of the last leaf once the
+         iteration is over, so that it stays over. */
+      path.positions[0] = 0;
+    }
+  }
+  if(leaf == NULL) {
+    return INVALID_TUPLE;
+  }
+
+  entry = &leaf->entries[path.positions[0]++];
+  if(entry->key > max) {
+    return INVALID_TUPLE;
+  }
+
+  iterator->next_item_no++;
+  PRINTF("DB: Found key %ld with tuple %lu in the B+-tree\n",
+         (long)entry->key, (unsigned long)entry->tuple_id);
+  return entry->tuple_id;
+}
+#endif /* DB_FEATURE_BTREE */
@@ -72,7 +72,8 @@ static tuple_id_t get_next(index_iterator_t *);
  */
 index_api_t index_inline = {
   INDEX_INLINE,
-  INDEX_API_EXTERNAL | INDEX_API_COMPLETE | INDEX_API_RANGE_QUERIES,
+  INDEX_API_EXTERNAL | INDEX_API_COMPLETE | INDEX_API_RANGE_QUERIES |
+    INDEX_API_ORDERED,
   null_op,
   null_op,
   null_op,
@@ -100,10 +101,12 @@ get_value(tuple_id_t *index, relation_t *rel, attribute_t *attr)
   return &value;
 }
 
-static tuple_id_t
-binary_search(index_iterator_t *index_iterator,
-              attribute_value_t *target_value,
-              int exact_match)
+/* Find the position of the first row whose value is greater than the
+   target value, or greater than or equal to it unless after_equal is
+   set. Rows with equal values may be in any order among themselves. */
+static db_result_t
+binary_search(index_iterator_t *index_iterator, long target,
+              int after_equal, tuple_id_t *position)
 {
   relation_t *rel;
   attribute_t *attr;
@@ -111,72 +114,64 @@ binary_search(index_iterator_t *index_iterator,
   tuple_id_t min;
   tuple_id_t max;
   tuple_id_t center;
+  long value;
 
   rel = index_iterator->index->rel;
   attr = index_iterator->index->attr;
 
   max = relation_cardinality(rel);
   if(max == INVALID_TUPLE) {
-    return INVALID_TUPLE;
+    return DB_STORAGE_ERROR;
   }
-  max--;
   min = 0;
 
-  do {
+  while(min < max) {
     center = min + ((max - min) / 2);
 
     cmp_value = get_value(&center, rel, attr);
     if(cmp_value == NULL) {
       PRINTF("DB: Failed to get the center value, index = %ld\n",
 	(long)center);
-      return INVALID_TUPLE;
+      return DB_STORAGE_ERROR;
     }
 
-    if(db_value_to_long(target_value) > db_value_to_long(cmp_value)) {
+    value = db_value_to_long(cmp_value);
+    if(value < target || (after_equal && value == target)) {
       min = center + 1;
     } else {
-      max = center - 1;
+      max = center;
     }
-  } while(min <= max &&
-          db_value_to_long(target_value) != db_value_to_long(cmp_value));
-
-  if(exact_match &&
-     db_value_to_long(target_value) != db_value_to_long(cmp_value)) {
-    PRINTF("DB: Could not find value %ld in the inline index\n",
-           db_value_to_long(target_value));
-    return INVALID_TUPLE;
   }
 
-  return center;
+  *position = min;
+  return DB_OK;
 }
 
 static tuple_id_t
 range_search(index_iterator_t *index_iterator,
              tuple_id_t *start, tuple_id_t *end)
 {
-  attribute_value_t *low_target;
-  attribute_value_t *high_target;
-  int exact_match;
+  long low_target;
+  long high_target;
 
-  low_target = &index_iterator->min_value;
-  high_target = &index_iterator->max_value;
+  low_target = db_value_to_long(&index_iterator->min_value);
+  high_target = db_value_to_long(&index_iterator->max_value);
 
   PRINTF("DB: Search index for value range (%ld, %ld)\n",
-    db_value_to_long(low_target), db_value_to_long(high_target));
-
-  exact_match = db_value_to_long(low_target) == db_value_to_long(high_target);
+    low_target, high_target);
 
-  /* Optimize later so that the other search uses the result
-     from the first one. */
-  *start = binary_search(index_iterator, low_target, exact_match);
-  if(*start == INVALID_TUPLE) {
+  if(DB_ERROR(binary_search(index_iterator, low_target, 0, start)) ||
+     DB_ERROR(binary_search(index_iterator, high_target, 1, end))) {
     return DB_INDEX_ERROR;
   }
 
-  *end = binary_search(index_iterator, high_target, exact_match);
-  if(*end == INVALID_TUPLE) {
+  if(*start >= *end) {
+    PRINTF("DB: Could not find the value range in the inline index\n");
     return DB_INDEX_ERROR;
   }
+
+  /* The end is the last row within the range. */
+  (*end)--;
   return DB_OK;
 }
 
@@ -49,7 +49,11 @@
 #include "storage.h"
 
 static index_api_t *index_components[] = {&index_inline,
-	&index_maxheap};
+	&index_maxheap,
+#if DB_FEATURE_BTREE
+	&index_btree,
+#endif /* DB_FEATURE_BTREE */
+};
 
 LIST(indices);
 MEMB(index_memb, index_t, DB_INDEX_POOL_SIZE);
@@ -301,6 +305,39 @@ index_get_iterator(index_iterator_t *iterator, index_t *index,
   return DB_OK;
 }
 
+/*
+ * A prefix iteration finds all values whose most significant bits
+ * equal those of the given value, which is the range of values between
+ * the prefix followed by zeroes and the prefix followed by ones.
+ */
+db_result_t
+index_get_prefix_iterator(index_iterator_t *iterator, index_t *index,
+                          attribute_value_t *value, unsigned prefix_bits)
+{
+  attribute_value_t min_value;
+  attribute_value_t max_value;
+  uint32_t mask;
+  uint32_t prefix;
+
+  if(prefix_bits > 32) {
+    return DB_INDEX_ERROR;
+  }
+
+  min_value.domain = max_value.domain = DOMAIN_LONG;
+  if(prefix_bits == 0) {
+    /* All values have the empty prefix. */
+    VALUE_LONG(&min_value) = INT32_MIN;
+    VALUE_LONG(&max_value) = INT32_MAX;
+  } else {
+    prefix = (uint32_t)db_value_to_long(value);
+    mask = ((uint32_t)1 << (32 - prefix_bits)) - 1;
+    VALUE_LONG(&min_value) = (int32_t)(prefix & ~mask);
+    VALUE_LONG(&max_value) = (int32_t)(prefix | mask);
+  }
+
+  return index_get_iterator(iterator, index, &min_value, &max_value);
+}
+
 tuple_id_t
 index_get_next(index_iterator_t *iterator)
 {
@@ -0,0 +1,1021 @@
+/*
+ * Copyright (c) 2015, EasyRF.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *	Hash join and sort-merge join operators for Antelope. Both use a
+ *	fixed amount of memory and keep intermediate rows in CFS files
+ *	when the relations do not fit in memory.
+ */
+
+#include <limits.h>
+#include <string.h>
+
+#include "cfs/cfs.h"
+
+#include "db-options.h"
+#include "index.h"
+#include "join.h"
+#include "storage.h"
+
+#define DEBUG DEBUG_NONE
+#include "net/ip/uip-debug.h"
+
+#if DB_FEATURE_JOIN
+
+/*
+ * The hash join keeps the rows of the smaller relation in a hash table
+ * and probes it with each row of the other relation. If the smaller
+ * relation does not fit in the join buffer, the rows of both relations
+ * are first spilled into DB_JOIN_PARTITIONS partitions by the hash of
+ * the join attribute, and each partition is then joined separately.
+ * A partition that is still too large is joined in chunks.
+ *
+ * The sort-merge join sorts each relation into a file by the join
+ * attribute, using sorted runs of the size of the join buffer that are
+ * merged pairwise, and then merges the two sorted files.
+ */
+
+/* The number of input rows that join_next() processes before
+   yielding if no result row has been found. */
+#define ROWS_PER_STEP		32
+
+/* Spilled rows are stored in blocks, each of which holds rows of a
+   single partition and the number of the previous block of that
+   partition. The blocks of all partitions are kept in the same file. */
+#define BLOCK_SIZE		(DB_JOIN_BUFFER_SIZE / DB_JOIN_PARTITIONS)
+#define BLOCK_HEADER_SIZE	3
+#define NO_BLOCK		0xffff
+
+#define NO_SLOT			0xff
+#define MAX_SLOTS		0xff
+
+enum join_phase {
+  PHASE_DONE,
+  PHASE_PARTITION,
+  PHASE_LOAD,
+  PHASE_PROBE,
+  PHASE_SORT_RUNS,
+  PHASE_SORT_MERGE,
+  PHASE_MERGE
+};
+
+struct join_side {
+  relation_t *rel;
+  unsigned char *row;
+  unsigned row_length;
+  tuple_id_t cardinality;
+  domain_t key_domain;
+  uint8_t key_offset;
+  uint8_t key_size;
+};
+
+/* The rows of a hash join partition, read from a chain of spilled
+   blocks or directly from the relation. */
+struct row_source {
+  uint16_t block;
+  uint8_t row;
+  tuple_id_t tuple_id;
+};
+
+/* Buffered access to the rows of a region in a sort file. */
+struct row_reader {
+  db_storage_id_t fd;
+  unsigned long base;
+  tuple_id_t rows;
+  unsigned row_length;
+  unsigned char *buf;
+  unsigned capacity;
+  tuple_id_t first;
+  unsigned count;
+};
+
+static uint8_t phase;
+static struct join_side sides[2];
+static unsigned char join_buffer[DB_JOIN_BUFFER_SIZE];
+static unsigned char *io_buffer;
+static unsigned io_size;
+static struct storage_scan scan;
+static tuple_id_t scan_id;
+
+static db_storage_id_t files[2] = {-1, -1};
+static char filenames[2][DB_MAX_FILENAME_LENGTH];
+
+/* Hash join state. */
+static uint8_t build;
+static uint8_t spill;
+static uint8_t scan_side;
+static uint8_t partition;
+static uint8_t last_chunk;
+static uint8_t capacity;
+static uint8_t slots;
+static uint8_t match;
+static uint8_t buckets[DB_JOIN_HASH_BUCKETS];
+static uint8_t fill[DB_JOIN_PARTITIONS];
+static uint16_t chains[2][DB_JOIN_PARTITIONS];
+static uint16_t block_count;
+static uint16_t io_block;
+static struct row_source build_source;
+static struct row_source probe_source;
+
+/* Sort-merge join state. */
+static uint8_t sort_side;
+static uint8_t regions[2];
+static tuple_id_t rows[2];
+static tuple_id_t run_length;
+static tuple_id_t run_pos[2];
+static tuple_id_t run_end[2];
+static tuple_id_t out_pos;
+static struct row_reader readers[2];
+static tuple_id_t group_start;
+static tuple_id_t group_pos;
+static uint8_t in_group;
+/*---------------------------------------------------------------------------*/
+static int
+is_numeric(domain_t domain)
+{
+  return domain == DOMAIN_INT || domain == DOMAIN_LONG;
+}
+/*---------------------------------------------------------------------------*/
+static long
+key_value(struct join_side *side, const unsigned char *row)
+{
+  const unsigned char *ptr;
+
+  ptr = row + side->key_offset;
+  if(side->key_domain == DOMAIN_INT) {
+    return (int16_t)((ptr[0] << 8) | ptr[1]);
+  }
+  return (int32_t)((uint32_t)ptr[0] << 24 | (uint32_t)ptr[1] << 16 |
+                   (uint32_t)ptr[2] << 8 | ptr[3]);
+}
+/*---------------------------------------------------------------------------*/
+static int
+key_compare(struct join_side *a, const unsigned char *row_a,
+            struct join_side *b, const unsigned char *row_b)
+{
+  long value_a;
+  long value_b;
+
+  if(a->key_domain == DOMAIN_STRING) {
+    return strncmp((const char *)row_a + a->key_offset,
+                   (const char *)row_b + b->key_offset,
+                   a->key_size < b->key_size ? a->key_size : b->key_size);
+  }
+
+  value_a = key_value(a, row_a);
+  value_b = key_value(b, row_b);
+  return value_a < value_b ? -1 : value_a > value_b;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned long
+key_hash(struct join_side *side, const unsigned char *row)
+{
+  const unsigned char *ptr;
+  unsigned long hash;
+  unsigned i;
+
+  if(side->key_domain == DOMAIN_STRING) {
+    ptr = row + side->key_offset;
+    for(hash = 0, i = 0; i < side->key_size && ptr[i] != '\0'; i++) {
+      hash = hash * 31 + ptr[i];
+    }
+  } else {
+    hash = (unsigned long)key_value(side, row);
+  }
+
+  hash ^= hash >> 16;
+  hash *= 0x45d9f3bUL;
+  hash ^= hash >> 16;
+  return hash;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned
+rows_per_block(struct join_side *side)
+{
+  return (BLOCK_SIZE - BLOCK_HEADER_SIZE) / side->row_length;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned
+hash_capacity(struct join_side *side)
+{
+  unsigned n;
+
+  n = DB_JOIN_BUFFER_SIZE / (side->row_length + 1);
+  return n > MAX_SLOTS ? MAX_SLOTS : n;
+}
+/*---------------------------------------------------------------------------*/
+static db_result_t
+create_file(int i, unsigned long size)
+{
+  char *filename;
+
+  filename = storage_generate_file("join", size > 0 ? size : 1);
+  if(filename == NULL) {
+    return DB_STORAGE_ERROR;
+  }
+  strncpy(filenames[i], filename, sizeof(filenames[i]) - 1);
+  filenames[i][sizeof(filenames[i]) - 1] = '\0';
+
+  files[i] = storage_open(filenames[i]);
+  if(files[i] < 0) {
+    cfs_remove(filenames[i]);
+    filenames[i][0] = '\0';
+    return DB_STORAGE_ERROR;
+  }
+  return DB_OK;
+}
+/*---------------------------------------------------------------------------*/
+static db_result_t
+finish(void)
+{
+  join_release();
+  return DB_FINISHED;
+}
+/*---------------------------------------------------------------------------*/
+static void
+reset_table(void)
+{
+  memset(buckets, NO_SLOT, sizeof(buckets));
+  slots = 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+start_partition(void)
+{
+  build_source.block = spill ? chains[build][partition] : NO_BLOCK;
+  build_source.row = 0;
+  build_source.tuple_id = 0;
+  reset_table();
+  phase = PHASE_LOAD;
+}
+/*---------------------------------------------------------------------------*/
+static db_result_t
+next_chunk(void)
+{
+  if(!last_chunk) {
+    /* Continue with the next chunk of the same partition. */
+    reset_table();
+    phase = PHASE_LOAD;
+    return DB_OK;
+  }
+
+  if(spill && ++partition < DB_JOIN_PARTITIONS) {
+    start_partition();
+    return DB_OK;
+  }
+
+  return finish();
+}
+/*---------------------------------------------------------------------------*/
+static db_result_t
+source_next(struct row_source *source, struct join_side *side,
+            unsigned char **row)
+{
+  db_result_t result;
+
+  if(!spill) {
+    if(scan.rel != side->rel) {
+      result = storage_scan_init(&scan, side->rel, io_buffer, io_size);
+      if(DB_ERROR(result)) {
+        return result;
+      }
+    }
+    result = storage_scan_get(&scan, source->tuple_id, row);
+    if(result == DB_OK) {
+      source->tuple_id++;
+    }
+    return result;
+  }
+
+  for(;;) {
+    if(source->block == NO_BLOCK) {
+      return DB_FINISHED;
+    }
+
+    if(io_block != source->block) {
+      if(DB_ERROR(storage_read(files[0], io_buffer,
+                               (unsigned long)source->block * BLOCK_SIZE,
+                               BLOCK_SIZE))) {
+        return DB_STORAGE_ERROR;
+      }
+      io_block = source->block;
+    }
+
+    if(source->row < io_buffer[2]) {
+      *row = io_buffer + BLOCK_HEADER_SIZE + source->row * side->row_length;
+      source->row++;
+      return DB_OK;
+    }
+
+    source->block = io_buffer[0] << 8 | io_buffer[1];
+    source->row = 0;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static db_result_t
+flush_block(unsigned p)
+{
+  unsigned char *block;
+
+  if(block_count == NO_BLOCK) {
+    return DB_LIMIT_ERROR;
+  }
+
+  block = join_buffer + p * BLOCK_SIZE;
+  block[0] = chains[scan_side][p] >> 8;
+  block[1] = chains[scan_side][p] & 0xff;
+  block[2] = fill[p];
+  if(DB_ERROR(storage_write(files[0], block,
+                            (unsigned long)block_count * BLOCK_SIZE,
+                            BLOCK_SIZE))) {
+    return DB_STORAGE_ERROR;
+  }
+
+  chains[scan_side][p] = block_count++;
+  fill[p] = 0;
+  return DB_OK;
+}
+/*---------------------------------------------------------------------------*/
+static db_result_t
+partition_rows(void)
+{
+  struct join_side *side;
+  storage_row_t row;
+  db_result_t result;
+  unsigned p;
+  int i;
+
+  side = &sides[scan_side];
+
+  for(i = 0; i < ROWS_PER_STEP; i++) {
+    result = storage_scan_get(&scan, scan_id, &row);
+    if(DB_ERROR(result)) {
+      return result;
+    }
+
+    if(result == DB_FINISHED) {
+      for(p = 0; p < DB_JOIN_PARTITIONS; p++) {
+        if(fill[p] > 0 && DB_ERROR(result = flush_block(p))) {
+          return result;
+        }
+      }
+
+      if(scan_side == build) {
+        /* Continue with the relation to probe with. */
+        scan_side = !build;
+        scan_id = 0;
+        return storage_scan_init(&scan, sides[scan_side].rel,
+                                 io_buffer, io_size);
+      }
+
+      PRINTF("DB: Spilled %u blocks for the hash join\n", block_count);
+      partition = 0;
+      start_partition();
+      return DB_OK;
+    }
+    scan_id++;
+
+    p = (key_hash(side, row) / DB_JOIN_HASH_BUCKETS) % DB_JOIN_PARTITIONS;
+    memcpy(join_buffer + p * BLOCK_SIZE + BLOCK_HEADER_SIZE +
+           fill[p] * side->row_length, row, side->row_length);
+    if(++fill[p] == rows_per_block(side)) {
+      result = flush_block(p);
+      if(DB_ERROR(result)) {
+        return result;
+      }
+    }
+  }
+
+  return DB_OK;
+}
+/*---------------------------------------------------------------------------*/
+static db_result_t
+load_rows(void)
+{
+  struct join_side *side;
+  unsigned char *row;
+  unsigned char *slot;
+  db_result_t result;
+  unsigned bucket;
+  int i;
+
+  side = &sides[build];
+
+  for(i = 0; i < ROWS_PER_STEP; i++) {
+    if(slots == capacity) {
+      last_chunk = 0;
+      break;
+    }
+
+    result = source_next(&build_source, side, &row);
+    if(DB_ERROR(result)) {
+      return result;
+    }
+    if(result == DB_FINISHED) {
+      last_chunk = 1;
+      if(slots == 0) {
+        /* Nothing to probe against in this partition. */
+        return next_chunk();
+      }
+      break;
+    }
+
+    slot = join_buffer + slots * (side->row_length + 1);
+    memcpy(slot + 1, row, side->row_length);
+    bucket = key_hash(side, row) % DB_JOIN_HASH_BUCKETS;
+    slot[0] = buckets[bucket];
+    buckets[bucket] = slots++;
+  }
+
+  if(i == ROWS_PER_STEP) {
+    return DB_OK;
+  }
+
+  probe_source.block = spill ? chains[!build][partition] : NO_BLOCK;
+  probe_source.row = 0;
+  probe_source.tuple_id = 0;
+  match = NO_SLOT;
+  phase = PHASE_PROBE;
+  return DB_OK;
+}
+/*---------------------------------------------------------------------------*/
+static db_result_t
+probe_rows(void)
+{
+  struct join_side *build_side;
+  struct join_side *probe_side;
+  unsigned char *row;
+  unsigned char *slot;
+  db_result_t result;
+  int i;
+
+  build_side = &sides[build];
+  probe_side = &sides[!build];
+
+  for(i = 0; i < ROWS_PER_STEP; i++) {
+    while(match != NO_SLOT) {
+      slot = join_buffer + match * (build_side->row_length + 1);
+      match = slot[0];
+      if(key_compare(build_side, slot + 1, probe_side, probe_side->row) == 0) {
+        memcpy(build_side->row, slot + 1, build_side->row_length);
+        return DB_GOT_ROW;
+      }
+    }
+
+    result = source_next(&probe_source, probe_side, &row);
+    if(DB_ERROR(result)) {
+      return result;
+    }
+    if(result == DB_FINISHED) {
+      return next_chunk();
+    }
+
+    memcpy(probe_side->row, row, probe_side->row_length);
+    match = buckets[key_hash(probe_side, row) % DB_JOIN_HASH_BUCKETS];
+  }
+
+  return DB_OK;
+}
+/*---------------------------------------------------------------------------*/
+static db_result_t
+hash_init(void)
+{
+  unsigned long size;
+  db_result_t result;
+
+  build = sides[0].cardinality < sides[1].cardinality ? 0 : 1;
+  capacity = hash_capacity(&sides[build]);
+  if(capacity == 0) {
+    return DB_LIMIT_ERROR;
+  }
+  spill = sides[build].cardinality > capacity;
+
+  PRINTF("DB: Hash join with the %s relation in memory%s\n",
+         build == 0 ? "left" : "right", spill ? ", spilling to a file" : "");
+
+  if(!spill) {
+    partition = 0;
+    start_partition();
+    return DB_OK;
+  }
+
+  /* The spilled blocks are read back into the I/O buffer. */
+  if(io_size < BLOCK_SIZE) {
+    PRINTF("DB: The I/O buffer cannot hold a block of %u bytes\n",
+           (unsigned)BLOCK_SIZE);
+    return DB_LIMIT_ERROR;
+  }
+
+  if(rows_per_block(&sides[0]) == 0 || rows_per_block(&sides[1]) == 0) {
+    return DB_LIMIT_ERROR;
+  }
+
+  size = ((unsigned long)sides[0].cardinality / rows_per_block(&sides[0]) +
+          (unsigned long)sides[1].cardinality / rows_per_block(&sides[1]) +
+          2 * DB_JOIN_PARTITIONS) * BLOCK_SIZE;
+  result = create_file(0, size);
+  if(DB_ERROR(result)) {
+    return result;
+  }
+
+  memset(chains, 0xff, sizeof(chains));
+  memset(fill, 0, sizeof(fill));
+  block_count = 0;
+  io_block = NO_BLOCK;
+
+  scan_side = build;
+  scan_id = 0;
+  phase = PHASE_PARTITION;
+  return storage_scan_init(&scan, sides[build].rel, io_buffer, io_size);
+}
+/*---------------------------------------------------------------------------*/
+static void
+reader_init(struct row_reader *reader, int side, unsigned char *buf,
+            unsigned size)
+{
+  reader->fd = files[side];
+  reader->row_length = sides[side].row_length;
+  reader->rows = rows[side];
+  reader->base = (unsigned long)regions[side] * rows[side] *
+                 sides[side].row_length;
+  reader->buf = buf;
+  reader->capacity = size / sides[side].row_length;
+  reader->first = 0;
+  reader->count = 0;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned char *
+reader_get(struct row_reader *reader, tuple_id_t row)
+{
+  unsigned count;
+
+  if(row < reader->first || row >= reader->first + reader->count) {
+    count = reader->capacity;
+    if(count > reader->rows - row) {
+      count = reader->rows - row;
+    }
+    if(DB_ERROR(storage_read(reader->fd, reader->buf,
+                             reader->base + (unsigned long)row * reader->row_length,
+                             count * reader->row_length))) {
+      reader->count = 0;
+      return NULL;
+    }
+    reader->first = row;
+    reader->count = count;
+  }
+
+  return reader->buf + (row - reader->first) * reader->row_length;
+}
+/*---------------------------------------------------------------------------*/
+static void
+sort_rows(struct join_side *side, unsigned char *buf, unsigned n)
+{
+  unsigned char tmp[DB_MAX_CHAR_SIZE_PER_ROW];
+  unsigned length;
+  unsigned gap;
+  unsigned i;
+  unsigned j;
+
+  /* Shell sort, moving whole rows. */
+  length = side->row_length;
+  for(gap = n / 2; gap > 0; gap /= 2) {
+    for(i = gap; i < n; i++) {
+      memcpy(tmp, buf + i * length, length);
+      for(j = i;
+          j >= gap && key_compare(side, buf + (j - gap) * length, side, tmp) > 0;
+          j -= gap) {
+        memcpy(buf + j * length, buf + (j - gap) * length, length);
+      }
+      memcpy(buf + j * length, tmp, length);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static db_result_t
+start_sort(int side)
+{
+  sort_side = side;
+  rows[side] = 0;
+  regions[side] = 0;
+  scan_id = 0;
+  phase = PHASE_SORT_RUNS;
+  return storage_scan_init(&scan, sides[side].rel, io_buffer, io_size);
+}
+/*---------------------------------------------------------------------------*/
+static db_result_t
+start_merge_pair(void)
+{
+  tuple_id_t n;
+
+  n = rows[sort_side];
+  if(out_pos >= n) {
+    /* The pass is finished. */
+    regions[sort_side] = !regions[sort_side];
+    run_length *= 2;
+    out_pos = 0;
+  }
+
+  if(run_length >= n) {
+    PRINTF("DB: Sorted %lu rows for the merge join\n", (unsigned long)n);
+    if(sort_side == 0) {
+      return start_sort(1);
+    }
+
+    reader_init(&readers[0], 0, io_buffer, io_size / 2);
+    reader_init(&readers[1], 1, io_buffer + io_size / 2, io_size / 2);
+    run_pos[0] = run_pos[1] = 0;
+    in_group = 0;
+    phase = PHASE_MERGE;
+    return DB_OK;
+  }
+
+  run_pos[0] = out_pos;
+  run_end[0] = run_pos[1] = out_pos + run_length < n ? out_pos + run_length : n;
+  run_end[1] = run_end[0] + run_length < n ? run_end[0] + run_length : n;
+  reader_init(&readers[0], sort_side, io_buffer, io_size / 2);
+  reader_init(&readers[1], sort_side, io_buffer + io_size / 2, io_size / 2);
+  phase = PHASE_SORT_MERGE;
+  return DB_OK;
+}
+/*---------------------------------------------------------------------------*/
+static db_result_t
+sort_runs(void)
+{
+  struct join_side *side;
+  unsigned char *row;
+  db_result_t result;
+  unsigned run_capacity;
+  unsigned n;
+
+  side = &sides[sort_side];
+  run_capacity = DB_JOIN_BUFFER_SIZE / side->row_length;
+
+  for(n = 0; n < run_capacity; n++) {
+    result = storage_scan_get(&scan, scan_id, &row);
+    if(DB_ERROR(result)) {
+      return result;
+    }
+    if(result == DB_FINISHED) {
+      break;
+    }
+    scan_id++;
+    memcpy(join_buffer + n * side->row_length, row, side->row_length);
+  }
+
+  if(n > 0) {
+    sort_rows(side, join_buffer, n);
+    if(DB_ERROR(storage_write(files[sort_side], join_buffer,
+                              (unsigned long)rows[sort_side] * side->row_length,
+                              n * side->row_length))) {
+      return DB_STORAGE_ERROR;
+    }
+    rows[sort_side] += n;
+  }
+
+  if(n < run_capacity) {
+    /* All runs have been formed; merge them pairwise. */
+    run_length = run_capacity;
+    out_pos = 0;
+    return start_merge_pair();
+  }
+
+  return DB_OK;
+}
+/*---------------------------------------------------------------------------*/
+static db_result_t
+sort_merge(void)
+{
+  struct join_side *side;
+  unsigned char *row[2];
+  unsigned length;
+  unsigned n;
+  int i;
+
+  side = &sides[sort_side];
+  length = side->row_length;
+
+  for(n = 0; n < DB_JOIN_BUFFER_SIZE / length; n++) {
+    for(i = 0; i < 2; i++) {
+      row[i] = NULL;
+      if(run_pos[i] < run_end[i]) {
+        row[i] = reader_get(&readers[i], run_pos[i]);
+        if(row[i] == NULL) {
+          return DB_STORAGE_ERROR;
+        }
+      }
+    }
+
+    if(row[0] == NULL && row[1] == NULL) {
+      break;
+    }
+    i = row[1] == NULL ||
+        (row[0] != NULL && key_compare(side, row[0], side, row[1]) <= 0) ? 0 : 1;
+    memcpy(join_buffer + n * length, row[i], length);
+    run_pos[i]++;
+  }
+
+  if(DB_ERROR(storage_write(files[sort_side], join_buffer,
+                            (unsigned long)(!regions[sort_side]) *
+                            rows[sort_side] * length +
+                            (unsigned long)out_pos * length,
+                            n * length))) {
+    return DB_STORAGE_ERROR;
+  }
+  out_pos += n;
+
+  if(run_pos[0] == run_end[0] && run_pos[1] == run_end[1]) {
+    return start_merge_pair();
+  }
+  return DB_OK;
+}
+/*---------------------------------------------------------------------------*/
+static db_result_t
+merge_rows(void)
+{
+  unsigned char *left;
+  unsigned char *right;
+  int cmp;
+  int i;
+
+  for(i = 0; i < ROWS_PER_STEP; i++) {
+    if(run_pos[0] >= rows[0] || (!in_group && run_pos[1] >= rows[1])) {
+      return finish();
+    }
+
+    left = reader_get(&readers[0], run_pos[0]);
+    if(left == NULL) {
+      return DB_STORAGE_ERROR;
+    }
+
+    if(!in_group) {
+      right = reader_get(&readers[1], run_pos[1]);
+      if(right == NULL) {
+        return DB_STORAGE_ERROR;
+      }
+      cmp = key_compare(&sides[0], left, &sides[1], right);
+      if(cmp < 0) {
+        run_pos[0]++;
+        continue;
+      } else if(cmp > 0) {
+        run_pos[1]++;
+        continue;
+      }
+      in_group = 1;
+      group_start = group_pos = run_pos[1];
+    }
+
+    if(group_pos < rows[1]) {
+      right = reader_get(&readers[1], group_pos);
+      if(right == NULL) {
+        return DB_STORAGE_ERROR;
+      }
+      if(key_compare(&sides[0], left, &sides[1], right) == 0) {
+        memcpy(sides[0].row, left, sides[0].row_length);
+        memcpy(sides[1].row, right, sides[1].row_length);
+        group_pos++;
+        return DB_GOT_ROW;
+      }
+    }
+
+    /* The left row has been joined with all the matching right rows.
+       The next left row may have the same value, so start over from
+       the beginning of the group. */
+    run_pos[0]++;
+    run_pos[1] = group_start;
+    in_group = 0;
+  }
+
+  return DB_OK;
+}
+/*---------------------------------------------------------------------------*/
+static db_result_t
+merge_init(void)
+{
+  db_result_t result;
+  int i;
+
+  for(i = 0; i < 2; i++) {
+    if(DB_JOIN_BUFFER_SIZE / sides[i].row_length < 2 ||
+       io_size / 2 < sides[i].row_length) {
+      return DB_LIMIT_ERROR;
+    }
+  }
+
+  for(i = 0; i < 2; i++) {
+    result = create_file(i, 2UL * sides[i].cardinality * sides[i].row_length);
+    if(DB_ERROR(result)) {
+      return result;
+    }
+  }
+
+  PRINTF("DB: Sort-merge join\n");
+  return start_sort(0);
+}
+/*---------------------------------------------------------------------------*/
+static unsigned long
+hash_join_cost(struct join_side *build_side, struct join_side *probe_side)
+{
+  unsigned long chunks;
+  unsigned long total;
+  unsigned long n;
+
+  n = hash_capacity(build_side);
+  total = (unsigned long)build_side->cardinality + probe_side->cardinality;
+  if(build_side->cardinality <= n) {
+    return total;
+  }
+  if(n == 0 || rows_per_block(build_side) == 0 ||
+     rows_per_block(probe_side) == 0) {
+    return ULONG_MAX;
+  }
+
+  /* Read and spill both relations, read the partitions back, and
+     read each probe partition once for every chunk. */
+  n *= DB_JOIN_PARTITIONS;
+  chunks = (build_side->cardinality + n - 1) / n;
+  return 3 * total + (chunks - 1) * probe_side->cardinality;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned long
+sort_cost(struct join_side *side)
+{
+  unsigned long runs;
+  unsigned passes;
+
+  if(DB_JOIN_BUFFER_SIZE / side->row_length < 2) {
+    return ULONG_MAX / 4;
+  }
+
+  runs = side->cardinality / (DB_JOIN_BUFFER_SIZE / side->row_length) + 1;
+  for(passes = 0; runs > 1; passes++) {
+    runs = (runs + 1) / 2;
+  }
+
+  /* Form the runs, then read and write all rows in each pass. */
+  return 2UL * side->cardinality * (passes + 1);
+}
+/*---------------------------------------------------------------------------*/
+static void
+init_side(struct join_side *side, struct join_input *input)
+{
+  tuple_id_t cardinality;
+
+  cardinality = relation_cardinality(input->rel);
+
+  side->rel = input->rel;
+  side->row = input->row;
+  side->row_length = input->rel->row_length;
+  side->cardinality = cardinality == INVALID_TUPLE ? 0 : cardinality;
+  side->key_domain = input->attr->domain;
+  side->key_offset = input->offset;
+  side->key_size = input->attr->element_size;
+}
+/*---------------------------------------------------------------------------*/
+join_method_t
+join_select_method(struct join_input *left, struct join_input *right)
+{
+  struct join_side l;
+  struct join_side r;
+  unsigned long index_cost;
+  unsigned long hash_cost;
+  unsigned long merge_cost;
+  tuple_id_t n;
+
+  if(DB_JOIN_METHOD != JOIN_METHOD_AUTO &&
+     (DB_JOIN_METHOD != JOIN_METHOD_INDEX || index_exists(right->attr))) {
+    return DB_JOIN_METHOD;
+  }
+
+  init_side(&l, left);
+  init_side(&r, right);
+
+  /* Estimate the number of rows that each method reads or writes. An
+     index lookup is assumed to cost a binary search in the right
+     relation. */
+  index_cost = ULONG_MAX;
+  if(index_exists(right->attr)) {
+    index_cost = 1;
+    for(n = r.cardinality; n > 1; n /= 2) {
+      index_cost++;
+    }
+    index_cost *= l.cardinality;
+  }
+
+  if(l.cardinality < r.cardinality) {
+    hash_cost = hash_join_cost(&l, &r);
+  } else {
+    hash_cost = hash_join_cost(&r, &l);
+  }
+
+  merge_cost = sort_cost(&l) + sort_cost(&r) + l.cardinality + r.cardinality;
+
+  PRINTF("DB: Join costs: index %lu, hash %lu, merge %lu\n",
+         index_cost, hash_cost, merge_cost);
+
+  if(index_cost <= hash_cost && index_cost <= merge_cost) {
+    return JOIN_METHOD_INDEX;
+  }
+  return hash_cost <= merge_cost ? JOIN_METHOD_HASH : JOIN_METHOD_MERGE;
+}
+/*---------------------------------------------------------------------------*/
+db_result_t
+join_init(join_method_t method,
+          struct join_input *left, struct join_input *right,
+          unsigned char *buf, unsigned size)
+{
+  join_release();
+
+  init_side(&sides[0], left);
+  init_side(&sides[1], right);
+
+  if(is_numeric(sides[0].key_domain) != is_numeric(sides[1].key_domain) ||
+     (!is_numeric(sides[0].key_domain) &&
+      sides[0].key_domain != sides[1].key_domain)) {
+    PRINTF("DB: The attributes to join on have incompatible domains\n");
+    return DB_TYPE_ERROR;
+  }
+
+  io_buffer = buf;
+  io_size = size;
+  scan.rel = NULL;
+
+  switch(method) {
+  case JOIN_METHOD_HASH:
+    return hash_init();
+  case JOIN_METHOD_MERGE:
+    return merge_init();
+  default:
+    return DB_ARGUMENT_ERROR;
+  }
+}
+/*---------------------------------------------------------------------------*/
+db_result_t
+join_next(void)
+{
+  switch(phase) {
+  case PHASE_PARTITION:
+    return partition_rows();
+  case PHASE_LOAD:
+    return load_rows();
+  case PHASE_PROBE:
+    return probe_rows();
+  case PHASE_SORT_RUNS:
+    return sort_runs();
+  case PHASE_SORT_MERGE:
+    return sort_merge();
+  case PHASE_MERGE:
+    return merge_rows();
+  default:
+    return DB_FINISHED;
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+join_release(void)
+{
+  int i;
+
+  for(i = 0; i < 2; i++) {
+    if(files[i] >= 0) {
+      storage_close(files[i]);
+      files[i] = -1;
+    }
+    if(filenames[i][0] != '\0') {
+      cfs_remove(filenames[i]);
+      filenames[i][0] = '\0';
+    }
+  }
+  phase = PHASE_DONE;
+}
+/*---------------------------------------------------------------------------*/
+#endif /* DB_FEATURE_JOIN */
@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2015, EasyRF.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *	Join operators that do not require an index on the join attribute.
+ */
+
+#ifndef JOIN_H
+#define JOIN_H
+
+#include "relation.h"
+
+typedef enum {
+  JOIN_METHOD_AUTO = 0,
+  JOIN_METHOD_INDEX = 1,
+  JOIN_METHOD_HASH = 2,
+  JOIN_METHOD_MERGE = 3
+} join_method_t;
+
+/* One of the relations to join, and the attribute to join on. */
+struct join_input {
+  relation_t *rel;
+  attribute_t *attr;
+  unsigned offset;
+  unsigned char *row;
+};
+
+join_method_t join_select_method(struct join_input *left,
+                                 struct join_input *right);
+db_result_t join_init(join_method_t method,
+                      struct join_input *left, struct join_input *right,
+                      unsigned char *buf, unsigned size);
+db_result_t join_next(void);
+void join_release(void);
+
+#endif /* !JOIN_H */
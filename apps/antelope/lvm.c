@@ -64,12 +64,27 @@
 #define LVM_USE_FLOATS			0
 #endif
 
+/* The maximum number of instructions in a compiled predicate. */
+#ifndef LVM_MAX_INSNS
+#define LVM_MAX_INSNS			16
+#endif
+
+/* The number of intermediate values that a compiled predicate can
+   hold for each row in a batch. */
+#ifndef LVM_STACK_DEPTH
+#define LVM_STACK_DEPTH			4
+#endif
+
 #define IS_CONNECTIVE(op) ((op) & LVM_CONNECTIVE)
 
 struct variable {
   operand_type_t type;
   operand_value_t value;
   char name[LVM_MAX_NAME_LENGTH + 1];
+  /* The location of the variable in the rows given to
+     lvm_execute_batch(). A width of zero means that it is unbound. */
+  uint8_t offset;
+  uint8_t width;
 };
 typedef struct variable variable_t;
 
@@ -87,6 +102,38 @@ static variable_t variables[LVM_MAX_VARIABLE_ID - 1];
 /* Range derivations of variables that are used for index searches. */
 static derivation_t derivations[LVM_MAX_VARIABLE_ID - 1];
 
+/*
+ * A compiled predicate is a sequence of instructions, each of which
+ * processes a whole batch of rows before the next one is dispatched.
+ * The instructions operate on a small stack of vector registers, where
+ * the slot of an instruction is fixed at compile time.
+ */
+struct insn;
+typedef void (*insn_handler_t)(const struct insn *, unsigned);
+
+struct insn {
+  insn_handler_t handler;
+  operator_t op;
+  uint8_t slot;
+  variable_id_t id;
+  long value;
+  long min;
+};
+
+static struct insn program[LVM_MAX_INSNS];
+static unsigned program_length;
+/* The instance that the program was compiled from. The program is
+   reused as long as neither the bytecode nor the variable bindings
+   have changed. */
+static lvm_instance_t *program_owner;
+static uint8_t program_divides;
+static uint8_t program_exact;
+
+static const unsigned char *batch_rows;
+static unsigned batch_row_length;
+static long registers[LVM_STACK_DEPTH][LVM_BATCH_SIZE];
+static uint8_t batch_errors[LVM_BATCH_SIZE];
+
 #if DEBUG
 static void
 print_derivations(derivation_t *d)
@@ -306,9 +353,11 @@ lvm_reset(lvm_instance_t *p, unsigned char *code, lvm_ip_t size)
   p->end = 0;
   p->ip = 0;
   p->error = 0;
+  p->compiled = 0;
 
   memset(variables, 0, sizeof(variables));
   memset(derivations, 0, sizeof(derivations));
+  program_owner = NULL;
 }
 
 lvm_ip_t
@@ -438,6 +487,72 @@ lvm_set_long(lvm_instance_t *p, long l)
   lvm_set_operand(p, &op);
 }
 
+lvm_status_t
+lvm_replace_long(lvm_instance_t *p, unsigned operand, long l)
+{
+  lvm_ip_t ip;
+  operand_t op;
+
+  for(ip = 0; ip < p->end;) {
+    if(*(node_type_t *)(p->code + ip) != LVM_OPERAND) {
+      ip += sizeof(node_type_t) + sizeof(operator_t);
+      continue;
+    }
+    ip += sizeof(node_type_t);
+    if(operand-- == 0) {
+      memcpy(&op, p->code + ip, sizeof(op));
+      if(op.type != LVM_LONG) {
+        return TYPE_ERROR;
+      }
+      op.value.l = l;
+      memcpy(p->code + ip, &op, sizeof(op));
+      p->compiled = 0;
+      return TRUE;
+    }
+    ip += sizeof(operand_t);
+  }
+
+  return INVALID_IDENTIFIER;
+}
+
+void
+lvm_save_variables(struct lvm_variables *saved)
+{
+  int i;
+
+  for(i = 0; i < LVM_MAX_VARIABLE_ID - 1; i++) {
+    memcpy(saved->names[i], variables[i].name, sizeof(saved->names[i]));
+    saved->types[i] = variables[i].type;
+  }
+}
+
+void
+lvm_restore_variables(const struct lvm_variables *saved)
+{
+  int i;
+
+  memset(derivations, 0, sizeof(derivations));
+
+  for(i = 0; i < LVM_MAX_VARIABLE_ID - 1; i++) {
+    if(strcmp(variables[i].name, saved->names[i]) != 0 ||
+       variables[i].type != saved->types[i]) {
+      break;
+    }
+  }
+  if(i == LVM_MAX_VARIABLE_ID - 1) {
+    /* The variables are still registered, so their bindings and
+       the compiled program can be kept. */
+    return;
+  }
+
+  memset(variables, 0, sizeof(variables));
+  for(i = 0; i < LVM_MAX_VARIABLE_ID - 1; i++) {
+    memcpy(variables[i].name, saved->names[i], sizeof(variables[i].name));
+    variables[i].type = saved->types[i];
+  }
+  program_owner = NULL;
+}
+
 lvm_status_t
 lvm_register_variable(char *name, operand_type_t type)
 {
@@ -579,6 +694,24 @@ create_union(derivation_t *result, derivation_t *d1, derivation_t *d2)
 #endif /* DEBUG */
 }
 
+/* Gives the relation that holds if the two operands swap places. */
+static operator_t
+mirror_relation(operator_t op)
+{
+  switch(op) {
+  case LVM_GE:
+    return LVM_LE;
+  case LVM_GEQ:
+    return LVM_LEQ;
+  case LVM_LE:
+    return LVM_GE;
+  case LVM_LEQ:
+    return LVM_GEQ;
+  default:
+    return op;
+  }
+}
+
 static int
 derive_relation(lvm_instance_t *p, derivation_t *local_derivations)
 {
@@ -589,6 +722,7 @@ derive_relation(lvm_instance_t *p, derivation_t *local_derivations)
   int variable_id;
   operand_value_t *value;
   derivation_t *derivation;
+  operator_t op;
 
   type = get_type(p);
   operator = get_operator(p);
@@ -635,6 +769,7 @@ derive_relation(lvm_instance_t *p, derivation_t *local_derivations)
   }
 
   /* Determine which of the operands that is the variable. */
+  op = *operator;
   if(operand[0].type == LVM_VARIABLE) {
     if(operand[1].type == LVM_VARIABLE) {
       return DERIVATION_ERROR;
@@ -642,8 +777,12 @@ derive_relation(lvm_instance_t *p, derivation_t *local_derivations)
     variable_id = operand[0].value.id;
     value = &operand[1].value;
   } else {
+    if(operand[1].type != LVM_VARIABLE) {
+      return DERIVATION_ERROR;
+    }
     variable_id = operand[1].value.id;
     value = &operand[0].value;
+    op = mirror_relation(op);
   }
 
   if(variable_id >= LVM_MAX_VARIABLE_ID) {
@@ -657,7 +796,7 @@ derive_relation(lvm_instance_t *p, derivation_t *local_derivations)
   derivation->max.l = LONG_MAX;
   derivation->min.l = LONG_MIN;
 
-  switch(*operator) {
+  switch(op) {
   case LVM_EQ:
     derivation->max = *value;
     derivation->min = *value;
@@ -686,6 +825,7 @@ derive_relation(lvm_instance_t *p, derivation_t *local_derivations)
 lvm_status_t
 lvm_derive(lvm_instance_t *p)
 {
+  p->ip = 0;
   return derive_relation(p, derivations);
 }
 
@@ -708,6 +848,468 @@ lvm_get_derived_range(lvm_instance_t *p, char *name,
   return INVALID_IDENTIFIER;
 }
 
+static void
+load_variable(const struct insn *insn, long *r, unsigned count)
+{
+  const unsigned char *ptr;
+  unsigned i;
+
+  ptr = batch_rows + variables[insn->id].offset;
+  if(variables[insn->id].width == 2) {
+    for(i = 0; i < count; i++, ptr += batch_row_length) {
+      r[i] = (int16_t)(ptr[0] << 8 | ptr[1]);
+    }
+  } else {
+    for(i = 0; i < count; i++, ptr += batch_row_length) {
+      r[i] = (int32_t)((uint32_t)ptr[0] << 24 | (uint32_t)ptr[1] << 16 |
+                       (uint32_t)ptr[2] << 8 | ptr[3]);
+    }
+  }
+}
+
+static void
+exec_push_const(const struct insn *insn, unsigned count)
+{
+  long *r;
+  unsigned i;
+
+  r = registers[insn->slot];
+  for(i = 0; i < count; i++) {
+    r[i] = insn->value;
+  }
+}
+
+static void
+exec_push_var(const struct insn *insn, unsigned count)
+{
+  load_variable(insn, registers[insn->slot], count);
+}
+
+static void
+exec_arith(const struct insn *insn, unsigned count)
+{
+  long *a;
+  long *b;
+  unsigned i;
+
+  a = registers[insn->slot];
+  b = registers[insn->slot + 1];
+
+  switch(insn->op) {
+  case LVM_ADD:
+    for(i = 0; i < count; i++) {
+      a[i] += b[i];
+    }
+    break;
+  case LVM_SUB:
+    for(i = 0; i < count; i++) {
+      a[i] -= b[i];
+    }
+    break;
+  case LVM_MUL:
+    for(i = 0; i < count; i++) {
+      a[i] *= b[i];
+    }
+    break;
+  default:
+    for(i = 0; i < count; i++) {
+      if(b[i] == 0) {
+        batch_errors[i] = 1;
+        a[i] = 0;
+      } else {
+        a[i] /= b[i];
+      }
+    }
+    break;
+  }
+}
+
+#define COMPARE(rel, rhs) do {           \
+    for(i = 0; i < count; i++) {          \
+      a[i] = a[i] rel (rhs);              \
+    }                                     \
+  } while(0)
+
+static void
+compare(operator_t op, long *a, const long *b, long value, unsigned count)
+{
+  unsigned i;
+
+  /* The right operand is either a register or a constant. */
+  if(b == NULL) {
+    switch(op) {
+    case LVM_EQ: COMPARE(==, value); break;
+    case LVM_NEQ: COMPARE(!=, value); break;
+    case LVM_GE: COMPARE(>, value); break;
+    case LVM_GEQ: COMPARE(>=, value); break;
+    case LVM_LE: COMPARE(<, value); break;
+    default: COMPARE(<=, value); break;
+    }
+  } else {
+    switch(op) {
+    case LVM_EQ: COMPARE(==, b[i]); break;
+    case LVM_NEQ: COMPARE(!=, b[i]); break;
+    case LVM_GE: COMPARE(>, b[i]); break;
+    case LVM_GEQ: COMPARE(>=, b[i]); break;
+    case LVM_LE: COMPARE(<, b[i]); break;
+    default: COMPARE(<=, b[i]); break;
+    }
+  }
+}
+
+static void
+exec_cmp(const struct insn *insn, unsigned count)
+{
+  compare(insn->op, registers[insn->slot], registers[insn->slot + 1], 0, count);
+}
+
+static void
+exec_cmp_const(const struct insn *insn, unsigned count)
+{
+  load_variable(insn, registers[insn->slot], count);
+  compare(insn->op, registers[insn->slot], NULL, insn->value, count);
+}
+
+static void
+exec_range(const struct insn *insn, unsigned count)
+{
+  long *r;
+  unsigned i;
+
+  r = registers[insn->slot];
+  load_variable(insn, r, count);
+  for(i = 0; i < count; i++) {
+    r[i] = r[i] >= insn->min && r[i] <= insn->value;
+  }
+}
+
+static void
+exec_connective(const struct insn *insn, unsigned count)
+{
+  long *a;
+  long *b;
+  unsigned i;
+
+  a = registers[insn->slot];
+  b = registers[insn->slot + 1];
+
+  switch(insn->op) {
+  case LVM_AND:
+    for(i = 0; i < count; i++) {
+      a[i] = a[i] & b[i];
+    }
+    break;
+  case LVM_OR:
+    for(i = 0; i < count; i++) {
+      a[i] = a[i] | b[i];
+    }
+    break;
+  default:
+    for(i = 0; i < count; i++) {
+      a[i] = !a[i];
+    }
+    break;
+  }
+}
+
+static struct insn *
+emit(insn_handler_t handler, operator_t op, unsigned slot)
+{
+  struct insn *insn;
+
+  if(program_length == LVM_MAX_INSNS || slot >= LVM_STACK_DEPTH) {
+    return NULL;
+  }
+
+  insn = &program[program_length++];
+  insn->handler = handler;
+  insn->op = op;
+  insn->slot = slot;
+  return insn;
+}
+
+static int
+is_bound(operand_t *operand)
+{
+  return operand->type == LVM_VARIABLE &&
+         operand->value.id < LVM_MAX_VARIABLE_ID - 1 &&
+         variables[operand->value.id].width != 0;
+}
+
+static lvm_status_t
+compile_expr(lvm_instance_t *p, unsigned slot)
+{
+  operator_t op;
+  operand_t operand;
+  struct insn *insn;
+  lvm_status_t r;
+
+  switch(get_type(p)) {
+  case LVM_ARITH_OP:
+    op = *get_operator(p);
+    if(op < LVM_ADD || op > LVM_DIV || slot + 1 >= LVM_STACK_DEPTH) {
+      return SEMANTIC_ERROR;
+    }
+    r = compile_expr(p, slot);
+    if(LVM_ERROR(r)) {
+      return r;
+    }
+    r = compile_expr(p, slot + 1);
+    if(LVM_ERROR(r)) {
+      return r;
+    }
+    if(op == LVM_DIV) {
+      program_divides = 1;
+    }
+    return emit(exec_arith, op, slot) == NULL ? STACK_OVERFLOW : TRUE;
+  case LVM_OPERAND:
+    get_operand(p, &operand);
+    if(operand.type == LVM_LONG) {
+      insn = emit(exec_push_const, 0, slot);
+      if(insn == NULL) {
+        return STACK_OVERFLOW;
+      }
+      insn->value = operand.value.l;
+    } else if(is_bound(&operand)) {
+      insn = emit(exec_push_var, 0, slot);
+      if(insn == NULL) {
+        return STACK_OVERFLOW;
+      }
+      insn->id = operand.value.id;
+    } else {
+      return TYPE_ERROR;
+    }
+    return TRUE;
+  default:
+    return SEMANTIC_ERROR;
+  }
+}
+
+static lvm_status_t
+compile_logic(lvm_instance_t *p, operator_t op, unsigned slot)
+{
+  operand_t operand[2];
+  struct insn *insn;
+  lvm_ip_t ip;
+  lvm_status_t r;
+  int i;
+
+  if(IS_CONNECTIVE(op)) {
+    if(op != LVM_AND) {
+      program_exact = 0;
+    }
+    for(i = 0; i < (op == LVM_NOT ? 1 : 2); i++) {
+      if(get_type(p) != LVM_CMP_OP) {
+        return SEMANTIC_ERROR;
+      }
+      r = compile_logic(p, *get_operator(p), slot + i);
+      if(LVM_ERROR(r)) {
+        return r;
+      }
+    }
+    return emit(exec_connective, op, slot) == NULL ? STACK_OVERFLOW : TRUE;
+  }
+
+  if(op < LVM_EQ || op > LVM_LEQ) {
+    return SEMANTIC_ERROR;
+  }
+
+  /* Fuse comparisons between a column and a constant into a
+     single instruction. */
+  ip = p->ip;
+  if(get_type(p) == LVM_OPERAND) {
+    get_operand(p, &operand[0]);
+    if(get_type(p) == LVM_OPERAND) {
+      get_operand(p, &operand[1]);
+      if(operand[1].type == LVM_LONG && is_bound(&operand[0])) {
+        i = 0;
+      } else if(operand[0].type == LVM_LONG && is_bound(&operand[1])) {
+        i = 1;
+        op = mirror_relation(op);
+      } else {
+        i = -1;
+      }
+      if(i >= 0) {
+        insn = emit(exec_cmp_const, op, slot);
+        if(insn == NULL) {
+          return STACK_OVERFLOW;
+        }
+        insn->id = operand[i].value.id;
+        insn->value = operand[!i].value.l;
+        /* Ranges derived from the comparison must be exact. */
+        if(op == LVM_NEQ ||
+           (op == LVM_GE && insn->value == LONG_MAX) ||
+           (op == LVM_LE && insn->value == LONG_MIN)) {
+          program_exact = 0;
+        }
+        return TRUE;
+      }
+    }
+  }
+  p->ip = ip;
+  program_exact = 0;
+
+  if(slot + 1 >= LVM_STACK_DEPTH) {
+    return STACK_OVERFLOW;
+  }
+  r = compile_expr(p, slot);
+  if(LVM_ERROR(r)) {
+    return r;
+  }
+  r = compile_expr(p, slot + 1);
+  if(LVM_ERROR(r)) {
+    return r;
+  }
+  return emit(exec_cmp, op, slot) == NULL ? STACK_OVERFLOW : TRUE;
+}
+
+/*
+ * Replaces a conjunction of comparisons between columns and constants
+ * with one range check per column, using the same derivation as the
+ * index selection does.
+ */
+static void
+compile_ranges(lvm_instance_t *p)
+{
+  derivation_t d[LVM_MAX_VARIABLE_ID];
+  struct insn ranges[LVM_MAX_VARIABLE_ID];
+  struct insn *insn;
+  unsigned count;
+  unsigned i;
+
+  memset(d, 0, sizeof(d));
+  p->ip = 0;
+  if(get_type(p) != LVM_CMP_OP) {
+    return;
+  }
+  p->ip = 0;
+  if(LVM_ERROR(derive_relation(p, d))) {
+    return;
+  }
+
+  for(count = 0, i = 0; i < LVM_MAX_VARIABLE_ID - 1; i++) {
+    if(d[i].derived) {
+      insn = &ranges[count];
+      insn->handler = exec_range;
+      insn->slot = count == 0 ? 0 : 1;
+      insn->id = i;
+      insn->min = d[i].min.l;
+      insn->value = d[i].max.l;
+      count++;
+    }
+  }
+
+  if(count == 0 || 2 * count - 1 > program_length) {
+    return;
+  }
+
+  program_length = 0;
+  for(i = 0; i < count; i++) {
+    program[program_length++] = ranges[i];
+    if(i > 0) {
+      emit(exec_connective, LVM_AND, 0);
+    }
+  }
+  PRINTF("LVM: Pushed down %u range checks\n", count);
+}
+lvm_status_t
+lvm_bind_variable(char *name, unsigned offset, unsigned width)
+{
+  variable_id_t id;
+
+  id = lookup(name);
+  if(id >= LVM_MAX_VARIABLE_ID - 1 || variables[id].name[0] == '\0') {
+    return INVALID_IDENTIFIER;
+  }
+  if((width != 2 && width != 4) || offset > UCHAR_MAX) {
+    return TYPE_ERROR;
+  }
+
+  if(variables[id].offset != offset || variables[id].width != width) {
+    program_owner = NULL;
+  }
+  variables[id].offset = offset;
+  variables[id].width = width;
+  return TRUE;
+}
+
+lvm_status_t
+lvm_compile(lvm_instance_t *p)
+{
+  lvm_status_t r;
+
+  if(p->compiled && program_owner == p) {
+    return TRUE;
+  }
+
+  p->compiled = 0;
+  program_owner = NULL;
+  program_length = 0;
+  program_divides = 0;
+  program_exact = 1;
+
+  p->ip = 0;
+  if(get_type(p) != LVM_CMP_OP) {
+    return SEMANTIC_ERROR;
+  }
+  r = compile_logic(p, *get_operator(p), 0);
+  if(LVM_ERROR(r)) {
+    PRINTF("LVM: The predicate cannot be compiled: %d\n", (int)r);
+    return r;
+  }
+
+  if(program_exact) {
+    compile_ranges(p);
+  }
+
+  PRINTF("LVM: Compiled the predicate into %u instructions\n",
+         program_length);
+  p->compiled = 1;
+  program_owner = p;
+  return TRUE;
+}
+
+lvm_status_t
+lvm_execute_batch(lvm_instance_t *p, const unsigned char *rows,
+                  unsigned row_length, unsigned count, uint8_t *results)
+{
+  const struct insn *insn;
+  const struct insn *end;
+  unsigned n;
+  unsigned i;
+
+  if(!p->compiled || program_owner != p) {
+    return EXECUTION_ERROR;
+  }
+
+  end = program + program_length;
+  batch_row_length = row_length;
+
+  for(; count > 0; count -= n) {
+    n = count < LVM_BATCH_SIZE ? count : LVM_BATCH_SIZE;
+    batch_rows = rows;
+    if(program_divides) {
+      memset(batch_errors, 0, n);
+    }
+
+    for(insn = program; insn < end; insn++) {
+      insn->handler(insn, n);
+    }
+
+    for(i = 0; i < n; i++) {
+      results[i] = registers[0][i] ? TRUE : FALSE;
+      if(program_divides && batch_errors[i]) {
+        results[i] = MATH_ERROR;
+      }
+    }
+
+    rows += n * row_length;
+    results += n;
+  }
+
+  return TRUE;
+}
+
 #if DEBUG
 static lvm_ip_t
 print_operator(lvm_instance_t *p, lvm_ip_t index)
@@ -896,7 +1498,7 @@ main(void)
   lvm_set_relation(&p, LVM_LE);
   lvm_set_variable(&p, "a");
   lvm_set_long(&p, 100);
-  lvm_set_relation(&p, LVM_GE);
+  lvm_set_relation(&p, LVM_LE);
   lvm_set_long(&p, 10);
   lvm_set_variable(&p, "a");
 
@@ -927,8 +1529,8 @@ main(void)
   lvm_set_long(&p, 100);
   lvm_set_relation(&p, LVM_OR);
   lvm_set_relation(&p, LVM_LE);
-  lvm_set_long(&p, 1000);
   lvm_set_variable(&p, "a");
+  lvm_set_long(&p, 1000);
   lvm_set_relation(&p, LVM_LE);
   lvm_set_variable(&p, "a");
   lvm_set_long(&p, 1902);
@@ -40,6 +40,7 @@
 #ifndef LVM_H
 #define LVM_H
 
+#include <stdint.h>
 #include <stdlib.h>
 
 #include "db-options.h"
@@ -61,6 +62,11 @@ typedef enum lvm_status lvm_status_t;
 
 #define LVM_ERROR(x)	(x >= 2)
 
+/* The number of rows evaluated together by lvm_execute_batch(). */
+#ifndef LVM_BATCH_SIZE
+#define LVM_BATCH_SIZE			16
+#endif
+
 typedef int lvm_ip_t;
 
 struct lvm_instance {
@@ -69,6 +75,7 @@ struct lvm_instance {
   lvm_ip_t end;
   lvm_ip_t ip;
   unsigned error;
+  uint8_t compiled;
 };
 typedef struct lvm_instance lvm_instance_t;
 
@@ -120,6 +127,13 @@ struct operand {
 };
 typedef struct operand operand_t;
 
+/* A copy of the registered variables, which allows the bytecode of
+   a predicate to be executed after other predicates have been built. */
+struct lvm_variables {
+  char names[LVM_MAX_VARIABLE_ID - 1][LVM_MAX_NAME_LENGTH + 1];
+  uint8_t types[LVM_MAX_VARIABLE_ID - 1];
+};
+
 void lvm_reset(lvm_instance_t *p, unsigned char *code, lvm_ip_t size);
 void lvm_clone(lvm_instance_t *dst, lvm_instance_t *src);
 lvm_status_t lvm_derive(lvm_instance_t *p);
@@ -128,6 +142,11 @@ lvm_status_t lvm_get_derived_range(lvm_instance_t *p, char *name,
                                    operand_value_t *max);
 void lvm_print_derivations(lvm_instance_t *p);
 lvm_status_t lvm_execute(lvm_instance_t *p);
+lvm_status_t lvm_bind_variable(char *name, unsigned offset, unsigned width);
+lvm_status_t lvm_compile(lvm_instance_t *p);
+lvm_status_t lvm_execute_batch(lvm_instance_t *p, const unsigned char *rows,
+                               unsigned row_length, unsigned count,
+                               uint8_t *results);
 lvm_status_t lvm_register_variable(char *name, operand_type_t type);
 lvm_status_t lvm_set_variable_value(char *name, operand_value_t value);
 void lvm_print_code(lvm_instance_t *p);
@@ -139,6 +158,9 @@ void lvm_set_op(lvm_instance_t *p, operator_t op);
 void lvm_set_relation(lvm_instance_t *p, operator_t op);
 void lvm_set_operand(lvm_instance_t *p, operand_t *op);
 void lvm_set_long(lvm_instance_t *p, long l);
+lvm_status_t lvm_replace_long(lvm_instance_t *p, unsigned operand, long l);
+void lvm_save_variables(struct lvm_variables *saved);
+void lvm_restore_variables(const struct lvm_variables *saved);
 void lvm_set_variable(lvm_instance_t *p, char *name);
 
 #endif /* LVM_H */
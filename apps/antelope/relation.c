@@ -45,7 +45,9 @@
 #include "net/ip/uip-debug.h"
 
 #include "db-options.h"
+#include "group.h"
 #include "index.h"
+#include "join.h"
 #include "lvm.h"
 #include "relation.h"
 #include "result.h"
@@ -88,6 +90,58 @@ static unsigned char * const left_row = row;
 static unsigned char * const right_row = extra_row;
 static unsigned char * const join_row = result_row;
 
+/* Cursors over the scanned relation and the right relation of a join. */
+static struct storage_scan scan;
+static unsigned char scan_buffer[DB_SCAN_BUFFER_SIZE];
+#if DB_FEATURE_JOIN
+static struct storage_scan right_scan;
+#endif /* DB_FEATURE_JOIN */
+
+/* Predicate results for a batch of rows in the scan buffer. */
+static uint8_t batch_results[LVM_BATCH_SIZE];
+static tuple_id_t batch_first;
+static unsigned batch_count;
+
+/* The number of rows aggregated in a selection without GROUP BY. */
+static tuple_id_t aggregated_rows;
+
+#if DB_FEATURE_SERIES
+/* The value ranges of the attributes in a block of a series relation,
+   and the ranges derived from the predicate of the selection. */
+static long block_min[DB_MAX_ATTRIBUTES_PER_RELATION];
+static long block_max[DB_MAX_ATTRIBUTES_PER_RELATION];
+static long range_min[DB_MAX_ATTRIBUTES_PER_RELATION];
+static long range_max[DB_MAX_ATTRIBUTES_PER_RELATION];
+static uint8_t range_known[DB_MAX_ATTRIBUTES_PER_RELATION];
+#endif /* DB_FEATURE_SERIES */
+
+#if DB_FEATURE_GROUP
+/*
+ * The group keys and the aggregated values of each selected row are
+ * passed to the group operator, which emits the groups once all rows
+ * have been read. If the rows are read in the order of one of the group
+ * keys, the groups are instead emitted each time that key changes, so
+ * the group operator only has to hold the groups of one key value.
+ */
+enum {
+  GROUP_SCAN,
+  GROUP_DRAIN,
+  GROUP_FINISH
+};
+
+static struct source_dest_map *group_keys[AQL_GROUP_LIMIT];
+static long group_divisors[AQL_GROUP_LIMIT];
+static uint8_t group_key_count;
+static struct source_dest_map *group_values[AQL_ATTRIBUTE_LIMIT];
+static uint8_t group_value_count;
+static long row_keys[AQL_GROUP_LIMIT];
+static long row_values[AQL_ATTRIBUTE_LIMIT];
+static int8_t ordered_key;
+static long last_key;
+static uint8_t group_rows;
+static uint8_t group_state;
+#endif /* DB_FEATURE_GROUP */
+
 LIST(relations);
 MEMB(relations_memb, relation_t, DB_RELATION_POOL_SIZE);
 MEMB(attributes_memb, attribute_t, DB_ATTRIBUTE_POOL_SIZE);
@@ -273,7 +327,7 @@ relation_release(relation_t *rel)
 }
 
 relation_t *
-relation_create(char *name, db_direction_t dir)
+relation_create(char *name, db_direction_t dir, uint8_t flags)
 {
   relation_t old_rel;
   relation_t *rel;
@@ -298,6 +352,7 @@ relation_create(char *name, db_direction_t dir)
     strncpy(rel->name, name, sizeof(rel->name) - 1);
     rel->name[sizeof(rel->name) - 1] = '\0';
     rel->dir = dir;
+    rel->flags = flags;
 
     if(dir == DB_STORAGE) {
       storage_drop_relation(rel, 1);
@@ -347,6 +402,14 @@ relation_attribute_add(relation_t *rel, db_direction_t dir, char *name,
     return NULL;
   }
 
+#if DB_FEATURE_SERIES
+  if((rel->flags & RELATION_FLAG_SERIES) &&
+     domain != DOMAIN_INT && domain != DOMAIN_LONG) {
+    PRINTF("DB: Series relations support only INT and LONG attributes\n");
+    return NULL;
+  }
+#endif /* DB_FEATURE_SERIES */
+
   attribute = memb_alloc(&attributes_memb);
   if(attribute == NULL) {
     PRINTF("DB: Failed to allocate attribute \"%s\"!\n", name);
@@ -480,11 +543,20 @@ relation_insert(relation_t *rel, attribute_value_t *values)
   unsigned char *ptr;
   attribute_value_t *value;
   db_result_t result;
+  tuple_id_t tuple_id;
 
   value = values;
 
   PRINTF("DB: Relation %s has a record size of %u bytes\n",
 	 rel->name, (unsigned)rel->row_length);
+
+  /* The new row is appended, so its tuple ID is the cardinality. For
+     a relation loaded from storage, the rows are counted first so that
+     the indexes get the right tuple ID. */
+  tuple_id = relation_cardinality(rel);
+  if(tuple_id == INVALID_TUPLE) {
+    return DB_STORAGE_ERROR;
+  }
   ptr = record;
 
   PRINTF("DB: Insert (");
@@ -534,7 +606,7 @@ relation_insert(relation_t *rel, attribute_value_t *values)
 
     ptr += attr->element_size;
     if(attr->index != NULL) {
-      if(DB_ERROR(index_insert(attr->index, value, rel->next_row))) {
+      if(DB_ERROR(index_insert(attr->index, value, tuple_id))) {
         return DB_INDEX_ERROR;
       }
     }
@@ -542,8 +614,7 @@ relation_insert(relation_t *rel, attribute_value_t *values)
 
   PRINTF(")\n");
 
-  rel->cardinality++;
-  rel->next_row++;
+  rel->cardinality = tuple_id + 1;
   return storage_put_row(rel, record);
 }
 
@@ -568,9 +639,8 @@ aggregate(attribute_t *attr, attribute_value_t *value)
     attr->aggregation_value++;
     break;
   case AQL_SUM:
-    attr->aggregation_value += long_value;
-    break;
   case AQL_MEAN:
+    attr->aggregation_value += long_value;
     break;
   case AQL_MEDIAN:
     break;
@@ -655,7 +725,7 @@ select_index(db_handle_t *handle, lvm_instance_t *lvm_instance)
 
       if(range <= min_range) {
         index = attr->index;
-        av_min.domain = av_max.domain = DOMAIN_INT;
+        av_min.domain = av_max.domain = DOMAIN_LONG;
         VALUE_LONG(&av_min) = min.l;
         VALUE_LONG(&av_max) = max.l;
       }
@@ -671,12 +741,367 @@ select_index(db_handle_t *handle, lvm_instance_t *lvm_instance)
   }
 }
 
+#if DB_FEATURE_SERIES
+static unsigned
+attribute_position(relation_t *rel, attribute_t *wanted)
+{
+  attribute_t *attr;
+  unsigned i;
+
+  for(i = 0, attr = list_head(rel->attributes);
+      attr != wanted;
+      i++, attr = attr->next);
+
+  return i;
+}
+
+/* Decide whether the block summaries of a series relation can be used
+   to skip blocks during a selection. */
+static int
+derive_block_ranges(db_handle_t *handle, aql_adt_t *adt, int derived)
+{
+  attribute_t *attr;
+  struct source_dest_map *attr_map_ptr;
+  operand_value_t min;
+  operand_value_t max;
+  unsigned i;
+  int useful;
+
+  useful = 0;
+  for(i = 0, attr = list_head(handle->rel->attributes);
+      attr != NULL;
+      i++, attr = attr->next) {
+    range_known[i] = derived &&
+      !(AQL_GET_FLAGS(adt) & AQL_FLAG_INVERSE_LOGIC) &&
+      !LVM_ERROR(lvm_get_derived_range(adt->lvm_instance, attr->name,
+                                       &min, &max));
+    if(range_known[i]) {
+      range_min[i] = min.l;
+      range_max[i] = max.l;
+      useful = 1;
+    }
+  }
+
+  if((AQL_GET_FLAGS(adt) & AQL_FLAG_AGGREGATE) && AQL_GROUP_COUNT(adt) == 0) {
+    /* Blocks may also be skipped if only extremes are aggregated. */
+    for(attr_map_ptr = attr_map;
+        attr_map_ptr < attr_map + handle->result_rel->attribute_count;
+        attr_map_ptr++) {
+      attr = attr_map_ptr->to_attr;
+      if(!(attr->flags & ATTRIBUTE_FLAG_NO_STORE) &&
+         attr->aggregator != AQL_MIN && attr->aggregator != AQL_MAX) {
+        break;
+      }
+    }
+    if(attr_map_ptr == attr_map + handle->result_rel->attribute_count) {
+      useful = 1;
+    }
+  }
+
+  return useful;
+}
+
+/* Check whether any row in a block with the value ranges in
+   block_min and block_max can affect the result of a selection. */
+static int
+block_is_relevant(db_handle_t *handle, aql_adt_t *adt)
+{
+  attribute_t *attr;
+  struct source_dest_map *attr_map_ptr;
+  unsigned i;
+
+  for(i = 0, attr = list_head(handle->rel->attributes);
+      attr != NULL;
+      i++, attr = attr->next) {
+    if(range_known[i] &&
+       (block_max[i] < range_min[i] || block_min[i] > range_max[i])) {
+      /* The predicate is false for all rows in the block. */
+      return 0;
+    }
+  }
+
+  if(!(AQL_GET_FLAGS(adt) & AQL_FLAG_AGGREGATE) || AQL_GROUP_COUNT(adt) > 0) {
+    return 1;
+  }
+
+  for(attr_map_ptr = attr_map;
+      attr_map_ptr < attr_map + handle->result_rel->attribute_count;
+      attr_map_ptr++) {
+    attr = attr_map_ptr->to_attr;
+    if(attr->flags & ATTRIBUTE_FLAG_NO_STORE) {
+      continue;
+    }
+    i = attribute_position(handle->rel, attr_map_ptr->from_attr);
+    switch(attr->aggregator) {
+    case AQL_MAX:
+      if(block_max[i] > attr->aggregation_value) {
+        return 1;
+      }
+      break;
+    case AQL_MIN:
+      if(block_min[i] < attr->aggregation_value) {
+        return 1;
+      }
+      break;
+    default:
+      return 1;
+    }
+  }
+
+  /* No value in the block is beyond the current extremes. */
+  return 0;
+}
+
+static db_result_t
+skip_blocks(db_handle_t *handle, aql_adt_t *adt)
+{
+  db_result_t result;
+  tuple_id_t end;
+
+  for(;;) {
+    result = storage_scan_summary(&scan, handle->tuple_id, &end,
+                                  block_min, block_max);
+    if(result != DB_OK) {
+      return DB_ERROR(result) ? result : DB_OK;
+    }
+    if(block_is_relevant(handle, adt)) {
+      return DB_OK;
+    }
+    PRINTF("DB: Skipping rows %lu to %lu\n",
+           (unsigned long)handle->tuple_id, (unsigned long)end - 1);
+    handle->tuple_id = end;
+  }
+}
+#endif /* DB_FEATURE_SERIES */
+
+static int
+bind_predicate_variables(unsigned attribute_count)
+{
+  struct source_dest_map *attr_map_ptr;
+  unsigned width;
+
+  for(attr_map_ptr = attr_map;
+      attr_map_ptr < attr_map + attribute_count;
+      attr_map_ptr++) {
+    if(attr_map_ptr->from_attr->domain == DOMAIN_INT) {
+      width = 2;
+    } else if(attr_map_ptr->from_attr->domain == DOMAIN_LONG) {
+      width = 4;
+    } else {
+      continue;
+    }
+    if(lvm_bind_variable(attr_map_ptr->from_attr->name,
+                         attr_map_ptr->from_offset, width) == TYPE_ERROR) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+static int
+is_group_key(aql_adt_t *adt, unsigned attribute)
+{
+  unsigned i;
+
+  for(i = 0; i < AQL_GROUP_COUNT(adt); i++) {
+    if(adt->groups[i].attribute == attribute) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+#if DB_FEATURE_GROUP
+static long
+read_long(struct source_dest_map *attr_map_ptr, unsigned char *tuple)
+{
+  attribute_value_t value;
+
+  if(DB_ERROR(db_phy_to_value(&value, attr_map_ptr->from_attr,
+                              tuple + attr_map_ptr->from_offset))) {
+    return 0;
+  }
+  return db_value_to_long(&value);
+}
+
+static db_result_t
+init_groups(db_handle_t *handle, aql_adt_t *adt)
+{
+  uint8_t aggregators[AQL_ATTRIBUTE_LIMIT];
+  struct source_dest_map *attr_map_ptr;
+  attribute_t *attr;
+  index_t *index;
+  tuple_id_t cardinality;
+  unsigned i;
+
+  for(i = 0; i < AQL_GROUP_COUNT(adt); i++) {
+    attr_map_ptr = &attr_map[adt->groups[i].attribute];
+    if(attr_map_ptr->from_attr->domain != DOMAIN_INT &&
+       attr_map_ptr->from_attr->domain != DOMAIN_LONG) {
+      PRINTF("DB: Cannot group by the non-numeric attribute %s\n",
+             attr_map_ptr->from_attr->name);
+      return DB_TYPE_ERROR;
+    }
+    group_keys[i] = attr_map_ptr;
+    group_divisors[i] = adt->groups[i].divisor;
+  }
+  group_key_count = i;
+
+  group_value_count = 0;
+  for(attr_map_ptr = attr_map;
+      attr_map_ptr < attr_map + handle->result_rel->attribute_count;
+      attr_map_ptr++) {
+    if(attr_map_ptr->to_attr->aggregator != AQL_NONE) {
+      aggregators[group_value_count] = attr_map_ptr->to_attr->aggregator;
+      group_values[group_value_count++] = attr_map_ptr;
+    }
+  }
+
+  /* The rows are read in the order of a group key if they are found
+     through an ordered index on it, or if they are scanned from a
+     relation that is sorted by it because of an inline index. */
+  ordered_key = -1;
+  for(i = 0; i < group_key_count; i++) {
+    attr = group_keys[i]->from_attr;
+    if(handle->flags & DB_HANDLE_FLAG_SEARCH_INDEX) {
+      index = handle->index_iterator.index;
+      if(index->attr == attr && (index->api->flags & INDEX_API_ORDERED)) {
+        ordered_key = i;
+        break;
+      }
+    } else if(attr->index != NULL &&
+              ((index_t *)attr->index)->type == INDEX_INLINE) {
+      ordered_key = i;
+      break;
+    }
+  }
+  PRINTF("DB: Grouping by %u keys; ordered key %d\n",
+         group_key_count, ordered_key);
+
+  handle->flags |= DB_HANDLE_FLAG_GROUP;
+  group_state = GROUP_SCAN;
+  group_rows = 0;
+
+  cardinality = relation_cardinality(handle->rel);
+  return group_init(group_key_count, aggregators, group_value_count,
+                    cardinality == INVALID_TUPLE ? 0 : cardinality);
+}
+
+static db_result_t
+group_row(unsigned char *tuple)
+{
+  unsigned i;
+  long value;
+
+  for(i = 0; i < group_key_count; i++) {
+    /* Round the key down to the start of its interval. */
+    value = read_long(group_keys[i], tuple);
+    row_keys[i] = value / group_divisors[i];
+    if(value % group_divisors[i] < 0) {
+      row_keys[i]--;
+    }
+  }
+  for(i = 0; i < group_value_count; i++) {
+    row_values[i] = read_long(group_values[i], tuple);
+  }
+
+  if(ordered_key >= 0) {
+    if(group_rows && row_keys[ordered_key] != last_key) {
+      /* The groups of the previous key are complete. Emit them
+         before adding this row. */
+      last_key = row_keys[ordered_key];
+      group_state = GROUP_DRAIN;
+      return group_finish();
+    }
+    last_key = row_keys[ordered_key];
+  }
+
+  group_rows = 1;
+  return group_add(row_keys, row_values);
+}
+
+static db_result_t
+finish_groups(void)
+{
+  group_state = GROUP_FINISH;
+  return group_finish();
+}
+
+static db_result_t
+next_group(db_handle_t *handle)
+{
+  long keys[AQL_GROUP_LIMIT];
+  long results[AQL_ATTRIBUTE_LIMIT];
+  struct source_dest_map *attr_map_ptr;
+  attribute_t *result_attr;
+  attribute_value_t value;
+  db_result_t result;
+  long long_value;
+  unsigned i;
+  unsigned j;
+
+  result = group_next(keys, results);
+  if(result == DB_FINISHED) {
+    if(group_state == GROUP_FINISH) {
+      return DB_FINISHED;
+    }
+    /* Continue with the row that started the next key. */
+    group_state = GROUP_SCAN;
+    return group_add(row_keys, row_values);
+  } else if(result != DB_GOT_ROW) {
+    return result;
+  }
+
+  for(i = 0, attr_map_ptr = attr_map;
+      attr_map_ptr < attr_map + handle->result_rel->attribute_count;
+      attr_map_ptr++) {
+    result_attr = attr_map_ptr->to_attr;
+    if(result_attr->aggregator != AQL_NONE) {
+      long_value = results[i++];
+    } else {
+      for(j = 0; j < group_key_count && group_keys[j] != attr_map_ptr; j++);
+      if(j == group_key_count) {
+        /* The attribute is used just for the predicate. */
+        continue;
+      }
+      long_value = keys[j] * group_divisors[j];
+    }
+
+    if(result_attr->flags & ATTRIBUTE_FLAG_NO_STORE) {
+      continue;
+    }
+
+    value.domain = result_attr->domain;
+    if(value.domain == DOMAIN_INT) {
+      VALUE_INT(&value) = long_value;
+    } else {
+      VALUE_LONG(&value) = long_value;
+    }
+    db_value_to_phy(result_row + attr_map_ptr->to_offset, result_attr, &value);
+  }
+
+  if(AQL_GET_FLAGS((aql_adt_t *)handle->adt) & AQL_FLAG_ASSIGN) {
+    if(DB_ERROR(storage_put_row(handle->result_rel, result_row))) {
+      PRINTF("DB: Failed to store a row in the result relation!\n");
+      return DB_STORAGE_ERROR;
+    }
+  }
+
+  handle->current_row++;
+  return DB_GOT_ROW;
+}
+#endif /* DB_FEATURE_GROUP */
+
 static db_result_t
 generate_selection_result(db_handle_t *handle, relation_t *rel, aql_adt_t *adt)
 {
   relation_t *result_rel;
   unsigned attribute_count;
   attribute_t *attr;
+  int derived;
+#if DB_FEATURE_GROUP
+  db_result_t result;
+#endif /* DB_FEATURE_GROUP */
 
   result_rel = handle->result_rel;
 
@@ -696,12 +1121,45 @@ generate_selection_result(db_handle_t *handle, relation_t *rel, aql_adt_t *adt)
     return DB_IMPLEMENTATION_ERROR;
   }
 
+  if(DB_ERROR(storage_scan_init(&scan, rel, scan_buffer, sizeof(scan_buffer)))) {
+    PRINTF("DB: Failed to start a scan of relation %s\n", rel->name);
+    return DB_STORAGE_ERROR;
+  }
+
+  derived = 0;
   if(adt->lvm_instance != NULL) {
     /* Try to establish acceptable ranges for the attribute values. */
-    if(!LVM_ERROR(lvm_derive(adt->lvm_instance))) {
+    derived = !LVM_ERROR(lvm_derive(adt->lvm_instance));
+    if(derived) {
       select_index(handle, adt->lvm_instance);
     }
+
+    /* Evaluate the predicate over batches of rows if all the
+       attributes that it uses can be read directly from the rows. */
+    if(bind_predicate_variables(attribute_count) &&
+       !LVM_ERROR(lvm_compile(adt->lvm_instance))) {
+      handle->flags |= DB_HANDLE_FLAG_BATCH;
+      batch_count = 0;
+    }
+  }
+
+#if DB_FEATURE_GROUP
+  if(AQL_GROUP_COUNT(adt) > 0) {
+    result = init_groups(handle, adt);
+    if(DB_ERROR(result)) {
+      PRINTF("DB: Failed to initialize the grouping\n");
+      return result;
+    }
   }
+#endif /* DB_FEATURE_GROUP */
+
+#if DB_FEATURE_SERIES
+  if((rel->flags & RELATION_FLAG_SERIES) &&
+     !(handle->flags & DB_HANDLE_FLAG_SEARCH_INDEX) &&
+     derive_block_ranges(handle, adt, derived)) {
+    handle->flags |= DB_HANDLE_FLAG_SUMMARY;
+  }
+#endif /* DB_FEATURE_SERIES */
 
   handle->flags |= DB_HANDLE_FLAG_PROCESSING;
 
@@ -741,11 +1199,11 @@ relation_process_select(void *handle_ptr)
   struct source_dest_map *attr_map_ptr, *attr_map_end;
   attribute_t *result_attr;
   unsigned char *from_ptr;
-  unsigned char *to_ptr;
+  storage_row_t tuple;
   operand_value_t operand_value;
-  uint8_t intbuf[2];
   attribute_value_t value;
   lvm_status_t wanted_result;
+  tuple_id_t tuple_id;
 
   handle = (db_handle_t *)handle_ptr;
   adt = (aql_adt_t *)handle->adt;
@@ -753,13 +1211,21 @@ relation_process_select(void *handle_ptr)
   attribute_count = handle->result_rel->attribute_count;
   attr_map_end = attr_map + attribute_count;
 
+#if DB_FEATURE_GROUP
+  if((handle->flags & DB_HANDLE_FLAG_GROUP) && group_state != GROUP_SCAN) {
+    return next_group(handle);
+  }
+#endif /* DB_FEATURE_GROUP */
+
   if(handle->flags & DB_HANDLE_FLAG_SEARCH_INDEX) {
     handle->tuple_id = index_get_next(&handle->index_iterator);
     if(handle->tuple_id == INVALID_TUPLE) {
       PRINTF("DB: An attribute value could not be found in the index\n");
-      if(handle->index_iterator.next_item_no == 0) {
-        return DB_INDEX_ERROR;
+#if DB_FEATURE_GROUP
+      if(handle->flags & DB_HANDLE_FLAG_GROUP) {
+        return finish_groups();
       }
+#endif /* DB_FEATURE_GROUP */
 
       if(adt->flags & AQL_FLAG_AGGREGATE) {
         goto end_aggregation;
@@ -769,35 +1235,87 @@ relation_process_select(void *handle_ptr)
     }
   }
 
+#if DB_FEATURE_SERIES
+  if(handle->flags & DB_HANDLE_FLAG_SUMMARY) {
+    /* Skip the blocks of rows that cannot affect the result. */
+    result = skip_blocks(handle, adt);
+    if(DB_ERROR(result)) {
+      return result;
+    }
+  }
+#endif /* DB_FEATURE_SERIES */
+
   /* Put the tuples fulfilling the given condition into a new relation.
      The tuples may be projected. */
-  result = storage_get_row(handle->rel, &handle->tuple_id, row);
+  result = storage_scan_get(&scan, handle->tuple_id, &tuple);
   handle->tuple_id++;
   if(DB_ERROR(result)) {
     PRINTF("DB: Failed to get a row in relation %s!\n", handle->rel->name);
     return result;
   } else if(result == DB_FINISHED) {
+#if DB_FEATURE_GROUP
+    if(handle->flags & DB_HANDLE_FLAG_GROUP) {
+      return finish_groups();
+    }
+#endif /* DB_FEATURE_GROUP */
     if(AQL_GET_FLAGS(adt) & AQL_FLAG_AGGREGATE) {
       goto end_aggregation;
     }
     return DB_FINISHED;
   }
 
+  wanted_result = TRUE;
+  if(AQL_GET_FLAGS(adt) & AQL_FLAG_INVERSE_LOGIC) {
+    wanted_result = FALSE;
+  }
+
+  if(handle->flags & DB_HANDLE_FLAG_BATCH) {
+    /* Evaluate the predicate for this row and the rows following it
+       in the scan buffer at once, unless that has already been done. */
+    tuple_id = handle->tuple_id - 1;
+    if(tuple_id < batch_first || tuple_id >= batch_first + batch_count) {
+      batch_first = tuple_id;
+      batch_count = scan.first + scan.count - tuple_id;
+      if(batch_count > LVM_BATCH_SIZE) {
+        batch_count = LVM_BATCH_SIZE;
+      }
+      lvm_execute_batch(adt->lvm_instance, tuple, handle->rel->row_length,
+                        batch_count, batch_results);
+    }
+    if(!(handle->flags & DB_HANDLE_FLAG_SEARCH_INDEX)) {
+      /* The rows are scanned in order, so skip directly to the next
+         row in the batch for which the predicate holds. */
+      while(batch_results[tuple_id - batch_first] != wanted_result) {
+        if(++tuple_id == batch_first + batch_count) {
+          handle->tuple_id = tuple_id;
+          return DB_OK;
+        }
+        tuple += handle->rel->row_length;
+      }
+      handle->tuple_id = tuple_id + 1;
+    } else if(batch_results[tuple_id - batch_first] != wanted_result) {
+      return DB_OK;
+    }
+  }
+
   /* Process the attributes in the result relation. */
   for(attr_map_ptr = attr_map; attr_map_ptr < attr_map_end; attr_map_ptr++) {
-    from_ptr = row + attr_map_ptr->from_offset;
+    from_ptr = tuple + attr_map_ptr->from_offset;
     result_attr = attr_map_ptr->to_attr;
 
-    /* Update the internal state of the PLE. */
-    if(result_attr->domain == DOMAIN_INT) {
-      operand_value.l = from_ptr[0] << 8 | from_ptr[1];
-      lvm_set_variable_value(result_attr->name, operand_value);
-    } else if(result_attr->domain == DOMAIN_LONG) {
-      operand_value.l = (uint32_t)from_ptr[0] << 24 |
-                        (uint32_t)from_ptr[1] << 16 |
-                        (uint32_t)from_ptr[2] << 8 |
-                        from_ptr[3];
-      lvm_set_variable_value(result_attr->name, operand_value);
+    /* Update the internal state of the PLE, unless the predicate
+       has been evaluated for the whole batch already. */
+    if(!(handle->flags & DB_HANDLE_FLAG_BATCH)) {
+      if(attr_map_ptr->from_attr->domain == DOMAIN_INT) {
+        operand_value.l = (int16_t)(from_ptr[0] << 8 | from_ptr[1]);
+        lvm_set_variable_value(result_attr->name, operand_value);
+      } else if(attr_map_ptr->from_attr->domain == DOMAIN_LONG) {
+        operand_value.l = (int32_t)((uint32_t)from_ptr[0] << 24 |
+                                    (uint32_t)from_ptr[1] << 16 |
+                                    (uint32_t)from_ptr[2] << 8 |
+                                    from_ptr[3]);
+        lvm_set_variable_value(result_attr->name, operand_value);
+      }
     }
 
     if(result_attr->flags & ATTRIBUTE_FLAG_NO_STORE) {
@@ -813,23 +1331,27 @@ relation_process_select(void *handle_ptr)
     }
   }
 
-  wanted_result = TRUE;
-  if(AQL_GET_FLAGS(adt) & AQL_FLAG_INVERSE_LOGIC) {
-    wanted_result = FALSE;
-  }
-
   /* Check whether the given predicate is true for this tuple. */
-  if(adt->lvm_instance == NULL ||
+  if(adt->lvm_instance == NULL || (handle->flags & DB_HANDLE_FLAG_BATCH) ||
      lvm_execute(adt->lvm_instance) == wanted_result) {
+#if DB_FEATURE_GROUP
+    if(handle->flags & DB_HANDLE_FLAG_GROUP) {
+      return group_row(tuple);
+    }
+#endif /* DB_FEATURE_GROUP */
     if(AQL_GET_FLAGS(adt) & AQL_FLAG_AGGREGATE) {
       for(attr_map_ptr = attr_map; attr_map_ptr < attr_map_end; attr_map_ptr++) {
-        from_ptr = row + attr_map_ptr->from_offset;
-        result = db_phy_to_value(&value, attr_map_ptr->to_attr, from_ptr);
+        if(attr_map_ptr->to_attr->aggregator == AQL_NONE) {
+          continue;
+        }
+        from_ptr = tuple + attr_map_ptr->from_offset;
+        result = db_phy_to_value(&value, attr_map_ptr->from_attr, from_ptr);
         if(DB_ERROR(result)) {
 	  return result;
         }
         aggregate(attr_map_ptr->to_attr, &value);
       }
+      aggregated_rows++;
     } else {
       if(AQL_GET_FLAGS(adt) & AQL_FLAG_ASSIGN) {
         if(DB_ERROR(storage_put_row(handle->result_rel, result_row))) {
@@ -848,12 +1370,16 @@ end_aggregation:
   /* Generate aggregated result if requested. */
   for(attr_map_ptr = attr_map; attr_map_ptr < attr_map_end; attr_map_ptr++) {
     result_attr = attr_map_ptr->to_attr;
-    to_ptr = result_row + attr_map_ptr->to_offset;
+    if(result_attr->flags & ATTRIBUTE_FLAG_NO_STORE) {
+      continue;
+    }
 
-    intbuf[0] = result_attr->aggregation_value >> 8;
-    intbuf[1] = result_attr->aggregation_value & 0xff;
-    from_ptr = intbuf;
-    memcpy(to_ptr, from_ptr, result_attr->element_size);
+    value.domain = DOMAIN_LONG;
+    VALUE_LONG(&value) = result_attr->aggregation_value;
+    if(result_attr->aggregator == AQL_MEAN && aggregated_rows > 0) {
+      VALUE_LONG(&value) /= (long)aggregated_rows;
+    }
+    db_value_to_phy(result_row + attr_map_ptr->to_offset, result_attr, &value);
   }
 
   if(AQL_GET_FLAGS(adt) & AQL_FLAG_ASSIGN) {
@@ -880,6 +1406,7 @@ relation_select(void *handle_ptr, relation_t *rel, void *adt_ptr)
   attribute_t *attr;
   int i;
   int normal_attributes;
+  int aggregated_attributes;
 
   adt = (aql_adt_t *)adt_ptr;
 
@@ -895,7 +1422,7 @@ relation_select(void *handle_ptr, relation_t *rel, void *adt_ptr)
     dir = DB_MEMORY;
   }
   relation_remove(name, 1);
-  relation_create(name, dir);
+  relation_create(name, dir, 0);
   handle->result_rel = relation_load(name);
 
   if(handle->result_rel == NULL) {
@@ -903,7 +1430,9 @@ relation_select(void *handle_ptr, relation_t *rel, void *adt_ptr)
     return DB_ALLOCATION_ERROR;
   }
 
-  for(i = normal_attributes = 0; i < AQL_ATTRIBUTE_COUNT(adt); i++) {
+  aggregated_rows = 0;
+  normal_attributes = aggregated_attributes = 0;
+  for(i = 0; i < AQL_ATTRIBUTE_COUNT(adt); i++) {
     attribute_name = adt->attributes[i].name;
 
     attr = relation_attribute_get(rel, attribute_name);
@@ -916,10 +1445,11 @@ relation_select(void *handle_ptr, relation_t *rel, void *adt_ptr)
     PRINTF("DB: Found attribute %s in relation %s\n",
 	attribute_name, rel->name);
 
+    /* Aggregates are computed as long values. */
     attr = relation_attribute_add(handle->result_rel, dir,
 				  attribute_name, 
-				  adt->aggregators[i] ? DOMAIN_INT : attr->domain,
-				  attr->element_size);
+				  adt->aggregators[i] ? DOMAIN_LONG : attr->domain,
+				  adt->aggregators[i] ? 4 : attr->element_size);
     if(attr == NULL) {
       PRINTF("DB: Failed to add a result attribute\n");
       relation_release(handle->result_rel);
@@ -927,9 +1457,13 @@ relation_select(void *handle_ptr, relation_t *rel, void *adt_ptr)
     }
 
     attr->aggregator = adt->aggregators[i];
+    if(attr->aggregator != AQL_NONE) {
+      aggregated_attributes++;
+    }
     switch(attr->aggregator) {
     case AQL_NONE:
-      if(!(adt->attributes[i].flags & ATTRIBUTE_FLAG_NO_STORE)) {
+      if(!(adt->attributes[i].flags & ATTRIBUTE_FLAG_NO_STORE) &&
+         !is_group_key(adt, i)) {
         /* Only count attributes projected into the result set. */
         normal_attributes++;
       }
@@ -949,9 +1483,10 @@ relation_select(void *handle_ptr, relation_t *rel, void *adt_ptr)
   }
 
   /* Preclude mixes of normal attributes and aggregated ones in 
-     selection results. */
+     selection results. With GROUP BY, only the group keys may be
+     selected without an aggregator. */
   if(normal_attributes > 0 &&
-     handle->result_rel->attribute_count > normal_attributes) {
+     (aggregated_attributes > 0 || AQL_GROUP_COUNT(adt) > 0)) {
      return DB_RELATIONAL_ERROR;
   }
 
@@ -959,39 +1494,75 @@ relation_select(void *handle_ptr, relation_t *rel, void *adt_ptr)
 }
 
 #if DB_FEATURE_JOIN
+static db_result_t
+generate_join_row(db_handle_t *handle)
+{
+  relation_t *join_rel;
+  unsigned char *join_next_attribute_ptr;
+  size_t element_size;
+  int i;
+
+  join_rel = handle->join_rel;
+
+  /* Use the source attribute map to fill in the physical representation
+     of the resulting tuple. */
+  join_next_attribute_ptr = join_row;
+
+  for(i = 0; i < join_rel->attribute_count; i++) {
+    element_size = source_map[i].attr->element_size;
+
+    memcpy(join_next_attribute_ptr, source_map[i].from_ptr, element_size);
+    join_next_attribute_ptr += element_size;
+  }
+
+  if(((aql_adt_t *)handle->adt)->flags & AQL_FLAG_ASSIGN) {
+    if(DB_ERROR(storage_put_row(join_rel, join_row))) {
+      return DB_STORAGE_ERROR;
+    }
+  }
+
+  handle->current_row++;
+  return DB_GOT_ROW;
+}
+
 db_result_t
 relation_process_join(void *handle_ptr)
 {
   db_handle_t *handle;
   db_result_t result;
   relation_t *left_rel;
-  relation_t *right_rel;
-  relation_t *join_rel;
-  unsigned char *join_next_attribute_ptr;
-  size_t element_size;
   tuple_id_t right_tuple_id;
+  storage_row_t tuple;
   attribute_value_t value;
-  int i;
 
   handle = (db_handle_t *)handle_ptr;
   left_rel = handle->left_rel;
-  right_rel = handle->right_rel;
-  join_rel = handle->join_rel;
+
+  if(handle->flags & DB_HANDLE_FLAG_JOIN_OPERATOR) {
+    /* The hash join or the sort-merge join fills in left_row and
+       right_row for each matching pair. */
+    result = join_next();
+    if(result == DB_GOT_ROW) {
+      return generate_join_row(handle);
+    }
+    return result;
+  }
 
   if(!(handle->flags & DB_HANDLE_FLAG_INDEX_STEP)) {
     goto inner_loop;
   }
 
-  /* Equi-join for indexed attributes only. In the outer loop, we iterate over
+  /* Equi-join for indexed attributes. In the outer loop, we iterate over
      each tuple in the left relation. */
   for(handle->tuple_id = 0;; handle->tuple_id++) {
-    result = storage_get_row(left_rel, &handle->tuple_id, left_row);
+    result = storage_scan_get(&scan, handle->tuple_id, &tuple);
     if(DB_ERROR(result)) {
       PRINTF("DB: Failed to get a row in left relation %s!\n", left_rel->name);
       return result;
     } else if(result == DB_FINISHED) {
       return DB_FINISHED;
     }
+    memcpy(left_row, tuple, left_rel->row_length);
 
     if(DB_ERROR(relation_get_value(left_rel, handle->left_join_attr, left_row, &value))) {
       PRINTF("DB: Failed to get a value of the attribute \"%s\" to join on\n",
@@ -1020,9 +1591,10 @@ inner_loop:
         break;
       }
 
-      result = storage_get_row(right_rel, &right_tuple_id, right_row);
+      result = storage_scan_get(&right_scan, right_tuple_id, &tuple);
       if(DB_ERROR(result)) {
-        PRINTF("DB: Failed to get a row in right relation %s!\n", right_rel->name);
+        PRINTF("DB: Failed to get a row in right relation %s!\n",
+               handle->right_rel->name);
         return result;
       } else if(result == DB_FINISHED) {
 	PRINTF("DB: The index refers to an invalid row: %lu\n",
@@ -1030,25 +1602,7 @@ inner_loop:
         return DB_IMPLEMENTATION_ERROR;
       }
 
-      /* Use the source attribute map to fill in the physical representation
-	 of the resulting tuple. */
-      join_next_attribute_ptr = join_row;
-
-      for(i = 0; i < join_rel->attribute_count; i++) {
-	element_size = source_map[i].attr->element_size;
-
-	memcpy(join_next_attribute_ptr, source_map[i].from_ptr, element_size);
-	join_next_attribute_ptr += element_size;
-      }
-
-      if(((aql_adt_t *)handle->adt)->flags & AQL_FLAG_ASSIGN) {
-        if(DB_ERROR(storage_put_row(join_rel, join_row))) {
-          return DB_STORAGE_ERROR;
-        }
-      }
-
-      handle->current_row++;
-      return DB_GOT_ROW;
+      return generate_join_row(handle);
     }
   }
 
@@ -1067,6 +1621,10 @@ generate_join_result(db_handle_t *handle)
   int i;
   int offset;
   unsigned char *from_ptr;
+  struct join_input left;
+  struct join_input right;
+  join_method_t method;
+  db_result_t result;
 
   handle->tuple = (tuple_t)join_row;
   handle->tuple_id = 0;
@@ -1102,6 +1660,39 @@ generate_join_result(db_handle_t *handle)
     source_pair->from_ptr = from_ptr;
   }
 
+  left.rel = left_rel;
+  left.attr = handle->left_join_attr;
+  left.offset = get_attribute_value_offset(left_rel, left.attr);
+  left.row = left_row;
+  right.rel = right_rel;
+  right.attr = handle->right_join_attr;
+  right.offset = get_attribute_value_offset(right_rel, right.attr);
+  right.row = right_row;
+
+  method = join_select_method(&left, &right);
+  if(method != JOIN_METHOD_INDEX) {
+    result = join_init(method, &left, &right, scan_buffer, sizeof(scan_buffer));
+    if(DB_ERROR(result)) {
+      PRINTF("DB: Failed to start the join\n");
+      return result;
+    }
+    handle->flags |= DB_HANDLE_FLAG_JOIN_OPERATOR | DB_HANDLE_FLAG_PROCESSING;
+    return DB_OK;
+  }
+
+  if(!index_exists(right.attr)) {
+    PRINTF("DB: The attribute to join on is not indexed\n");
+    return DB_INDEX_ERROR;
+  }
+
+  /* The right rows are fetched through the index one at a time, straight
+     into right_row, which the source map refers to. */
+  if(DB_ERROR(storage_scan_init(&scan, left_rel, scan_buffer, sizeof(scan_buffer))) ||
+     DB_ERROR(storage_scan_init(&right_scan, right_rel, right_row, right_rel->row_length))) {
+    PRINTF("DB: Failed to start scanning the relations to join\n");
+    return DB_STORAGE_ERROR;
+  }
+
   handle->flags |= DB_HANDLE_FLAG_PROCESSING;
 
   return DB_OK;
@@ -1137,7 +1728,7 @@ relation_join(void *query_result, void *adt_ptr)
     dir = DB_MEMORY;
   }
   relation_remove(name, 1);
-  relation_create(name, dir);
+  relation_create(name, dir, 0);
   join_rel = relation_load(name);
   handle->result_rel = join_rel;
 
@@ -1158,11 +1749,6 @@ relation_join(void *query_result, void *adt_ptr)
     return DB_RELATIONAL_ERROR;
   }
 
-  if(!index_exists(handle->right_join_attr)) {
-    PRINTF("DB: The attribute to join on is not indexed\n");
-    return DB_INDEX_ERROR;
-  }
-
   /*
    * Define the resulting relation. We start from 1 when counting attributes
    * because the first attribute is only the one to join, and is not included
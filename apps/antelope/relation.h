@@ -56,6 +56,10 @@ typedef enum db_direction {
 
 #define RELATION_HAS_TUPLES(rel) ((rel)->tuple_storage >= 0)
 
+/* The rows of the relation are stored in compressed blocks, and may
+   only be appended. */
+#define RELATION_FLAG_SERIES	0x01
+
 /*
  * A relation consists of a name, a set of domains, a set of indexes,
  * and a set of keys. Each relation must have a primary key.
@@ -67,10 +71,10 @@ struct relation {
   size_t row_length;
   attribute_id_t attribute_count;
   tuple_id_t cardinality;
-  tuple_id_t next_row;
   db_storage_id_t tuple_storage;
   db_direction_t dir;
   uint8_t references;
+  uint8_t flags;
   char name[RELATION_NAME_LENGTH + 1];
   char tuple_filename[RELATION_NAME_LENGTH + 1];
 };
@@ -84,7 +88,7 @@ db_result_t relation_process_select(void *);
 db_result_t relation_process_join(void *);
 relation_t *relation_load(char *);
 db_result_t relation_release(relation_t *);
-relation_t *relation_create(char *, db_direction_t);
+relation_t *relation_create(char *, db_direction_t, uint8_t);
 db_result_t relation_rename(char *, char *);
 attribute_t *relation_attribute_add(relation_t *, db_direction_t, char *,
 				    domain_t, size_t);
@@ -39,6 +39,8 @@
 #define DEBUG DEBUG_NONE
 #include "net/ip/uip-debug.h"
 
+#include "group.h"
+#include "join.h"
 #include "result.h"
 #include "storage.h"
 
@@ -97,13 +99,13 @@ db_phy_to_value(attribute_value_t *value, attribute_t *attr,
     PRINTF("DB: %s = %s\n", attr->name, ptr);
     break;
   case DOMAIN_INT:
-    int_value = (ptr[0] << 8) | ((unsigned)ptr[1] & 0xff);
+    int_value = (int16_t)((ptr[0] << 8) | ((unsigned)ptr[1] & 0xff));
     VALUE_INT(value) = int_value;
     PRINTF("DB: %s = %d\n", attr->name, int_value);
     break;
   case DOMAIN_LONG:
-    long_value = (long)ptr[0] << 24 | (long)ptr[1] << 16 |
-                 (long)ptr[2] << 8 | (long)ptr[3];
+    long_value = (int32_t)((uint32_t)ptr[0] << 24 | (uint32_t)ptr[1] << 16 |
+                           (uint32_t)ptr[2] << 8 | ptr[3]);
     VALUE_LONG(value) = long_value;
     PRINTF("DB: %s = %ld\n", attr->name, long_value);
     break;
@@ -178,6 +180,16 @@ db_free(db_handle_t *handle)
   if(handle->right_rel != NULL) {
     relation_release(handle->right_rel);
   }
+#if DB_FEATURE_JOIN
+  if(handle->flags & DB_HANDLE_FLAG_JOIN_OPERATOR) {
+    join_release();
+  }
+#endif /* DB_FEATURE_JOIN */
+#if DB_FEATURE_GROUP
+  if(handle->flags & DB_HANDLE_FLAG_GROUP) {
+    group_release();
+  }
+#endif /* DB_FEATURE_GROUP */
 
   handle->flags = 0;
 
@@ -49,6 +49,10 @@ typedef unsigned char *tuple_t;
 #define DB_HANDLE_FLAG_INDEX_STEP	0x01
 #define DB_HANDLE_FLAG_SEARCH_INDEX	0x02
 #define DB_HANDLE_FLAG_PROCESSING	0x04
+#define DB_HANDLE_FLAG_BATCH		0x08
+#define DB_HANDLE_FLAG_JOIN_OPERATOR	0x10
+#define DB_HANDLE_FLAG_SUMMARY		0x20
+#define DB_HANDLE_FLAG_GROUP		0x40
 
 struct db_handle {
   index_iterator_t index_iterator;
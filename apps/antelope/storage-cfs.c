@@ -68,6 +68,10 @@ struct index_record {
 
 #define ROW_XOR 0xf6U
 
+/* The prefix of the tuple files of series relations. Like "tuple", it
+   leaves room for the random suffix in RELATION_NAME_LENGTH. */
+#define SERIES_FILE_PREFIX "ts"
+
 static void
 merge_strings(char *dest, char *prefix, char *suffix)
 {
@@ -156,6 +160,13 @@ storage_get_relation(relation_t *rel, char *name)
 
   rel->tuple_filename[sizeof(rel->tuple_filename) - 1] ^= ROW_XOR;
 
+#if DB_FEATURE_SERIES
+  if(strncmp(rel->tuple_filename, SERIES_FILE_PREFIX ".",
+             sizeof(SERIES_FILE_PREFIX)) == 0) {
+    rel->flags |= RELATION_FLAG_SERIES;
+  }
+#endif /* DB_FEATURE_SERIES */
+
   /* Read attribute records. */
   result = DB_OK;
   for(i = 0;; i++) {
@@ -212,7 +223,10 @@ storage_put_relation(relation_t *rel)
   }
 
   if(rel->tuple_filename[0] == '\0') {
-    str = storage_generate_file("tuple", DB_COFFEE_RESERVE_SIZE);
+    /* The format of the tuple file is recognized by its name. */
+    str = storage_generate_file(rel->flags & RELATION_FLAG_SERIES ?
+                                SERIES_FILE_PREFIX : "tuple",
+                                DB_COFFEE_RESERVE_SIZE);
     if(str == NULL) {
       cfs_close(fd);
       cfs_remove(rel->name);
@@ -279,6 +293,11 @@ storage_put_attribute(relation_t *rel, attribute_t *attr)
 db_result_t
 storage_drop_relation(relation_t *rel, int remove_tuples)
 {
+#if DB_FEATURE_SERIES
+  if(remove_tuples) {
+    storage_series_drop(rel);
+  }
+#endif /* DB_FEATURE_SERIES */
   if(remove_tuples && RELATION_HAS_TUPLES(rel)) {
     cfs_remove(rel->tuple_filename);
   }
@@ -406,6 +425,12 @@ storage_get_row(relation_t *rel, tuple_id_t *tuple_id, storage_row_t row)
   int r;
   tuple_id_t nrows;
 
+#if DB_FEATURE_SERIES
+  if(rel->flags & RELATION_FLAG_SERIES) {
+    return storage_series_get_row(rel, *tuple_id, row);
+  }
+#endif /* DB_FEATURE_SERIES */
+
   if(DB_ERROR(storage_get_row_amount(rel, &nrows))) {
     return DB_STORAGE_ERROR;
   }
@@ -449,6 +474,12 @@ storage_put_row(relation_t *rel, storage_row_t row)
   char buf[rel->row_length];
 #endif
 
+#if DB_FEATURE_SERIES
+  if(rel->flags & RELATION_FLAG_SERIES) {
+    return storage_series_put_row(rel, row);
+  }
+#endif /* DB_FEATURE_SERIES */
+
   end = cfs_seek(rel->tuple_storage, 0, CFS_SEEK_END);
   if(end == (cfs_offset_t)-1) {
     return DB_STORAGE_ERROR;
@@ -496,6 +527,10 @@ storage_get_row_amount(relation_t *rel, tuple_id_t *amount)
 
   if(rel->row_length == 0) {
     *amount = 0;
+#if DB_FEATURE_SERIES
+  } else if(rel->flags & RELATION_FLAG_SERIES) {
+    return storage_series_get_row_amount(rel, amount);
+#endif /* DB_FEATURE_SERIES */
   } else {
     offset = cfs_seek(rel->tuple_storage, 0, CFS_SEEK_END);
     if(offset == (cfs_offset_t)-1) {
@@ -508,6 +543,122 @@ storage_get_row_amount(relation_t *rel, tuple_id_t *amount)
   return DB_OK;
 }
 
+db_result_t
+storage_scan_init(struct storage_scan *scan, relation_t *rel,
+                  unsigned char *buf, unsigned size)
+{
+  scan->rel = rel;
+  scan->buf = buf;
+  scan->size = size;
+  scan->count = 0;
+  scan->first = 0;
+  scan->nrows = 0;
+
+  if(!RELATION_HAS_TUPLES(rel)) {
+    return DB_OK;
+  }
+  if(size < rel->row_length) {
+    return DB_STORAGE_ERROR;
+  }
+#if DB_FEATURE_SERIES
+  if(rel->flags & RELATION_FLAG_SERIES) {
+    return storage_series_scan_init(scan);
+  }
+#endif /* DB_FEATURE_SERIES */
+  return storage_get_row_amount(rel, &scan->nrows);
+}
+
+db_result_t
+storage_scan_get(struct storage_scan *scan, tuple_id_t tuple_id,
+                 storage_row_t *row)
+{
+  relation_t *rel;
+  unsigned long start;
+  unsigned long end;
+  unsigned long page_end;
+  unsigned length;
+  unsigned i;
+  int r;
+
+  rel = scan->rel;
+
+#if DB_FEATURE_SERIES
+  if(rel->flags & RELATION_FLAG_SERIES) {
+    return storage_series_scan_get(scan, tuple_id, row);
+  }
+#endif /* DB_FEATURE_SERIES */
+
+  if(tuple_id >= scan->nrows) {
+    return DB_FINISHED;
+  }
+
+  if(tuple_id >= scan->first && tuple_id < scan->first + scan->count) {
+    *row = scan->buf + (tuple_id - scan->first) * rel->row_length;
+    return DB_OK;
+  }
+
+  start = (unsigned long)tuple_id * rel->row_length;
+  if(tuple_id == scan->first + scan->count) {
+    /* Sequential access: fill the buffer. If that leaves only a small
+       part of a page for the next batch, stop at the page boundary
+       instead, so that later batches start close to page boundaries.
+       A buffer of less than two rows may hold no row before the page
+       boundary, and is then filled anyway. */
+    end = start + scan->size - scan->size % rel->row_length;
+    page_end = end - end % DB_SCAN_PAGE_SIZE;
+    if(page_end >= start + scan->size / 2) {
+      page_end -= (page_end - start) % rel->row_length;
+      if(page_end - start >= rel->row_length) {
+        end = page_end;
+      }
+    }
+    if(end > (unsigned long)scan->nrows * rel->row_length) {
+      end = (unsigned long)scan->nrows * rel->row_length;
+    }
+  } else {
+    end = start + rel->row_length;
+  }
+
+  if(cfs_seek(rel->tuple_storage, start, CFS_SEEK_SET) == (cfs_offset_t)-1) {
+    return DB_STORAGE_ERROR;
+  }
+
+  for(length = 0; length < end - start; length += r) {
+    r = cfs_read(rel->tuple_storage, scan->buf + length, end - start - length);
+    if(r <= 0) {
+      PRINTF("DB: Reading failed on fd %d\n", rel->tuple_storage);
+      scan->count = 0;
+      return DB_STORAGE_ERROR;
+    }
+  }
+
+  scan->first = tuple_id;
+  scan->count = length / rel->row_length;
+  for(i = 1; i <= scan->count; i++) {
+    scan->buf[i * rel->row_length - 1] ^= ROW_XOR;
+  }
+
+  PRINTF("DB: Read %u rows from relation %s\n", scan->count, rel->name);
+
+  *row = scan->buf;
+  return DB_OK;
+}
+
+db_result_t
+storage_scan_summary(struct storage_scan *scan, tuple_id_t tuple_id,
+                     tuple_id_t *end, long *min, long *max)
+{
+#if DB_FEATURE_SERIES
+  if(RELATION_HAS_TUPLES(scan->rel) &&
+     (scan->rel->flags & RELATION_FLAG_SERIES)) {
+    return storage_series_scan_summary(scan, tuple_id, end, min, max);
+  }
+#endif /* DB_FEATURE_SERIES */
+
+  /* Only series relations have summaries of blocks of rows. */
+  return DB_FINISHED;
+}
+
 db_storage_id_t
 storage_open(const char *filename)
 {
@@ -0,0 +1,691 @@
+/*
+ * Copyright (c) 2015, EasyRF.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *     An append-only block format for the rows of series relations.
+ *
+ *     The tuple file of a series relation is divided into blocks of
+ *     DB_SERIES_BLOCK_SIZE bytes. Within a block, each attribute value
+ *     is stored as its difference from the value in the previous row,
+ *     in zigzag and variable-length encoding. The first row of a block
+ *     is stored as its difference from zero, so that a block can be
+ *     decoded without reading the blocks before it. Rows are written
+ *     to the file as soon as they are inserted. When a row does not fit
+ *     in the last block, the block is padded and closed with a summary
+ *     of its rows: the first tuple ID, the number of rows, and the
+ *     minimum and maximum value of each attribute. Scans use the
+ *     summaries to find rows by their tuple IDs, and to skip blocks
+ *     that cannot hold any rows of interest to a query.
+ *
+ *     The last byte of an encoded value has its most significant bit
+ *     set, as does the last byte of a summary, so the file never ends
+ *     with a zero byte that would make Coffee misjudge its length.
+ */
+
+#include <limits.h>
+#include <string.h>
+
+#include "cfs/cfs.h"
+
+#include "db-options.h"
+#include "result.h"
+#include "storage.h"
+
+#define DEBUG DEBUG_NONE
+#include "net/ip/uip-debug.h"
+
+#if DB_FEATURE_SERIES
+
+#define BLOCK_SIZE              DB_SERIES_BLOCK_SIZE
+#define SUMMARY_MAGIC           0xa5
+#define SUMMARY_SIZE(rel)       ((rel)->attribute_count * 8 + 7)
+#define MAX_SUMMARY_SIZE        (DB_MAX_ATTRIBUTES_PER_RELATION * 8 + 7)
+#define MAX_VARINT_SIZE         5
+#define MAX_ROW_SIZE            (DB_MAX_ATTRIBUTES_PER_RELATION * \
+                                 MAX_VARINT_SIZE)
+#define NOT_DECODED             UINT_MAX
+
+#if BLOCK_SIZE < MAX_SUMMARY_SIZE + MAX_ROW_SIZE || BLOCK_SIZE > 65535
+#error "DB_SERIES_BLOCK_SIZE is out of range."
+#endif
+
+/* The last block of the series relation that rows were most
+   recently appended to. The state is kept while the tuple file is
+   closed between queries, so it is identified by the file name. */
+static struct {
+  char file[RELATION_NAME_LENGTH + 1];
+  unsigned long block;
+  tuple_id_t first;
+  unsigned used;
+  unsigned count;
+  uint32_t prev[DB_MAX_ATTRIBUTES_PER_RELATION];
+  long min[DB_MAX_ATTRIBUTES_PER_RELATION];
+  long max[DB_MAX_ATTRIBUTES_PER_RELATION];
+} state;
+
+/* The most recently read block. */
+static unsigned char block_buf[BLOCK_SIZE];
+static char block_file[RELATION_NAME_LENGTH + 1];
+static unsigned long block_no;
+static unsigned block_length;
+
+#define IS_FILE(file, rel)      ((file)[0] != '\0' && \
+                                 strcmp((file), (rel)->tuple_filename) == 0)
+#define SET_FILE(file, rel)     strcpy((file), (rel)->tuple_filename)
+#define CLEAR_FILE(file)        ((file)[0] = '\0')
+
+static uint32_t
+get_long(const unsigned char *ptr)
+{
+  return (uint32_t)ptr[0] << 24 | (uint32_t)ptr[1] << 16 |
+         (uint32_t)ptr[2] << 8 | ptr[3];
+}
+
+static void
+put_long(unsigned char *ptr, uint32_t value)
+{
+  ptr[0] = value >> 24;
+  ptr[1] = value >> 16;
+  ptr[2] = value >> 8;
+  ptr[3] = value;
+}
+
+static uint32_t
+get_element(attribute_t *attr, const unsigned char *ptr)
+{
+  if(attr->domain == DOMAIN_INT) {
+    return (uint32_t)ptr[0] << 8 | ptr[1];
+  }
+  return get_long(ptr);
+}
+
+static void
+put_element(attribute_t *attr, unsigned char *ptr, uint32_t value)
+{
+  if(attr->domain == DOMAIN_INT) {
+    ptr[0] = value >> 8;
+    ptr[1] = value;
+  } else {
+    put_long(ptr, value);
+  }
+}
+
+static unsigned
+put_varint(unsigned char *ptr, uint32_t value)
+{
+  unsigned length;
+
+  for(length = 0; value >= 0x80; length++) {
+    ptr[length] = value & 0x7f;
+    value >>= 7;
+  }
+  ptr[length++] = value | 0x80;
+
+  return length;
+}
+
+static unsigned
+get_varint(const unsigned char *ptr, unsigned size, uint32_t *value)
+{
+  unsigned length;
+
+  *value = 0;
+  for(length = 0; length < size && length < MAX_VARINT_SIZE; length++) {
+    *value |= (uint32_t)(ptr[length] & 0x7f) << (7 * length);
+    if(ptr[length] & 0x80) {
+      return length + 1;
+    }
+  }
+
+  /* The value is incomplete. */
+  return 0;
+}
+
+static unsigned
+encode_row(relation_t *rel, const unsigned char *row, const uint32_t *prev,
+           unsigned char *buf)
+{
+  attribute_t *attr;
+  unsigned length;
+  unsigned i;
+  int32_t delta;
+
+  length = 0;
+  for(i = 0, attr = list_head(rel->attributes);
+      attr != NULL;
+      i++, attr = attr->next) {
+    delta = (int32_t)(get_element(attr, row) - prev[i]);
+    length += put_varint(buf + length,
+                         (uint32_t)delta << 1 ^ (uint32_t)(delta >> 31));
+    row += attr->element_size;
+  }
+
+  return length;
+}
+
+/* Decodes a row, and updates the previous values with it. Gives the
+   length of the encoded row, or 0 if the row is incomplete. */
+static unsigned
+decode_row(relation_t *rel, const unsigned char *ptr, unsigned size,
+           uint32_t *prev, unsigned char *row)
+{
+  attribute_t *attr;
+  unsigned char *row_ptr;
+  unsigned length;
+  unsigned r;
+  unsigned i;
+  uint32_t value;
+
+  length = 0;
+  row_ptr = row;
+  for(i = 0, attr = list_head(rel->attributes);
+      attr != NULL;
+      i++, attr = attr->next) {
+    r = get_varint(ptr + length, size - length, &value);
+    if(r == 0) {
+      return 0;
+    }
+    length += r;
+    put_element(attr, row_ptr, prev[i] + (value >> 1 ^ -(value & 1)));
+    row_ptr += attr->element_size;
+  }
+
+  for(i = 0, attr = list_head(rel->attributes);
+      attr != NULL;
+      i++, attr = attr->next) {
+    prev[i] = get_element(attr, row);
+    row += attr->element_size;
+  }
+
+  return length;
+}
+
+static int
+read_bytes(db_storage_id_t fd, unsigned long offset,
+           unsigned char *buf, unsigned length)
+{
+  unsigned total;
+  int r;
+
+  if(cfs_seek(fd, offset, CFS_SEEK_SET) == (cfs_offset_t)-1) {
+    return -1;
+  }
+
+  for(total = 0; total < length; total += r) {
+    r = cfs_read(fd, buf + total, length - total);
+    if(r < 0) {
+      return -1;
+    } else if(r == 0) {
+      break;
+    }
+  }
+
+  return total;
+}
+
+static unsigned char *
+read_block(relation_t *rel, unsigned long block)
+{
+  int r;
+
+  if(!IS_FILE(block_file, rel) || block_no != block) {
+    CLEAR_FILE(block_file);
+    r = read_bytes(rel->tuple_storage, block * BLOCK_SIZE,
+                   block_buf, BLOCK_SIZE);
+    if(r < 0) {
+      PRINTF("DB: Failed to read block %lu of %s\n", block, rel->name);
+      return NULL;
+    }
+    SET_FILE(block_file, rel);
+    block_no = block;
+    block_length = r;
+  }
+
+  return block_buf;
+}
+
+static db_result_t
+read_summary(relation_t *rel, unsigned long block, tuple_id_t *first,
+             unsigned *count, long *min, long *max)
+{
+  unsigned char buf[MAX_SUMMARY_SIZE];
+  unsigned char *ptr;
+  unsigned size;
+  unsigned i;
+
+  size = SUMMARY_SIZE(rel);
+  if(IS_FILE(block_file, rel) && block_no == block &&
+     block_length == BLOCK_SIZE) {
+    ptr = block_buf + BLOCK_SIZE - size;
+  } else {
+    ptr = buf;
+    if(read_bytes(rel->tuple_storage, (block + 1) * BLOCK_SIZE - size,
+                  buf, size) != size) {
+      return DB_STORAGE_ERROR;
+    }
+  }
+
+  if(ptr[size - 1] != SUMMARY_MAGIC) {
+    PRINTF("DB: Invalid summary in block %lu of %s\n", block, rel->name);
+    return DB_STORAGE_ERROR;
+  }
+
+  for(i = 0; i < rel->attribute_count; i++, ptr += 8) {
+    if(min != NULL) {
+      min[i] = (int32_t)get_long(ptr);
+      max[i] = (int32_t)get_long(ptr + 4);
+    }
+  }
+  *first = get_long(ptr);
+  *count = ptr[4] << 8 | ptr[5];
+
+  return DB_OK;
+}
+
+static void
+start_block(void)
+{
+  unsigned i;
+
+  state.used = 0;
+  state.count = 0;
+  for(i = 0; i < DB_MAX_ATTRIBUTES_PER_RELATION; i++) {
+    state.prev[i] = 0;
+    state.min[i] = LONG_MAX;
+    state.max[i] = LONG_MIN;
+  }
+}
+
+static void
+add_row(relation_t *rel, const unsigned char *row)
+{
+  attribute_t *attr;
+  attribute_value_t value;
+  unsigned i;
+  long l;
+
+  for(i = 0, attr = list_head(rel->attributes);
+      attr != NULL;
+      i++, attr = attr->next) {
+    state.prev[i] = get_element(attr, row);
+    /* Summarize the values in the signed order in which predicates
+       compare them. Series relations have only INT and LONG
+       attributes. */
+    db_phy_to_value(&value, attr, (unsigned char *)row);
+    l = db_value_to_long(&value);
+    if(l < state.min[i]) {
+      state.min[i] = l;
+    }
+    if(l > state.max[i]) {
+      state.max[i] = l;
+    }
+    row += attr->element_size;
+  }
+  state.count++;
+}
+
+static db_result_t
+load_state(relation_t *rel)
+{
+  cfs_offset_t end;
+  unsigned char row[DB_MAX_ATTRIBUTES_PER_RELATION * 4];
+  unsigned char *ptr;
+  tuple_id_t first;
+  unsigned count;
+  unsigned r;
+
+  if(IS_FILE(state.file, rel)) {
+    return DB_OK;
+  }
+
+  end = cfs_seek(rel->tuple_storage, 0, CFS_SEEK_END);
+  if(end == (cfs_offset_t)-1) {
+    return DB_STORAGE_ERROR;
+  }
+
+  CLEAR_FILE(state.file);
+  state.block = end / BLOCK_SIZE;
+  state.first = 0;
+  if(state.block > 0) {
+    if(DB_ERROR(read_summary(rel, state.block - 1, &first, &count,
+                             NULL, NULL))) {
+      return DB_STORAGE_ERROR;
+    }
+    state.first = first + count;
+  }
+
+  start_block();
+  ptr = read_block(rel, state.block);
+  if(ptr == NULL) {
+    return DB_STORAGE_ERROR;
+  }
+
+  /* Recover the last block. An incomplete row at its end, left by an
+     interrupted insertion, will be overwritten by the next row. */
+  for(;;) {
+    r = decode_row(rel, ptr + state.used, block_length - state.used,
+                   state.prev, row);
+    if(r == 0) {
+      break;
+    }
+    state.used += r;
+    add_row(rel, row);
+  }
+
+  PRINTF("DB: Relation %s has %lu full blocks and %u rows in the last\n",
+         rel->name, state.block, state.count);
+
+  SET_FILE(state.file, rel);
+  return DB_OK;
+}
+
+static db_result_t
+seal_block(relation_t *rel)
+{
+  unsigned char *ptr;
+  unsigned size;
+  unsigned i;
+
+  /* Pad the block and put the summary at its end. The block buffer
+     is used for composing the rest of the block. */
+  CLEAR_FILE(block_file);
+  size = SUMMARY_SIZE(rel);
+  memset(block_buf + state.used, 0, BLOCK_SIZE - size - state.used);
+
+  ptr = block_buf + BLOCK_SIZE - size;
+  for(i = 0; i < rel->attribute_count; i++, ptr += 8) {
+    put_long(ptr, (uint32_t)state.min[i]);
+    put_long(ptr + 4, (uint32_t)state.max[i]);
+  }
+  put_long(ptr, state.first);
+  ptr[4] = state.count >> 8;
+  ptr[5] = state.count;
+  ptr[6] = SUMMARY_MAGIC;
+
+  if(DB_ERROR(storage_write(rel->tuple_storage, block_buf + state.used,
+                            state.block * BLOCK_SIZE + state.used,
+                            BLOCK_SIZE - state.used))) {
+    return DB_STORAGE_ERROR;
+  }
+
+  PRINTF("DB: Sealed block %lu of %s with %u rows\n",
+         state.block, rel->name, state.count);
+
+  state.first += state.count;
+  state.block++;
+  start_block();
+
+  return DB_OK;
+}
+
+void
+storage_series_drop(relation_t *rel)
+{
+  if(IS_FILE(state.file, rel)) {
+    CLEAR_FILE(state.file);
+  }
+  if(IS_FILE(block_file, rel)) {
+    CLEAR_FILE(block_file);
+  }
+}
+
+db_result_t
+storage_series_put_row(relation_t *rel, storage_row_t row)
+{
+  unsigned char buf[MAX_ROW_SIZE];
+  unsigned length;
+
+  if(DB_ERROR(load_state(rel))) {
+    return DB_STORAGE_ERROR;
+  }
+
+  length = encode_row(rel, row, state.prev, buf);
+  if(state.used + length > BLOCK_SIZE - SUMMARY_SIZE(rel)) {
+    if(DB_ERROR(seal_block(rel))) {
+      CLEAR_FILE(state.file);
+      return DB_STORAGE_ERROR;
+    }
+    length = encode_row(rel, row, state.prev, buf);
+  }
+
+  if(DB_ERROR(storage_write(rel->tuple_storage, buf,
+                            state.block * BLOCK_SIZE + state.used,
+                            length))) {
+    CLEAR_FILE(state.file);
+    CLEAR_FILE(block_file);
+    return DB_STORAGE_ERROR;
+  }
+
+  /* Keep a cached copy of the last block up to date. */
+  if(IS_FILE(block_file, rel) && block_no == state.block) {
+    memcpy(block_buf + state.used, buf, length);
+    block_length = state.used + length;
+  }
+
+  state.used += length;
+  add_row(rel, row);
+
+  return DB_OK;
+}
+
+db_result_t
+storage_series_get_row_amount(relation_t *rel, tuple_id_t *amount)
+{
+  if(DB_ERROR(load_state(rel))) {
+    return DB_STORAGE_ERROR;
+  }
+
+  *amount = state.first + state.count;
+  return DB_OK;
+}
+
+db_result_t
+storage_series_get_row(relation_t *rel, tuple_id_t tuple_id,
+                       storage_row_t row)
+{
+  struct storage_scan scan;
+  storage_row_t ptr;
+
+  scan.rel = rel;
+  scan.buf = row;
+  scan.size = rel->row_length;
+  scan.count = 0;
+  scan.first = 0;
+
+  if(DB_ERROR(storage_series_scan_init(&scan))) {
+    return DB_STORAGE_ERROR;
+  }
+
+  return storage_series_scan_get(&scan, tuple_id, &ptr);
+}
+
+db_result_t
+storage_series_scan_init(struct storage_scan *scan)
+{
+  if(DB_ERROR(load_state(scan->rel))) {
+    return DB_STORAGE_ERROR;
+  }
+
+  scan->nrows = state.first + state.count;
+  scan->blocks = state.block;
+  scan->last_first = state.first;
+
+  /* No block has been located yet, and the first block follows. */
+  scan->block = (unsigned long)-1;
+  scan->block_first = 0;
+  scan->block_end = 0;
+  scan->offset = NOT_DECODED;
+
+  return DB_OK;
+}
+
+/* Finds the block that holds a tuple, and the summary of the block
+   unless it is the last one. */
+static db_result_t
+locate_block(struct storage_scan *scan, tuple_id_t tuple_id,
+             long *min, long *max)
+{
+  unsigned long low;
+  unsigned long high;
+  unsigned long block;
+  tuple_id_t first;
+  unsigned count;
+
+  if(tuple_id >= scan->last_first) {
+    block = scan->blocks;
+    first = scan->last_first;
+    count = scan->nrows - first;
+  } else if(tuple_id == scan->block_end) {
+    block = scan->block + 1;
+    if(DB_ERROR(read_summary(scan->rel, block, &first, &count, min, max))) {
+      return DB_STORAGE_ERROR;
+    }
+  } else {
+    /* Search the summaries of the full blocks. */
+    low = 0;
+    high = scan->blocks;
+    for(;;) {
+      if(low >= high) {
+        return DB_STORAGE_ERROR;
+      }
+      block = low + (high - low) / 2;
+      if(DB_ERROR(read_summary(scan->rel, block, &first, &count,
+                               min, max))) {
+        return DB_STORAGE_ERROR;
+      }
+      if(tuple_id < first) {
+        high = block;
+      } else if(tuple_id >= first + count) {
+        low = block + 1;
+      } else {
+        break;
+      }
+    }
+  }
+
+  scan->block = block;
+  scan->block_first = first;
+  scan->block_end = first + count;
+  scan->offset = NOT_DECODED;
+
+  return DB_OK;
+}
+
+db_result_t
+storage_series_scan_get(struct storage_scan *scan, tuple_id_t tuple_id,
+                        storage_row_t *row)
+{
+  relation_t *rel;
+  unsigned char *ptr;
+  unsigned capacity;
+  unsigned r;
+
+  rel = scan->rel;
+
+  if(tuple_id >= scan->nrows) {
+    return DB_FINISHED;
+  }
+
+  if(tuple_id >= scan->first && tuple_id < scan->first + scan->count) {
+    *row = scan->buf + (tuple_id - scan->first) * rel->row_length;
+    return DB_OK;
+  }
+
+  if(tuple_id < scan->block_first || tuple_id >= scan->block_end) {
+    if(tuple_id == scan->block_end && scan->block + 1 < scan->blocks) {
+      /* The next block will be decoded, so read its summary along
+         with the rest of it. */
+      read_block(rel, scan->block + 1);
+    }
+    if(DB_ERROR(locate_block(scan, tuple_id, NULL, NULL))) {
+      PRINTF("DB: No block for tuple %lu in %s\n",
+             (unsigned long)tuple_id, rel->name);
+      return DB_STORAGE_ERROR;
+    }
+  }
+
+  ptr = read_block(rel, scan->block);
+  if(ptr == NULL) {
+    return DB_STORAGE_ERROR;
+  }
+
+  if(scan->offset == NOT_DECODED || tuple_id < scan->next) {
+    scan->offset = 0;
+    scan->next = scan->block_first;
+    memset(scan->prev, 0, sizeof(scan->prev));
+  }
+
+  /* Decode rows up to the requested one, and then as many rows as
+     the buffer can hold. */
+  capacity = scan->size / rel->row_length;
+  scan->first = tuple_id;
+  scan->count = 0;
+  while(scan->next < scan->block_end && scan->count < capacity) {
+    r = decode_row(rel, ptr + scan->offset, block_length - scan->offset,
+                   scan->prev, scan->buf + scan->count * rel->row_length);
+    if(r == 0) {
+      PRINTF("DB: Corrupt block %lu in %s\n", scan->block, rel->name);
+      scan->offset = NOT_DECODED;
+      scan->count = 0;
+      return DB_STORAGE_ERROR;
+    }
+    scan->offset += r;
+    if(scan->next++ >= tuple_id) {
+      scan->count++;
+    }
+  }
+
+  PRINTF("DB: Decoded %u rows from relation %s\n", scan->count, rel->name);
+
+  *row = scan->buf;
+  return DB_OK;
+}
+
+db_result_t
+storage_series_scan_summary(struct storage_scan *scan, tuple_id_t tuple_id,
+                            tuple_id_t *end, long *min, long *max)
+{
+  /* Only full blocks that the scan has not entered have summaries. */
+  if(tuple_id != scan->block_end || tuple_id >= scan->last_first) {
+    return DB_FINISHED;
+  }
+
+  if(DB_ERROR(locate_block(scan, tuple_id, min, max))) {
+    return DB_STORAGE_ERROR;
+  }
+
+  *end = scan->block_end;
+  return DB_OK;
+}
+
+#endif /* DB_FEATURE_SERIES */
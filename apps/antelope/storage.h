@@ -50,6 +50,33 @@
 
 typedef unsigned char * storage_row_t;
 
+/*
+ * A cursor for reading the rows of a relation. The number of rows is
+ * determined once, and consecutive tuple IDs are read in batches into
+ * the buffer. Other tuple IDs are read one row at a time.
+ */
+struct storage_scan {
+  relation_t *rel;
+  unsigned char *buf;
+  unsigned size;
+  unsigned count;
+  tuple_id_t first;
+  tuple_id_t nrows;
+#if DB_FEATURE_SERIES
+  /* The number of full blocks in a series relation and the first row
+     of the last block, the block that holds the rows in the buffer,
+     and the state of its decoder. */
+  unsigned long blocks;
+  tuple_id_t last_first;
+  unsigned long block;
+  tuple_id_t block_first;
+  tuple_id_t block_end;
+  tuple_id_t next;
+  unsigned offset;
+  uint32_t prev[DB_MAX_ATTRIBUTES_PER_RELATION];
+#endif /* DB_FEATURE_SERIES */
+};
+
 char *storage_generate_file(char *, unsigned long);
 
 db_result_t storage_load(relation_t *);
@@ -68,9 +95,29 @@ db_result_t storage_get_row(relation_t *, tuple_id_t *, storage_row_t);
 db_result_t storage_put_row(relation_t *, storage_row_t);
 db_result_t storage_get_row_amount(relation_t *, tuple_id_t *);
 
+db_result_t storage_scan_init(struct storage_scan *, relation_t *,
+                              unsigned char *, unsigned);
+db_result_t storage_scan_get(struct storage_scan *, tuple_id_t,
+                             storage_row_t *);
+db_result_t storage_scan_summary(struct storage_scan *, tuple_id_t,
+                                 tuple_id_t *, long *, long *);
+
 db_storage_id_t storage_open(const char *);
 void storage_close(db_storage_id_t);
 db_result_t storage_read(db_storage_id_t, void *, unsigned long, unsigned);
 db_result_t storage_write(db_storage_id_t, void *, unsigned long, unsigned);
 
+#if DB_FEATURE_SERIES
+/* The block format of series relations, used by the CFS backend. */
+void storage_series_drop(relation_t *);
+db_result_t storage_series_get_row(relation_t *, tuple_id_t, storage_row_t);
+db_result_t storage_series_put_row(relation_t *, storage_row_t);
+db_result_t storage_series_get_row_amount(relation_t *, tuple_id_t *);
+db_result_t storage_series_scan_init(struct storage_scan *);
+db_result_t storage_series_scan_get(struct storage_scan *, tuple_id_t,
+                                    storage_row_t *);
+db_result_t storage_series_scan_summary(struct storage_scan *, tuple_id_t,
+                                        tuple_id_t *, long *, long *);
+#endif /* DB_FEATURE_SERIES */
+
 #endif /* STORAGE_H */
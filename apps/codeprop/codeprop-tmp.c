@@ -50,6 +50,7 @@
  *    Point-to-point download over TCP
  *    Point-to-multipoint delivery over UDP broadcasts
  *    Versioning of code modules
+ *    Delta patches against the running program
  *
  * Procedure:
  *
@@ -61,6 +62,11 @@
  *    binary where the NACK pointed to. (This is *not* very efficient,
  *    but simple to implement...)
  *
+ *    A program that starts with the delta patch magic is a patch made
+ *    with tools/deltadiff against the running program. Only the patch
+ *    is propagated, and each node builds the new program in the image
+ *    file that is not in use, and verifies it before loading it.
+ *
  * States:
  *
  *  Receiving code header -> receiving code -> sending code
@@ -73,15 +79,26 @@
 #include "cfs/cfs.h"
 #include "codeprop-tmp.h"
 #include "loader/elfloader.h"
+#include "delta.h"
 #include <string.h>
 
 static const char *err_msgs[] =
   {"OK\r\n", "Bad ELF header\r\n", "No symtab\r\n", "No strtab\r\n",
    "No text\r\n", "Symbol not found\r\n", "Segment not found\r\n",
-   "No startpoint\r\n" };
+   "No startpoint\r\n", "Bad patch\r\n" };
 
 #define CODEPROP_DATA_PORT 6510
 
+/* The files that hold programs, indexed by the FILE_ constants. */
+static const char *files[] = { "codeprop-a", "codeprop-b", "codeprop-patch" };
+#define FILE_IMAGE_A 0
+#define FILE_IMAGE_B 1
+#define FILE_PATCH   2
+#define FILE_NONE    0xff
+
+/* Holds the index of the image of the running program across reboots. */
+#define IMAGE_STATE_FILE "codeprop-image"
+
 /*static int random_rand(void) { return 1; }*/
 
 #if 1
@@ -140,12 +157,19 @@ struct codeprop_state {
   struct pt recv_udpthread_pt;
 };
 
-static int fd;
+static int fd = -1;
+
+/* The image file of the running program, and the file that is
+   received. */
+static uint8_t image = FILE_NONE;
+static uint8_t received;
 
 static struct uip_udp_conn *udp_conn;
 
 static struct codeprop_state s;
 
+static void load_image_state(void);
+
 void system_log(char *msg);
 
 static clock_time_t send_time;
@@ -164,6 +188,7 @@ PROCESS_THREAD(codeprop_process, ev, data)
   PROCESS_BEGIN();
 
   elfloader_init();
+  load_image_state();
 
   s.id = 0/*random_rand()*/;
 
@@ -181,8 +206,6 @@ PROCESS_THREAD(codeprop_process, ev, data)
   s.addr = 0;
   s.len = 0;
 
-  fd = cfs_open("codeprop-image", CFS_READ | CFS_WRITE);
-
   while(1) {
 
     PROCESS_YIELD();
@@ -197,6 +220,60 @@ PROCESS_THREAD(codeprop_process, ev, data)
   PROCESS_END();
 }
 /*---------------------------------------------------------------------*/
+static uint8_t
+other_image(void)
+{
+  return image == FILE_IMAGE_A ? FILE_IMAGE_B : FILE_IMAGE_A;
+}
+/*---------------------------------------------------------------------*/
+/* Restores the image of the program that was last started, so that a
+   patch can still be applied against it after a reboot. */
+static void
+load_image_state(void)
+{
+  int state_fd;
+  uint8_t index;
+
+  image = FILE_NONE;
+  state_fd = cfs_open(IMAGE_STATE_FILE, CFS_READ);
+  if(state_fd >= 0) {
+    if(cfs_read(state_fd, &index, 1) == 1 &&
+       (index == FILE_IMAGE_A || index == FILE_IMAGE_B)) {
+      image = index;
+    }
+    cfs_close(state_fd);
+  }
+}
+/*---------------------------------------------------------------------*/
+static void
+save_image_state(void)
+{
+  int state_fd;
+
+  cfs_remove(IMAGE_STATE_FILE);
+  state_fd = cfs_open(IMAGE_STATE_FILE, CFS_WRITE);
+  if(state_fd >= 0) {
+    cfs_write(state_fd, &image, 1);
+    cfs_close(state_fd);
+  }
+}
+/*---------------------------------------------------------------------*/
+/* Opens the file for a new program, given its first bytes. */
+static void
+open_received(const uint8_t *data, int len)
+{
+  if(len >= 4 && memcmp(data, DELTA_MAGIC, 4) == 0) {
+    received = FILE_PATCH;
+  } else {
+    received = other_image();
+  }
+  if(fd >= 0) {
+    cfs_close(fd);
+  }
+  cfs_remove(files[received]);
+  fd = cfs_open(files[received], CFS_READ | CFS_WRITE);
+}
+/*---------------------------------------------------------------------*/
 static uint16_t
 send_udpdata(struct codeprop_udphdr *uh)
 {
@@ -307,6 +384,7 @@ PT_THREAD(recv_udpthread(struct pt *pt))
     s.addr = 0;
     s.id = uip_htons(uh->id);
     s.len = uip_htons(uh->len);
+    open_received(&uh->data[0], uip_datalen() - UDPHEADERSIZE);
 
     timer_set(&s.timer, CONNECTION_TIMEOUT);
 /*     process_post(PROCESS_BROADCAST, codeprop_event_quit, (process_data_t)NULL); */
@@ -397,6 +475,7 @@ PT_THREAD(recv_tcpthread(struct pt *pt))
     s.addr = 0;
     uip_appdata += sizeof(struct codeprop_tcphdr);
     datalen -= sizeof(struct codeprop_tcphdr);
+    open_received(uip_appdata, datalen);
     
     /* Read the rest of the data. */
     do {
@@ -463,12 +542,31 @@ codeprop_exit_program(void)
 int
 codeprop_start_program(void)
 {
+  uint8_t new_image;
+  int image_fd;
   int err;
 
   codeprop_exit_program();
 
-  err = elfloader_load(fd);
+  new_image = received;
+  if(received == FILE_PATCH) {
+    /* The patch is kept for the UDP broadcast, and the new program is
+       built next to the running one. */
+    new_image = other_image();
+    if(image == FILE_NONE ||
+       delta_patch_file(files[image], files[FILE_PATCH],
+                        files[new_image]) != DELTA_OK) {
+      PRINTF(("codeprop: bad patch\n"));
+      return CODEPROP_BAD_PATCH;
+    }
+  }
+
+  image_fd = cfs_open(files[new_image], CFS_READ);
+  err = elfloader_load(image_fd);
+  cfs_close(image_fd);
   if(err == ELFLOADER_OK) {
+    image = new_image;
+    save_image_state();
     PRINTF(("codeprop: starting %s\n",
 	    elfloader_autostart_processes[0]->name));
     autostart_start(elfloader_autostart_processes);
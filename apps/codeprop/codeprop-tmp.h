@@ -36,6 +36,10 @@
 
 #define CODEPROP_DATA_PORT 6510
 
+/* Returned by codeprop_start_program() when a delta patch does not
+   apply to the running program. */
+#define CODEPROP_BAD_PATCH 8
+
 PROCESS_NAME(codeprop_process);
 
 void codeprop_set_rate(clock_time_t time);
@@ -0,0 +1,392 @@
+/*
+ * Copyright (c) 2015, EasyRF.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *         Streaming patcher for delta-encoded firmware images.
+ */
+
+#include "contiki.h"
+#include "cfs/cfs.h"
+#include "delta.h"
+
+#include <string.h>
+
+#define DEBUG 0
+#if DEBUG
+#include <stdio.h>
+#define PRINTF(...) printf(__VA_ARGS__)
+#else
+#define PRINTF(...)
+#endif
+
+#define STATE_HEADER       0
+#define STATE_DIFF_LEN     1
+#define STATE_EXTRA_LEN    2
+#define STATE_SEEK         3
+#define STATE_RUN          4
+#define STATE_LITERAL      5
+#define STATE_EXTRA        6
+#define STATE_DONE         7
+
+#define HEADER_BASE_SIZE   4
+#define HEADER_NEW_SIZE    8
+#define HEADER_BASE_DIGEST 12
+#define HEADER_NEW_DIGEST  (HEADER_BASE_DIGEST + SHA256_DIGEST_LENGTH)
+/*---------------------------------------------------------------------------*/
+static uint32_t
+get32(const uint8_t *p)
+{
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+    ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+/*---------------------------------------------------------------------------*/
+int
+delta_digest(int fd, uint32_t len, uint8_t digest[SHA256_DIGEST_LENGTH])
+{
+  struct sha256_state state;
+  uint8_t buf[DELTA_BUF_SIZE];
+  int n;
+
+  if(cfs_seek(fd, 0, CFS_SEEK_SET) != 0) {
+    return -1;
+  }
+
+  sha256_init(&state);
+  while(len > 0) {
+    n = len < sizeof(buf) ? len : sizeof(buf);
+    if(cfs_read(fd, buf, n) != n) {
+      return -1;
+    }
+    sha256_update(&state, buf, n);
+    len -= n;
+  }
+  sha256_finish(&state, digest);
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+flush_new(struct delta_patch *p)
+{
+  if(p->new_buf_len > 0) {
+    if(cfs_write(p->new_fd, p->new_buf, p->new_buf_len) != p->new_buf_len) {
+      return DELTA_IO_ERROR;
+    }
+    p->new_buf_len = 0;
+  }
+  return DELTA_OK;
+}
+/*---------------------------------------------------------------------------*/
+static int
+put_new(struct delta_patch *p, uint8_t c)
+{
+  p->new_buf[p->new_buf_len++] = c;
+  p->new_pos++;
+  if(p->new_buf_len == sizeof(p->new_buf)) {
+    return flush_new(p);
+  }
+  return DELTA_OK;
+}
+/*---------------------------------------------------------------------------*/
+static int
+get_base(struct delta_patch *p, uint8_t *c)
+{
+  uint32_t left;
+  int n;
+
+  if(p->base_pos < p->base_buf_pos ||
+     p->base_pos >= p->base_buf_pos + p->base_buf_len) {
+    left = p->base_size - p->base_pos;
+    n = left < sizeof(p->base_buf) ? left : sizeof(p->base_buf);
+    if(cfs_seek(p->base_fd, p->base_pos, CFS_SEEK_SET) != p->base_pos ||
+       cfs_read(p->base_fd, p->base_buf, n) != n) {
+      p->base_buf_len = 0;
+      return DELTA_IO_ERROR;
+    }
+    p->base_buf_pos = p->base_pos;
+    p->base_buf_len = n;
+  }
+  *c = p->base_buf[p->base_pos++ - p->base_buf_pos];
+  return DELTA_OK;
+}
+/*---------------------------------------------------------------------------*/
+static int
+check_header(struct delta_patch *p)
+{
+  uint8_t digest[SHA256_DIGEST_LENGTH];
+
+  if(memcmp(p->header, DELTA_MAGIC, 4) != 0) {
+    return DELTA_BAD_HEADER;
+  }
+  p->base_size = get32(&p->header[HEADER_BASE_SIZE]);
+  p->new_size = get32(&p->header[HEADER_NEW_SIZE]);
+
+  /* The patch only applies to the exact base image it was made for. */
+  if(cfs_seek(p->base_fd, 0, CFS_SEEK_END) < (cfs_offset_t)p->base_size ||
+     delta_digest(p->base_fd, p->base_size, digest) < 0 ||
+     memcmp(digest, &p->header[HEADER_BASE_DIGEST], sizeof(digest)) != 0) {
+    return DELTA_BAD_BASE;
+  }
+
+  PRINTF("delta: patching %lu bytes into %lu bytes\n",
+         (unsigned long)p->base_size, (unsigned long)p->new_size);
+  return DELTA_OK;
+}
+/*---------------------------------------------------------------------------*/
+static void
+end_record(struct delta_patch *p)
+{
+  p->state = p->new_pos == p->new_size ? STATE_DONE : STATE_DIFF_LEN;
+}
+/*---------------------------------------------------------------------------*/
+/* Acts on a complete variable length integer. */
+static int
+handle_value(struct delta_patch *p)
+{
+  uint32_t value;
+  uint8_t c;
+  int err;
+
+  value = p->value;
+  p->value = 0;
+  p->shift = 0;
+
+  switch(p->state) {
+  case STATE_DIFF_LEN:
+    p->diff_left = value;
+    p->state = STATE_EXTRA_LEN;
+    break;
+  case STATE_EXTRA_LEN:
+    p->extra_left = value;
+    p->state = STATE_SEEK;
+    break;
+  case STATE_SEEK:
+    if(p->diff_left > p->new_size - p->new_pos ||
+       p->extra_left > p->new_size - p->new_pos - p->diff_left ||
+       p->diff_left > p->base_size - p->base_pos) {
+      return DELTA_BAD_FORMAT;
+    }
+    p->seek = (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+    p->state = STATE_RUN;
+    break;
+  case STATE_RUN:
+    p->run_left = value >> 1;
+    if(p->run_left == 0 || p->run_left > p->diff_left) {
+      return DELTA_BAD_FORMAT;
+    }
+    p->diff_left -= p->run_left;
+    if(value & 1) {
+      p->state = STATE_LITERAL;
+      return DELTA_OK;
+    }
+    for(; p->run_left > 0; p->run_left--) {
+      err = get_base(p, &c);
+      if(err == DELTA_OK) {
+        err = put_new(p, c);
+      }
+      if(err != DELTA_OK) {
+        return err;
+      }
+    }
+    break;
+  }
+  return DELTA_OK;
+}
+/*---------------------------------------------------------------------------*/
+/* Moves on when the diff data or the extra data of a record is done. */
+static int
+next_part(struct delta_patch *p)
+{
+  if(p->state == STATE_RUN || p->state == STATE_LITERAL) {
+    if(p->state == STATE_LITERAL && p->run_left > 0) {
+      return DELTA_OK;
+    }
+    if(p->diff_left > 0) {
+      p->state = STATE_RUN;
+      return DELTA_OK;
+    }
+    p->state = STATE_EXTRA;
+  }
+
+  if(p->state == STATE_EXTRA && p->extra_left == 0) {
+    if(p->seek < -(int32_t)p->base_pos ||
+       p->seek > (int32_t)(p->base_size - p->base_pos)) {
+      return DELTA_BAD_FORMAT;
+    }
+    p->base_pos += p->seek;
+    end_record(p);
+  }
+  return DELTA_OK;
+}
+/*---------------------------------------------------------------------------*/
+void
+delta_patch_init(struct delta_patch *p, int base_fd, int new_fd)
+{
+  memset(p, 0, sizeof(*p));
+  p->base_fd = base_fd;
+  p->new_fd = new_fd;
+  p->state = STATE_HEADER;
+}
+/*---------------------------------------------------------------------------*/
+int
+delta_patch_input(struct delta_patch *p, const uint8_t *data, uint16_t len)
+{
+  uint8_t c;
+  int err;
+
+  err = p->error;
+  while(err == DELTA_OK && len > 0) {
+    switch(p->state) {
+    case STATE_HEADER:
+      p->header[p->header_len++] = *data++;
+      len--;
+      if(p->header_len == DELTA_HEADER_SIZE) {
+        err = check_header(p);
+        if(err == DELTA_OK) {
+          p->state = p->new_size == 0 ? STATE_DONE : STATE_DIFF_LEN;
+        }
+      }
+      break;
+    case STATE_DIFF_LEN:
+    case STATE_EXTRA_LEN:
+    case STATE_SEEK:
+    case STATE_RUN:
+      if(p->shift > 28) {
+        err = DELTA_BAD_FORMAT;
+        break;
+      }
+      p->value |= (uint32_t)(*data & 0x7f) << p->shift;
+      p->shift += 7;
+      len--;
+      if(*data++ & 0x80) {
+        break;
+      }
+      err = handle_value(p);
+      if(err == DELTA_OK) {
+        err = next_part(p);
+      }
+      break;
+    case STATE_LITERAL:
+      err = get_base(p, &c);
+      if(err == DELTA_OK) {
+        err = put_new(p, c + *data++);
+        len--;
+        p->run_left--;
+      }
+      if(err == DELTA_OK) {
+        err = next_part(p);
+      }
+      break;
+    case STATE_EXTRA:
+      err = put_new(p, *data++);
+      len--;
+      p->extra_left--;
+      if(err == DELTA_OK) {
+        err = next_part(p);
+      }
+      break;
+    case STATE_DONE:
+      /* Ignore what follows the last record, such as the padding
+         that Deluge adds to fill the last page of an object. */
+      len = 0;
+      break;
+    }
+  }
+  p->error = err;
+  return err;
+}
+/*---------------------------------------------------------------------------*/
+int
+delta_patch_finish(struct delta_patch *p)
+{
+  uint8_t digest[SHA256_DIGEST_LENGTH];
+  int err;
+
+  if(p->error != DELTA_OK) {
+    return p->error;
+  }
+  if(p->state != STATE_DONE) {
+    return DELTA_INCOMPLETE;
+  }
+  err = flush_new(p);
+  if(err != DELTA_OK) {
+    return err;
+  }
+
+  /* Verify the image as it was stored, not as it was computed. */
+  if(delta_digest(p->new_fd, p->new_size, digest) < 0) {
+    return DELTA_IO_ERROR;
+  }
+  if(memcmp(digest, &p->header[HEADER_NEW_DIGEST], sizeof(digest)) != 0) {
+    PRINTF("delta: digest mismatch\n");
+    return DELTA_BAD_DIGEST;
+  }
+  return DELTA_OK;
+}
+/*---------------------------------------------------------------------------*/
+int
+delta_patch_file(const char *base, const char *patch, const char *new_image)
+{
+  static struct delta_patch p;
+  uint8_t buf[DELTA_BUF_SIZE];
+  int base_fd, patch_fd, new_fd;
+  int n, err;
+
+  cfs_remove(new_image);
+  base_fd = cfs_open(base, CFS_READ);
+  patch_fd = cfs_open(patch, CFS_READ);
+  new_fd = cfs_open(new_image, CFS_READ | CFS_WRITE);
+
+  err = DELTA_IO_ERROR;
+  if(base_fd >= 0 && patch_fd >= 0 && new_fd >= 0) {
+    delta_patch_init(&p, base_fd, new_fd);
+    err = DELTA_OK;
+    while(err == DELTA_OK && (n = cfs_read(patch_fd, buf, sizeof(buf))) > 0) {
+      err = delta_patch_input(&p, buf, n);
+    }
+    if(err == DELTA_OK) {
+      err = delta_patch_finish(&p);
+    }
+  }
+
+  if(base_fd >= 0) {
+    cfs_close(base_fd);
+  }
+  if(patch_fd >= 0) {
+    cfs_close(patch_fd);
+  }
+  if(new_fd >= 0) {
+    cfs_close(new_fd);
+  }
+  return err;
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2015, EasyRF.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *         Streaming patcher for delta-encoded firmware images.
+ *
+ *         A patch describes a new image in terms of a base image that
+ *         the node already has. It is made on the host with
+ *         tools/deltadiff and applied on the node while the patch is
+ *         read, either from a file or piece by piece as it arrives.
+ *         The new image is written sequentially to a file, and only a
+ *         few small buffers are needed regardless of the image size.
+ *
+ *         Patch format, with all integers in little endian byte order:
+ *
+ *         - A header of DELTA_HEADER_SIZE bytes: the magic "DLT1",
+ *           the size of the base image, the size of the new image, the
+ *           SHA-256 digest of the base image and the SHA-256 digest of
+ *           the new image. Sizes are four bytes each.
+ *
+ *         - A sequence of records until the new image is complete.
+ *           Each record starts with three variable length integers
+ *           (seven bits per byte, least significant group first, high
+ *           bit set on all bytes but the last): the diff length, the
+ *           extra length and the zigzag encoded seek distance.
+ *
+ *         - The diff data, diff length bytes of the new image that are
+ *           computed from the base image at the current base position.
+ *           It is a sequence of runs, each starting with a variable
+ *           length integer n * 2 + literal. A run with literal zero
+ *           copies n bytes of the base image; a literal run is followed
+ *           by n bytes that are added to the base bytes.
+ *
+ *         - The extra data, extra length bytes that are copied to the
+ *           new image as they are. Then the seek distance is added to
+ *           the base position.
+ *
+ *         Any bytes after the record that completes the new image are
+ *         ignored, so a patch may be padded to a whole number of pages.
+ *
+ *         The digest of the base image is checked before anything is
+ *         written, and the digest of the stored new image must be
+ *         checked with delta_patch_finish() before it is activated.
+ */
+
+#ifndef DELTA_H_
+#define DELTA_H_
+
+#include "contiki.h"
+#include "lib/sha256.h"
+
+#define DELTA_MAGIC         "DLT1"
+#define DELTA_HEADER_SIZE   (4 + 4 + 4 + 2 * SHA256_DIGEST_LENGTH)
+
+/* The size of the buffers for the base and the new image. */
+#ifdef DELTA_CONF_BUF_SIZE
+#define DELTA_BUF_SIZE DELTA_CONF_BUF_SIZE
+#else
+#define DELTA_BUF_SIZE 32
+#endif
+
+#define DELTA_OK            0
+#define DELTA_BAD_HEADER    1
+#define DELTA_BAD_BASE      2
+#define DELTA_BAD_FORMAT    3
+#define DELTA_IO_ERROR      4
+#define DELTA_INCOMPLETE    5
+#define DELTA_BAD_DIGEST    6
+
+struct delta_patch {
+  int base_fd;
+  int new_fd;
+  uint32_t base_size;
+  uint32_t new_size;
+  uint32_t base_pos;
+  uint32_t new_pos;
+  uint32_t diff_left;
+  uint32_t extra_left;
+  uint32_t run_left;
+  int32_t seek;
+  uint32_t value;
+  uint8_t shift;
+  uint8_t state;
+  uint8_t error;
+  uint8_t header_len;
+  uint8_t header[DELTA_HEADER_SIZE];
+  uint32_t base_buf_pos;
+  uint8_t base_buf_len;
+  uint8_t new_buf_len;
+  uint8_t base_buf[DELTA_BUF_SIZE];
+  uint8_t new_buf[DELTA_BUF_SIZE];
+};
+
+/**
+ * \brief Prepares to patch a base image.
+ * \param p       The patch state.
+ * \param base_fd A file descriptor open for reading the base image.
+ * \param new_fd  A file descriptor open for reading and writing the
+ *                new image.
+ *
+ * The new image is written from the start of new_fd.
+ */
+void delta_patch_init(struct delta_patch *p, int base_fd, int new_fd);
+
+/**
+ * \brief Applies the next part of a patch.
+ * \return DELTA_OK, or an error code. After an error, all further
+ *         input is rejected with the same error.
+ */
+int delta_patch_input(struct delta_patch *p, const uint8_t *data, uint16_t len);
+
+/**
+ * \brief Completes the new image and verifies its digest.
+ * \return DELTA_OK if the stored image is complete and intact.
+ *
+ * The digest is computed over the image as it was read back from
+ * new_fd, so that the image is verified as it was stored.
+ */
+int delta_patch_finish(struct delta_patch *p);
+
+/**
+ * \brief Builds a new image from a base image and a patch file.
+ * \return DELTA_OK if the new image has been written and verified.
+ */
+int delta_patch_file(const char *base, const char *patch, const char *new_image);
+
+/**
+ * \brief Computes the SHA-256 digest of the first len bytes of a file.
+ * \return Zero on success, or -1 if the file is shorter than len.
+ */
+int delta_digest(int fd, uint32_t len, uint8_t digest[SHA256_DIGEST_LENGTH]);
+
+#endif /* DELTA_H_ */
@@ -71,6 +71,7 @@ static struct broadcast_conn deluge_broadcast;
 static struct unicast_conn deluge_uc;
 static struct deluge_object current_object;
 static process_event_t deluge_event;
+static void (*update_callback)(char *file, unsigned version);
 
 /* Deluge variables. */
 static int deluge_state;
@@ -100,57 +101,84 @@ static const struct unicast_callbacks unicast_call = {unicast_recv, NULL};
 /* The Deluge process manages the main Deluge timer. */
 PROCESS(deluge_process, "Deluge");
 
+/*
+ * The RX and TX states are independent, so that a node can serve the
+ * pages that it has while it receives later pages. The summary and
+ * profile timers are stopped when the node leaves the maintenance
+ * state.
+ */
 static void
-transition(int state)
+enter_state(int state)
 {
-  if(state != deluge_state) {
-    switch(deluge_state) {
-    case DELUGE_STATE_MAINTAIN:
-      ctimer_stop(&summary_timer);
-      ctimer_stop(&profile_timer);
-      break;
-    case DELUGE_STATE_RX:
-      ctimer_stop(&rx_timer);
-      break;
-    case DELUGE_STATE_TX:
-      ctimer_stop(&tx_timer);
-      break;
-    }
-    deluge_state = state;
+  if(deluge_state == DELUGE_STATE_MAINTAIN) {
+    ctimer_stop(&summary_timer);
+    ctimer_stop(&profile_timer);
+  }
+  deluge_state |= state;
+}
+
+static void
+leave_state(int state)
+{
+  switch(state) {
+  case DELUGE_STATE_RX:
+    ctimer_stop(&rx_timer);
+    break;
+  case DELUGE_STATE_TX:
+    ctimer_stop(&tx_timer);
+    break;
+  }
+  deluge_state &= ~state;
+}
+
+/*
+ * Start a new round with the shortest interval, like a Trickle timer
+ * does when it hears an inconsistency, instead of waiting for the end
+ * of the current round.
+ */
+static void
+reset_round(void)
+{
+  neighbor_inconsistency = 1;
+  if(r_interval > T_LOW) {
+    process_post(&deluge_process, deluge_event, NULL);
   }
 }
 
 static int
-write_page(struct deluge_object *obj, unsigned pagenum, unsigned char *data)
+write_packet(struct deluge_object *obj, unsigned pagenum, unsigned packetnum,
+             unsigned char *data)
 {
   cfs_offset_t offset;
 
-  offset = pagenum * S_PAGE;
+  offset = (cfs_offset_t)pagenum * S_PAGE + packetnum * S_PKT;
 
   if(cfs_seek(obj->cfs_fd, offset, CFS_SEEK_SET) != offset) {
     return -1;
   }
-  return cfs_write(obj->cfs_fd, (char *)data, S_PAGE);
+  return cfs_write(obj->cfs_fd, (char *)data, S_PKT);
 }
 
 static int
-read_page(struct deluge_object *obj, unsigned pagenum, unsigned char *buf)
+read_packet(struct deluge_object *obj, unsigned pagenum, unsigned packetnum,
+            unsigned char *buf)
 {
   cfs_offset_t offset;
 
-  offset = pagenum * S_PAGE;
+  offset = (cfs_offset_t)pagenum * S_PAGE + packetnum * S_PKT;
 
   if(cfs_seek(obj->cfs_fd, offset, CFS_SEEK_SET) != offset) {
     return -1;
   }
-  return cfs_read(obj->cfs_fd, (char *)buf, S_PAGE);
+  return cfs_read(obj->cfs_fd, (char *)buf, S_PKT);
 }
 
 static void
 init_page(struct deluge_object *obj, int pagenum, int have)
 {
   struct deluge_page *page;
-  unsigned char buf[S_PAGE];
+  unsigned char buf[S_PKT];
+  int i;
 
   page = &obj->pages[pagenum];
 
@@ -162,8 +190,11 @@ init_page(struct deluge_object *obj, int pagenum, int have)
     page->version = obj->version;
     page->packet_set = ALL_PACKETS;
     page->flags |= PAGE_COMPLETE;
-    read_page(obj, pagenum, buf);
-    page->crc = crc16_data(buf, S_PAGE, 0);
+    page->crc = 0;
+    for(i = 0; i < N_PKT; i++) {
+      read_packet(obj, pagenum, i, buf);
+      page->crc = crc16_data(buf, S_PKT, page->crc);
+    }
   } else {
     page->version = 0;
     page->packet_set = 0;
@@ -187,6 +218,16 @@ file_size(const char *file)
   return size;
 }
 
+static void
+expire_requests(struct deluge_object *obj)
+{
+  int i;
+
+  for(i = 0; i < DELUGE_RX_WINDOW; i++) {
+    obj->request_time[i] = clock_time() - T_RX_RETRY;
+  }
+}
+
 static int
 init_object(struct deluge_object *obj, char *filename, unsigned version)
 {
@@ -204,7 +245,9 @@ init_object(struct deluge_object *obj, char *filename, unsigned version)
   obj->version = obj->update_version = version;
   obj->current_rx_page = 0;
   obj->nrequests = 0;
-  obj->tx_set = 0;
+  memset(obj->neighbors, 0, sizeof(obj->neighbors));
+  memset(obj->tx_queue, 0, sizeof(obj->tx_queue));
+  expire_requests(obj);
 
   obj->pages = malloc(OBJECT_PAGE_COUNT(*obj) * sizeof(*obj->pages));
   if(obj->pages == NULL) {
@@ -217,8 +260,6 @@ init_object(struct deluge_object *obj, char *filename, unsigned version)
     init_page(&current_object, i, 1);
   }
 
-  memset(obj->current_page, 0, sizeof(obj->current_page));
-
   return 0;
 }
 
@@ -236,32 +277,145 @@ highest_available_page(struct deluge_object *obj)
   return i;
 }
 
+static void
+update_neighbor(struct deluge_object *obj, const linkaddr_t *addr,
+                unsigned highest_available)
+{
+  struct deluge_neighbor *n, *oldest;
+  int i;
+
+  oldest = NULL;
+  for(i = 0; i < DELUGE_NEIGHBORS; i++) {
+    n = &obj->neighbors[i];
+    if(linkaddr_cmp(&n->addr, addr)) {
+      oldest = n;
+      break;
+    }
+    if(oldest == NULL || n->highest_available == 0 ||
+       (oldest->highest_available != 0 &&
+        n->last_heard < oldest->last_heard)) {
+      oldest = n;
+    }
+  }
+
+  linkaddr_copy(&oldest->addr, addr);
+  oldest->highest_available = highest_available;
+  oldest->last_heard = clock_time();
+}
+
+static struct deluge_neighbor *
+select_neighbor(struct deluge_object *obj, unsigned pagenum)
+{
+  int i, count, choice;
+
+  count = 0;
+  for(i = 0; i < DELUGE_NEIGHBORS; i++) {
+    if(obj->neighbors[i].highest_available > pagenum) {
+      count++;
+    }
+  }
+  if(count == 0) {
+    return NULL;
+  }
+
+  /* Spread the pages over the neighbors that have them, and move on
+     to another neighbor when a request is repeated. */
+  choice = (pagenum + obj->nrequests) % count;
+  for(i = 0; i < DELUGE_NEIGHBORS; i++) {
+    if(obj->neighbors[i].highest_available > pagenum && choice-- == 0) {
+      return &obj->neighbors[i];
+    }
+  }
+  return NULL;
+}
+
+static struct deluge_neighbor *
+leading_neighbor(struct deluge_object *obj)
+{
+  struct deluge_neighbor *leader;
+  int i;
+
+  leader = NULL;
+  for(i = 0; i < DELUGE_NEIGHBORS; i++) {
+    if(obj->neighbors[i].highest_available > 0 &&
+       (leader == NULL ||
+        obj->neighbors[i].highest_available > leader->highest_available)) {
+      leader = &obj->neighbors[i];
+    }
+  }
+  return leader;
+}
+
 static void
 send_request(void *arg)
 {
   struct deluge_object *obj;
   struct deluge_msg_request request;
+  struct deluge_neighbor *neighbor;
+  struct deluge_page *page;
+  clock_time_t *request_time;
+  unsigned pagenum, end;
+  uint32_t missing;
+  int i, sent;
 
   obj = (struct deluge_object *)arg;
 
-  request.cmd = DELUGE_CMD_REQUEST;
-  request.pagenum = obj->current_rx_page;
-  request.version = obj->pages[request.pagenum].version;
-  request.request_set = ~obj->pages[obj->current_rx_page].packet_set;
-  request.object_id = obj->object_id;
+  end = obj->current_rx_page + DELUGE_RX_WINDOW;
+  if(end > OBJECT_PAGE_COUNT(*obj)) {
+    end = OBJECT_PAGE_COUNT(*obj);
+  }
+
+  /* Request the missing packets of every incomplete page in the
+     window that has not been requested recently. */
+  sent = 0;
+  for(pagenum = obj->current_rx_page; pagenum < end; pagenum++) {
+    page = &obj->pages[pagenum];
+    request_time = &obj->request_time[pagenum % DELUGE_RX_WINDOW];
+    if((page->flags & PAGE_COMPLETE) ||
+       clock_time() - *request_time < T_RX_RETRY) {
+      continue;
+    }
+
+    neighbor = select_neighbor(obj, pagenum);
+    if(neighbor != NULL) {
+      sent++;
+    } else {
+      /* No neighbor has advertised the page yet. Ask the one that is
+	 furthest ahead for the lowest missing page anyway, since it
+	 may have received the page after its last summary. */
+      if(pagenum != obj->current_rx_page ||
+	 (neighbor = leading_neighbor(obj)) == NULL) {
+	continue;
+      }
+    }
 
-  PRINTF("Sending request for page %d, version %u, request_set %u\n", 
-	request.pagenum, request.version, request.request_set);
-  packetbuf_copyfrom(&request, sizeof(request));
-  unicast_send(&deluge_uc, &obj->summary_from);
+    request.cmd = DELUGE_CMD_REQUEST;
+    request.pagenum = pagenum;
+    request.version = page->version;
+    request.object_id = obj->object_id;
+    missing = ~page->packet_set & ALL_PACKETS;
+    for(i = 0; i < S_SET; i++) {
+      request.request_set[i] = missing >> (8 * i);
+    }
 
-  /* Deluge R.2 */
-  if(++obj->nrequests == CONST_LAMBDA) {
+    PRINTF("Sending request for page %d, version %u, request_set %lx to %u.%u\n",
+	request.pagenum, request.version, (unsigned long)missing,
+	neighbor->addr.u8[0], neighbor->addr.u8[1]);
+    packetbuf_copyfrom(&request, sizeof(request));
+    unicast_send(&deluge_uc, &neighbor->addr);
+    *request_time = clock_time();
+  }
+
+  /* Deluge R.2. Only unanswered requests count; when no neighbor has
+     the pages yet, the node waits for their summaries. */
+  if(sent > 0 && ++obj->nrequests == CONST_LAMBDA) {
     /* XXX check rate here too. */
     obj->nrequests = 0;
-    transition(DELUGE_STATE_MAINTAIN);
+    memset(obj->neighbors, 0, sizeof(obj->neighbors));
+    leave_state(DELUGE_STATE_RX);
   } else {
-    ctimer_reset(&rx_timer);
+    ctimer_set(&rx_timer, T_RX_RETRY + ((unsigned)random_rand() % (T_R / 2)),
+	send_request, obj);
   }
 }
 
@@ -303,7 +457,15 @@ handle_summary(struct deluge_msg_summary *msg, const linkaddr_t *sender)
     recv_adv++;
   }
 
-  if(msg->version < current_object.version) {
+  /* Answer a newer version with our own summary without waiting for
+     the end of the round, so that the neighbor sends its profile. */
+  if(msg->version > current_object.update_version) {
+    reset_round();
+  }
+
+  /* Nodes that are still receiving the update also announce it, so
+     that the pages can be pipelined over several hops. */
+  if(msg->version < current_object.update_version) {
     old_summary = 1;
     broadcast_profile = 1;
   }
@@ -316,13 +478,25 @@ handle_summary(struct deluge_msg_summary *msg, const linkaddr_t *sender)
       return;
     }
 
+    update_neighbor(&current_object, sender, msg->highest_available);
+    if(deluge_state & DELUGE_STATE_RX) {
+      /* Request the lowest missing page soon if it was held back
+         because no neighbor had it. */
+      if(clock_time() - current_object.request_time[highest_available %
+             DELUGE_RX_WINDOW] >= T_RX_RETRY) {
+        ctimer_set(&rx_timer, (unsigned)random_rand() % (T_R / 4),
+                   send_request, &current_object);
+      }
+      return;
+    }
+
     oldest_request = oldest_data = now = clock_time();
     for(i = 0; i < msg->highest_available; i++) {
       page = &current_object.pages[i];
       if(page->last_request < oldest_request) {
 	oldest_request = page->last_request;
       }
-      if(page->last_request < oldest_data) {
+      if(page->last_data < oldest_data) {
 	oldest_data = page->last_data;
       }
     }
@@ -332,8 +506,7 @@ handle_summary(struct deluge_msg_summary *msg, const linkaddr_t *sender)
       return;
     }
 
-    linkaddr_copy(&current_object.summary_from, sender);
-    transition(DELUGE_STATE_RX);
+    enter_state(DELUGE_STATE_RX);
 
     if(ctimer_expired(&rx_timer)) {
       ctimer_set(&rx_timer,
@@ -344,60 +517,76 @@ handle_summary(struct deluge_msg_summary *msg, const linkaddr_t *sender)
 }
 
 static void
-send_page(struct deluge_object *obj, unsigned pagenum)
+send_packets(struct deluge_object *obj, struct deluge_tx_page *tx)
 {
-  unsigned char buf[S_PAGE];
   struct deluge_msg_packet pkt;
-  unsigned char *cp;
+  uint32_t bit;
+  int burst;
 
   pkt.cmd = DELUGE_CMD_PACKET;
-  pkt.pagenum = pagenum;
-  pkt.version = obj->pages[pagenum].version;
-  pkt.packetnum = 0;
+  pkt.pagenum = tx->pagenum;
+  pkt.version = obj->pages[tx->pagenum].version;
   pkt.object_id = obj->object_id;
-  pkt.crc = 0;
 
-  read_page(obj, pagenum, buf);
-
-  /* Divide the page into packets and send them one at a time. */
-  for(cp = buf; cp + S_PKT <= (unsigned char *)&buf[S_PAGE]; cp += S_PKT) {
-    if(obj->tx_set & (1 << pkt.packetnum)) {
-      pkt.crc = crc16_data(cp, S_PKT, 0);
-      memcpy(pkt.payload, cp, S_PKT);
+  /* Send the requested packets of the page, a burst at a time. */
+  burst = 0;
+  for(pkt.packetnum = 0;
+      pkt.packetnum < N_PKT && burst < DELUGE_TX_BURST;
+      pkt.packetnum++) {
+    bit = (uint32_t)1 << pkt.packetnum;
+    if(tx->tx_set & bit) {
+      tx->tx_set &= ~bit;
+      read_packet(obj, tx->pagenum, pkt.packetnum, pkt.payload);
+      pkt.crc = crc16_data(pkt.payload, S_PKT, 0);
       packetbuf_copyfrom(&pkt, sizeof(pkt));
+      packetbuf_set_attr(PACKETBUF_ATTR_PACKET_TYPE, tx->tx_set ?
+			 PACKETBUF_ATTR_PACKET_TYPE_STREAM :
+			 PACKETBUF_ATTR_PACKET_TYPE_STREAM_END);
       broadcast_send(&deluge_broadcast);
+      burst++;
     }
-    pkt.packetnum++;
   }
-  obj->tx_set = 0;
 }
 
 static void
 tx_callback(void *arg)
 {
   struct deluge_object *obj;
+  struct deluge_tx_page *tx;
+  int i;
 
   obj = (struct deluge_object *)arg;
-  if(obj->current_tx_page >= 0 && obj->tx_set) {
-    send_page(obj, obj->current_tx_page);
-    /* Deluge T.2. */
-    if(obj->tx_set) {
-      packetbuf_set_attr(PACKETBUF_ATTR_PACKET_TYPE,
-			 PACKETBUF_ATTR_PACKET_TYPE_STREAM);
-      ctimer_reset(&tx_timer);
-    } else {
-      packetbuf_set_attr(PACKETBUF_ATTR_PACKET_TYPE,
-			 PACKETBUF_ATTR_PACKET_TYPE_STREAM_END);
-      obj->current_tx_page = -1;
-      transition(DELUGE_STATE_MAINTAIN);
+
+  /* Serve the lowest requested page first, since it is the one that
+     holds back the progress of the requesters. */
+  tx = NULL;
+  for(i = 0; i < DELUGE_TX_QUEUE; i++) {
+    if(obj->tx_queue[i].tx_set != 0 &&
+       (tx == NULL || obj->tx_queue[i].pagenum < tx->pagenum)) {
+      tx = &obj->tx_queue[i];
     }
   }
+  if(tx != NULL) {
+    send_packets(obj, tx);
+  }
+
+  /* Deluge T.2. */
+  for(i = 0; i < DELUGE_TX_QUEUE; i++) {
+    if(obj->tx_queue[i].tx_set != 0) {
+      ctimer_set(&tx_timer, T_TX, tx_callback, obj);
+      return;
+    }
+  }
+  leave_state(DELUGE_STATE_TX);
 }
 
 static void
 handle_request(struct deluge_msg_request *msg)
 {
-  int highest_available;
+  struct deluge_page *page;
+  struct deluge_tx_page *tx, *free_tx;
+  uint32_t request_set;
+  int i;
 
   if(msg->pagenum >= OBJECT_PAGE_COUNT(current_object)) {
     return;
@@ -407,23 +596,48 @@ handle_request(struct deluge_msg_request *msg)
     neighbor_inconsistency = 1;
   }
 
-  highest_available = highest_available_page(&current_object);
+  /* Deluge M.6. Any complete page is served, also while the pages
+     below it are still being received. */
+  page = &current_object.pages[msg->pagenum];
+  if(msg->version != page->version || !(page->flags & PAGE_COMPLETE)) {
+    return;
+  }
+  page->last_request = clock_time();
 
-  /* Deluge M.6 */
-  if(msg->version == current_object.version &&
-      msg->pagenum <= highest_available) {
-    current_object.pages[msg->pagenum].last_request = clock_time();
+  request_set = 0;
+  for(i = 0; i < S_SET; i++) {
+    request_set |= (uint32_t)msg->request_set[i] << (8 * i);
+  }
+  request_set &= ALL_PACKETS;
+  if(request_set == 0) {
+    return;
+  }
 
-    /* Deluge T.1 */
-    if(msg->pagenum == current_object.current_tx_page) {
-      current_object.tx_set |= msg->request_set;
-    } else {
-      current_object.current_tx_page = msg->pagenum;
-      current_object.tx_set = msg->request_set;
+  /* Deluge T.1 */
+  free_tx = NULL;
+  for(i = 0; i < DELUGE_TX_QUEUE; i++) {
+    tx = &current_object.tx_queue[i];
+    if(tx->tx_set == 0) {
+      if(free_tx == NULL) {
+        free_tx = tx;
+      }
+    } else if(tx->pagenum == msg->pagenum) {
+      tx->tx_set |= request_set;
+      return;
     }
+  }
 
-    transition(DELUGE_STATE_TX);
-    ctimer_set(&tx_timer, CLOCK_SECOND, tx_callback, &current_object);
+  if(free_tx == NULL) {
+    /* The requester will try again, possibly with another neighbor. */
+    PRINTF("No room to queue page %u\n", msg->pagenum);
+    return;
+  }
+  free_tx->pagenum = msg->pagenum;
+  free_tx->tx_set = request_set;
+
+  if(!(deluge_state & DELUGE_STATE_TX)) {
+    enter_state(DELUGE_STATE_TX);
+    ctimer_set(&tx_timer, T_TX, tx_callback, &current_object);
   }
 }
 
@@ -432,6 +646,7 @@ handle_packet(struct deluge_msg_packet *msg)
 {
   struct deluge_page *page;
   uint16_t crc;
+  uint32_t bit;
   struct deluge_msg_packet packet;
 
   memcpy(&packet, msg, sizeof(packet));
@@ -440,7 +655,11 @@ handle_packet(struct deluge_msg_packet *msg)
 	(unsigned)packet.object_id, (unsigned)packet.version,
 	(unsigned)packet.pagenum, (unsigned)packet.packetnum);
 
-  if(packet.pagenum != current_object.current_rx_page) {
+  /* Accept packets for any page in the receive window. */
+  if(packet.pagenum < current_object.current_rx_page ||
+     packet.pagenum >= current_object.current_rx_page + DELUGE_RX_WINDOW ||
+     packet.pagenum >= OBJECT_PAGE_COUNT(current_object) ||
+     packet.packetnum >= N_PKT) {
     return;
   }
 
@@ -449,49 +668,71 @@ handle_packet(struct deluge_msg_packet *msg)
   }
 
   page = &current_object.pages[packet.pagenum];
-  if(packet.version == page->version && !(page->flags & PAGE_COMPLETE)) {
-    memcpy(&current_object.current_page[S_PKT * packet.packetnum],
-	packet.payload, S_PKT);
-
+  bit = (uint32_t)1 << packet.packetnum;
+  if(packet.version == page->version && !(page->flags & PAGE_COMPLETE) &&
+     !(page->packet_set & bit)) {
     crc = crc16_data(packet.payload, S_PKT, 0);
     if(packet.crc != crc) {
       PRINTF("packet crc: %hu, calculated crc: %hu\n", packet.crc, crc);
       return;
     }
 
+    /* The packet is written directly to its place in the file, so no
+       page buffer is needed for the pages being received. */
+    if(write_packet(&current_object, packet.pagenum, packet.packetnum,
+                    packet.payload) != S_PKT) {
+      PRINTF("Failed to write packet %u of page %u\n",
+             packet.packetnum, packet.pagenum);
+      return;
+    }
+
     page->last_data = clock_time();
-    page->packet_set |= (1 << packet.packetnum);
+    page->packet_set |= bit;
+    current_object.nrequests = 0;
 
     if(page->packet_set == ALL_PACKETS) {
       /* This is the last packet of the requested page; stop streaming. */
       packetbuf_set_attr(PACKETBUF_ATTR_PACKET_TYPE,
 			 PACKETBUF_ATTR_PACKET_TYPE_STREAM_END);
 
-      write_page(&current_object, packet.pagenum, current_object.current_page);
       page->version = packet.version;
       page->flags = PAGE_COMPLETE;
       PRINTF("Page %u completed\n", packet.pagenum);
 
-      current_object.current_rx_page++;
+      current_object.request_time[packet.pagenum % DELUGE_RX_WINDOW] =
+        clock_time() - T_RX_RETRY;
+      current_object.current_rx_page = highest_available_page(&current_object);
 
-      if(packet.pagenum == OBJECT_PAGE_COUNT(current_object) - 1) {
+      if(current_object.current_rx_page == OBJECT_PAGE_COUNT(current_object)) {
 	current_object.version = current_object.update_version;
 	leds_on(LEDS_RED);
 	PRINTF("Update completed for object %u, version %u\n", 
 	       (unsigned)current_object.object_id, packet.version);
-      } else if(current_object.current_rx_page < OBJECT_PAGE_COUNT(current_object)) {
-        if(ctimer_expired(&rx_timer)) {
-	  ctimer_set(&rx_timer,
-		CONST_OMEGA * ESTIMATED_TX_TIME + (random_rand() % T_R),
-		send_request, &current_object);
+	/* Deluge R.3 */
+	leave_state(DELUGE_STATE_RX);
+	if(update_callback != NULL) {
+	  update_callback(current_object.filename, current_object.version);
 	}
+      } else {
+	/* Request the next page of the window without waiting for
+	   another summary round. */
+	enter_state(DELUGE_STATE_RX);
+	ctimer_set(&rx_timer, (unsigned)random_rand() % (T_R / 4),
+		   send_request, &current_object);
       }
-      /* Deluge R.3 */
-      transition(DELUGE_STATE_MAINTAIN);
     } else {
       /* More packets to come. Put lower layers in streaming mode. */
       packetbuf_set_attr(PACKETBUF_ATTR_PACKET_TYPE,
 			 PACKETBUF_ATTR_PACKET_TYPE_STREAM);
+
+      /* The request has been answered. Request the packets that are
+	 still missing when the sender has gone quiet. */
+      current_object.request_time[packet.pagenum % DELUGE_RX_WINDOW] =
+        clock_time() - T_RX_RETRY;
+      if(deluge_state & DELUGE_STATE_RX) {
+	ctimer_set(&rx_timer, 2 * T_TX + (unsigned)random_rand() % (T_R / 4),
+		   send_request, &current_object);
+      }
     }
   }
 }
@@ -508,7 +749,7 @@ send_profile(struct deluge_object *obj)
 
     msg = (struct deluge_msg_profile *)buf;
     msg->cmd = DELUGE_CMD_PROFILE;
-    msg->version = obj->version;
+    msg->version = obj->update_version;
     msg->npages = OBJECT_PAGE_COUNT(*obj);
     msg->object_id = obj->object_id;
     for(i = 0; i < msg->npages; i++) {
@@ -537,7 +778,7 @@ handle_profile(struct deluge_msg_profile *msg)
 	msg->version, msg->npages);
 
   leds_off(LEDS_RED);
-  current_object.tx_set = 0;
+  memset(current_object.tx_queue, 0, sizeof(current_object.tx_queue));
 
   npages = OBJECT_PAGE_COUNT(*obj);
   obj->size = msg->npages * S_PAGE;
@@ -570,8 +811,16 @@ handle_profile(struct deluge_msg_profile *msg)
 
   obj->current_rx_page = highest_available_page(obj);
   obj->update_version = msg->version;
+  /* Let the neighbors know about the new version. */
+  reset_round();
+  obj->nrequests = 0;
+  expire_requests(obj);
+
+  /* The sender may not have the complete object, so the sources of
+     the pages are learned from the summaries that follow. */
+  memset(obj->neighbors, 0, sizeof(obj->neighbors));
 
-  transition(DELUGE_STATE_RX);
+  enter_state(DELUGE_STATE_RX);
 
   ctimer_set(&rx_timer,
 	CONST_OMEGA * ESTIMATED_TX_TIME + ((unsigned)random_rand() % T_R),
@@ -638,6 +887,12 @@ deluge_disseminate(char *file, unsigned version)
   return 0;
 }
 
+void
+deluge_set_update_callback(void (*callback)(char *file, unsigned version))
+{
+  update_callback = callback;
+}
+
 PROCESS_THREAD(deluge_process, ev, data)
 {
   static struct etimer et;
@@ -681,7 +936,13 @@ PROCESS_THREAD(deluge_process, ev, data)
     ctimer_set(&profile_timer, r_rand * CLOCK_SECOND,
 	(void *)(void *)send_profile, &current_object);
 
-    LONG_TIMER(et, time_counter, r_interval);
+    for(time_counter = 0; time_counter < r_interval; time_counter++) {
+      etimer_set(&et, CLOCK_SECOND);
+      PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et) || ev == deluge_event);
+      if(ev == deluge_event) {
+	break;
+      }
+    }
   }
 
 exit:
@@ -61,9 +61,59 @@ PROCESS_NAME(deluge_process);
 #define PAGE_AVAILABLE	1
 
 #define S_PKT		64		/* Deluge packet size. */
-#define N_PKT		4		/* Packets per page. */
+
+/* Packets per page. */
+#ifdef DELUGE_CONF_PACKETS_PER_PAGE
+#define N_PKT		DELUGE_CONF_PACKETS_PER_PAGE
+#else
+#define N_PKT		4
+#endif
+
+#if N_PKT < 1 || N_PKT > 32
+#error "DELUGE_CONF_PACKETS_PER_PAGE must be between 1 and 32"
+#endif
+
 #define S_PAGE		(S_PKT * N_PKT)	/* Fixed page size. */
 
+/* The size of a packet bitmap in a request. */
+#define S_SET		((N_PKT + 7) / 8)
+
+/*
+ * The number of pages that are received concurrently. Pages above the
+ * highest available page are requested and accepted as long as they
+ * are within this window, so that a node can forward a page while it
+ * receives the following pages.
+ */
+#ifdef DELUGE_CONF_RX_WINDOW
+#define DELUGE_RX_WINDOW	DELUGE_CONF_RX_WINDOW
+#else
+#define DELUGE_RX_WINDOW	2
+#endif
+
+/*
+ * The number of neighbors that are remembered as sources of pages.
+ * Requests for different pages are spread over these neighbors.
+ */
+#ifdef DELUGE_CONF_NEIGHBORS
+#define DELUGE_NEIGHBORS	DELUGE_CONF_NEIGHBORS
+#else
+#define DELUGE_NEIGHBORS	4
+#endif
+
+/* The number of pages that can be queued for transmission. */
+#ifdef DELUGE_CONF_TX_QUEUE
+#define DELUGE_TX_QUEUE		DELUGE_CONF_TX_QUEUE
+#else
+#define DELUGE_TX_QUEUE		2
+#endif
+
+/* The maximum number of packets sent back-to-back. */
+#ifdef DELUGE_CONF_TX_BURST
+#define DELUGE_TX_BURST		DELUGE_CONF_TX_BURST
+#else
+#define DELUGE_TX_BURST		4
+#endif
+
 /* Bounds for the round time in seconds. */
 #define T_LOW		2
 #define T_HIGH		64
@@ -71,22 +121,26 @@ PROCESS_NAME(deluge_process);
 /* Random interval for request transmissions in jiffies. */
 #define T_R		(CLOCK_SECOND * 2)
 
+/* Delay before a requested page is sent, and between packet bursts. */
+#define T_TX		(CLOCK_SECOND / 4)
+
 /* Bound for the number of advertisements. */
 #define CONST_K		1
 
 /* The number of pages in this object. */
 #define OBJECT_PAGE_COUNT(obj)	(((obj).size + (S_PAGE - 1)) / S_PAGE)
 
-#define ALL_PACKETS		((1 << N_PKT) - 1)
+#define ALL_PACKETS		(0xffffffffUL >> (32 - N_PKT))
 
 #define DELUGE_CMD_SUMMARY	1
 #define DELUGE_CMD_REQUEST	2
 #define DELUGE_CMD_PACKET	3
 #define DELUGE_CMD_PROFILE	4
 
-#define DELUGE_STATE_MAINTAIN	1
-#define DELUGE_STATE_RX		2
-#define DELUGE_STATE_TX		3
+/* The RX and TX states can be active at the same time. */
+#define DELUGE_STATE_MAINTAIN	0
+#define DELUGE_STATE_RX		1
+#define DELUGE_STATE_TX		2
 
 #define CONST_LAMBDA		2
 #define CONST_ALPHA		0.5
@@ -94,6 +148,9 @@ PROCESS_NAME(deluge_process);
 #define CONST_OMEGA		8
 #define ESTIMATED_TX_TIME	(CLOCK_SECOND)
 
+/* The time to wait for data before a request is repeated. */
+#define T_RX_RETRY		ESTIMATED_TX_TIME
+
 typedef uint8_t deluge_object_id_t;
 
 struct deluge_msg_summary {
@@ -107,8 +164,10 @@ struct deluge_msg_request {
   uint8_t cmd;
   uint8_t version;
   uint8_t pagenum;
-  uint8_t request_set;
   deluge_object_id_t object_id;
+  /* Bitmap of the packets that are missing, least significant
+     bit of the first byte first. */
+  uint8_t request_set[S_SET];
 };
 
 struct deluge_msg_packet {
@@ -129,6 +188,17 @@ struct deluge_msg_profile {
   uint8_t version_vector[];
 };
 
+struct deluge_neighbor {
+  linkaddr_t addr;
+  clock_time_t last_heard;
+  uint8_t highest_available;
+};
+
+struct deluge_tx_page {
+  uint32_t tx_set;
+  uint8_t pagenum;
+};
+
 struct deluge_object {
   char *filename;
   uint16_t object_id;
@@ -137,12 +207,11 @@ struct deluge_object {
   uint8_t update_version;
   struct deluge_page *pages;
   uint8_t current_rx_page;
-  int8_t current_tx_page;
   uint8_t nrequests;
-  uint8_t current_page[S_PAGE];
-  uint8_t tx_set;
   int cfs_fd;
-  linkaddr_t summary_from;
+  clock_time_t request_time[DELUGE_RX_WINDOW];
+  struct deluge_neighbor neighbors[DELUGE_NEIGHBORS];
+  struct deluge_tx_page tx_queue[DELUGE_TX_QUEUE];
 };
 
 struct deluge_page {
@@ -156,4 +225,11 @@ struct deluge_page {
 
 int deluge_disseminate(char *file, unsigned version);
 
+/*
+ * Sets a function to be called when a new version of the object has
+ * been received completely, e.g. to apply a delta patch before the
+ * new image is activated.
+ */
+void deluge_set_update_callback(void (*callback)(char *file, unsigned version));
+
 #endif
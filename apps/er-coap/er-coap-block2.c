@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2015, EasyRF.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *      CoAP module for streaming Block2 responses out of CFS
+ */
+
+#include <string.h>
+
+#include "cfs/cfs.h"
+#include "er-coap.h"
+#include "er-coap-block2.h"
+
+#define DEBUG 0
+#if DEBUG
+#include <stdio.h>
+#define PRINTF(...) printf(__VA_ARGS__)
+#else
+#define PRINTF(...)
+#endif
+
+/* The file being streamed stays open between blocks. It is known by
+   the name pointer and length that the handler passed when opening it. */
+static int fd = -1;
+static const char *open_name;
+static size_t open_name_len;
+static cfs_offset_t file_pos;
+static cfs_offset_t file_size;
+
+/*----------------------------------------------------------------------------*/
+static void
+close_file(void)
+{
+  if(fd >= 0) {
+    cfs_close(fd);
+    fd = -1;
+  }
+  open_name = NULL;
+}
+/*----------------------------------------------------------------------------*/
+static int
+is_open(const char *filename)
+{
+  return fd >= 0 && filename == open_name &&
+         strlen(filename) == open_name_len;
+}
+/*----------------------------------------------------------------------------*/
+static int
+open_file(const char *filename)
+{
+  close_file();
+  fd = cfs_open(filename, CFS_READ);
+  if(fd < 0) {
+    return 0;
+  }
+  file_size = cfs_seek(fd, 0, CFS_SEEK_END);
+  if(file_size == (cfs_offset_t)-1) {
+    close_file();
+    return 0;
+  }
+  open_name = filename;
+  open_name_len = strlen(filename);
+  file_pos = file_size;
+  return 1;
+}
+/*----------------------------------------------------------------------------*/
+
+/**
+ * \brief Block 2 support for resources stored in CFS
+ *
+ *        Call this function from a GET handler to return the file as a
+ *        chunk-wise resource. The file stays open between blocks, so
+ *        consecutive blocks are read without seeking, and it is closed
+ *        after the last block or an error. A request for offset 0, or
+ *        for another file, reopens it. Files are told apart by the
+ *        filename pointer, so it must stay valid during a transfer.
+ *
+ * \param response        Response pointer from the handler
+ * \param filename        Name of the file in CFS
+ * \param buffer          Buffer pointer from the handler
+ * \param preferred_size  Preferred size from the handler
+ * \param offset          Offset pointer from the handler
+ *
+ * \return the number of bytes set as payload, or -1 if the file could not
+ *         be read, in which case an error response has been set up
+ */
+int
+coap_block2_cfs_handler(void *response, const char *filename,
+                        uint8_t *buffer, uint16_t preferred_size,
+                        int32_t *offset)
+{
+  int len;
+
+  if(*offset == 0 || !is_open(filename)) {
+    if(!open_file(filename)) {
+      PRINTF("Blockwise: cannot open %s\n", filename);
+      coap_set_status_code(response, NOT_FOUND_4_04);
+      return -1;
+    }
+  }
+
+  if(*offset > 0 && *offset >= file_size) {
+    close_file();
+    coap_set_status_code(response, BAD_OPTION_4_02);
+    coap_set_payload(response, "BlockOutOfScope", 15);
+    return -1;
+  }
+
+  /* only seek if the blocks are not requested in sequence */
+  if(file_pos != *offset) {
+    PRINTF("Blockwise: seeking from %ld to %ld\n", (long)file_pos,
+           (long)*offset);
+    if(cfs_seek(fd, *offset, CFS_SEEK_SET) != *offset) {
+      close_file();
+      coap_set_status_code(response, INTERNAL_SERVER_ERROR_5_00);
+      return -1;
+    }
+    file_pos = *offset;
+  }
+
+  len = cfs_read(fd, buffer, preferred_size);
+  if(len < 0) {
+    close_file();
+    coap_set_status_code(response, INTERNAL_SERVER_ERROR_5_00);
+    return -1;
+  }
+  file_pos += len;
+  coap_set_header_size2(response, file_size);
+  coap_set_payload(response, buffer, len);
+
+  *offset += len;
+  if(*offset >= file_size) {
+    /* signal the end of the resource representation */
+    *offset = -1;
+    close_file();
+  }
+  return len;
+}
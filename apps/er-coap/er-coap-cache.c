@@ -0,0 +1,304 @@
+/*
+ * Copyright (c) 2015, EasyRF.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *      CoAP response cache for GET requests. Responses are only cached
+ *      when the resource handler sets a Max-Age, and for as long as that
+ *      Max-Age. Cached responses get an ETag, so that conditional requests
+ *      can be answered with 2.03 Valid.
+ */
+
+#include <string.h>
+
+#include "er-coap-cache.h"
+
+#if COAP_RESPONSE_CACHE_SIZE
+
+#define DEBUG 0
+#if DEBUG
+#include <stdio.h>
+#define PRINTF(...) printf(__VA_ARGS__)
+#else
+#define PRINTF(...)
+#endif
+
+#define NO_ACCEPT   0xFFFF
+#define CACHE_ETAG_LEN 4
+
+typedef struct {
+  struct timer max_age;
+  uint8_t valid;
+  uint8_t key[COAP_RESPONSE_CACHE_KEY_LEN]; /* Uri-Path '?' Uri-Query */
+  uint8_t key_len;
+  uint8_t path_len;
+  uint16_t accept;
+  uint8_t has_content_format;
+  uint16_t content_format;
+  uint8_t etag_len;
+  uint8_t etag[COAP_ETAG_LEN];
+  uint16_t payload_len;
+  uint8_t payload[REST_MAX_CHUNK_SIZE];
+} coap_cache_entry_t;
+
+static coap_cache_entry_t cache[COAP_RESPONSE_CACHE_SIZE];
+
+/* key of the request being handled */
+static uint8_t request_key[COAP_RESPONSE_CACHE_KEY_LEN];
+static uint8_t request_key_len;
+static uint8_t request_path_len;
+/*---------------------------------------------------------------------------*/
+static int
+make_key(coap_packet_t *request)
+{
+  const char *path = NULL;
+  const char *query = NULL;
+  int path_len;
+  int query_len;
+
+  path_len = coap_get_header_uri_path(request, &path);
+  query_len = coap_get_header_uri_query(request, &query);
+  if(path_len + 1 + query_len > COAP_RESPONSE_CACHE_KEY_LEN) {
+    return 0;
+  }
+
+  if(path_len > 0) {
+    memcpy(request_key, path, path_len);
+  }
+  request_key_len = path_len;
+  request_path_len = path_len;
+  if(query_len > 0) {
+    request_key[request_key_len++] = '?';
+    memcpy(request_key + request_key_len, query, query_len);
+    request_key_len += query_len;
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+accept_of(coap_packet_t *request)
+{
+  return IS_OPTION(request, COAP_OPTION_ACCEPT) ? request->accept : NO_ACCEPT;
+}
+/*---------------------------------------------------------------------------*/
+static int
+is_cacheable_request(coap_packet_t *request)
+{
+  /* registrations and blockwise transfers have to reach the resource */
+  return request->code == COAP_GET
+         && !IS_OPTION(request, COAP_OPTION_OBSERVE)
+         && !IS_OPTION(request, COAP_OPTION_BLOCK2)
+         && !IS_OPTION(request, COAP_OPTION_BLOCK1);
+}
+/*---------------------------------------------------------------------------*/
+static coap_cache_entry_t *
+lookup(uint16_t accept)
+{
+  coap_cache_entry_t *entry;
+
+  for(entry = cache; entry < &cache[COAP_RESPONSE_CACHE_SIZE]; entry++) {
+    if(entry->valid && entry->key_len == request_key_len
+       && entry->accept == accept
+       && memcmp(entry->key, request_key, request_key_len) == 0) {
+      return entry;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+/* FNV-1a over content format and payload */
+static uint32_t
+generate_etag(coap_packet_t *response)
+{
+  uint32_t hash = 2166136261UL;
+  uint16_t i;
+
+  hash = (hash ^ (response->content_format & 0xFF)) * 16777619UL;
+  hash = (hash ^ (response->content_format >> 8)) * 16777619UL;
+  for(i = 0; i < response->payload_len; i++) {
+    hash = (hash ^ response->payload[i]) * 16777619UL;
+  }
+  return hash;
+}
+/*---------------------------------------------------------------------------*/
+static int
+etag_matches(coap_packet_t *request, const uint8_t *etag, uint8_t etag_len)
+{
+  return IS_OPTION(request, COAP_OPTION_ETAG) && request->etag_len == etag_len
+         && memcmp(request->etag, etag, etag_len) == 0;
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief Answers a request from the cache
+ * \param request The parsed request
+ * \param response The initialized response
+ * \return 1 if the response has been set up from the cache
+ */
+int
+coap_cache_respond(coap_packet_t *request, coap_packet_t *response)
+{
+  coap_cache_entry_t *entry;
+
+  if(!is_cacheable_request(request) || !make_key(request)) {
+    return 0;
+  }
+  entry = lookup(accept_of(request));
+  if(entry == NULL || timer_expired(&entry->max_age)) {
+    return 0;
+  }
+
+  PRINTF("Cache: hit for %.*s\n", entry->key_len, entry->key);
+
+  coap_set_header_etag(response, entry->etag, entry->etag_len);
+  coap_set_header_max_age(response, (timer_remaining(&entry->max_age)
+                                     + CLOCK_SECOND - 1) / CLOCK_SECOND);
+  if(etag_matches(request, entry->etag, entry->etag_len)) {
+    /* the client already has this representation */
+    coap_set_status_code(response, VALID_2_03);
+    return 1;
+  }
+  if(entry->has_content_format) {
+    coap_set_header_content_format(response, entry->content_format);
+  }
+  coap_set_payload(response, entry->payload, entry->payload_len);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief Stores a response that has just been created by a resource handler
+ * \param request The parsed request
+ * \param response The response of the resource handler
+ *
+ *        Responses to unsafe methods invalidate the cached representations
+ *        of the resource instead.
+ */
+void
+coap_cache_update(coap_packet_t *request, coap_packet_t *response)
+{
+  coap_cache_entry_t *entry;
+  coap_cache_entry_t *e;
+  uint32_t hash;
+  uint8_t etag[CACHE_ETAG_LEN];
+
+  if(request->code != COAP_GET) {
+    if(response->code < BAD_REQUEST_4_00 && make_key(request)) {
+      request_key[request_path_len] = '\0';
+      coap_cache_invalidate((const char *)request_key);
+    }
+    return;
+  }
+
+  if(!is_cacheable_request(request) || response->code != CONTENT_2_05
+     || !IS_OPTION(response, COAP_OPTION_MAX_AGE) || response->max_age == 0
+     || IS_OPTION(response, COAP_OPTION_OBSERVE)
+     || IS_OPTION(response, COAP_OPTION_BLOCK2)
+     || response->payload_len > REST_MAX_CHUNK_SIZE
+     || !make_key(request)) {
+    return;
+  }
+
+  if(!IS_OPTION(response, COAP_OPTION_ETAG)) {
+    hash = generate_etag(response);
+    etag[0] = hash >> 24;
+    etag[1] = hash >> 16;
+    etag[2] = hash >> 8;
+    etag[3] = hash;
+    coap_set_header_etag(response, etag, CACHE_ETAG_LEN);
+  }
+
+  /* reuse the entry of the same request, else an expired one, else the
+     one that expires first */
+  entry = lookup(accept_of(request));
+  if(entry == NULL) {
+    entry = cache;
+    for(e = cache; e < &cache[COAP_RESPONSE_CACHE_SIZE]; e++) {
+      if(!e->valid || timer_expired(&e->max_age)) {
+        entry = e;
+        break;
+      }
+      if(timer_remaining(&e->max_age) < timer_remaining(&entry->max_age)) {
+        entry = e;
+      }
+    }
+  }
+
+  PRINTF("Cache: storing %.*s for %lu s\n", request_key_len, request_key,
+         (unsigned long)response->max_age);
+
+  entry->valid = 1;
+  memcpy(entry->key, request_key, request_key_len);
+  entry->key_len = request_key_len;
+  entry->path_len = request_path_len;
+  entry->accept = accept_of(request);
+  entry->has_content_format = IS_OPTION(response, COAP_OPTION_CONTENT_FORMAT)
+    ? 1 : 0;
+  entry->content_format = response->content_format;
+  entry->etag_len = response->etag_len;
+  memcpy(entry->etag, response->etag, response->etag_len);
+  entry->payload_len = response->payload_len;
+  memcpy(entry->payload, response->payload, response->payload_len);
+  timer_set(&entry->max_age, (clock_time_t)response->max_age * CLOCK_SECOND);
+
+  if(etag_matches(request, entry->etag, entry->etag_len)) {
+    coap_set_status_code(response, VALID_2_03);
+    response->payload_len = 0;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief Drops all cached representations of a resource
+ * \param url The URI path of the resource, without leading '/'
+ *
+ *        Resources call this when their state changes before Max-Age
+ *        runs out. Notifying the observers of a resource does so, too.
+ */
+void
+coap_cache_invalidate(const char *url)
+{
+  coap_cache_entry_t *entry;
+  size_t url_len;
+
+  while(url[0] == '/') {
+    ++url;
+  }
+  url_len = strlen(url);
+
+  for(entry = cache; entry < &cache[COAP_RESPONSE_CACHE_SIZE]; entry++) {
+    if(entry->valid && entry->path_len == url_len
+       && memcmp(entry->key, url, url_len) == 0) {
+      PRINTF("Cache: invalidating %.*s\n", entry->key_len, entry->key);
+      entry->valid = 0;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+#endif /* COAP_RESPONSE_CACHE_SIZE */
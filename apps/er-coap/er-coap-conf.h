@@ -53,11 +53,40 @@
 #define COAP_MAX_OPEN_TRANSACTIONS     4
 #endif /* COAP_MAX_OPEN_TRANSACTIONS */
 
+/* Number of hash buckets for looking up open transactions by MID */
+#ifndef COAP_TRANSACTION_HASH_SIZE
+#define COAP_TRANSACTION_HASH_SIZE     8
+#endif /* COAP_TRANSACTION_HASH_SIZE */
+
+/* Slots and slot length (in clock ticks) of the retransmission timer wheel */
+#ifndef COAP_TRANSACTION_WHEEL_SLOTS
+#define COAP_TRANSACTION_WHEEL_SLOTS   16
+#endif /* COAP_TRANSACTION_WHEEL_SLOTS */
+
+#ifndef COAP_TRANSACTION_WHEEL_TICK
+#define COAP_TRANSACTION_WHEEL_TICK    (CLOCK_SECOND / 4)
+#endif /* COAP_TRANSACTION_WHEEL_TICK */
+
+/* Number of cached GET responses, only used for resources that set a Max-Age */
+#ifndef COAP_RESPONSE_CACHE_SIZE
+#define COAP_RESPONSE_CACHE_SIZE       0
+#endif /* COAP_RESPONSE_CACHE_SIZE */
+
+/* Longest Uri-Path plus Uri-Query that can be cached */
+#ifndef COAP_RESPONSE_CACHE_KEY_LEN
+#define COAP_RESPONSE_CACHE_KEY_LEN    32
+#endif /* COAP_RESPONSE_CACHE_KEY_LEN */
+
 /* Maximum number of failed request attempts before action */
 #ifndef COAP_MAX_ATTEMPTS
 #define COAP_MAX_ATTEMPTS              4
 #endif /* COAP_MAX_ATTEMPTS */
 
+/* Maximum number of block requests a blockwise transfer keeps in flight */
+#ifndef COAP_BLOCKWISE_WINDOW
+#define COAP_BLOCKWISE_WINDOW          4
+#endif /* COAP_BLOCKWISE_WINDOW */
+
 /* Conservative size limit, as not all options have to be set at the same time. Check when Proxy-Uri option is used */
 #ifndef COAP_MAX_HEADER_SIZE    /*     Hdr                  CoF  If-Match         Obs Blo strings   */
 #define COAP_MAX_HEADER_SIZE           (4 + COAP_TOKEN_LEN + 3 + 1 + COAP_ETAG_LEN + 4 + 4 + 30)  /* 65 */
@@ -68,6 +97,11 @@
 #define COAP_MAX_OBSERVERS    COAP_MAX_OPEN_TRANSACTIONS - 1
 #endif /* COAP_MAX_OBSERVERS */
 
+/* Number of hash buckets for looking up observers by client, MID and token */
+#ifndef COAP_OBSERVER_HASH_SIZE
+#define COAP_OBSERVER_HASH_SIZE        8
+#endif /* COAP_OBSERVER_HASH_SIZE */
+
 /* Interval in notifies in which NON notifies are changed to CON notifies to check client. */
 #define COAP_OBSERVE_REFRESH_INTERVAL  20
 
@@ -40,6 +40,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include "er-coap-engine.h"
+#include "er-coap-cache.h"
 
 #define DEBUG 0
 #if DEBUG
@@ -132,10 +133,14 @@ coap_receive(void)
           /* invoke resource handler */
           if(service_cbk) {
 
-            /* call REST framework and check if found and allowed */
-            if(service_cbk
-                 (message, response, transaction->packet + COAP_MAX_HEADER_SIZE,
-                 block_size, &new_offset)) {
+            if(coap_cache_respond(message, response)) {
+              PRINTF("Answered from the response cache\n");
+
+              /* call REST framework and check if found and allowed */
+            } else if(service_cbk
+                        (message, response,
+                        transaction->packet + COAP_MAX_HEADER_SIZE,
+                        block_size, &new_offset)) {
 
               if(erbium_status_code == NO_ERROR) {
 
@@ -203,14 +208,23 @@ coap_receive(void)
                                        COAP_MAX_BLOCK_SIZE));
                 } /* blockwise transfer handling */
               } /* no errors/hooks */
+
+              if(erbium_status_code == NO_ERROR) {
+                coap_cache_update(message, response);
+              }
                 /* successful service callback */
                 /* serialize response */
             }
             if(erbium_status_code == NO_ERROR) {
-              if((transaction->packet_len = coap_serialize_message(response,
-                                                                   transaction->
-                                                                   packet)) ==
-                 0) {
+              /* responses are not retransmitted: write them directly into
+                 the outgoing UDP buffer if they do not refer to the request */
+              if(coap_send_packet(&transaction->addr, transaction->port,
+                                  response) > 0) {
+                coap_clear_transaction(transaction);
+                transaction = NULL;
+              } else if((transaction->packet_len =
+                            coap_serialize_message(response,
+                                                   transaction->packet)) == 0) {
                 erbium_status_code = PACKET_SERIALIZATION_ERROR;
               }
             }
@@ -282,9 +296,7 @@ coap_receive(void)
                         message->mid);
       coap_set_payload(message, coap_error_message,
                        strlen(coap_error_message));
-      coap_send_message(&UIP_IP_BUF->srcipaddr, UIP_UDP_BUF->srcport,
-                        uip_appdata, coap_serialize_message(message,
-                                                            uip_appdata));
+      coap_send_packet(&UIP_IP_BUF->srcipaddr, UIP_UDP_BUF->srcport, message);
     }
   }
 
@@ -423,6 +435,260 @@ PT_THREAD(coap_blocking_request
   PT_END(&state->pt);
 }
 /*---------------------------------------------------------------------------*/
+#define SLOT_FREE   0
+#define SLOT_SENT   1
+#define SLOT_RETRY  2
+
+#define NO_BLOCK    0xFFFFFFFF
+
+static void
+blockwise_callback(void *callback_data, void *response)
+{
+  struct blockwise_slot_t *slot = (struct blockwise_slot_t *)callback_data;
+  struct blockwise_state_t *state = slot->state;
+  coap_packet_t *const coap_pkt = (coap_packet_t *)response;
+  uint32_t num;
+  uint8_t more;
+  uint16_t size;
+  uint32_t total;
+
+  state->in_flight--;
+  process_poll(state->process);
+
+  if(coap_pkt == NULL
+     || clock_time() - slot->sent > COAP_RESPONSE_TIMEOUT_TICKS) {
+    /* the block needed retransmissions: back off */
+    state->window = state->window > 1 ? state->window / 2 : 1;
+    state->acked = 0;
+  } else if(++state->acked >= state->window) {
+    if(state->window < COAP_BLOCKWISE_WINDOW) {
+      ++state->window;
+    }
+    state->acked = 0;
+  }
+
+  if(coap_pkt == NULL) {
+    PRINTF("Block %lu timed out\n", slot->block_num);
+    if(++state->retries < COAP_MAX_ATTEMPTS) {
+      slot->status = SLOT_RETRY;
+      return;
+    }
+    slot->status = SLOT_FREE;
+    state->error_block = MIN(state->error_block, slot->block_num);
+    return;
+  }
+  slot->status = SLOT_FREE;
+
+  if(coap_pkt->code >= BAD_REQUEST_4_00) {
+    /* also the answer to blocks requested past the end of a download */
+    PRINTF("Block %lu failed (%u)\n", slot->block_num, coap_pkt->code);
+    state->error_block = MIN(state->error_block, slot->block_num);
+    return;
+  }
+
+  if(state->upload) {
+    if(state->block_size == 0) {
+      /* The server may acknowledge the first block with a smaller size
+         (RFC 7959, 2.3). It has taken the whole block, and the upload
+         goes on after it in blocks of the new size. */
+      size = COAP_MAX_BLOCK_SIZE;
+      coap_get_header_block1(coap_pkt, NULL, NULL, &size, NULL);
+      size = MIN(size, COAP_MAX_BLOCK_SIZE);
+      state->block_size = size;
+      state->next_block = (slot->block_num + 1) * COAP_MAX_BLOCK_SIZE / size;
+      state->last_block = state->upload_len > 0
+        ? (state->upload_len - 1) / size : 0;
+    }
+  } else {
+    if(coap_get_header_block2(coap_pkt, &num, &more, &size, NULL)) {
+      if(state->block_size == 0) {
+        /* the server may have chosen a smaller block size */
+        state->block_size = size;
+        if(coap_get_header_size2(coap_pkt, &total) && total > 0) {
+          state->last_block = (total - 1) / size;
+        }
+      }
+      if(num != slot->block_num) {
+        PRINTF("WRONG BLOCK %lu/%lu\n", num, slot->block_num);
+        state->error_block = MIN(state->error_block, slot->block_num);
+        return;
+      }
+      if(!more) {
+        state->last_block = MIN(state->last_block, num);
+      }
+    } else {
+      /* the representation fits into a single response */
+      state->last_block = 0;
+    }
+    if(slot->block_num > state->last_block) {
+      return;
+    }
+  }
+
+  PRINTF("Received #%lu (%u bytes)\n", slot->block_num,
+         coap_pkt->payload_len);
+  state->response_handler(coap_pkt);
+}
+/*---------------------------------------------------------------------------*/
+static int
+blockwise_send(struct blockwise_state_t *state, struct blockwise_slot_t *slot,
+               uip_ipaddr_t *remote_ipaddr, uint16_t remote_port,
+               coap_packet_t *request, uint32_t upload_len,
+               blockwise_payload_handler payload_handler)
+{
+  coap_transaction_t *t;
+  uint32_t offset;
+  uint16_t size;
+  uint16_t len;
+
+  request->mid = coap_get_mid();
+  if(!(t = coap_new_transaction(request->mid, remote_ipaddr, remote_port))) {
+    PRINTF("Could not allocate transaction buffer\n");
+    return 0;
+  }
+  t->callback = blockwise_callback;
+  t->callback_data = slot;
+
+  size = state->block_size ? state->block_size : COAP_MAX_BLOCK_SIZE;
+  if(state->upload) {
+    /* read the block directly into the payload area of the transaction */
+    offset = slot->block_num * size;
+    len = MIN(size, upload_len - offset);
+    payload_handler(t->packet + COAP_MAX_HEADER_SIZE, offset, len);
+    coap_set_payload(request, t->packet + COAP_MAX_HEADER_SIZE, len);
+    coap_set_header_block1(request, slot->block_num,
+                           slot->block_num < state->last_block, size);
+  } else {
+    coap_set_header_block2(request, slot->block_num, 0, size);
+  }
+
+  if((t->packet_len = coap_serialize_message(request, t->packet)) == 0) {
+    coap_clear_transaction(t);
+    return 0;
+  }
+
+  slot->status = SLOT_SENT;
+  slot->sent = clock_time();
+  state->in_flight++;
+
+  coap_send_transaction(t);
+  PRINTF("Requested #%lu (MID %u, window %u)\n", slot->block_num,
+         request->mid, state->window);
+
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+blockwise_fill_window(struct blockwise_state_t *state,
+                      uip_ipaddr_t *remote_ipaddr, uint16_t remote_port,
+                      coap_packet_t *request, uint32_t upload_len,
+                      blockwise_payload_handler payload_handler)
+{
+  struct blockwise_slot_t *slot;
+  uint8_t i;
+
+  while(state->in_flight < state->window) {
+    /* blocks that timed out go first */
+    slot = NULL;
+    for(i = 0; i < COAP_BLOCKWISE_WINDOW; i++) {
+      if(state->slots[i].status == SLOT_RETRY) {
+        if(state->slots[i].block_num < state->error_block) {
+          slot = &state->slots[i];
+          break;
+        }
+        state->slots[i].status = SLOT_FREE;
+      }
+    }
+
+    if(slot == NULL) {
+      if(state->next_block > state->last_block
+         || state->next_block >= state->error_block) {
+        return;
+      }
+      /* the block size is only known after the first response */
+      if(state->next_block > 0 && state->block_size == 0) {
+        return;
+      }
+      /* the final Block1 block completes the upload on the server */
+      if(state->upload && state->next_block == state->last_block
+         && state->in_flight > 0) {
+        return;
+      }
+      for(i = 0; i < COAP_BLOCKWISE_WINDOW; i++) {
+        if(state->slots[i].status == SLOT_FREE) {
+          slot = &state->slots[i];
+          break;
+        }
+      }
+      if(slot == NULL) {
+        return;
+      }
+      slot->block_num = state->next_block++;
+    }
+
+    if(!blockwise_send(state, slot, remote_ipaddr, remote_port, request,
+                       upload_len, payload_handler)) {
+      if(state->in_flight == 0) {
+        /* nothing left that could free a transaction */
+        state->error_block = MIN(state->error_block, slot->block_num);
+      } else {
+        slot->status = SLOT_RETRY;
+      }
+      return;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+PT_THREAD(coap_blockwise_request
+            (struct blockwise_state_t *state, process_event_t ev,
+            uip_ipaddr_t *remote_ipaddr, uint16_t remote_port,
+            coap_packet_t *request, uint32_t upload_len,
+            blockwise_payload_handler payload_handler,
+            blocking_response_handler response_handler))
+{
+  uint8_t i;
+
+  PT_BEGIN(&state->pt);
+
+  state->process = PROCESS_CURRENT();
+  state->response_handler = response_handler;
+  state->upload = payload_handler != NULL;
+  state->upload_len = upload_len;
+  state->next_block = 0;
+  state->last_block = NO_BLOCK;
+  state->error_block = NO_BLOCK;
+  state->block_size = 0;
+  state->window = 1;
+  state->acked = 0;
+  state->in_flight = 0;
+  state->retries = 0;
+  state->failed = 0;
+  for(i = 0; i < COAP_BLOCKWISE_WINDOW; i++) {
+    state->slots[i].state = state;
+    state->slots[i].status = SLOT_FREE;
+  }
+
+  if(state->upload) {
+    /* until the first block is acknowledged with the server's size */
+    state->last_block = upload_len > 0
+      ? (upload_len - 1) / COAP_MAX_BLOCK_SIZE : 0;
+  }
+
+  while(1) {
+    blockwise_fill_window(state, remote_ipaddr, remote_port, request,
+                          upload_len, payload_handler);
+    if(state->in_flight == 0) {
+      break;
+    }
+    PT_YIELD_UNTIL(&state->pt, ev == PROCESS_EVENT_POLL);
+  }
+
+  state->failed = state->error_block <= state->last_block;
+  PRINTF("Blockwise transfer %s\n", state->failed ? "failed" : "done");
+
+  PT_END(&state->pt);
+}
+/*---------------------------------------------------------------------------*/
 /*- REST Engine Interface ---------------------------------------------------*/
 /*---------------------------------------------------------------------------*/
 const struct rest_implementation coap_rest_implementation = {
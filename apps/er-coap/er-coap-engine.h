@@ -81,5 +81,75 @@ PT_THREAD(coap_blocking_request
              ); \
   }
 /*---------------------------------------------------------------------------*/
+struct blockwise_state_t;
+
+struct blockwise_slot_t {
+  struct blockwise_state_t *state;
+  uint32_t block_num;
+  clock_time_t sent;
+  uint8_t status;
+};
+
+struct blockwise_state_t {
+  struct pt pt;
+  struct process *process;
+  blocking_response_handler response_handler;
+  struct blockwise_slot_t slots[COAP_BLOCKWISE_WINDOW];
+  uint32_t next_block;  /* next block that has not been requested yet */
+  uint32_t last_block;  /* last block of the transfer, once known */
+  uint32_t error_block; /* first block that failed */
+  uint32_t upload_len;
+  uint16_t block_size;  /* 0 until negotiated with the server */
+  uint8_t window;       /* congestion window, in blocks */
+  uint8_t acked;        /* responses since the window last grew */
+  uint8_t in_flight;
+  uint8_t retries;
+  uint8_t upload;
+  uint8_t failed;
+};
+
+/* Reads len bytes of a Block1 upload starting at offset into buffer */
+typedef void (*blockwise_payload_handler)(uint8_t *buffer, uint32_t offset,
+                                          uint16_t len);
+
+/*
+ * Pipelined blockwise transfer: keeps up to COAP_BLOCKWISE_WINDOW block
+ * requests in flight, halving the window whenever a block had to be
+ * retransmitted and growing it by one block per window of timely responses.
+ * Without payload_handler, the resource is downloaded with Block2 and
+ * response_handler is called for every block as it arrives, which may be
+ * out of order; use coap_get_header_block2() for the offset. With
+ * payload_handler, upload_len bytes are uploaded with Block1; the final
+ * block is only sent once all others have been acknowledged. state->failed
+ * is set if the transfer could not be completed.
+ */
+PT_THREAD(coap_blockwise_request
+            (struct blockwise_state_t *state, process_event_t ev,
+            uip_ipaddr_t *remote_ipaddr, uint16_t remote_port,
+            coap_packet_t *request, uint32_t upload_len,
+            blockwise_payload_handler payload_handler,
+            blocking_response_handler response_handler));
+
+#define COAP_BLOCKWISE_REQUEST(server_addr, server_port, request, chunk_handler) \
+  { \
+    static struct blockwise_state_t blockwise_state; \
+    PT_SPAWN(process_pt, &blockwise_state.pt, \
+             coap_blockwise_request(&blockwise_state, ev, \
+                                    server_addr, server_port, \
+                                    request, 0, NULL, chunk_handler) \
+             ); \
+  }
+
+#define COAP_BLOCKWISE_UPLOAD(server_addr, server_port, request, length, payload_handler, response_handler) \
+  { \
+    static struct blockwise_state_t blockwise_state; \
+    PT_SPAWN(process_pt, &blockwise_state.pt, \
+             coap_blockwise_request(&blockwise_state, ev, \
+                                    server_addr, server_port, \
+                                    request, length, payload_handler, \
+                                    response_handler) \
+             ); \
+  }
+/*---------------------------------------------------------------------------*/
 
 #endif /* ER_COAP_ENGINE_H_ */
@@ -39,6 +39,7 @@
 #include <stdio.h>
 #include <string.h>
 #include "er-coap-observe.h"
+#include "er-coap-cache.h"
 
 #define DEBUG 0
 #if DEBUG
@@ -55,9 +56,94 @@
 /*---------------------------------------------------------------------------*/
 MEMB(observers_memb, coap_observer_t, COAP_MAX_OBSERVERS);
 LIST(observers_list);
+
+/* Observers hashed by client address and port, by their last MID and
+   by their token */
+static coap_observer_t *client_table[COAP_OBSERVER_HASH_SIZE];
+static coap_observer_t *mid_table[COAP_OBSERVER_HASH_SIZE];
+static coap_observer_t *token_table[COAP_OBSERVER_HASH_SIZE];
+
+/* The hash chains of an observer */
+#define CLIENT_CHAIN 0
+#define MID_CHAIN    1
+#define TOKEN_CHAIN  2
+
+/* Observe option value of the next notification, shared by all observers */
+static uint32_t observe_counter;
+/*---------------------------------------------------------------------------*/
+static unsigned
+client_hash(uip_ipaddr_t *addr, uint16_t port)
+{
+  return (addr->u16[7] ^ port) % COAP_OBSERVER_HASH_SIZE;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned
+mid_hash(uint16_t mid)
+{
+  return mid % COAP_OBSERVER_HASH_SIZE;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned
+token_hash(const uint8_t *token, size_t token_len)
+{
+  unsigned hash = 0;
+
+  while(token_len-- > 0) {
+    hash = (hash << 3) + hash + *token++;
+  }
+  return hash % COAP_OBSERVER_HASH_SIZE;
+}
+/*---------------------------------------------------------------------------*/
+static coap_observer_t **
+chain_next(coap_observer_t *o, int chain)
+{
+  if(chain == MID_CHAIN) {
+    return &o->mid_next;
+  } else if(chain == TOKEN_CHAIN) {
+    return &o->token_next;
+  }
+  return &o->client_next;
+}
+/*---------------------------------------------------------------------------*/
+static void
+unlink_observer(coap_observer_t **p, coap_observer_t *o, int chain)
+{
+  for(; *p != NULL; p = chain_next(*p, chain)) {
+    if(*p == o) {
+      *p = *chain_next(o, chain);
+      return;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+set_last_mid(coap_observer_t *o, uint16_t mid)
+{
+  unlink_observer(&mid_table[mid_hash(o->last_mid)], o, MID_CHAIN);
+  o->last_mid = mid;
+  o->mid_next = mid_table[mid_hash(mid)];
+  mid_table[mid_hash(mid)] = o;
+}
+/*---------------------------------------------------------------------------*/
+static uint32_t
+next_observe_value(void)
+{
+  uint32_t observe;
+
+  /* The Observe option has 24 bits */
+  observe = observe_counter;
+  observe_counter = (observe_counter + 1) & 0xFFFFFF;
+  return observe;
+}
 /*---------------------------------------------------------------------------*/
 /*- Internal API ------------------------------------------------------------*/
 /*---------------------------------------------------------------------------*/
+list_t
+coap_get_observers(void)
+{
+  return observers_list;
+}
+/*---------------------------------------------------------------------------*/
 coap_observer_t *
 coap_add_observer(uip_ipaddr_t *addr, uint16_t port, const uint8_t *token,
                   size_t token_len, const char *uri)
@@ -74,11 +160,18 @@ coap_add_observer(uip_ipaddr_t *addr, uint16_t port, const uint8_t *token,
     o->token_len = token_len;
     memcpy(o->token, token, token_len);
     o->last_mid = 0;
+    o->obs_counter = 1;        /* the registration response was the first */
 
     PRINTF("Adding observer (%u/%u) for /%s [0x%02X%02X]\n",
            list_length(observers_list) + 1, COAP_MAX_OBSERVERS,
            o->url, o->token[0], o->token[1]);
     list_add(observers_list, o);
+    o->client_next = client_table[client_hash(addr, port)];
+    client_table[client_hash(addr, port)] = o;
+    o->mid_next = mid_table[mid_hash(o->last_mid)];
+    mid_table[mid_hash(o->last_mid)] = o;
+    o->token_next = token_table[token_hash(token, token_len)];
+    token_table[token_hash(token, token_len)] = o;
   }
 
   return o;
@@ -92,8 +185,13 @@ coap_remove_observer(coap_observer_t *o)
   PRINTF("Removing observer for /%s [0x%02X%02X]\n", o->url, o->token[0],
          o->token[1]);
 
-  memb_free(&observers_memb, o);
+  unlink_observer(&client_table[client_hash(&o->addr, o->port)], o,
+                  CLIENT_CHAIN);
+  unlink_observer(&mid_table[mid_hash(o->last_mid)], o, MID_CHAIN);
+  unlink_observer(&token_table[token_hash(o->token, o->token_len)], o,
+                  TOKEN_CHAIN);
   list_remove(observers_list, o);
+  memb_free(&observers_memb, o);
 }
 /*---------------------------------------------------------------------------*/
 int
@@ -101,12 +199,13 @@ coap_remove_observer_by_client(uip_ipaddr_t *addr, uint16_t port)
 {
   int removed = 0;
   coap_observer_t *obs = NULL;
+  coap_observer_t *next = NULL;
 
-  for(obs = (coap_observer_t *)list_head(observers_list); obs;
-      obs = obs->next) {
-    PRINTF("Remove check client ");
-    PRINT6ADDR(addr);
-    PRINTF(":%u\n", port);
+  PRINTF("Remove check client ");
+  PRINT6ADDR(addr);
+  PRINTF(":%u\n", port);
+  for(obs = client_table[client_hash(addr, port)]; obs; obs = next) {
+    next = obs->client_next;
     if(uip_ipaddr_cmp(&obs->addr, addr) && obs->port == port) {
       coap_remove_observer(obs);
       removed++;
@@ -121,10 +220,11 @@ coap_remove_observer_by_token(uip_ipaddr_t *addr, uint16_t port,
 {
   int removed = 0;
   coap_observer_t *obs = NULL;
+  coap_observer_t *next = NULL;
 
-  for(obs = (coap_observer_t *)list_head(observers_list); obs;
-      obs = obs->next) {
-    PRINTF("Remove check Token 0x%02X%02X\n", token[0], token[1]);
+  PRINTF("Remove check Token 0x%02X%02X\n", token[0], token[1]);
+  for(obs = token_table[token_hash(token, token_len)]; obs; obs = next) {
+    next = obs->token_next;
     if(uip_ipaddr_cmp(&obs->addr, addr) && obs->port == port
        && obs->token_len == token_len
        && memcmp(obs->token, token, token_len) == 0) {
@@ -141,12 +241,23 @@ coap_remove_observer_by_uri(uip_ipaddr_t *addr, uint16_t port,
 {
   int removed = 0;
   coap_observer_t *obs = NULL;
+  coap_observer_t *next = NULL;
 
-  for(obs = (coap_observer_t *)list_head(observers_list); obs;
-      obs = obs->next) {
-    PRINTF("Remove check URL %p\n", uri);
-    if((addr == NULL
-        || (uip_ipaddr_cmp(&obs->addr, addr) && obs->port == port))
+  PRINTF("Remove check URL %p\n", uri);
+  if(addr == NULL) {
+    for(obs = (coap_observer_t *)list_head(observers_list); obs; obs = next) {
+      next = obs->next;
+      if(obs->url == uri || memcmp(obs->url, uri, strlen(obs->url)) == 0) {
+        coap_remove_observer(obs);
+        removed++;
+      }
+    }
+    return removed;
+  }
+
+  for(obs = client_table[client_hash(addr, port)]; obs; obs = next) {
+    next = obs->client_next;
+    if(uip_ipaddr_cmp(&obs->addr, addr) && obs->port == port
        && (obs->url == uri || memcmp(obs->url, uri, strlen(obs->url)) == 0)) {
       coap_remove_observer(obs);
       removed++;
@@ -160,10 +271,11 @@ coap_remove_observer_by_mid(uip_ipaddr_t *addr, uint16_t port, uint16_t mid)
 {
   int removed = 0;
   coap_observer_t *obs = NULL;
+  coap_observer_t *next = NULL;
 
-  for(obs = (coap_observer_t *)list_head(observers_list); obs;
-      obs = obs->next) {
-    PRINTF("Remove check MID %u\n", mid);
+  PRINTF("Remove check MID %u\n", mid);
+  for(obs = mid_table[mid_hash(mid)]; obs; obs = next) {
+    next = obs->mid_next;
     if(uip_ipaddr_cmp(&obs->addr, addr) && obs->port == port
        && obs->last_mid == mid) {
       coap_remove_observer(obs);
@@ -175,56 +287,155 @@ coap_remove_observer_by_mid(uip_ipaddr_t *addr, uint16_t port, uint16_t mid)
 /*---------------------------------------------------------------------------*/
 /*- Notification ------------------------------------------------------------*/
 /*---------------------------------------------------------------------------*/
+/*
+ * Copies the notification serialized into source to t, replacing the
+ * message type, MID and token. Returns the length of the new message,
+ * or 0 if it does not fit.
+ */
+static uint16_t
+copy_notification(coap_transaction_t *t, const coap_transaction_t *source,
+                  const coap_observer_t *obs, coap_message_type_t type)
+{
+  uint8_t token_len;
+  uint16_t rest_len;
+
+  token_len = (source->packet[0] & COAP_HEADER_TOKEN_LEN_MASK)
+    >> COAP_HEADER_TOKEN_LEN_POSITION;
+  rest_len = source->packet_len - COAP_HEADER_LEN - token_len;
+  if(COAP_HEADER_LEN + obs->token_len + rest_len > COAP_MAX_PACKET_SIZE) {
+    return 0;
+  }
+
+  t->packet[0] = (source->packet[0]
+                  & ~(COAP_HEADER_TYPE_MASK | COAP_HEADER_TOKEN_LEN_MASK))
+    | (type << COAP_HEADER_TYPE_POSITION)
+    | (obs->token_len << COAP_HEADER_TOKEN_LEN_POSITION);
+  t->packet[1] = source->packet[1];
+  t->packet[2] = (uint8_t)(t->mid >> 8);
+  t->packet[3] = (uint8_t)t->mid;
+  memcpy(&t->packet[COAP_HEADER_LEN], obs->token, obs->token_len);
+  memcpy(&t->packet[COAP_HEADER_LEN + obs->token_len],
+         &source->packet[COAP_HEADER_LEN + token_len], rest_len);
+
+  return COAP_HEADER_LEN + obs->token_len + rest_len;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Returns the confirmable notification to the observer that has been
+ * sent but not yet acknowledged, or NULL. The transaction is freed when
+ * the ACK arrives or when it times out.
+ */
+static coap_transaction_t *
+get_open_notification(const coap_observer_t *obs,
+                      const coap_transaction_t *unsent)
+{
+  coap_transaction_t *t;
+
+  t = coap_get_transaction_by_mid(obs->last_mid);
+  if(t != NULL && t != unsent && t->port == obs->port
+     && uip_ipaddr_cmp(&t->addr, &obs->addr)
+     && COAP_TYPE_CON == ((COAP_HEADER_TYPE_MASK & t->packet[0])
+                          >> COAP_HEADER_TYPE_POSITION)) {
+    return t;
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
 void
 coap_notify_observers(resource_t *resource)
 {
   /* build notification */
   coap_packet_t notification[1]; /* this way the packet can be treated as pointer as usual */
-  coap_init_message(notification, COAP_TYPE_NON, CONTENT_2_05, 0);
   coap_observer_t *obs = NULL;
+  coap_transaction_t *transaction = NULL;
+  /* the previous notification, kept until the next one is copied from it */
+  coap_transaction_t *previous = NULL;
+  coap_message_type_t type;
+  uint32_t observe;
 
   PRINTF("Observe: Notification from %s\n", resource->url);
 
+  /* the representation has changed */
+  coap_cache_invalidate(resource->url);
+
+  observe = next_observe_value();
+
   /* iterate over observers */
   for(obs = (coap_observer_t *)list_head(observers_list); obs;
       obs = obs->next) {
     if(obs->url == resource->url) {     /* using RESOURCE url pointer as handle */
-      coap_transaction_t *transaction = NULL;
-
-      /*TODO implement special transaction for CON, sharing the same buffer to allow for more observers */
+      type = COAP_TYPE_NON;
+      if(obs->obs_counter % COAP_OBSERVE_REFRESH_INTERVAL == 0) {
+        PRINTF("           Force Confirmable for\n");
+        type = COAP_TYPE_CON;
+      }
+      obs->obs_counter++;
 
-      if((transaction = coap_new_transaction(coap_get_mid(), &obs->addr, obs->port))) {
-        if(obs->obs_counter % COAP_OBSERVE_REFRESH_INTERVAL == 0) {
-          PRINTF("           Force Confirmable for\n");
-          notification->type = COAP_TYPE_CON;
-        }
+      /* An observer has at most one confirmable notification in flight.
+         A new notification replaces it in the same transaction, which
+         keeps its retransmission timer and counter (RFC 7641, 4.5.2), so
+         that an observer that has gone away still times out. */
+      transaction = get_open_notification(obs, previous);
+      if(transaction != NULL) {
+        PRINTF("           Replacing unacknowledged notification\n");
+        coap_renew_transaction(transaction, coap_get_mid());
+        type = COAP_TYPE_CON;
+      } else {
+        transaction = coap_new_transaction(coap_get_mid(), &obs->addr,
+                                           obs->port);
+      }
+      if(transaction == NULL && previous != NULL) {
+        /* out of transactions: send the previous one to make room */
+        coap_send_transaction(previous);
+        previous = NULL;
+        transaction = coap_new_transaction(coap_get_mid(), &obs->addr,
+                                           obs->port);
+      }
+      if(transaction == NULL) {
+        continue;
+      }
 
-        PRINTF("           Observer ");
-        PRINT6ADDR(&obs->addr);
-        PRINTF(":%u\n", obs->port);
+      PRINTF("           Observer ");
+      PRINT6ADDR(&obs->addr);
+      PRINTF(":%u\n", obs->port);
 
-        /* update last MID for RST matching */
-        obs->last_mid = transaction->mid;
+      /* update last MID for RST matching */
+      set_last_mid(obs, transaction->mid);
 
-        /* prepare response */
-        notification->mid = transaction->mid;
+      /* The resource generates the representation only once; the
+         notifications to the other observers are copies of it. */
+      if(previous == NULL
+         || (transaction->packet_len =
+               copy_notification(transaction, previous, obs, type)) == 0) {
+        coap_init_message(notification, type, CONTENT_2_05, transaction->mid);
 
         resource->get_handler(NULL, notification,
                               transaction->packet + COAP_MAX_HEADER_SIZE,
                               REST_MAX_CHUNK_SIZE, NULL);
 
         if(notification->code < BAD_REQUEST_4_00) {
-          coap_set_header_observe(notification, (obs->obs_counter)++);
+          coap_set_header_observe(notification, observe);
         }
         coap_set_token(notification, obs->token, obs->token_len);
 
         transaction->packet_len =
           coap_serialize_message(notification, transaction->packet);
+        if(transaction->packet_len == 0) {
+          coap_clear_transaction(transaction);
+          continue;
+        }
+      }
 
-        coap_send_transaction(transaction);
+      if(previous != NULL) {
+        coap_send_transaction(previous);
       }
+      previous = transaction;
     }
   }
+
+  if(previous != NULL) {
+    coap_send_transaction(previous);
+  }
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -243,7 +454,7 @@ coap_observe_handler(resource_t *resource, void *request, void *response)
                                 coap_req->token, coap_req->token_len,
                                 resource->url);
        if(obs) {
-          coap_set_header_observe(coap_res, (obs->obs_counter)++);
+          coap_set_header_observe(coap_res, next_observe_value());
           /*
            * Following payload is for demonstration purposes only.
            * A subscription should return the same representation as a normal GET.
@@ -53,6 +53,9 @@ typedef struct coap_observable {
 
 typedef struct coap_observer {
   struct coap_observer *next;   /* for LIST */
+  struct coap_observer *client_next;    /* next in the same client hash bucket */
+  struct coap_observer *mid_next;       /* next in the same MID hash bucket */
+  struct coap_observer *token_next;     /* next in the same token hash bucket */
 
   const char *url;
   uip_ipaddr_t addr;
@@ -62,9 +65,6 @@ typedef struct coap_observer {
   uint16_t last_mid;
 
   int32_t obs_counter;
-
-  struct etimer retrans_timer;
-  uint8_t retrans_counter;
 } coap_observer_t;
 
 list_t coap_get_observers(void);
@@ -99,9 +99,7 @@ coap_separate_accept(void *request, coap_separate_t *separate_store)
       /* ACK with empty code (0) */
       coap_init_message(ack, COAP_TYPE_ACK, 0, coap_req->mid);
       /* serializing into IPBUF: Only overwrites header parts that are already parsed into the request struct */
-      coap_send_message(&UIP_IP_BUF->srcipaddr, UIP_UDP_BUF->srcport,
-                        (uip_appdata), coap_serialize_message(ack,
-                                                              uip_appdata));
+      coap_send_packet(&UIP_IP_BUF->srcipaddr, UIP_UDP_BUF->srcport, ack);
     }
 
     /* store remote address */
@@ -55,10 +55,135 @@
 
 /*---------------------------------------------------------------------------*/
 MEMB(transactions_memb, coap_transaction_t, COAP_MAX_OPEN_TRANSACTIONS);
-LIST(transactions_list);
+
+/* Open transactions hashed by MID */
+static coap_transaction_t *mid_table[COAP_TRANSACTION_HASH_SIZE];
+
+/*
+ * Retransmission timer wheel. Each slot holds the transactions whose
+ * retransmission timer expires within one COAP_TRANSACTION_WHEEL_TICK,
+ * and a single etimer wakes up the transaction handler for the next one
+ * due. Retransmission timeouts longer than a full turn of the wheel
+ * simply stay in their slot until they are due.
+ */
+#define WHEEL_SLOTS   COAP_TRANSACTION_WHEEL_SLOTS
+#define WHEEL_TICK    COAP_TRANSACTION_WHEEL_TICK
+#define NOT_SCHEDULED WHEEL_SLOTS
+
+static coap_transaction_t *wheel[WHEEL_SLOTS];
+static clock_time_t wheel_time;
+static uint16_t scheduled;
+static struct etimer wheel_timer;
 
 static struct process *transaction_handler_process = NULL;
 
+/*---------------------------------------------------------------------------*/
+static uint8_t
+wheel_slot(clock_time_t time)
+{
+  return (time / WHEEL_TICK) % WHEEL_SLOTS;
+}
+/*---------------------------------------------------------------------------*/
+static clock_time_t
+retrans_time(coap_transaction_t *t)
+{
+  return t->retrans_timer.start + t->retrans_timer.interval;
+}
+/*---------------------------------------------------------------------------*/
+static void
+set_wheel_timer(clock_time_t interval)
+{
+  PROCESS_CONTEXT_BEGIN(transaction_handler_process);
+  etimer_set(&wheel_timer, interval);
+  PROCESS_CONTEXT_END(transaction_handler_process);
+}
+/*---------------------------------------------------------------------------*/
+static void
+wheel_add(coap_transaction_t *t)
+{
+  if(scheduled == 0) {
+    wheel_time = clock_time() - clock_time() % WHEEL_TICK;
+  }
+  t->wheel_slot = wheel_slot(retrans_time(t));
+  t->wheel_next = wheel[t->wheel_slot];
+  wheel[t->wheel_slot] = t;
+  scheduled++;
+
+  /* Wake up earlier if this transaction is due before the next one */
+  if(etimer_expired(&wheel_timer)
+     || etimer_expiration_time(&wheel_timer) - clock_time()
+     > timer_remaining(&t->retrans_timer)) {
+    set_wheel_timer(timer_remaining(&t->retrans_timer));
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+wheel_remove(coap_transaction_t *t)
+{
+  coap_transaction_t **p;
+
+  if(t->wheel_slot == NOT_SCHEDULED) {
+    return;
+  }
+  for(p = &wheel[t->wheel_slot]; *p != NULL; p = &(*p)->wheel_next) {
+    if(*p == t) {
+      *p = t->wheel_next;
+      scheduled--;
+      break;
+    }
+  }
+  t->wheel_slot = NOT_SCHEDULED;
+}
+/*---------------------------------------------------------------------------*/
+/* Sets the wheel timer to the next retransmission that is due */
+static void
+update_wheel_timer(void)
+{
+  coap_transaction_t *t;
+  clock_time_t slot_time;
+  clock_time_t next;
+  uint8_t found;
+  uint8_t i;
+
+  if(scheduled == 0) {
+    etimer_stop(&wheel_timer);
+    return;
+  }
+
+  /* The first slot with a transaction due in this turn of the wheel
+     holds the next retransmission. */
+  slot_time = wheel_time;
+  next = 0;
+  found = 0;
+  for(i = 0; i < WHEEL_SLOTS && !found; i++, slot_time += WHEEL_TICK) {
+    for(t = wheel[wheel_slot(slot_time)]; t != NULL; t = t->wheel_next) {
+      if(retrans_time(t) - slot_time < WHEEL_TICK
+         && (!found || timer_remaining(&t->retrans_timer) < next)) {
+        next = timer_remaining(&t->retrans_timer);
+        found = 1;
+      }
+    }
+  }
+  if(!found) {
+    /* Only long timeouts are pending; check again after a full turn */
+    next = WHEEL_SLOTS * WHEEL_TICK - (clock_time() - wheel_time);
+  }
+  set_wheel_timer(next);
+}
+/*---------------------------------------------------------------------------*/
+static void
+mid_table_remove(coap_transaction_t *t)
+{
+  coap_transaction_t **p;
+
+  for(p = &mid_table[t->mid % COAP_TRANSACTION_HASH_SIZE]; *p != NULL;
+      p = &(*p)->mid_next) {
+    if(*p == t) {
+      *p = t->mid_next;
+      return;
+    }
+  }
+}
 /*---------------------------------------------------------------------------*/
 /*- Internal API ------------------------------------------------------------*/
 /*---------------------------------------------------------------------------*/
@@ -75,12 +200,14 @@ coap_new_transaction(uint16_t mid, uip_ipaddr_t *addr, uint16_t port)
   if(t) {
     t->mid = mid;
     t->retrans_counter = 0;
+    t->wheel_slot = NOT_SCHEDULED;
 
     /* save client address */
     uip_ipaddr_copy(&t->addr, addr);
     t->port = port;
 
-    list_add(transactions_list, t); /* list itself makes sure same element is not added twice */
+    t->mid_next = mid_table[mid % COAP_TRANSACTION_HASH_SIZE];
+    mid_table[mid % COAP_TRANSACTION_HASH_SIZE] = t;
   }
 
   return t;
@@ -99,29 +226,29 @@ coap_send_transaction(coap_transaction_t *t)
       /* not timed out yet */
       PRINTF("Keeping transaction %u\n", t->mid);
 
+      if(t->wheel_slot != NOT_SCHEDULED
+         && !timer_expired(&t->retrans_timer)) {
+        /* renewed before its retransmission was due: keep the timer */
+        return;
+      }
+
       if(t->retrans_counter == 0) {
-        t->retrans_timer.timer.interval =
+        t->retrans_timer.interval =
           COAP_RESPONSE_TIMEOUT_TICKS + (random_rand()
                                          %
                                          (clock_time_t)
                                          COAP_RESPONSE_TIMEOUT_BACKOFF_MASK);
         PRINTF("Initial interval %f\n",
-               (float)t->retrans_timer.timer.interval / CLOCK_SECOND);
+               (float)t->retrans_timer.interval / CLOCK_SECOND);
       } else {
-        t->retrans_timer.timer.interval <<= 1;  /* double */
+        t->retrans_timer.interval <<= 1;  /* double */
         PRINTF("Doubled (%u) interval %f\n", t->retrans_counter,
-               (float)t->retrans_timer.timer.interval / CLOCK_SECOND);
+               (float)t->retrans_timer.interval / CLOCK_SECOND);
       }
 
-      /*FIXME
-       * Hack: Setting timer for responsible process.
-       * Maybe there is a better way, but avoid posting everything to the process.
-       */
-      struct process *process_actual = PROCESS_CURRENT();
-
-      process_current = transaction_handler_process;
-      etimer_restart(&t->retrans_timer);        /* interval updated above */
-      process_current = process_actual;
+      wheel_remove(t);
+      timer_restart(&t->retrans_timer);        /* interval updated above */
+      wheel_add(t);
 
       t = NULL;
     } else {
@@ -145,13 +272,24 @@ coap_send_transaction(coap_transaction_t *t)
 }
 /*---------------------------------------------------------------------------*/
 void
+coap_renew_transaction(coap_transaction_t *t, uint16_t mid)
+{
+  PRINTF("Renewing transaction %u as %u\n", t->mid, mid);
+
+  mid_table_remove(t);
+  t->mid = mid;
+  t->mid_next = mid_table[mid % COAP_TRANSACTION_HASH_SIZE];
+  mid_table[mid % COAP_TRANSACTION_HASH_SIZE] = t;
+}
+/*---------------------------------------------------------------------------*/
+void
 coap_clear_transaction(coap_transaction_t *t)
 {
   if(t) {
     PRINTF("Freeing transaction %u: %p\n", t->mid, t);
 
-    etimer_stop(&t->retrans_timer);
-    list_remove(transactions_list, t);
+    wheel_remove(t);
+    mid_table_remove(t);
     memb_free(&transactions_memb, t);
   }
 }
@@ -160,7 +298,7 @@ coap_get_transaction_by_mid(uint16_t mid)
 {
   coap_transaction_t *t = NULL;
 
-  for(t = (coap_transaction_t *)list_head(transactions_list); t; t = t->next) {
+  for(t = mid_table[mid % COAP_TRANSACTION_HASH_SIZE]; t; t = t->mid_next) {
     if(t->mid == mid) {
       PRINTF("Found transaction for MID %u: %p\n", t->mid, t);
       return t;
@@ -172,14 +310,37 @@ coap_get_transaction_by_mid(uint16_t mid)
 void
 coap_check_transactions()
 {
-  coap_transaction_t *t = NULL;
+  coap_transaction_t *t, **p;
+  uint8_t slot;
+  uint8_t processed;
 
-  for(t = (coap_transaction_t *)list_head(transactions_list); t; t = t->next) {
-    if(etimer_expired(&t->retrans_timer)) {
-      ++(t->retrans_counter);
-      PRINTF("Retransmitting %u (%u)\n", t->mid, t->retrans_counter);
-      coap_send_transaction(t);
+  /* Retransmit everything that is due in the slots that have come up
+     since the last call, up to and including the current one. */
+  for(processed = 0; processed < WHEEL_SLOTS; processed++) {
+    slot = wheel_slot(wheel_time);
+    p = &wheel[slot];
+    while((t = *p) != NULL) {
+      if(timer_expired(&t->retrans_timer)) {
+        ++(t->retrans_counter);
+        PRINTF("Retransmitting %u (%u)\n", t->mid, t->retrans_counter);
+        coap_send_transaction(t);
+        /* Sending may have changed this slot; start over */
+        p = &wheel[slot];
+      } else {
+        p = &t->wheel_next;
+      }
+    }
+    if(clock_time() - wheel_time < WHEEL_TICK) {
+      break;
     }
+    wheel_time += WHEEL_TICK;
   }
+
+  if(clock_time() - wheel_time >= WHEEL_TICK) {
+    /* All slots have been processed, catch up with the clock. */
+    wheel_time = clock_time() - clock_time() % WHEEL_TICK;
+  }
+
+  update_wheel_timer();
 }
 /*---------------------------------------------------------------------------*/
@@ -50,11 +50,13 @@
 
 /* container for transactions with message buffer and retransmission info */
 typedef struct coap_transaction {
-  struct coap_transaction *next;        /* for LIST */
+  struct coap_transaction *mid_next;    /* next in the same MID hash bucket */
+  struct coap_transaction *wheel_next;  /* next in the same timer wheel slot */
 
   uint16_t mid;
-  struct etimer retrans_timer;
+  struct timer retrans_timer;
   uint8_t retrans_counter;
+  uint8_t wheel_slot;
 
   uip_ipaddr_t addr;
   uint16_t port;
@@ -72,6 +74,12 @@ void coap_register_as_transaction_handler();
 coap_transaction_t *coap_new_transaction(uint16_t mid, uip_ipaddr_t *addr,
                                          uint16_t port);
 void coap_send_transaction(coap_transaction_t *t);
+/*
+ * Reuses an open confirmable transaction for a new message with another
+ * MID. The transaction keeps its retransmission timer and counter, so
+ * the new message is retransmitted when the old one would have been.
+ */
+void coap_renew_transaction(coap_transaction_t *t, uint16_t mid);
 void coap_clear_transaction(coap_transaction_t *t);
 coap_transaction_t *coap_get_transaction_by_mid(uint16_t mid);
 
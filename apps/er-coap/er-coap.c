@@ -64,6 +64,12 @@ static uint16_t current_mid = 0;
 
 coap_status_t erbium_status_code = NO_ERROR;
 char *coap_error_message = "";
+
+/* repeatable options whose segments have not been joined yet */
+#define COAP_SPLIT_URI_PATH       0x01
+#define COAP_SPLIT_URI_QUERY      0x02
+#define COAP_SPLIT_LOCATION_PATH  0x04
+#define COAP_SPLIT_LOCATION_QUERY 0x08
 /*---------------------------------------------------------------------------*/
 /*- Local helper functions --------------------------------------------------*/
 /*---------------------------------------------------------------------------*/
@@ -215,24 +221,75 @@ coap_serialize_array_option(unsigned int number, unsigned int current_number,
 }
 /*---------------------------------------------------------------------------*/
 static void
-coap_merge_multi_option(char **dst, size_t *dst_len, uint8_t *option,
-                        size_t option_len, char separator)
+coap_add_multi_option(coap_packet_t *coap_pkt, const char **dst,
+                      size_t *dst_len, uint8_t *option, size_t option_len,
+                      uint8_t split_flag)
 {
-  /* merge multiple options */
-  if(*dst_len > 0) {
-    /* dst already contains an option: concatenate */
-    (*dst)[*dst_len] = separator;
-    *dst_len += 1;
-
-    /* memmove handles 2-byte option headers */
-    memmove((*dst) + (*dst_len), option, option_len);
-
-    *dst_len += option_len;
-  } else {
-    /* dst is empty: set to option */
+  if(*dst == NULL) {
+    /* first occurrence: reference the option in place */
     *dst = (char *)option;
     *dst_len = option_len;
+  } else {
+    /* further segments are only joined when the option is accessed */
+    coap_pkt->split_options |= split_flag;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+coap_join_multi_option(coap_packet_t *coap_pkt, const char **dst,
+                       size_t *dst_len, uint8_t split_flag, char separator)
+{
+  uint8_t *joined;
+  uint8_t *option;
+  size_t option_len;
+  size_t header_len;
+
+  if(!(coap_pkt->split_options & split_flag)) {
+    return;
   }
+  coap_pkt->split_options &= ~split_flag;
+
+  /* repeated options directly follow the first one with a delta of 0 */
+  joined = (uint8_t *)*dst;
+  option = joined + *dst_len;
+  while(option < coap_pkt->options_end && (option[0] & 0xF0) == 0) {
+    option_len = option[0] & 0x0F;
+    header_len = 1;
+    if(option_len == 13) {
+      option_len += option[1];
+      header_len = 2;
+    } else if(option_len == 14) {
+      option_len += 255 + (option[1] << 8) + option[2];
+      header_len = 3;
+    }
+
+    /* concatenate in place; memmove handles multi-byte option headers */
+    joined[*dst_len] = separator;
+    memmove(joined + *dst_len + 1, option + header_len, option_len);
+    *dst_len += 1 + option_len;
+
+    option += header_len + option_len;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+coap_in_uip_buf(const void *data)
+{
+  return (const uint8_t *)data >= &uip_buf[0]
+         && (const uint8_t *)data < &uip_buf[UIP_BUFSIZE];
+}
+/*---------------------------------------------------------------------------*/
+static int
+coap_refers_to_uip_buf(coap_packet_t *coap_pkt)
+{
+  return coap_in_uip_buf(coap_pkt->payload)
+         || coap_in_uip_buf(coap_pkt->uri_host)
+         || coap_in_uip_buf(coap_pkt->uri_path)
+         || coap_in_uip_buf(coap_pkt->uri_query)
+         || coap_in_uip_buf(coap_pkt->location_path)
+         || coap_in_uip_buf(coap_pkt->location_query)
+         || coap_in_uip_buf(coap_pkt->proxy_uri)
+         || coap_in_uip_buf(coap_pkt->proxy_scheme);
 }
 /*---------------------------------------------------------------------------*/
 static int
@@ -393,7 +450,10 @@ coap_serialize_message(void *packet, uint8_t *buffer)
       *option = 0xFF;
       ++option;
     }
-    memmove(option, coap_pkt->payload, coap_pkt->payload_len);
+    /* the payload might already be in place */
+    if(option != coap_pkt->payload) {
+      memmove(option, coap_pkt->payload, coap_pkt->payload_len);
+    }
   } else {
     /* an error occurred: caller must check for !=0 */
     coap_pkt->buffer = NULL;
@@ -434,6 +494,24 @@ coap_send_message(uip_ipaddr_t *addr, uint16_t port, uint8_t *data,
   udp_conn->rport = 0;
 }
 /*---------------------------------------------------------------------------*/
+size_t
+coap_send_packet(uip_ipaddr_t *addr, uint16_t port, void *packet)
+{
+  coap_packet_t *const coap_pkt = (coap_packet_t *)packet;
+  uint8_t *buffer = &uip_buf[UIP_LLH_LEN + UIP_IPUDPH_LEN];
+  size_t length;
+
+  /* serializing would overwrite data the message still refers to */
+  if(coap_refers_to_uip_buf(coap_pkt)) {
+    return 0;
+  }
+
+  if((length = coap_serialize_message(coap_pkt, buffer)) > 0) {
+    coap_send_message(addr, port, buffer, length);
+  }
+  return length;
+}
+/*---------------------------------------------------------------------------*/
 coap_status_t
 coap_parse_message(void *packet, uint8_t *data, uint16_t data_len)
 {
@@ -444,6 +522,7 @@ coap_parse_message(void *packet, uint8_t *data, uint16_t data_len)
 
   /* pointer to packet bytes */
   coap_pkt->buffer = data;
+  coap_pkt->options_end = data + data_len;
 
   /* parse header fields */
   coap_pkt->version = (COAP_HEADER_VERSION_MASK & coap_pkt->buffer[0])
@@ -595,34 +674,30 @@ coap_parse_message(void *packet, uint8_t *data, uint16_t data_len)
       PRINTF("Uri-Port [%u]\n", coap_pkt->uri_port);
       break;
     case COAP_OPTION_URI_PATH:
-      /* coap_merge_multi_option() operates in-place on the IPBUF, but final packet field should be const string -> cast to string */
-      coap_merge_multi_option((char **)&(coap_pkt->uri_path),
-                              &(coap_pkt->uri_path_len), current_option,
-                              option_length, '/');
+      coap_add_multi_option(coap_pkt, &(coap_pkt->uri_path),
+                            &(coap_pkt->uri_path_len), current_option,
+                            option_length, COAP_SPLIT_URI_PATH);
       PRINTF("Uri-Path [%.*s]\n", coap_pkt->uri_path_len, coap_pkt->uri_path);
       break;
     case COAP_OPTION_URI_QUERY:
-      /* coap_merge_multi_option() operates in-place on the IPBUF, but final packet field should be const string -> cast to string */
-      coap_merge_multi_option((char **)&(coap_pkt->uri_query),
-                              &(coap_pkt->uri_query_len), current_option,
-                              option_length, '&');
+      coap_add_multi_option(coap_pkt, &(coap_pkt->uri_query),
+                            &(coap_pkt->uri_query_len), current_option,
+                            option_length, COAP_SPLIT_URI_QUERY);
       PRINTF("Uri-Query [%.*s]\n", coap_pkt->uri_query_len,
              coap_pkt->uri_query);
       break;
 
     case COAP_OPTION_LOCATION_PATH:
-      /* coap_merge_multi_option() operates in-place on the IPBUF, but final packet field should be const string -> cast to string */
-      coap_merge_multi_option((char **)&(coap_pkt->location_path),
-                              &(coap_pkt->location_path_len), current_option,
-                              option_length, '/');
+      coap_add_multi_option(coap_pkt, &(coap_pkt->location_path),
+                            &(coap_pkt->location_path_len), current_option,
+                            option_length, COAP_SPLIT_LOCATION_PATH);
       PRINTF("Location-Path [%.*s]\n", coap_pkt->location_path_len,
              coap_pkt->location_path);
       break;
     case COAP_OPTION_LOCATION_QUERY:
-      /* coap_merge_multi_option() operates in-place on the IPBUF, but final packet field should be const string -> cast to string */
-      coap_merge_multi_option((char **)&(coap_pkt->location_query),
-                              &(coap_pkt->location_query_len), current_option,
-                              option_length, '&');
+      coap_add_multi_option(coap_pkt, &(coap_pkt->location_query),
+                            &(coap_pkt->location_query_len), current_option,
+                            option_length, COAP_SPLIT_LOCATION_QUERY);
       PRINTF("Location-Query [%.*s]\n", coap_pkt->location_query_len,
              coap_pkt->location_query);
       break;
@@ -683,11 +758,11 @@ coap_parse_message(void *packet, uint8_t *data, uint16_t data_len)
 int
 coap_get_query_variable(void *packet, const char *name, const char **output)
 {
-  coap_packet_t *const coap_pkt = (coap_packet_t *)packet;
+  const char *query;
+  size_t query_len;
 
-  if(IS_OPTION(coap_pkt, COAP_OPTION_URI_QUERY)) {
-    return coap_get_variable(coap_pkt->uri_query, coap_pkt->uri_query_len,
-                             name, output);
+  if((query_len = coap_get_header_uri_query(packet, &query)) > 0) {
+    return coap_get_variable(query, query_len, name, output);
   }
   return 0;
 }
@@ -906,6 +981,9 @@ coap_get_header_uri_path(void *packet, const char **path)
   if(!IS_OPTION(coap_pkt, COAP_OPTION_URI_PATH)) {
     return 0;
   }
+  coap_join_multi_option(coap_pkt, &(coap_pkt->uri_path),
+                         &(coap_pkt->uri_path_len),
+                         COAP_SPLIT_URI_PATH, '/');
   *path = coap_pkt->uri_path;
   return coap_pkt->uri_path_len;
 }
@@ -932,6 +1010,9 @@ coap_get_header_uri_query(void *packet, const char **query)
   if(!IS_OPTION(coap_pkt, COAP_OPTION_URI_QUERY)) {
     return 0;
   }
+  coap_join_multi_option(coap_pkt, &(coap_pkt->uri_query),
+                         &(coap_pkt->uri_query_len),
+                         COAP_SPLIT_URI_QUERY, '&');
   *query = coap_pkt->uri_query;
   return coap_pkt->uri_query_len;
 }
@@ -958,6 +1039,9 @@ coap_get_header_location_path(void *packet, const char **path)
   if(!IS_OPTION(coap_pkt, COAP_OPTION_LOCATION_PATH)) {
     return 0;
   }
+  coap_join_multi_option(coap_pkt, &(coap_pkt->location_path),
+                         &(coap_pkt->location_path_len),
+                         COAP_SPLIT_LOCATION_PATH, '/');
   *path = coap_pkt->location_path;
   return coap_pkt->location_path_len;
 }
@@ -992,6 +1076,9 @@ coap_get_header_location_query(void *packet, const char **query)
   if(!IS_OPTION(coap_pkt, COAP_OPTION_LOCATION_QUERY)) {
     return 0;
   }
+  coap_join_multi_option(coap_pkt, &(coap_pkt->location_query),
+                         &(coap_pkt->location_query_len),
+                         COAP_SPLIT_LOCATION_QUERY, '&');
   *query = coap_pkt->location_query;
   return coap_pkt->location_query_len;
 }
@@ -132,6 +132,9 @@ typedef struct {
   const char *uri_query;
   uint8_t if_none_match;
 
+  uint8_t split_options; /* repeated options that are joined on access */
+  uint8_t *options_end;
+
   uint16_t payload_len;
   uint8_t *payload;
 } coap_packet_t;
@@ -188,6 +191,10 @@ void coap_init_message(void *packet, coap_message_type_t type, uint8_t code,
 size_t coap_serialize_message(void *packet, uint8_t *buffer);
 void coap_send_message(uip_ipaddr_t *addr, uint16_t port, uint8_t *data,
                        uint16_t length);
+/* Serializes the message directly into the outgoing UDP buffer and sends it.
+ * Returns 0 if the message could not be serialized or still refers to data
+ * in uip_buf; the caller must then serialize into its own buffer. */
+size_t coap_send_packet(uip_ipaddr_t *addr, uint16_t port, void *packet);
 coap_status_t coap_parse_message(void *request, uint8_t *data,
                                  uint16_t data_len);
 
@@ -0,0 +1,487 @@
+/*
+ * Copyright (c) 2015, EasyRF.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *         Incremental JSON parser with precompiled path queries.
+ */
+
+#include "jsonstream.h"
+#include <string.h>
+
+/* Lexer states */
+#define LEX_VALUE          0 /* a value must follow */
+#define LEX_VALUE_OR_END   1 /* just after '[' */
+#define LEX_KEY            2 /* a key must follow */
+#define LEX_KEY_OR_END     3 /* just after '{' */
+#define LEX_COLON          4
+#define LEX_COMMA_OR_END   5
+#define LEX_STRING         6
+#define LEX_BARE           7 /* number or literal */
+#define LEX_DONE           8
+
+/* Query step types */
+#define STEP_KEY           0
+#define STEP_INDEX         1
+#define STEP_ANY_KEY       2
+#define STEP_ANY_INDEX     3
+
+#define IS_WS(c) ((c) == ' ' || (c) == '\n' || (c) == '\r' || (c) == '\t')
+#define IS_DIGIT(c) ((c) >= '0' && (c) <= '9')
+#define IS_BARE(c) (IS_DIGIT(c) || ((c) >= 'a' && (c) <= 'z') || \
+                    (c) == '-' || (c) == '+' || (c) == '.' || (c) == 'E')
+
+/*--------------------------------------------------------------------*/
+static void
+emit(struct jsonstream_state *state, int type, const char *value, int len,
+     int flags)
+{
+  struct jsonstream_query *q;
+
+  if(state->callback != NULL) {
+    state->callback(state, state->ptr, type, value, len, flags);
+  }
+  for(q = list_head(state->queries); q != NULL; q = q->next) {
+    if(q->matched == state->depth && q->steps == state->depth) {
+      q->callback(state, q->ptr, type, value, len, flags);
+    }
+  }
+}
+/*--------------------------------------------------------------------*/
+/* a new key or array element starts in the innermost container */
+/*--------------------------------------------------------------------*/
+static void
+set_component(struct jsonstream_state *state, const char *name, int len,
+              uint16_t index)
+{
+  struct jsonstream_query *q;
+  const struct jsonstream_step *step;
+  uint8_t d = state->depth;
+
+  for(q = list_head(state->queries); q != NULL; q = q->next) {
+    if(q->matched >= d) {
+      q->matched = d - 1;
+    }
+    if(q->matched != d - 1 || q->steps < d) {
+      continue;
+    }
+    step = &q->step[d - 1];
+    if(name == NULL) {
+      if(step->type == STEP_ANY_INDEX ||
+         (step->type == STEP_INDEX && step->value == index)) {
+        q->matched = d;
+      }
+    } else if(step->type == STEP_ANY_KEY ||
+              (step->type == STEP_KEY && step->value == len &&
+               memcmp(step->name, name, len) == 0)) {
+      q->matched = d;
+    }
+  }
+}
+/*--------------------------------------------------------------------*/
+static int
+push(struct jsonstream_state *state, char c)
+{
+  if(state->depth >= JSONSTREAM_MAX_DEPTH) {
+    state->error = JSON_ERROR_TOO_DEEP;
+    return 0;
+  }
+  state->stack[state->depth] = c;
+  state->index[state->depth] = 0;
+  state->depth++;
+  return 1;
+}
+/*--------------------------------------------------------------------*/
+static void
+pop(struct jsonstream_state *state)
+{
+  struct jsonstream_query *q;
+
+  state->depth--;
+  for(q = list_head(state->queries); q != NULL; q = q->next) {
+    if(q->matched > state->depth) {
+      q->matched = state->depth;
+    }
+  }
+}
+/*--------------------------------------------------------------------*/
+static void
+value_done(struct jsonstream_state *state)
+{
+  state->lex = state->depth == 0 ? LEX_DONE : LEX_COMMA_OR_END;
+}
+/*--------------------------------------------------------------------*/
+static void
+tok_append(struct jsonstream_state *state, const char *str, int len)
+{
+  if(state->toklen + len > JSONSTREAM_TOKEN_SIZE) {
+    /* remember the overflow; such a token never matches */
+    state->toklen = JSONSTREAM_TOKEN_SIZE + 1;
+    return;
+  }
+  memcpy(&state->tok[state->toklen], str, len);
+  state->toklen += len;
+}
+/*--------------------------------------------------------------------*/
+static void
+string_part(struct jsonstream_state *state, const char *str, int len,
+            int flags)
+{
+  if(len == 0 && (flags & JSONSTREAM_MORE)) {
+    return;
+  }
+  if(state->key) {
+    /* keys only go to the token callback, not to the queries */
+    if(state->callback != NULL) {
+      state->callback(state, state->ptr, JSON_TYPE_PAIR_NAME, str, len,
+                      flags);
+    }
+  } else {
+    emit(state, JSON_TYPE_STRING, str, len, flags);
+  }
+}
+/*--------------------------------------------------------------------*/
+static void
+bare_done(struct jsonstream_state *state, const char *str, int len)
+{
+  int i;
+  char type;
+
+  if(state->toklen > JSONSTREAM_TOKEN_SIZE) {
+    state->error = JSON_ERROR_SYNTAX;
+    return;
+  }
+  if(str[0] == '-' || IS_DIGIT(str[0])) {
+    for(i = 1; i < len; i++) {
+      if(!IS_DIGIT(str[i]) && str[i] != '.' && str[i] != 'e' &&
+         str[i] != 'E' && str[i] != '-' && str[i] != '+') {
+        state->error = JSON_ERROR_SYNTAX;
+        return;
+      }
+    }
+    type = JSON_TYPE_NUMBER;
+  } else if(len == 4 && memcmp(str, "true", 4) == 0) {
+    type = JSON_TYPE_TRUE;
+  } else if(len == 5 && memcmp(str, "false", 5) == 0) {
+    type = JSON_TYPE_FALSE;
+  } else if(len == 4 && memcmp(str, "null", 4) == 0) {
+    type = JSON_TYPE_NULL;
+  } else {
+    state->error = JSON_ERROR_SYNTAX;
+    return;
+  }
+  state->toklen = 0;
+  emit(state, type, str, len, 0);
+  value_done(state);
+}
+/*--------------------------------------------------------------------*/
+static void
+value_start(struct jsonstream_state *state, char c)
+{
+  if(state->depth > 0 && state->stack[state->depth - 1] == '[') {
+    set_component(state, NULL, 0, state->index[state->depth - 1]);
+  }
+  switch(c) {
+  case '{':
+    emit(state, JSON_TYPE_OBJECT, NULL, 0, 0);
+    if(push(state, c)) {
+      state->lex = LEX_KEY_OR_END;
+    }
+    break;
+  case '[':
+    emit(state, JSON_TYPE_ARRAY, NULL, 0, 0);
+    if(push(state, c)) {
+      state->lex = LEX_VALUE_OR_END;
+    }
+    break;
+  case '"':
+    state->key = 0;
+    state->lex = LEX_STRING;
+    break;
+  default:
+    if(c == '-' || IS_DIGIT(c) || (c >= 'a' && c <= 'z')) {
+      state->lex = LEX_BARE;
+    } else {
+      state->error = JSON_ERROR_SYNTAX;
+    }
+  }
+}
+/*--------------------------------------------------------------------*/
+static void
+container_end(struct jsonstream_state *state, char c)
+{
+  if(state->stack[state->depth - 1] != (c == '}' ? '{' : '[')) {
+    state->error = c == '}' ? JSON_ERROR_SYNTAX :
+      JSON_ERROR_UNEXPECTED_END_OF_ARRAY;
+    return;
+  }
+  pop(state);
+  emit(state, c, NULL, 0, 0);
+  value_done(state);
+}
+/*--------------------------------------------------------------------*/
+void
+jsonstream_setup(struct jsonstream_state *state,
+                 jsonstream_callback_t callback, void *ptr)
+{
+  state->callback = callback;
+  state->ptr = ptr;
+  LIST_STRUCT_INIT(state, queries);
+  state->lex = LEX_VALUE;
+  state->depth = 0;
+  state->toklen = 0;
+  state->escape = 0;
+  state->key = 0;
+  state->error = JSON_ERROR_OK;
+}
+/*--------------------------------------------------------------------*/
+int
+jsonstream_query_compile(struct jsonstream_query *query, const char *path)
+{
+  struct jsonstream_step *step;
+  const char *p;
+  uint16_t n;
+
+  if(*path++ != '$') {
+    return 0;
+  }
+  query->steps = 0;
+  while(*path != '\0') {
+    if(query->steps == JSONSTREAM_MAX_STEPS) {
+      return 0;
+    }
+    step = &query->step[query->steps];
+    if(*path == '.') {
+      p = ++path;
+      while(*path != '\0' && *path != '.' && *path != '[') {
+        path++;
+      }
+      if(path == p || path - p > JSONSTREAM_TOKEN_SIZE) {
+        return 0;
+      }
+      step->name = p;
+      step->value = path - p;
+      step->type = (step->value == 1 && *p == '*') ? STEP_ANY_KEY : STEP_KEY;
+    } else if(*path == '[') {
+      path++;
+      step->name = NULL;
+      if(*path == '*') {
+        path++;
+        step->type = STEP_ANY_INDEX;
+      } else {
+        if(!IS_DIGIT(*path)) {
+          return 0;
+        }
+        for(n = 0; IS_DIGIT(*path); path++) {
+          n = n * 10 + *path - '0';
+        }
+        step->value = n;
+        step->type = STEP_INDEX;
+      }
+      if(*path++ != ']') {
+        return 0;
+      }
+    } else {
+      return 0;
+    }
+    query->steps++;
+  }
+  return 1;
+}
+/*--------------------------------------------------------------------*/
+void
+jsonstream_add_query(struct jsonstream_state *state,
+                     struct jsonstream_query *query,
+                     jsonstream_callback_t callback, void *ptr)
+{
+  query->callback = callback;
+  query->ptr = ptr;
+  query->matched = 0;
+  list_add(state->queries, query);
+}
+/*--------------------------------------------------------------------*/
+int
+jsonstream_feed(struct jsonstream_state *state, const char *data, int len)
+{
+  const char *p = data;
+  const char *end = data + len;
+  const char *start;
+  char c;
+
+  while(p < end && state->error == JSON_ERROR_OK) {
+    start = p;
+    if(state->lex == LEX_STRING) {
+      while(p < end) {
+        c = *p;
+        if(state->escape) {
+          state->escape = 0;
+        } else if(c == '\\') {
+          state->escape = 1;
+        } else if(c == '"') {
+          break;
+        }
+        p++;
+      }
+      if(p == end) {
+        if(state->key) {
+          tok_append(state, start, p - start);
+        }
+        string_part(state, start, p - start, JSONSTREAM_MORE);
+        break;
+      }
+      string_part(state, start, p - start, 0);
+      p++;
+      if(state->key) {
+        if(state->toklen > 0) {
+          /* the key straddled two chunks */
+          tok_append(state, start, p - 1 - start);
+          set_component(state, state->tok, state->toklen, 0);
+          state->toklen = 0;
+        } else {
+          set_component(state, start, p - 1 - start, 0);
+        }
+        state->lex = LEX_COLON;
+      } else {
+        value_done(state);
+      }
+      continue;
+    }
+    if(state->lex == LEX_BARE) {
+      while(p < end && IS_BARE(*p)) {
+        p++;
+      }
+      if(p == end) {
+        tok_append(state, start, p - start);
+        break;
+      }
+      if(state->toklen > 0) {
+        tok_append(state, start, p - start);
+        bare_done(state, state->tok, state->toklen);
+      } else {
+        bare_done(state, start, p - start);
+      }
+      continue;
+    }
+
+    c = *p++;
+    if(IS_WS(c)) {
+      continue;
+    }
+    switch(state->lex) {
+    case LEX_VALUE_OR_END:
+      if(c == ']') {
+        container_end(state, c);
+        break;
+      }
+      /* fall through */
+    case LEX_VALUE:
+      value_start(state, c);
+      if(state->lex == LEX_BARE) {
+        /* the first character is part of the token */
+        p--;
+      }
+      break;
+    case LEX_KEY_OR_END:
+      if(c == '}') {
+        container_end(state, c);
+        break;
+      }
+      /* fall through */
+    case LEX_KEY:
+      if(c == '"') {
+        state->key = 1;
+        state->lex = LEX_STRING;
+      } else {
+        state->error = JSON_ERROR_SYNTAX;
+      }
+      break;
+    case LEX_COLON:
+      if(c == ':') {
+        state->lex = LEX_VALUE;
+      } else {
+        state->error = JSON_ERROR_SYNTAX;
+      }
+      break;
+    case LEX_COMMA_OR_END:
+      if(c == ',') {
+        if(state->stack[state->depth - 1] == '{') {
+          state->lex = LEX_KEY;
+        } else {
+          state->index[state->depth - 1]++;
+          state->lex = LEX_VALUE;
+        }
+      } else if(c == '}' || c == ']') {
+        container_end(state, c);
+      } else {
+        state->error = JSON_ERROR_SYNTAX;
+      }
+      break;
+    default:
+      /* only whitespace may follow the top-level value */
+      state->error = JSON_ERROR_SYNTAX;
+    }
+  }
+  return state->error;
+}
+/*--------------------------------------------------------------------*/
+int
+jsonstream_end(struct jsonstream_state *state)
+{
+  if(state->error == JSON_ERROR_OK && state->lex == LEX_BARE &&
+     state->depth == 0) {
+    /* a top-level number or literal ends with the document */
+    bare_done(state, state->tok, state->toklen);
+  }
+  if(state->error == JSON_ERROR_OK && state->lex != LEX_DONE) {
+    state->error = JSON_ERROR_INCOMPLETE;
+  }
+  return state->error;
+}
+/*--------------------------------------------------------------------*/
+long
+jsonstream_atol(const char *value, int len)
+{
+  long n = 0;
+  int neg = 0;
+
+  if(len > 0 && *value == '-') {
+    neg = 1;
+    value++;
+    len--;
+  }
+  while(len > 0 && IS_DIGIT(*value)) {
+    n = n * 10 + *value++ - '0';
+    len--;
+  }
+  return neg ? -n : n;
+}
+/*--------------------------------------------------------------------*/
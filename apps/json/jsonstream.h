@@ -0,0 +1,186 @@
+/*
+ * Copyright (c) 2015, EasyRF.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *         Incremental JSON parser with precompiled path queries.
+ *
+ *         The parser accepts a document in arbitrary chunks, for instance
+ *         straight from uip_appdata or from successive cfs_read() calls,
+ *         and reports every token to a callback.  Values are handed out as
+ *         pointers into the chunk being parsed; only a number, literal or
+ *         key that straddles two chunks is gathered in a small buffer in
+ *         the parser state.  String values are never buffered: a string
+ *         that straddles chunks is reported in several parts with
+ *         JSONSTREAM_MORE set on all but the last.
+ *
+ *         Path queries such as "$.sensors[3].rate" are compiled once and
+ *         fire their own callback only for the value at that path.
+ */
+
+#ifndef JSONSTREAM_H_
+#define JSONSTREAM_H_
+
+#include "contiki-conf.h"
+#include "json.h"
+#include "lib/list.h"
+
+#ifdef JSONSTREAM_CONF_MAX_DEPTH
+#define JSONSTREAM_MAX_DEPTH JSONSTREAM_CONF_MAX_DEPTH
+#else
+#define JSONSTREAM_MAX_DEPTH 10
+#endif
+
+/* Longest number, literal or key that can straddle two chunks */
+#ifdef JSONSTREAM_CONF_TOKEN_SIZE
+#define JSONSTREAM_TOKEN_SIZE JSONSTREAM_CONF_TOKEN_SIZE
+#else
+#define JSONSTREAM_TOKEN_SIZE 24
+#endif
+
+#ifdef JSONSTREAM_CONF_MAX_STEPS
+#define JSONSTREAM_MAX_STEPS JSONSTREAM_CONF_MAX_STEPS
+#else
+#define JSONSTREAM_MAX_STEPS 6
+#endif
+
+/* Callback flag: more parts of the same string follow */
+#define JSONSTREAM_MORE 0x01
+
+struct jsonstream_state;
+
+/**
+ * \brief      Token callback.
+ * \param state The parser state
+ * \param ptr  The pointer given when the callback was registered
+ * \param type JSON_TYPE_OBJECT, JSON_TYPE_ARRAY, '}' or ']' for
+ *             containers, JSON_TYPE_PAIR_NAME for keys, or
+ *             JSON_TYPE_STRING, JSON_TYPE_NUMBER, JSON_TYPE_TRUE,
+ *             JSON_TYPE_FALSE or JSON_TYPE_NULL for atomic values
+ * \param value The raw text of the token (escapes are left as is), or
+ *             NULL for containers.  Not null-terminated.
+ * \param len  The length of value
+ * \param flags JSONSTREAM_MORE if this is not the last part of a string
+ */
+typedef void (*jsonstream_callback_t)(struct jsonstream_state *state,
+                                      void *ptr, int type,
+                                      const char *value, int len,
+                                      int flags);
+
+struct jsonstream_step {
+  const char *name;
+  uint16_t value;
+  uint8_t type;
+};
+
+struct jsonstream_query {
+  struct jsonstream_query *next;
+  jsonstream_callback_t callback;
+  void *ptr;
+  uint8_t steps;
+  uint8_t matched;
+  struct jsonstream_step step[JSONSTREAM_MAX_STEPS];
+};
+
+struct jsonstream_state {
+  jsonstream_callback_t callback;
+  void *ptr;
+  LIST_STRUCT(queries);
+  uint8_t lex;
+  uint8_t depth;
+  uint8_t toklen;
+  char escape;
+  char key;
+  char error;
+  char stack[JSONSTREAM_MAX_DEPTH];
+  uint16_t index[JSONSTREAM_MAX_DEPTH];
+  char tok[JSONSTREAM_TOKEN_SIZE + 1];
+};
+
+/**
+ * \brief      Initialize a streaming JSON parser.
+ * \param state A pointer to the parser state
+ * \param callback Called for every token, or NULL when only the
+ *             path queries are of interest
+ * \param ptr  Passed to callback
+ */
+void jsonstream_setup(struct jsonstream_state *state,
+                      jsonstream_callback_t callback, void *ptr);
+
+/**
+ * \brief      Compile a path query.
+ * \param query The query to fill in
+ * \param path The path, e.g. "$.sensors[3].rate".  "$" is the root,
+ *             ".name" selects a member, "[n]" an array element and
+ *             ".*" or "[*]" any member or element.  The key names are
+ *             referenced, not copied, so path must stay valid.
+ * \return     1 on success, 0 if the path is malformed or too long
+ */
+int jsonstream_query_compile(struct jsonstream_query *query,
+                             const char *path);
+
+/**
+ * \brief      Attach a compiled query to a parser.
+ * \param state The parser state, after jsonstream_setup()
+ * \param query A compiled query
+ * \param callback Called for the tokens of the value at the query path.
+ *             For a container this is its opening and closing token.
+ * \param ptr  Passed to callback
+ */
+void jsonstream_add_query(struct jsonstream_state *state,
+                          struct jsonstream_query *query,
+                          jsonstream_callback_t callback, void *ptr);
+
+/**
+ * \brief      Parse the next chunk of a document.
+ * \param state The parser state
+ * \param data The chunk; it only has to stay valid during the call
+ * \param len  The length of the chunk
+ * \return     JSON_ERROR_OK, or the first error seen in the document
+ */
+int jsonstream_feed(struct jsonstream_state *state, const char *data,
+                    int len);
+
+/**
+ * \brief      Signal the end of the document.
+ * \param state The parser state
+ * \return     JSON_ERROR_OK if a complete value has been parsed
+ */
+int jsonstream_end(struct jsonstream_state *state);
+
+/* get the current nesting depth */
+#define jsonstream_get_depth(state) ((state)->depth)
+
+/* parse a number token handed to a callback */
+long jsonstream_atol(const char *value, int len);
+
+#endif /* JSONSTREAM_H_ */
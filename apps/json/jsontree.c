@@ -50,54 +50,145 @@
 #define PRINTF(...)
 #endif
 
+/* Template modes */
+#define TEMPLATE_NONE    0
+#define TEMPLATE_COMPILE 1
+#define TEMPLATE_RENDER  2
+
+/* buffer used by buffer_putchar() for callbacks that print directly */
+static struct jsontree_buffer *putchar_out;
+/*---------------------------------------------------------------------------*/
+static void
+buffer_write(struct jsontree_buffer *out, const char *text, int len)
+{
+  int n;
+
+  if(out->pos < out->offset) {
+    /* still before the requested offset */
+    n = out->offset - out->pos;
+    if(n >= len) {
+      out->pos += len;
+      return;
+    }
+    out->pos += n;
+    text += n;
+    len -= n;
+  }
+  n = out->size - out->len;
+  if(len > n) {
+    len = n;
+    out->full = 1;
+  }
+  memcpy(&out->buf[out->len], text, len);
+  out->len += len;
+  out->pos += len;
+}
+/*---------------------------------------------------------------------------*/
+static int
+buffer_putchar(int c)
+{
+  char ch = c;
+
+  buffer_write(putchar_out, &ch, 1);
+  return c;
+}
+/*---------------------------------------------------------------------------*/
+static void
+write_text(const struct jsontree_context *js_ctx, const char *text, int len)
+{
+  if(js_ctx->out != NULL) {
+    buffer_write(js_ctx->out, text, len);
+  } else {
+    while(len-- > 0) {
+      js_ctx->putchar(*text++);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* output that is part of the template when printing from one */
+/*---------------------------------------------------------------------------*/
+static void
+write_static(const struct jsontree_context *js_ctx, const char *text, int len)
+{
+  if(js_ctx->template_mode != TEMPLATE_RENDER) {
+    write_text(js_ctx, text, len);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+template_flush(struct jsontree_context *js_ctx, uint16_t to)
+{
+  write_text(js_ctx, &js_ctx->template->text[js_ctx->template_pos],
+             to - js_ctx->template_pos);
+  js_ctx->template_pos = to;
+}
+/*---------------------------------------------------------------------------*/
+/* returns 1 if the value should be printed now, 0 if it becomes a hole */
+/*---------------------------------------------------------------------------*/
+static int
+template_hole(struct jsontree_context *js_ctx)
+{
+  struct jsontree_template *t = js_ctx->template;
+
+  if(js_ctx->template_mode == TEMPLATE_COMPILE) {
+    if(t->count < t->max) {
+      t->holes[t->count++] = js_ctx->out->len;
+    } else {
+      js_ctx->out->full = 1;
+    }
+    return 0;
+  }
+  if(js_ctx->template_mode == TEMPLATE_RENDER) {
+    template_flush(js_ctx, t->holes[js_ctx->template_hole++]);
+  }
+  return 1;
+}
 /*---------------------------------------------------------------------------*/
 void
 jsontree_write_atom(const struct jsontree_context *js_ctx, const char *text)
 {
   if(text == NULL) {
-    js_ctx->putchar('0');
+    write_text(js_ctx, "0", 1);
   } else {
-    while(*text != '\0') {
-      js_ctx->putchar(*text++);
-    }
+    write_text(js_ctx, text, strlen(text));
   }
 }
 /*---------------------------------------------------------------------------*/
 void
 jsontree_write_string(const struct jsontree_context *js_ctx, const char *text)
 {
-  js_ctx->putchar('"');
+  const char *quote;
+
+  write_text(js_ctx, "\"", 1);
   if(text != NULL) {
-    while(*text != '\0') {
-      if(*text == '"') {
-        js_ctx->putchar('\\');
-      }
-      js_ctx->putchar(*text++);
+    while((quote = strchr(text, '"')) != NULL) {
+      write_text(js_ctx, text, quote - text);
+      write_text(js_ctx, "\\\"", 2);
+      text = quote + 1;
     }
+    write_text(js_ctx, text, strlen(text));
   }
-  js_ctx->putchar('"');
+  write_text(js_ctx, "\"", 1);
 }
 /*---------------------------------------------------------------------------*/
 void
 jsontree_write_int(const struct jsontree_context *js_ctx, int value)
 {
-  char buf[10];
+  char buf[11];
   int l;
 
+  l = sizeof(buf);
   if(value < 0) {
-    js_ctx->putchar('-');
+    write_text(js_ctx, "-", 1);
     value = -value;
   }
 
-  l = sizeof(buf) - 1;
   do {
-    buf[l--] = '0' + (value % 10);
+    buf[--l] = '0' + (value % 10);
     value /= 10;
-  } while(value > 0 && l >= 0);
+  } while(value > 0 && l > 0);
 
-  while(++l < sizeof(buf)) {
-    js_ctx->putchar(buf[l]);
-  }
+  write_text(js_ctx, &buf[l], sizeof(buf) - l);
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -115,6 +206,9 @@ jsontree_reset(struct jsontree_context *js_ctx)
 {
   js_ctx->depth = 0;
   js_ctx->index[0] = 0;
+  js_ctx->out = NULL;
+  js_ctx->template = NULL;
+  js_ctx->template_mode = TEMPLATE_NONE;
 }
 /*---------------------------------------------------------------------------*/
 const char *
@@ -144,24 +238,23 @@ jsontree_print_next(struct jsontree_context *js_ctx)
 
     index = js_ctx->index[js_ctx->depth];
     if(index == 0) {
-      js_ctx->putchar(v->type);
-      js_ctx->putchar('\n');
+      write_static(js_ctx, v->type == JSON_TYPE_OBJECT ? "{\n" : "[\n", 2);
     }
     if(index >= o->count) {
-      js_ctx->putchar('\n');
-      js_ctx->putchar(v->type + 2);
+      write_static(js_ctx, v->type == JSON_TYPE_OBJECT ? "\n}" : "\n]", 2);
       /* Default operation: back up one level! */
       break;
     }
 
     if(index > 0) {
-      js_ctx->putchar(',');
-      js_ctx->putchar('\n');
+      write_static(js_ctx, ",\n", 2);
     }
     if(v->type == JSON_TYPE_OBJECT) {
-      jsontree_write_string(js_ctx,
-                            ((struct jsontree_object *)o)->pairs[index].name);
-      js_ctx->putchar(':');
+      if(js_ctx->template_mode != TEMPLATE_RENDER) {
+        jsontree_write_string(js_ctx,
+                              ((struct jsontree_object *)o)->pairs[index].name);
+        write_text(js_ctx, ":", 1);
+      }
       ov = ((struct jsontree_object *)o)->pairs[index].value;
     } else {
       ov = o->values[index];
@@ -174,11 +267,15 @@ jsontree_print_next(struct jsontree_context *js_ctx)
     return 1;
   }
   case JSON_TYPE_STRING:
-    jsontree_write_string(js_ctx, ((struct jsontree_string *)v)->value);
+    if(js_ctx->template_mode != TEMPLATE_RENDER) {
+      jsontree_write_string(js_ctx, ((struct jsontree_string *)v)->value);
+    }
     /* Default operation: back up one level! */
     break;
   case JSON_TYPE_INT:
-    jsontree_write_int(js_ctx, ((struct jsontree_int *)v)->value);
+    if(template_hole(js_ctx)) {
+      jsontree_write_int(js_ctx, ((struct jsontree_int *)v)->value);
+    }
     /* Default operation: back up one level! */
     break;
   case JSON_TYPE_CALLBACK: {   /* pre-formatted json string currently */
@@ -186,6 +283,9 @@ jsontree_print_next(struct jsontree_context *js_ctx)
 
     callback = (struct jsontree_callback *)v;
     if(js_ctx->index[js_ctx->depth] == 0) {
+      if(!template_hole(js_ctx)) {
+        break;
+      }
       /* First call: reset the callback status */
       js_ctx->callback_state = 0;
     }
@@ -209,6 +309,9 @@ jsontree_print_next(struct jsontree_context *js_ctx)
     js_ctx->index[js_ctx->depth]++;
     return 1;
   }
+  if(js_ctx->template_mode == TEMPLATE_RENDER) {
+    template_flush(js_ctx, js_ctx->template->len);
+  }
   return 0;
 }
 /*---------------------------------------------------------------------------*/
@@ -273,3 +376,106 @@ jsontree_find_next(struct jsontree_context *js_ctx, int type)
   return js_ctx->path < js_ctx->depth ? v : NULL;
 }
 /*---------------------------------------------------------------------------*/
+int
+jsontree_template_compile(struct jsontree_template *t,
+                          struct jsontree_value *root)
+{
+  struct jsontree_context js_ctx;
+  struct jsontree_buffer out;
+
+  memset(&out, 0, sizeof(out));
+  out.buf = t->text;
+  out.size = t->size;
+
+  jsontree_setup(&js_ctx, root, NULL);
+  js_ctx.out = &out;
+  js_ctx.template = t;
+  js_ctx.template_mode = TEMPLATE_COMPILE;
+  t->count = 0;
+  while(jsontree_print_next(&js_ctx));
+  t->len = out.len;
+  return !out.full;
+}
+/*---------------------------------------------------------------------------*/
+void
+jsontree_set_template(struct jsontree_context *js_ctx,
+                      struct jsontree_template *t)
+{
+  js_ctx->template = t;
+  js_ctx->template_mode = TEMPLATE_RENDER;
+  js_ctx->template_pos = 0;
+  js_ctx->template_hole = 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+save_step(struct jsontree_context *js_ctx, struct jsontree_buffer *out)
+{
+  out->step_pos = out->pos;
+  out->step_depth = js_ctx->depth;
+  out->step_index = js_ctx->index[js_ctx->depth];
+  if(js_ctx->depth > 0) {
+    out->step_parent = js_ctx->index[js_ctx->depth - 1];
+  }
+  out->step_hole = js_ctx->template_hole;
+  out->step_template_pos = js_ctx->template_pos;
+  out->step_callback_state = js_ctx->callback_state;
+}
+/*---------------------------------------------------------------------------*/
+static void
+restore_step(struct jsontree_context *js_ctx, struct jsontree_buffer *out)
+{
+  out->pos = out->step_pos;
+  js_ctx->depth = out->step_depth;
+  js_ctx->index[js_ctx->depth] = out->step_index;
+  if(js_ctx->depth > 0) {
+    js_ctx->index[js_ctx->depth - 1] = out->step_parent;
+  }
+  js_ctx->template_hole = out->step_hole;
+  js_ctx->template_pos = out->step_template_pos;
+  js_ctx->callback_state = out->step_callback_state;
+}
+/*---------------------------------------------------------------------------*/
+int
+jsontree_write_chunk(struct jsontree_context *js_ctx,
+                     struct jsontree_buffer *out, char *buf, int size,
+                     int32_t *offset)
+{
+  int more;
+
+  if(*offset < 0) {
+    return 0;
+  }
+  if(js_ctx->out != out || *offset < out->step_pos) {
+    /* start over from the top */
+    js_ctx->depth = 0;
+    js_ctx->index[0] = 0;
+    js_ctx->template_pos = 0;
+    js_ctx->template_hole = 0;
+    out->pos = 0;
+  } else {
+    /* redo the step that did not fit into the previous chunk */
+    restore_step(js_ctx, out);
+  }
+  out->buf = buf;
+  out->size = size;
+  out->len = 0;
+  out->offset = *offset;
+  out->full = 0;
+
+  js_ctx->out = out;
+  js_ctx->putchar = buffer_putchar;
+  putchar_out = out;
+
+  do {
+    save_step(js_ctx, out);
+    more = jsontree_print_next(js_ctx);
+  } while(more && !out->full);
+
+  /* the last step may not have fit either */
+  more |= out->full;
+  PRINTF("jsontree: chunk at %ld, %d bytes%s\n", (long)*offset, out->len,
+         more ? "" : " (last)");
+  *offset = more ? *offset + out->len : -1;
+  return out->len;
+}
+/*---------------------------------------------------------------------------*/
@@ -49,6 +49,9 @@
 #define JSONTREE_MAX_DEPTH 10
 #endif /* JSONTREE_CONF_MAX_DEPTH */
 
+struct jsontree_buffer;
+struct jsontree_template;
+
 struct jsontree_context {
   struct jsontree_value *values[JSONTREE_MAX_DEPTH];
   uint16_t index[JSONTREE_MAX_DEPTH];
@@ -56,6 +59,49 @@ struct jsontree_context {
   uint8_t depth;
   uint8_t path;
   int callback_state;
+  /* buffered output, see jsontree_write_chunk() */
+  struct jsontree_buffer *out;
+  /* precomputed skeleton, see jsontree_set_template() */
+  struct jsontree_template *template;
+  uint16_t template_pos;
+  uint8_t template_hole;
+  uint8_t template_mode;
+};
+
+/*
+ * State of chunked output. Besides the chunk being filled, it remembers
+ * where the step that did not fit into the previous chunk started, so
+ * that the next chunk continues from there instead of from the top.
+ */
+struct jsontree_buffer {
+  char *buf;
+  uint16_t size;
+  uint16_t len;
+  uint32_t pos;      /* bytes of the document generated so far */
+  uint32_t offset;   /* bytes before this offset are discarded */
+  uint8_t full;
+  /* checkpoint taken before each step */
+  uint32_t step_pos;
+  uint16_t step_index;
+  uint16_t step_parent;
+  uint8_t step_depth;
+  uint8_t step_hole;
+  uint16_t step_template_pos;
+  int step_callback_state;
+};
+
+/*
+ * A tree serialized once with its integers and callbacks left out. The
+ * text holds everything else (structure, names and strings) and holes
+ * the offsets at which the left out values go, in document order.
+ */
+struct jsontree_template {
+  char *text;
+  uint16_t *holes;
+  uint16_t size;
+  uint16_t len;
+  uint8_t max;
+  uint8_t count;
 };
 
 struct jsontree_value {
@@ -123,6 +169,12 @@ struct jsontree_array {
     count,                        \
     jsontree_value##name }         
 
+#define JSONTREE_TEMPLATE(name, size, holes)                            \
+  static char jsontree_text_##name[size];                               \
+  static uint16_t jsontree_holes_##name[holes];                         \
+  static struct jsontree_template name = {                              \
+    jsontree_text_##name, jsontree_holes_##name, size, 0, holes, 0 }
+
 void jsontree_setup(struct jsontree_context *js_ctx,
                     struct jsontree_value *root, int (* putchar)(int));
 void jsontree_reset(struct jsontree_context *js_ctx);
@@ -139,4 +191,47 @@ int jsontree_print_next(struct jsontree_context *js_ctx);
 struct jsontree_value *jsontree_find_next(struct jsontree_context *js_ctx,
                                           int type);
 
+/**
+ * \brief      Precompute the static parts of a tree.
+ * \param t    A template declared with JSONTREE_TEMPLATE()
+ * \param root The tree; its strings are treated as constant, use a
+ *             callback for strings that change
+ * \return     1 on success, 0 if the text or holes did not fit
+ */
+int jsontree_template_compile(struct jsontree_template *t,
+                              struct jsontree_value *root);
+
+/**
+ * \brief      Print the tree from a compiled template.
+ * \param js_ctx A context set up for the root the template was
+ *             compiled from
+ * \param t    The compiled template
+ *
+ *             Only the integers and callbacks are formatted while
+ *             printing; the rest is copied from the template. The
+ *             whole tree is printed, js_ctx->path is not supported.
+ */
+void jsontree_set_template(struct jsontree_context *js_ctx,
+                           struct jsontree_template *t);
+
+/**
+ * \brief      Print part of the tree into a buffer.
+ * \param js_ctx A context set up for the tree
+ * \param out  Chunked output state, kept between calls
+ * \param buf  The buffer to fill
+ * \param size The size of buf
+ * \param offset The byte offset in the document to start at. It is
+ *             advanced past the written bytes, or set to -1 when the
+ *             document is complete, as in a REST Block2 handler.
+ * \return     The number of bytes written to buf
+ *
+ *             Consecutive offsets continue the walk where the previous
+ *             chunk ended; any other offset prints the tree again from
+ *             the top and discards the bytes before it. Callbacks must
+ *             produce the same output when called again for a chunk.
+ */
+int jsontree_write_chunk(struct jsontree_context *js_ctx,
+                         struct jsontree_buffer *out, char *buf, int size,
+                         int32_t *offset);
+
 #endif /* JSONTREE_H_ */
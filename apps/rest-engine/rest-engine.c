@@ -58,6 +58,104 @@ PROCESS(rest_engine_process, "REST Engine");
 /*---------------------------------------------------------------------------*/
 LIST(restful_services);
 LIST(restful_periodic_services);
+
+/* Resources hashed by their full URI path */
+static resource_t *resource_index[REST_ENGINE_INDEX_SIZE];
+/* Number of activated resources with HAS_SUB_RESOURCES */
+static uint8_t parent_resources;
+/*---------------------------------------------------------------------------*/
+static uint16_t
+url_hash(const char *url, uint16_t len)
+{
+  uint16_t hash;
+
+  hash = 0;
+  while(len--) {
+    hash = (hash << 5) - hash + (uint8_t)*url++;
+  }
+  return hash % REST_ENGINE_INDEX_SIZE;
+}
+/*---------------------------------------------------------------------------*/
+static void
+index_remove(resource_t *resource)
+{
+  resource_t **r;
+  uint8_t i;
+
+  for(i = 0; i < REST_ENGINE_INDEX_SIZE; i++) {
+    for(r = &resource_index[i]; *r != NULL; r = &(*r)->index_next) {
+      if(*r == resource) {
+        *r = resource->index_next;
+        if(resource->flags & HAS_SUB_RESOURCES) {
+          parent_resources--;
+        }
+        return;
+      }
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+index_add(resource_t *resource)
+{
+  resource_t **r;
+
+  /* A resource activated again moves to its new path, as in the list */
+  index_remove(resource);
+
+  resource->url_len = strlen(resource->url);
+  resource->index_next = NULL;
+
+  /* Append, so that the first of several resources with the same path
+     keeps handling it, as with the former linear search */
+  for(r = &resource_index[url_hash(resource->url, resource->url_len)];
+      *r != NULL; r = &(*r)->index_next);
+  *r = resource;
+
+  if(resource->flags & HAS_SUB_RESOURCES) {
+    parent_resources++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static resource_t *
+index_lookup(const char *url, uint16_t len, uint8_t parent)
+{
+  resource_t *r;
+
+  for(r = resource_index[url_hash(url, len)]; r != NULL; r = r->index_next) {
+    if(r->url_len == len
+       && (!parent || (r->flags & HAS_SUB_RESOURCES))
+       && (len == 0 || memcmp(r->url, url, len) == 0)) {
+      return r;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Finds the resource for the given URI path: an exact match if there is
+ * one, otherwise the parent resource with the longest path that is a
+ * prefix of the URI path ending at a segment boundary.
+ */
+static resource_t *
+find_resource(const char *url, uint16_t len)
+{
+  resource_t *r;
+
+  r = index_lookup(url, len, 0);
+  if(r != NULL || parent_resources == 0) {
+    return r;
+  }
+
+  while(len > 0) {
+    /* Strip the last path segment */
+    while(--len > 0 && url[len] != '/');
+    if(len > 0 && (r = index_lookup(url, len, 1)) != NULL) {
+      return r;
+    }
+  }
+  return NULL;
+}
 /*---------------------------------------------------------------------------*/
 /*- REST Engine API ---------------------------------------------------------*/
 /*---------------------------------------------------------------------------*/
@@ -71,6 +169,8 @@ void
 rest_init_engine(void)
 {
   list_init(restful_services);
+  memset(resource_index, 0, sizeof(resource_index));
+  parent_resources = 0;
 
   REST.set_service_callback(rest_invoke_restful_service);
 
@@ -95,6 +195,7 @@ rest_activate_resource(resource_t *resource, char *path)
 {
   resource->url = path;
   list_add(restful_services, resource);
+  index_add(resource);
 
   PRINTF("Activating: %s\n", resource->url);
 
@@ -124,40 +225,35 @@ rest_invoke_restful_service(void *request, void *response, uint8_t *buffer,
 
   resource_t *resource = NULL;
   const char *url = NULL;
+  int url_len;
+
+  url_len = REST.get_url(request, &url);
+  resource = find_resource(url, url_len);
+
+  if(resource != NULL) {
+    found = 1;
+    rest_resource_flags_t method = REST.get_method_type(request);
 
-  for(resource = (resource_t *)list_head(restful_services);
-      resource; resource = resource->next) {
-
-    /* if the web service handles that kind of requests and urls matches */
-    if((REST.get_url(request, &url) == strlen(resource->url)
-        || (REST.get_url(request, &url) > strlen(resource->url)
-            && (resource->flags & HAS_SUB_RESOURCES)))
-       && strncmp(resource->url, url, strlen(resource->url)) == 0) {
-      found = 1;
-      rest_resource_flags_t method = REST.get_method_type(request);
-
-      PRINTF("/%s, method %u, resource->flags %u\n", resource->url,
-             (uint16_t)method, resource->flags);
-
-      if((method & METHOD_GET) && resource->get_handler != NULL) {
-        /* call handler function */
-        resource->get_handler(request, response, buffer, buffer_size, offset);
-      } else if((method & METHOD_POST) && resource->post_handler != NULL) {
-        /* call handler function */
-        resource->post_handler(request, response, buffer, buffer_size,
+    PRINTF("/%s, method %u, resource->flags %u\n", resource->url,
+           (uint16_t)method, resource->flags);
+
+    if((method & METHOD_GET) && resource->get_handler != NULL) {
+      /* call handler function */
+      resource->get_handler(request, response, buffer, buffer_size, offset);
+    } else if((method & METHOD_POST) && resource->post_handler != NULL) {
+      /* call handler function */
+      resource->post_handler(request, response, buffer, buffer_size,
+                             offset);
+    } else if((method & METHOD_PUT) && resource->put_handler != NULL) {
+      /* call handler function */
+      resource->put_handler(request, response, buffer, buffer_size, offset);
+    } else if((method & METHOD_DELETE) && resource->delete_handler != NULL) {
+      /* call handler function */
+      resource->delete_handler(request, response, buffer, buffer_size,
                                offset);
-      } else if((method & METHOD_PUT) && resource->put_handler != NULL) {
-        /* call handler function */
-        resource->put_handler(request, response, buffer, buffer_size, offset);
-      } else if((method & METHOD_DELETE) && resource->delete_handler != NULL) {
-        /* call handler function */
-        resource->delete_handler(request, response, buffer, buffer_size,
-                                 offset);
-      } else {
-        allowed = 0;
-        REST.set_response_status(response, REST.status.METHOD_NOT_ALLOWED);
-      }
-      break;
+    } else {
+      allowed = 0;
+      REST.set_response_status(response, REST.status.METHOD_NOT_ALLOWED);
     }
   }
   if(!found) {
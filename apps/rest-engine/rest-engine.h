@@ -62,6 +62,18 @@
 #define REST_MAX_CHUNK_SIZE     64
 #endif
 
+/*
+ * Number of buckets of the hash table used to look up resources by URI
+ * path. Parent resources are found by looking up each path prefix that
+ * ends at a '/', so no bucket ever needs to be scanned linearly across
+ * all resources.
+ */
+#ifdef REST_ENGINE_CONF_INDEX_SIZE
+#define REST_ENGINE_INDEX_SIZE REST_ENGINE_CONF_INDEX_SIZE
+#else /* REST_ENGINE_CONF_INDEX_SIZE */
+#define REST_ENGINE_INDEX_SIZE 16
+#endif /* REST_ENGINE_CONF_INDEX_SIZE */
+
 #ifndef MIN
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
 #endif /* MIN */
@@ -99,6 +111,8 @@ struct resource_s {
     restful_trigger_handler trigger;
     restful_trigger_handler resume;
   };
+  struct resource_s *index_next;  /* next resource in the same index bucket */
+  uint16_t url_len;               /* length of url, set on activation */
 };
 typedef struct resource_s resource_t;
 
@@ -13,8 +13,19 @@ extern const char http_index_htm[11];
 extern const char http_index_html[12];
 extern const char http_404_html[10];
 extern const char http_referer[9];
+extern const char http_if_none_match[15];
+extern const char http_connection[12];
+extern const char http_close[6];
+extern const char http_etag[7];
 extern const char http_header_200[85];
+extern const char http_header_304[95];
 extern const char http_header_404[92];
+extern const char http_header_200_11[66];
+extern const char http_header_304_11[76];
+extern const char http_header_404_11[73];
+extern const char http_content_length[17];
+extern const char http_chunked[29];
+extern const char http_last_chunk[6];
 extern const char http_content_type_plain[29];
 extern const char http_content_type_html[28];
 extern const char http_content_type_css [27];
@@ -63,10 +63,15 @@ int snprintf(char *str, size_t size, const char *format, ...);
 #define STATE_WAITING 0
 #define STATE_OUTPUT  1
 
+#define HTTPD_KEEPALIVE 0x01 /* Persistent HTTP/1.1 connection */
+#define HTTPD_CLOSE     0x02 /* No more requests are read */
+#define HTTPD_PARTIAL   0x04 /* The last header line did not fit in inputbuf */
+
 #define SEND_STRING(s, str) PSOCK_SEND(s, (uint8_t *)str, strlen(str))
 MEMB(conns, struct httpd_state, CONNS);
 
 #define ISO_nl      0x0a
+#define ISO_cr      0x0d
 #define ISO_space   0x20
 #define ISO_period  0x2e
 #define ISO_slash   0x2f
@@ -125,13 +130,35 @@ get_content_type(const char *filename)
   return ptr;
 }
 /*---------------------------------------------------------------------------*/
+static void
+get_entity_headers(struct httpd_state *s)
+{
+  cfs_offset_t len = -1;
+
+  /* A persistent connection needs the length of the file. */
+  if(s->fd >= 0 && (s->flags & HTTPD_KEEPALIVE)) {
+    len = cfs_seek(s->fd, 0, CFS_SEEK_END);
+    if(cfs_seek(s->fd, 0, CFS_SEEK_SET) != 0) {
+      len = -1;
+    }
+  }
+  if(len < 0 ||
+     snprintf(s->outputbuf, sizeof(s->outputbuf), "%s%ld\r\n%s",
+	      http_content_length, (long)len,
+	      get_content_type(s->filename)) >= (int)sizeof(s->outputbuf)) {
+    /* The end of the file is marked by closing the connection. */
+    s->flags &= ~HTTPD_KEEPALIVE;
+    strcpy(s->outputbuf, get_content_type(s->filename));
+  }
+}
+/*---------------------------------------------------------------------------*/
 static
 PT_THREAD(send_headers(struct httpd_state *s, const char *statushdr))
 {
   PSOCK_BEGIN(&s->sout);
 
   SEND_STRING(&s->sout, statushdr);
-  SEND_STRING(&s->sout, get_content_type(s->filename));
+  SEND_STRING(&s->sout, s->outputbuf);
 
   PSOCK_END(&s->sout);
 }
@@ -141,75 +168,140 @@ PT_THREAD(handle_output(struct httpd_state *s))
 {
   PT_BEGIN(&s->outputpt);
 
-  petsciiconv_topetscii(s->filename, sizeof(s->filename));
-  s->fd = cfs_open(&s->filename[1], CFS_READ);
-  petsciiconv_toascii(s->filename, sizeof(s->filename));
-  if(s->fd < 0) {
-    strcpy(s->filename, "/notfound.htm");
+  do {
+    PT_WAIT_UNTIL(&s->outputpt, s->state == STATE_OUTPUT);
+
+    petsciiconv_topetscii(s->filename, sizeof(s->filename));
     s->fd = cfs_open(&s->filename[1], CFS_READ);
     petsciiconv_toascii(s->filename, sizeof(s->filename));
-    PT_WAIT_THREAD(&s->outputpt,
-                   send_headers(s, http_header_404));
     if(s->fd < 0) {
+      strcpy(s->filename, "/notfound.htm");
+      s->fd = cfs_open(&s->filename[1], CFS_READ);
+      petsciiconv_toascii(s->filename, sizeof(s->filename));
+      get_entity_headers(s);
+      PT_WAIT_THREAD(&s->outputpt,
+		     send_headers(s,
+		     (s->flags & HTTPD_KEEPALIVE) ?
+		     http_header_404_11 : http_header_404));
+      if(s->fd < 0) {
+	PT_WAIT_THREAD(&s->outputpt,
+		       send_string(s, "not found"));
+	s->state = STATE_WAITING;
+	s->flags |= HTTPD_CLOSE;
+	uip_close();
+	webserver_log_file(&uip_conn->ripaddr, "404 (no notfound.htm)");
+	PT_EXIT(&s->outputpt);
+      }
+      webserver_log_file(&uip_conn->ripaddr, "404 - notfound.htm");
+    } else {
+      get_entity_headers(s);
       PT_WAIT_THREAD(&s->outputpt,
-                     send_string(s, "not found"));
-      uip_close();
-      webserver_log_file(&uip_conn->ripaddr, "404 (no notfound.htm)");
-      PT_EXIT(&s->outputpt);
+		     send_headers(s,
+		     (s->flags & HTTPD_KEEPALIVE) ?
+		     http_header_200_11 : http_header_200));
     }
-    webserver_log_file(&uip_conn->ripaddr, "404 - notfound.htm");
-  } else {
-    PT_WAIT_THREAD(&s->outputpt,
-		   send_headers(s, http_header_200));
-  }
-  PT_WAIT_THREAD(&s->outputpt, send_file(s));
-  cfs_close(s->fd);
-  s->fd = -1;
+    PT_WAIT_THREAD(&s->outputpt, send_file(s));
+    cfs_close(s->fd);
+    s->fd = -1;
+    s->state = STATE_WAITING;
+  } while(s->flags & HTTPD_KEEPALIVE);
+
+  s->flags |= HTTPD_CLOSE;
   PSOCK_CLOSE(&s->sout);
   PT_END(&s->outputpt);
 }
 /*---------------------------------------------------------------------------*/
+static int
+parse_header(struct httpd_state *s)
+{
+  int len = PSOCK_DATALEN(&s->sin);
+  char partial = s->flags & HTTPD_PARTIAL;
+
+  if(s->inputbuf[len - 1] == ISO_nl) {
+    s->flags &= ~HTTPD_PARTIAL;
+  } else {
+    s->flags |= HTTPD_PARTIAL;
+  }
+  if(partial) {
+    /* The rest of a line that did not fit in inputbuf. */
+    return 0;
+  }
+
+  if(s->inputbuf[0] == ISO_cr || s->inputbuf[0] == ISO_nl) {
+    /* The empty line that ends the request. */
+    return 1;
+  }
+
+  if(strncmp(s->inputbuf, http_referer, 8) == 0) {
+    s->inputbuf[len - 2] = 0;
+    petsciiconv_topetscii(s->inputbuf, len - 2);
+    webserver_log(s->inputbuf);
+  } else if(strncmp(s->inputbuf, http_connection,
+		    sizeof(http_connection) - 1) == 0) {
+    s->inputbuf[len] = 0;
+    if(strstr(s->inputbuf, http_close) != NULL) {
+      s->flags &= ~HTTPD_KEEPALIVE;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
 static
 PT_THREAD(handle_input(struct httpd_state *s))
 {
   PSOCK_BEGIN(&s->sin);
 
-  PSOCK_READTO(&s->sin, ISO_space);
+  while(1) {
+    PSOCK_READTO(&s->sin, ISO_space);
   
-  if(strncmp(s->inputbuf, http_get, 4) != 0) {
-    PSOCK_CLOSE_EXIT(&s->sin);
-  }
-  PSOCK_READTO(&s->sin, ISO_space);
+    if(strncmp(s->inputbuf, http_get, 4) != 0) {
+      PSOCK_CLOSE_EXIT(&s->sin);
+    }
 
-  if(s->inputbuf[0] != ISO_slash) {
-    PSOCK_CLOSE_EXIT(&s->sin);
-  }
+    if(s->state == STATE_OUTPUT) {
+      /* Pipelined requests are not queued. The connection is closed
+	 after the current response, and the client sends the request
+	 again on a new connection. */
+      s->flags = (s->flags & ~HTTPD_KEEPALIVE) | HTTPD_CLOSE;
+      PSOCK_EXIT(&s->sin);
+    }
+
+    PSOCK_READTO(&s->sin, ISO_space);
+
+    if(s->inputbuf[0] != ISO_slash) {
+      PSOCK_CLOSE_EXIT(&s->sin);
+    }
 
 #if URLCONV
-  s->inputbuf[PSOCK_DATALEN(&s->sin) - 1] = 0;
-  urlconv_tofilename(s->filename, s->inputbuf, sizeof(s->filename));
-#else /* URLCONV */
-  if(s->inputbuf[1] == ISO_space) {
-    strncpy(s->filename, http_index_htm, sizeof(s->filename));
-  } else {
     s->inputbuf[PSOCK_DATALEN(&s->sin) - 1] = 0;
-    strncpy(s->filename, s->inputbuf, sizeof(s->filename));
-  }
+    urlconv_tofilename(s->filename, s->inputbuf, sizeof(s->filename));
+#else /* URLCONV */
+    if(s->inputbuf[1] == ISO_space) {
+      strncpy(s->filename, http_index_htm, sizeof(s->filename));
+    } else {
+      s->inputbuf[PSOCK_DATALEN(&s->sin) - 1] = 0;
+      strncpy(s->filename, s->inputbuf, sizeof(s->filename));
+    }
 #endif /* URLCONV */
 
-  petsciiconv_topetscii(s->filename, sizeof(s->filename));
-  webserver_log_file(&uip_conn->ripaddr, s->filename);
-  petsciiconv_toascii(s->filename, sizeof(s->filename));
-  s->state = STATE_OUTPUT;
+    petsciiconv_topetscii(s->filename, sizeof(s->filename));
+    webserver_log_file(&uip_conn->ripaddr, s->filename);
+    petsciiconv_toascii(s->filename, sizeof(s->filename));
 
-  while(1) {
+    /* HTTP/1.1 connections are persistent unless the client asks
+       for them to be closed. */
     PSOCK_READTO(&s->sin, ISO_nl);
-
-    if(strncmp(s->inputbuf, http_referer, 8) == 0) {
-      s->inputbuf[PSOCK_DATALEN(&s->sin) - 2] = 0;
-      petsciiconv_topetscii(s->inputbuf, PSOCK_DATALEN(&s->sin) - 2);
-      webserver_log(s->inputbuf);
+    if(strncmp(s->inputbuf, http_11, 8) == 0) {
+      s->flags = HTTPD_KEEPALIVE;
+    } else {
+      s->flags = 0;
     }
+
+    do {
+      PSOCK_READTO(&s->sin, ISO_nl);
+    } while(!parse_header(s));
+
+    s->state = STATE_OUTPUT;
   }
   
   PSOCK_END(&s->sin);
@@ -218,10 +310,10 @@ PT_THREAD(handle_input(struct httpd_state *s))
 static void
 handle_connection(struct httpd_state *s)
 {
-  handle_input(s);
-  if(s->state == STATE_OUTPUT) {
-    handle_output(s);
+  if(!(s->flags & HTTPD_CLOSE)) {
+    handle_input(s);
   }
+  handle_output(s);
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -250,6 +342,7 @@ httpd_appcall(void *state)
     PT_INIT(&s->outputpt);
     s->fd = -1;
     s->state = STATE_WAITING;
+    s->flags = 0;
     timer_set(&s->timer, CLOCK_SECOND * 10);
     handle_connection(s);
   } else if(s != NULL) {
@@ -262,6 +355,7 @@ httpd_appcall(void *state)
 	}
         memb_free(&conns, s);
         webserver_log_file(&uip_conn->ripaddr, "reset (timeout)");
+	return;
       }
     } else {
       timer_restart(&s->timer);
@@ -50,6 +50,7 @@ struct httpd_state {
   char outputbuf[UIP_TCP_MSS];
   char filename[HTTPD_PATHLEN];
   char state;
+  char flags;
   int fd;
   int len;
 };
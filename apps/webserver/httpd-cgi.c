@@ -137,7 +137,7 @@ static unsigned short
 generate_file_stats(void *arg)
 {
   char *f = (char *)arg;
-  return snprintf((char *)uip_appdata, uip_mss(), "%5u", httpd_fs_count(f));
+  return snprintf((char *)uip_appdata, httpd_mss(), "%5u", httpd_fs_count(f));
 }
 /*---------------------------------------------------------------------------*/
 static
@@ -145,7 +145,7 @@ PT_THREAD(file_stats(struct httpd_state *s, char *ptr))
 {
   PSOCK_BEGIN(&s->sout);
 
-  PSOCK_GENERATOR_SEND(&s->sout, generate_file_stats, (void *) (strchr(ptr, ' ') + 1));
+  HTTPD_GENERATOR_SEND(s, generate_file_stats, (void *) (strchr(ptr, ' ') + 1));
   
   PSOCK_END(&s->sout);
 }
@@ -160,7 +160,7 @@ make_tcp_stats(void *arg)
 #if UIP_CONF_IPV6
   char buf[48];
   httpd_sprint_ip6(conn->ripaddr, buf);
-  return snprintf((char *)uip_appdata, uip_mss(),
+  return snprintf((char *)uip_appdata, httpd_mss(),
          "<tr align=\"center\"><td>%d</td><td>%s:%u</td><td>%s</td><td>%u</td><td>%u</td><td>%c %c</td></tr>\r\n",
          uip_htons(conn->lport),
          buf,
@@ -171,7 +171,7 @@ make_tcp_stats(void *arg)
          (uip_outstanding(conn))? '*':' ',
          (uip_stopped(conn))? '!':' ');
 #else
-  return snprintf((char *)uip_appdata, uip_mss(),
+  return snprintf((char *)uip_appdata, httpd_mss(),
          "<tr align=\"center\"><td>%d</td><td>%u.%u.%u.%u:%u</td><td>%s</td><td>%u</td><td>%u</td><td>%c %c</td></tr>\r\n",
          uip_htons(conn->lport),
          conn->ripaddr.u8[0],
@@ -195,7 +195,7 @@ PT_THREAD(tcp_stats(struct httpd_state *s, char *ptr))
 
   for(s->u.count = 0; s->u.count < UIP_CONNS; ++s->u.count) {
     if((uip_conns[s->u.count].tcpstateflags & UIP_TS_MASK) != UIP_CLOSED) {
-      PSOCK_GENERATOR_SEND(&s->sout, make_tcp_stats, s);
+      HTTPD_GENERATOR_SEND(s, make_tcp_stats, s);
     }
   }
 
@@ -210,7 +210,7 @@ make_processes(void *p)
   strncpy(name, PROCESS_NAME_STRING((struct process *)p), 40);
   petsciiconv_toascii(name, 40);
 
-  return snprintf((char *)uip_appdata, uip_mss(),
+  return snprintf((char *)uip_appdata, httpd_mss(),
 		 "<tr align=\"center\"><td>%p</td><td>%s</td><td>%p</td><td>%s</td></tr>\r\n",
 		 p, name,
 		 *((char **)&(((struct process *)p)->thread)),
@@ -222,7 +222,7 @@ PT_THREAD(processes(struct httpd_state *s, char *ptr))
 {
   PSOCK_BEGIN(&s->sout);
   for(s->u.ptr = PROCESS_LIST(); s->u.ptr != NULL; s->u.ptr = ((struct process *)s->u.ptr)->next) {
-    PSOCK_GENERATOR_SEND(&s->sout, make_processes, s->u.ptr);
+    HTTPD_GENERATOR_SEND(s, make_processes, s->u.ptr);
   }
   PSOCK_END(&s->sout);
 }
@@ -251,16 +251,16 @@ make_addresses(void *p)
 {
 uint8_t i,j=0;
 uint16_t numprinted;
-  numprinted = httpd_snprintf((char *)uip_appdata, uip_mss(),httpd_cgi_addrh);
+  numprinted = httpd_snprintf((char *)uip_appdata, httpd_mss(),httpd_cgi_addrh);
   for (i=0; i<UIP_DS6_ADDR_NB;i++) {
     if (uip_ds6_if.addr_list[i].isused) {
       j++;
       numprinted += httpd_cgi_sprint_ip6(uip_ds6_if.addr_list[i].ipaddr, uip_appdata + numprinted);
-      numprinted += httpd_snprintf((char *)uip_appdata+numprinted, uip_mss()-numprinted, httpd_cgi_addrb); 
+      numprinted += httpd_snprintf((char *)uip_appdata+numprinted, httpd_mss()-numprinted, httpd_cgi_addrb); 
     }
   }
-//if (j==0) numprinted += httpd_snprintf((char *)uip_appdata+numprinted, uip_mss()-numprinted, httpd_cgi_addrn);
-  numprinted += httpd_snprintf((char *)uip_appdata+numprinted, uip_mss()-numprinted, httpd_cgi_addrf, UIP_DS6_ADDR_NB-j); 
+//if (j==0) numprinted += httpd_snprintf((char *)uip_appdata+numprinted, httpd_mss()-numprinted, httpd_cgi_addrn);
+  numprinted += httpd_snprintf((char *)uip_appdata+numprinted, httpd_mss()-numprinted, httpd_cgi_addrf, UIP_DS6_ADDR_NB-j); 
   return numprinted;
 }
 /*---------------------------------------------------------------------------*/
@@ -269,7 +269,7 @@ PT_THREAD(addresses(struct httpd_state *s, char *ptr))
 {
   PSOCK_BEGIN(&s->sout);
 
-  PSOCK_GENERATOR_SEND(&s->sout, make_addresses, s->u.ptr);
+  HTTPD_GENERATOR_SEND(s, make_addresses, s->u.ptr);
 
   PSOCK_END(&s->sout);
 }
@@ -279,17 +279,17 @@ make_neighbors(void *p)
 {
 uint8_t i,j=0;
 uint16_t numprinted;
-  numprinted = httpd_snprintf((char *)uip_appdata, uip_mss(),httpd_cgi_addrh);
+  numprinted = httpd_snprintf((char *)uip_appdata, httpd_mss(),httpd_cgi_addrh);
   uip_ds6_nbr_t *nbr;
   for(nbr = nbr_table_head(ds6_neighbors);
       nbr != NULL;
       nbr = nbr_table_next(ds6_neighbors, nbr)) {
     j++;
     numprinted += httpd_cgi_sprint_ip6(nbr->ipaddr, uip_appdata + numprinted);
-    numprinted += httpd_snprintf((char *)uip_appdata+numprinted, uip_mss()-numprinted, httpd_cgi_addrb);
+    numprinted += httpd_snprintf((char *)uip_appdata+numprinted, httpd_mss()-numprinted, httpd_cgi_addrb);
   }
-//if (j==0) numprinted += httpd_snprintf((char *)uip_appdata+numprinted, uip_mss()-numprinted, httpd_cgi_addrn);
-  numprinted += httpd_snprintf((char *)uip_appdata+numprinted, uip_mss()-numprinted, httpd_cgi_addrf,NBR_TABLE_MAX_NEIGHBORS-j);
+//if (j==0) numprinted += httpd_snprintf((char *)uip_appdata+numprinted, httpd_mss()-numprinted, httpd_cgi_addrn);
+  numprinted += httpd_snprintf((char *)uip_appdata+numprinted, httpd_mss()-numprinted, httpd_cgi_addrf,NBR_TABLE_MAX_NEIGHBORS-j);
   return numprinted;
 }
 /*---------------------------------------------------------------------------*/
@@ -298,7 +298,7 @@ PT_THREAD(neighbors(struct httpd_state *s, char *ptr))
 {
   PSOCK_BEGIN(&s->sout);
 
-  PSOCK_GENERATOR_SEND(&s->sout, make_neighbors, s->u.ptr);  
+  HTTPD_GENERATOR_SEND(s, make_neighbors, s->u.ptr);  
   
   PSOCK_END(&s->sout);
 }
@@ -313,22 +313,22 @@ make_routes(void *p)
   uint16_t numprinted;
   uip_ds6_route_t *r;
 
-  numprinted = httpd_snprintf((char *)uip_appdata, uip_mss(),httpd_cgi_addrh);
+  numprinted = httpd_snprintf((char *)uip_appdata, httpd_mss(),httpd_cgi_addrh);
   for(r = uip_ds6_route_head();
       r != NULL;
       r = uip_ds6_route_next(r)) {
     j++;
     numprinted += httpd_cgi_sprint_ip6(r->ipaddr, uip_appdata + numprinted);
-    numprinted += httpd_snprintf((char *)uip_appdata+numprinted, uip_mss()-numprinted, httpd_cgi_rtes1, r->length);
+    numprinted += httpd_snprintf((char *)uip_appdata+numprinted, httpd_mss()-numprinted, httpd_cgi_rtes1, r->length);
     numprinted += httpd_cgi_sprint_ip6(uip_ds6_route_nexthop(r), uip_appdata + numprinted);
     if(r->state.lifetime < 3600) {
-      numprinted += httpd_snprintf((char *)uip_appdata+numprinted, uip_mss()-numprinted, httpd_cgi_rtes2, r->state.lifetime);
+      numprinted += httpd_snprintf((char *)uip_appdata+numprinted, httpd_mss()-numprinted, httpd_cgi_rtes2, r->state.lifetime);
     } else {
-      numprinted += httpd_snprintf((char *)uip_appdata+numprinted, uip_mss()-numprinted, httpd_cgi_rtes3);
+      numprinted += httpd_snprintf((char *)uip_appdata+numprinted, httpd_mss()-numprinted, httpd_cgi_rtes3);
     }
   }
-  if (j==0) numprinted += httpd_snprintf((char *)uip_appdata+numprinted, uip_mss()-numprinted, httpd_cgi_addrn);
-  numprinted += httpd_snprintf((char *)uip_appdata+numprinted, uip_mss()-numprinted, httpd_cgi_addrf,UIP_DS6_ROUTE_NB-j);
+  if (j==0) numprinted += httpd_snprintf((char *)uip_appdata+numprinted, httpd_mss()-numprinted, httpd_cgi_addrn);
+  numprinted += httpd_snprintf((char *)uip_appdata+numprinted, httpd_mss()-numprinted, httpd_cgi_addrf,UIP_DS6_ROUTE_NB-j);
   return numprinted;
 }
 /*---------------------------------------------------------------------------*/
@@ -337,7 +337,7 @@ PT_THREAD(routes(struct httpd_state *s, char *ptr))
 {
   PSOCK_BEGIN(&s->sout);
  
-  PSOCK_GENERATOR_SEND(&s->sout, make_routes, s->u.ptr); 
+  HTTPD_GENERATOR_SEND(s, make_routes, s->u.ptr); 
  
   PSOCK_END(&s->sout);
 }
@@ -65,9 +65,67 @@ loop:
   goto loop;
 }
 /*-----------------------------------------------------------------------------------*/
+#ifdef HTTPD_FS_FILETAB
+/* makefsdata was run with -x, -H or -z, so the files are in a table
+   that is indexed by the order of the files. */
+static int
+lookup(const char *name)
+{
+#ifdef HTTPD_FS_HASH_BITS
+  uint16_t h;
+  uint8_t i;
+  const char *p;
+
+  /* The hash covers the name up to the end of the path. The hash
+     function must match the one in tools/makefsdata. */
+  h = 0;
+  for(p = name;
+      *p != 0 && *p != '\r' && *p != '\n' && *p != ' ' && *p != '?';
+      ++p) {
+    h = h * 33 + (uint8_t)*p;
+  }
+  h = (uint16_t)((uint32_t)h * HTTPD_FS_HASH_SEED) >> (16 - HTTPD_FS_HASH_BITS);
+
+  i = httpd_fs_hashtab[h];
+  if(i != 0 && httpd_fs_strcmp(name, httpd_fs_filetab[i - 1]->name) == 0) {
+    return i - 1;
+  }
+#else /* HTTPD_FS_HASH_BITS */
+  int i;
+
+  for(i = 0; i < HTTPD_FS_NUMFILES; i++) {
+    if(httpd_fs_strcmp(name, httpd_fs_filetab[i]->name) == 0) {
+      return i;
+    }
+  }
+#endif /* HTTPD_FS_HASH_BITS */
+  return -1;
+}
+#endif /* HTTPD_FS_FILETAB */
+/*-----------------------------------------------------------------------------------*/
 int
 httpd_fs_open(const char *name, struct httpd_fs_file *file)
 {
+#ifdef HTTPD_FS_FILETAB
+  int i;
+
+  i = lookup(name);
+  if(i < 0) {
+    return 0;
+  }
+  file->data = (char *)httpd_fs_filetab[i]->data;
+  file->len = httpd_fs_filetab[i]->len;
+#ifdef HTTPD_FS_HEADERS
+  file->headers = httpd_fs_headertab[i].headers;
+  file->etag = httpd_fs_headertab[i].etag;
+#else /* HTTPD_FS_HEADERS */
+  file->headers = file->etag = NULL;
+#endif /* HTTPD_FS_HEADERS */
+#if HTTPD_FS_STATISTICS
+  ++count[i];
+#endif /* HTTPD_FS_STATISTICS */
+  return 1;
+#else /* HTTPD_FS_FILETAB */
 #if HTTPD_FS_STATISTICS
   uint16_t i = 0;
 #endif /* HTTPD_FS_STATISTICS */
@@ -80,6 +138,7 @@ httpd_fs_open(const char *name, struct httpd_fs_file *file)
     if(httpd_fs_strcmp(name, f->name) == 0) {
       file->data = f->data;
       file->len = f->len;
+      file->headers = file->etag = NULL;
 #if HTTPD_FS_STATISTICS
       ++count[i];
 #endif /* HTTPD_FS_STATISTICS */
@@ -91,6 +150,7 @@ httpd_fs_open(const char *name, struct httpd_fs_file *file)
 
   }
   return 0;
+#endif /* HTTPD_FS_FILETAB */
 }
 /*-----------------------------------------------------------------------------------*/
 void
@@ -108,6 +168,12 @@ httpd_fs_init(void)
 uint16_t
 httpd_fs_count(char *name)
 {
+#ifdef HTTPD_FS_FILETAB
+  int i;
+
+  i = lookup(name);
+  return i < 0 ? 0 : count[i];
+#else /* HTTPD_FS_FILETAB */
   struct httpd_fsdata_file_noconst *f;
   uint16_t i;
 
@@ -122,6 +188,7 @@ httpd_fs_count(char *name)
     ++i;
   }
   return 0;
+#endif /* HTTPD_FS_FILETAB */
 }
 #endif /* HTTPD_FS_STATISTICS */
 /*-----------------------------------------------------------------------------------*/
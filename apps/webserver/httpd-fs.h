@@ -41,6 +41,10 @@
 struct httpd_fs_file {
   char *data;
   int len;
+  /* The precomputed headers and ETag of the file, or NULL if
+     makefsdata did not generate them. */
+  const char *headers;
+  const char *etag;
 };
 
 /* file must be allocated by caller and will be filled in
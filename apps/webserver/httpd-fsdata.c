@@ -1,4 +1,4 @@
-/*********Generated by contiki/tools/makefsdata on 2015-01-19*********/
+/*********Generated by contiki/tools/makefsdata on 2026-10-19*********/
 
 
 const char data_404_html[170]  = {
@@ -673,3 +673,44 @@ const struct httpd_fsdata_file     file_upload_html[] ={{      file_tcp_shtml, d
 #define HTTPD_FS_ROOT  file_upload_html
 #define HTTPD_FS_NUMFILES  10
 #define HTTPD_FS_SIZE 6166
+
+#define HTTPD_FS_FILETAB 1
+static const struct httpd_fsdata_file *const httpd_fs_filetab[HTTPD_FS_NUMFILES] = {
+   file_404_html,
+   file_files_shtml,
+   file_footer_html,
+   file_header_html,
+   file_index_html,
+   file_processes_shtml,
+   file_status_shtml,
+   file_style_css,
+   file_tcp_shtml,
+   file_upload_html,
+};
+
+#define HTTPD_FS_HASH_BITS 4
+#define HTTPD_FS_HASH_SEED 263
+/* Index into httpd_fs_filetab plus one, or zero for no file */
+static const uint8_t httpd_fs_hashtab[1 << HTTPD_FS_HASH_BITS] = {
+   6, 0, 0, 0, 4, 3, 0, 2, 5, 8, 1, 9, 10, 7, 0, 0,
+};
+
+#define HTTPD_FS_HEADERS 1
+static const struct httpd_fsdata_headers httpd_fs_headertab[HTTPD_FS_NUMFILES] = {
+   {"Content-Length: 160\r\nETag: \"c571d246\"\r\nContent-type: text/html\r\n\r\n",
+    "\"c571d246\""}, /* /404.html */
+   {NULL, NULL}, /* /files.shtml */
+   {"Content-Length: 17\r\nETag: \"f7cab59c\"\r\nContent-type: text/html\r\n\r\n",
+    "\"f7cab59c\""}, /* /footer.html */
+   {"Content-Length: 788\r\nETag: \"2d55a8b1\"\r\nContent-type: text/html\r\n\r\n",
+    "\"2d55a8b1\""}, /* /header.html */
+   {"Content-Length: 1011\r\nETag: \"e7c6cf20\"\r\nContent-type: text/html\r\n\r\n",
+    "\"e7c6cf20\""}, /* /index.html */
+   {NULL, NULL}, /* /processes.shtml */
+   {NULL, NULL}, /* /status.shtml */
+   {"Content-Length: 2560\r\nETag: \"9c0b075e\"\r\nContent-type: text/css\r\n\r\n",
+    "\"9c0b075e\""}, /* /style.css */
+   {NULL, NULL}, /* /tcp.shtml */
+   {"Content-Length: 196\r\nETag: \"e70751d0\"\r\nContent-type: text/html\r\n\r\n",
+    "\"e70751d0\""}, /* /upload.html */
+};
@@ -60,4 +60,12 @@ struct httpd_fsdata_file_noconst {
 #endif /* HTTPD_FS_STATISTICS */
 };
 
+/* Generated by makefsdata -H: the Content-Length, Content-Encoding,
+   ETag and Content-type headers of a file, ending with an empty
+   line, and its ETag. */
+struct httpd_fsdata_headers {
+  const char *headers;
+  const char *etag;
+};
+
 #endif /* HTTPD_FSDATA_H_ */
@@ -51,13 +51,37 @@
 #define CONNS WEBSERVER_CONF_CGI_CONNS
 #endif /* WEBSERVER_CONF_CGI_CONNS */
 
-#define STATE_WAITING 0
-#define STATE_OUTPUT  1
+/* Connection state bits. */
+#define STATE_CLOSE   0x01 /* No more requests are read */
+#define STATE_PARTIAL 0x02 /* The last header line did not fit in inputbuf */
+
+/* Request and response flags. */
+#define HTTPD_KEEPALIVE 0x01 /* Persistent HTTP/1.1 connection */
+#define HTTPD_SCRIPT    0x02 /* The response is script output */
+#define HTTPD_CHUNKED   0x04 /* The response uses chunked encoding */
+#define HTTPD_FRAMING   0x08 /* Body data is being sent as chunks */
+#define HTTPD_LAST      0x10 /* The last chunk follows the body data */
+#define HTTPD_NOT_FOUND 0x20 /* 404 response */
+#define HTTPD_NOT_MOD   0x40 /* 304 response */
+
+/* The chunk size line, the CRLF after the chunk data and the last
+   chunk. The size is always sent as four hex digits. */
+#define CHUNK_HEADER_LEN 6
+#define CHUNK_OVERHEAD (CHUNK_HEADER_LEN + 2 + sizeof(http_last_chunk) - 1)
+
+/* The longest header lines that are added to files for which
+   makefsdata has not generated the headers. */
+#define ENTITY_HEADERS_MAX \
+  (sizeof(http_chunked) - 1 + sizeof(http_content_type_binary) - 1)
+
+#define NEXT_REQUEST(s) \
+  (&(s)->pending[((s)->first + (s)->npending) % HTTPD_PIPELINE])
 
 #define SEND_STRING(s, str) PSOCK_SEND(s, (uint8_t *)str, (unsigned int)strlen(str))
 MEMB(conns, struct httpd_state, CONNS);
 
 #define ISO_nl      0x0a
+#define ISO_cr      0x0d
 #define ISO_space   0x20
 #define ISO_bang    0x21
 #define ISO_percent 0x25
@@ -65,14 +89,70 @@ MEMB(conns, struct httpd_state, CONNS);
 #define ISO_slash   0x2f
 #define ISO_colon   0x3a
 
+/*---------------------------------------------------------------------------*/
+unsigned short
+httpd_mss(void)
+{
+  struct httpd_state *s = (struct httpd_state *)uip_conn->appstate.state;
+
+  if(s != NULL && (s->flags & HTTPD_FRAMING)) {
+    return uip_mss() - CHUNK_OVERHEAD;
+  }
+  return uip_mss();
+}
+/*---------------------------------------------------------------------------*/
+unsigned short
+httpd_generate(void *state)
+{
+  struct httpd_state *s = (struct httpd_state *)state;
+  char *data = uip_appdata;
+  char *ptr;
+  unsigned short len;
+
+  len = s->generator(s->generator_arg);
+  if(!(s->flags & HTTPD_FRAMING) || len == 0) {
+    return len;
+  }
+
+  /* The generator has left room for the framing within uip_mss().
+     Output that did not fit, such as a truncated snprintf(), is cut
+     as psock would have cut it. */
+  if(len > httpd_mss()) {
+    len = httpd_mss();
+  }
+  memmove(data + CHUNK_HEADER_LEN, data, len);
+  sprintf(data, "%04x", len);
+  data[4] = ISO_cr;
+  data[5] = ISO_nl;
+  ptr = data + CHUNK_HEADER_LEN + len;
+  ptr = strcpy(ptr, http_crnl) + strlen(http_crnl);
+  if(s->flags & HTTPD_LAST) {
+    ptr = strcpy(ptr, http_last_chunk) + strlen(http_last_chunk);
+  }
+  return (unsigned short)(ptr - data);
+}
+/*---------------------------------------------------------------------------*/
+unsigned short
+httpd_generate_copy(void *state)
+{
+  struct httpd_state *s = (struct httpd_state *)state;
+
+  s->sentlen = s->sendlen;
+  if(s->sentlen > httpd_mss()) {
+    s->sentlen = httpd_mss();
+  }
+  memcpy(uip_appdata, s->sendptr, s->sentlen);
+
+  return s->sentlen;
+}
 /*---------------------------------------------------------------------------*/
 static unsigned short
 generate(void *state)
 {
   struct httpd_state *s = (struct httpd_state *)state;
 
-  if(s->file.len > uip_mss()) {
-    s->len = uip_mss();
+  if(s->file.len > httpd_mss()) {
+    s->len = httpd_mss();
   } else {
     s->len = s->file.len;
   }
@@ -86,11 +166,11 @@ PT_THREAD(send_file(struct httpd_state *s))
 {
   PSOCK_BEGIN(&s->sout);
   
-  do {
-    PSOCK_GENERATOR_SEND(&s->sout, generate, s);
+  while(s->file.len > 0) {
+    HTTPD_GENERATOR_SEND(s, generate, s);
     s->file.len -= s->len;
     s->file.data += s->len;
-  } while(s->file.len > 0);
+  }
       
   PSOCK_END(&s->sout);
 }
@@ -100,7 +180,7 @@ PT_THREAD(send_part_of_file(struct httpd_state *s))
 {
   PSOCK_BEGIN(&s->sout);
 
-  PSOCK_SEND(&s->sout, (uint8_t *)s->file.data, s->len);
+  HTTPD_SEND(s, s->file.data, s->len);
   
   PSOCK_END(&s->sout);
 }
@@ -154,8 +234,8 @@ PT_THREAD(handle_script(struct httpd_state *s))
       /* See if we find the start of script marker in the block of HTML
 	 to be sent. */
 
-      if(s->file.len > uip_mss()) {
-	s->len = uip_mss();
+      if(s->file.len > httpd_mss()) {
+	s->len = httpd_mss();
       } else {
 	s->len = s->file.len;
       }
@@ -168,10 +248,14 @@ PT_THREAD(handle_script(struct httpd_state *s))
       if(ptr != NULL &&
 	 ptr != s->file.data) {
 	s->len = (int)(ptr - s->file.data);
-	if(s->len >= uip_mss()) {
-	  s->len = uip_mss();
+	if(s->len >= httpd_mss()) {
+	  s->len = httpd_mss();
 	}
       }
+      if(s->len == s->file.len) {
+	/* The end of the file can carry the last chunk. */
+	s->flags |= HTTPD_LAST;
+      }
       PT_WAIT_THREAD(&s->scriptpt, send_part_of_file(s));
       s->file.data += s->len;
       s->file.len -= s->len;
@@ -181,17 +265,10 @@ PT_THREAD(handle_script(struct httpd_state *s))
   PT_END(&s->scriptpt);
 }
 /*---------------------------------------------------------------------------*/
-static
-PT_THREAD(send_headers(struct httpd_state *s, const char *statushdr))
+static const char *
+get_content_type(struct httpd_state *s)
 {
-/* gcc warning if not initialized. 
- * If initialized, minimal-net platform segmentation fault if not static...
- */
-  static const char *ptr = NULL;
-
-  PSOCK_BEGIN(&s->sout);
-
-  SEND_STRING(&s->sout, statushdr);
+  const char *ptr;
 
   ptr = strrchr(s->filename, ISO_period);
   if(ptr == NULL) {
@@ -210,78 +287,362 @@ PT_THREAD(send_headers(struct httpd_state *s, const char *statushdr))
   } else {
     ptr = http_content_type_plain;
   }
-  SEND_STRING(&s->sout, ptr);
+  return ptr;
+}
+/*---------------------------------------------------------------------------*/
+static const char *
+get_status_header(struct httpd_state *s)
+{
+  if(s->flags & HTTPD_KEEPALIVE) {
+    if(s->flags & HTTPD_NOT_FOUND) {
+      return http_header_404_11;
+    } else if(s->flags & HTTPD_NOT_MOD) {
+      return http_header_304_11;
+    }
+    return http_header_200_11;
+  }
+  if(s->flags & HTTPD_NOT_FOUND) {
+    return http_header_404;
+  } else if(s->flags & HTTPD_NOT_MOD) {
+    return http_header_304;
+  }
+  return http_header_200;
+}
+/*---------------------------------------------------------------------------*/
+static char *
+add_entity_headers(struct httpd_state *s, char *ptr)
+{
+  const char *type;
+
+  /* The length of a file is known, but script output on a persistent
+     connection has to be sent in chunks. */
+  if(s->flags & HTTPD_CHUNKED) {
+    ptr = strcpy(ptr, http_chunked) + strlen(http_chunked);
+  } else if(!(s->flags & HTTPD_SCRIPT)) {
+    ptr = strcpy(ptr, http_content_length) + strlen(http_content_length);
+    ptr += sprintf(ptr, "%u\r\n", (unsigned int)s->file.len);
+  }
+  type = get_content_type(s);
+  return strcpy(ptr, type) + strlen(type);
+}
+/*---------------------------------------------------------------------------*/
+static unsigned short
+generate_entity_headers(void *state)
+{
+  struct httpd_state *s = (struct httpd_state *)state;
+  char *ptr;
+
+  ptr = add_entity_headers(s, uip_appdata);
+
+  return (unsigned short)(ptr - (char *)uip_appdata);
+}
+/*---------------------------------------------------------------------------*/
+static unsigned short
+generate_headers(void *state)
+{
+  struct httpd_state *s = (struct httpd_state *)state;
+  const char *str;
+  char *ptr = uip_appdata;
+
+  str = get_status_header(s);
+  ptr = strcpy(ptr, str) + strlen(str);
+  if(s->file.headers != NULL) {
+    ptr = strcpy(ptr, s->file.headers) + strlen(s->file.headers);
+  } else {
+    ptr = add_entity_headers(s, ptr);
+  }
+
+  /* Fill the rest of the segment with the start of a file. */
+  s->len = 0;
+  if(!(s->flags & HTTPD_SCRIPT)) {
+    s->len = uip_mss() - (int)(ptr - (char *)uip_appdata);
+    if(s->len > s->file.len) {
+      s->len = s->file.len;
+    }
+    memcpy(ptr, s->file.data, s->len);
+    ptr += s->len;
+  }
+
+  return (unsigned short)(ptr - (char *)uip_appdata);
+}
+/*---------------------------------------------------------------------------*/
+static
+PT_THREAD(send_headers(struct httpd_state *s))
+{
+  PSOCK_BEGIN(&s->sout);
+
+  if(strlen(get_status_header(s)) +
+     (s->file.headers != NULL ? strlen(s->file.headers) : ENTITY_HEADERS_MAX)
+     <= uip_mss()) {
+    /* Each segment waits for an acknowledgment, so the headers and
+       the start of a file are sent together. */
+    PSOCK_GENERATOR_SEND(&s->sout, generate_headers, s);
+    s->file.data += s->len;
+    s->file.len -= s->len;
+  } else {
+    SEND_STRING(&s->sout, get_status_header(s));
+    if(s->file.headers != NULL) {
+      SEND_STRING(&s->sout, s->file.headers);
+    } else {
+      PSOCK_GENERATOR_SEND(&s->sout, generate_entity_headers, s);
+    }
+  }
+
+  PSOCK_END(&s->sout);
+}
+/*---------------------------------------------------------------------------*/
+static
+PT_THREAD(send_last_chunk(struct httpd_state *s))
+{
+  PSOCK_BEGIN(&s->sout);
+
+  SEND_STRING(&s->sout, http_last_chunk);
+
+  PSOCK_END(&s->sout);
+}
+/*---------------------------------------------------------------------------*/
+static char *
+add_etag(struct httpd_state *s, char *ptr)
+{
+  /* The ETag header and the empty line that ends the headers. */
+  ptr = strcpy(ptr, http_etag) + strlen(http_etag);
+  ptr = strcpy(ptr, s->file.etag) + strlen(s->file.etag);
+  ptr = strcpy(ptr, http_crnl) + strlen(http_crnl);
+  return strcpy(ptr, http_crnl) + strlen(http_crnl);
+}
+/*---------------------------------------------------------------------------*/
+static unsigned short
+generate_etag(void *state)
+{
+  struct httpd_state *s = (struct httpd_state *)state;
+  char *ptr;
+
+  ptr = add_etag(s, uip_appdata);
+
+  return (unsigned short)(ptr - (char *)uip_appdata);
+}
+/*---------------------------------------------------------------------------*/
+static unsigned short
+generate_not_modified(void *state)
+{
+  struct httpd_state *s = (struct httpd_state *)state;
+  const char *str;
+  char *ptr = uip_appdata;
+
+  str = get_status_header(s);
+  ptr = strcpy(ptr, str) + strlen(str);
+  ptr = add_etag(s, ptr);
+
+  return (unsigned short)(ptr - (char *)uip_appdata);
+}
+/*---------------------------------------------------------------------------*/
+static
+PT_THREAD(send_not_modified(struct httpd_state *s))
+{
+  PSOCK_BEGIN(&s->sout);
+
+  if(strlen(get_status_header(s)) + strlen(http_etag) +
+     strlen(s->file.etag) + 2 * strlen(http_crnl) <= uip_mss()) {
+    PSOCK_GENERATOR_SEND(&s->sout, generate_not_modified, s);
+  } else {
+    SEND_STRING(&s->sout, get_status_header(s));
+    PSOCK_GENERATOR_SEND(&s->sout, generate_etag, s);
+  }
+
   PSOCK_END(&s->sout);
 }
 /*---------------------------------------------------------------------------*/
+static void
+next_request(struct httpd_state *s)
+{
+  struct httpd_request *r = &s->pending[s->first];
+
+  memcpy(s->filename, r->filename, sizeof(s->filename));
+  memcpy(s->etag, r->etag, sizeof(s->etag));
+  s->flags = r->flags;
+  s->first = (s->first + 1) % HTTPD_PIPELINE;
+  --s->npending;
+
+  if((s->state & STATE_CLOSE) && s->npending == 0) {
+    /* This is the last response on the connection. */
+    s->flags &= ~HTTPD_KEEPALIVE;
+  }
+}
+/*---------------------------------------------------------------------------*/
 static
 PT_THREAD(handle_output(struct httpd_state *s))
 {
   char *ptr;
   
   PT_BEGIN(&s->outputpt);
- 
-  if(!httpd_fs_open(s->filename, &s->file)) {
-    strcpy(s->filename, http_404_html);
-    httpd_fs_open(s->filename, &s->file);
-    PT_WAIT_THREAD(&s->outputpt,
-		   send_headers(s,
-		   http_header_404));
-    PT_WAIT_THREAD(&s->outputpt,
-		   send_file(s));
-  } else {
-    PT_WAIT_THREAD(&s->outputpt,
-		   send_headers(s,
-		   http_header_200));
-    ptr = strrchr(s->filename, ISO_period);
-    if(ptr != NULL && strncmp(ptr, http_shtml, 6) == 0) {
-      PT_INIT(&s->scriptpt);
-      PT_WAIT_THREAD(&s->outputpt, handle_script(s));
-    } else {
+
+  do {
+    PT_WAIT_UNTIL(&s->outputpt, s->npending > 0);
+    next_request(s);
+
+    if(!httpd_fs_open(s->filename, &s->file)) {
+      strcpy(s->filename, http_404_html);
+      httpd_fs_open(s->filename, &s->file);
+      s->flags |= HTTPD_NOT_FOUND;
+      PT_WAIT_THREAD(&s->outputpt,
+		     send_headers(s));
       PT_WAIT_THREAD(&s->outputpt,
 		     send_file(s));
+    } else if(s->file.etag != NULL && strcmp(s->etag, s->file.etag) == 0) {
+      /* The client already has this version of the file. */
+      s->flags |= HTTPD_NOT_MOD;
+      PT_WAIT_THREAD(&s->outputpt,
+		     send_not_modified(s));
+    } else {
+      ptr = strrchr(s->filename, ISO_period);
+      if(ptr != NULL && strncmp(ptr, http_shtml, 6) == 0) {
+	s->flags |= HTTPD_SCRIPT;
+	if(s->flags & HTTPD_KEEPALIVE) {
+	  s->flags |= HTTPD_CHUNKED;
+	}
+      }
+      PT_WAIT_THREAD(&s->outputpt,
+		     send_headers(s));
+      if(s->flags & HTTPD_SCRIPT) {
+	PT_INIT(&s->scriptpt);
+	if(s->flags & HTTPD_CHUNKED) {
+	  s->flags |= HTTPD_FRAMING;
+	}
+	PT_WAIT_THREAD(&s->outputpt, handle_script(s));
+	if(s->flags & HTTPD_CHUNKED) {
+	  s->flags &= ~HTTPD_FRAMING;
+	  if(!(s->flags & HTTPD_LAST)) {
+	    PT_WAIT_THREAD(&s->outputpt, send_last_chunk(s));
+	  }
+	}
+      } else {
+	PT_WAIT_THREAD(&s->outputpt,
+		       send_file(s));
+      }
     }
-  }
+  } while(s->flags & HTTPD_KEEPALIVE);
+
+  s->state |= STATE_CLOSE;
+  s->npending = 0;
   PSOCK_CLOSE(&s->sout);
   PT_END(&s->outputpt);
 }
 /*---------------------------------------------------------------------------*/
-static
-PT_THREAD(handle_input(struct httpd_state *s))
+static void
+get_etag(struct httpd_state *s, char *etag)
 {
-  PSOCK_BEGIN(&s->sin);
+  char *ptr, *end;
+  int len;
 
-  PSOCK_READTO(&s->sin, ISO_space);
-  
-  if(strncmp(s->inputbuf, http_get, 4) != 0) {
-    PSOCK_CLOSE_EXIT(&s->sin);
+  ptr = s->inputbuf + sizeof(http_if_none_match) - 1;
+  end = s->inputbuf + PSOCK_DATALEN(&s->sin);
+  while(ptr < end && *ptr == ISO_space) {
+    ++ptr;
   }
-  PSOCK_READTO(&s->sin, ISO_space);
-
-  if(s->inputbuf[0] != ISO_slash) {
-    PSOCK_CLOSE_EXIT(&s->sin);
+  len = 0;
+  while(ptr + len < end && len < (int)sizeof(s->etag) - 1 &&
+        ptr[len] != ISO_cr && ptr[len] != ISO_nl) {
+    ++len;
   }
+  memcpy(etag, ptr, len);
+  etag[len] = 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+parse_header(struct httpd_state *s)
+{
+  struct httpd_request *r = NEXT_REQUEST(s);
+  int len = PSOCK_DATALEN(&s->sin);
+  char partial = s->state & STATE_PARTIAL;
 
-  if(s->inputbuf[1] == ISO_space) {
-    strncpy(s->filename, http_index_html, sizeof(s->filename));
+  if(s->inputbuf[len - 1] == ISO_nl) {
+    s->state &= ~STATE_PARTIAL;
   } else {
-    s->inputbuf[PSOCK_DATALEN(&s->sin) - 1] = 0;
-    strncpy(s->filename, s->inputbuf, sizeof(s->filename));
+    s->state |= STATE_PARTIAL;
+  }
+  if(partial) {
+    /* The rest of a line that did not fit in inputbuf. */
+    return 0;
+  }
+
+  if(s->inputbuf[0] == ISO_cr || s->inputbuf[0] == ISO_nl) {
+    /* The empty line that ends the request. */
+    return 1;
   }
 
-  petsciiconv_topetscii(s->filename, sizeof(s->filename));
-  webserver_log_file(&uip_conn->ripaddr, s->filename);
-  petsciiconv_toascii(s->filename, sizeof(s->filename));
-  s->state = STATE_OUTPUT;
+  if(strncmp(s->inputbuf, http_referer, 8) == 0) {
+    s->inputbuf[len - 2] = 0;
+    petsciiconv_topetscii(s->inputbuf, len - 2);
+    webserver_log(s->inputbuf);
+  } else if(strncmp(s->inputbuf, http_if_none_match,
+                    sizeof(http_if_none_match) - 1) == 0) {
+    get_etag(s, r->etag);
+  } else if(strncmp(s->inputbuf, http_connection,
+                    sizeof(http_connection) - 1) == 0) {
+    s->inputbuf[len] = 0;
+    if(strstr(s->inputbuf, http_close) != NULL) {
+      r->flags &= ~HTTPD_KEEPALIVE;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static
+PT_THREAD(handle_input(struct httpd_state *s))
+{
+  PSOCK_BEGIN(&s->sin);
 
+  /* Pipelined requests are parsed as they arrive and queued until
+     the responses to the requests before them have been sent. */
   while(1) {
-    PSOCK_READTO(&s->sin, ISO_nl);
+    PSOCK_READTO(&s->sin, ISO_space);
+  
+    if(strncmp(s->inputbuf, http_get, 4) != 0) {
+      PSOCK_CLOSE_EXIT(&s->sin);
+    }
+
+    if(s->npending == HTTPD_PIPELINE) {
+      /* There is no room for this request. The queued requests are
+	 answered and the connection is closed, and the client sends
+	 the rest of its requests again on a new connection. */
+      s->state |= STATE_CLOSE;
+      PSOCK_EXIT(&s->sin);
+    }
 
-    if(strncmp(s->inputbuf, http_referer, 8) == 0) {
-      s->inputbuf[PSOCK_DATALEN(&s->sin) - 2] = 0;
-      petsciiconv_topetscii(s->inputbuf, PSOCK_DATALEN(&s->sin) - 2);
-      webserver_log(s->inputbuf);
+    PSOCK_READTO(&s->sin, ISO_space);
+
+    if(s->inputbuf[0] != ISO_slash) {
+      PSOCK_CLOSE_EXIT(&s->sin);
+    }
+
+    if(s->inputbuf[1] == ISO_space) {
+      strncpy(NEXT_REQUEST(s)->filename, http_index_html,
+	      sizeof(s->filename));
+    } else {
+      s->inputbuf[PSOCK_DATALEN(&s->sin) - 1] = 0;
+      strncpy(NEXT_REQUEST(s)->filename, s->inputbuf, sizeof(s->filename));
     }
+
+    petsciiconv_topetscii(NEXT_REQUEST(s)->filename, sizeof(s->filename));
+    webserver_log_file(&uip_conn->ripaddr, NEXT_REQUEST(s)->filename);
+    petsciiconv_toascii(NEXT_REQUEST(s)->filename, sizeof(s->filename));
+
+    /* HTTP/1.1 connections are persistent unless the client asks
+       for them to be closed. */
+    PSOCK_READTO(&s->sin, ISO_nl);
+    if(strncmp(s->inputbuf, http_11, 8) == 0) {
+      NEXT_REQUEST(s)->flags = HTTPD_KEEPALIVE;
+    } else {
+      NEXT_REQUEST(s)->flags = 0;
+    }
+    NEXT_REQUEST(s)->etag[0] = 0;
+
+    s->state &= ~STATE_PARTIAL;
+    do {
+      PSOCK_READTO(&s->sin, ISO_nl);
+    } while(!parse_header(s));
+
+    ++s->npending;
   }
   
   PSOCK_END(&s->sin);
@@ -290,10 +651,10 @@ PT_THREAD(handle_input(struct httpd_state *s))
 static void
 handle_connection(struct httpd_state *s)
 {
-  handle_input(s);
-  if(s->state == STATE_OUTPUT) {
-    handle_output(s);
+  if(!(s->state & STATE_CLOSE)) {
+    handle_input(s);
   }
+  handle_output(s);
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -315,7 +676,10 @@ httpd_appcall(void *state)
     PSOCK_INIT(&s->sin, (uint8_t *)s->inputbuf, sizeof(s->inputbuf) - 1);
     PSOCK_INIT(&s->sout, (uint8_t *)s->inputbuf, sizeof(s->inputbuf) - 1);
     PT_INIT(&s->outputpt);
-    s->state = STATE_WAITING;
+    s->state = 0;
+    s->flags = 0;
+    s->first = 0;
+    s->npending = 0;
     /*    timer_set(&s->timer, CLOCK_SECOND * 100);*/
     s->timer = 0;
     handle_connection(s);
@@ -325,6 +689,7 @@ httpd_appcall(void *state)
       if(s->timer >= 20) {
 	uip_abort();
 	memb_free(&conns, s);
+	return;
       }
     } else {
       s->timer = 0;
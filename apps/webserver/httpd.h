@@ -38,13 +38,31 @@
 #include "contiki-net.h"
 #include "httpd-fs.h"
 
+/* The number of pipelined requests that can be queued on a
+   persistent connection while a response is sent. Must be at least 1. */
+#ifdef WEBSERVER_CONF_PIPELINE
+#define HTTPD_PIPELINE WEBSERVER_CONF_PIPELINE
+#else /* WEBSERVER_CONF_PIPELINE */
+#define HTTPD_PIPELINE 2
+#endif /* WEBSERVER_CONF_PIPELINE */
+
+struct httpd_request {
+  char filename[20];
+  char etag[11];
+  char flags;
+};
+
 struct httpd_state {
   unsigned char timer;
   struct psock sin, sout;
   struct pt outputpt, scriptpt;
   char inputbuf[50];
   char filename[20];
+  char etag[11];
+  char flags;
   char state;
+  struct httpd_request pending[HTTPD_PIPELINE];
+  unsigned char first, npending;
   struct httpd_fs_file file;  
   int len;
   char *scriptptr;
@@ -53,11 +71,44 @@ struct httpd_state {
     unsigned short count;
     void *ptr;
   } u;
+  unsigned short (*generator)(void *);
+  void *generator_arg;
+  const char *sendptr;
+  unsigned short sendlen, sentlen;
 };
 
+/*
+ * Script output on a persistent connection is sent in chunks, so the
+ * CGI functions send their output with these macros instead of
+ * PSOCK_SEND() and PSOCK_GENERATOR_SEND(), and their generators
+ * write at most httpd_mss() bytes into uip_appdata.
+ */
+#define HTTPD_GENERATOR_SEND(s, gen, arg)				\
+  do {									\
+    (s)->generator = (gen);						\
+    (s)->generator_arg = (arg);						\
+    PSOCK_GENERATOR_SEND(&(s)->sout, httpd_generate, (s));		\
+  } while(0)
+
+#define HTTPD_SEND(s, data, len)					\
+  do {									\
+    (s)->sendptr = (const char *)(data);				\
+    (s)->sendlen = (len);						\
+    while((s)->sendlen > 0) {						\
+      HTTPD_GENERATOR_SEND(s, httpd_generate_copy, (s));		\
+      (s)->sendptr += (s)->sentlen;					\
+      (s)->sendlen -= (s)->sentlen;					\
+    }									\
+  } while(0)
+
+#define HTTPD_SEND_STR(s, str) HTTPD_SEND(s, str, strlen(str))
+
 
 void httpd_init(void);
 void httpd_appcall(void *state);
+unsigned short httpd_mss(void);
+unsigned short httpd_generate(void *state);
+unsigned short httpd_generate_copy(void *state);
 
 #if UIP_CONF_IPV6
 uint8_t httpd_sprint_ip6(uip_ip6addr_t addr, char * result);
@@ -45,6 +45,11 @@
 #define AES_128_BLOCK_SIZE 16
 #define AES_128_KEY_LENGTH 16
 
+/*
+ * aes_128_driver is the compact byte-oriented software implementation.
+ * aes_128_ttable_driver is a faster table-driven software
+ * implementation that needs 1 KB more ROM.
+ */
 #ifdef AES_128_CONF
 #define AES_128            AES_128_CONF
 #else /* AES_128_CONF */
@@ -78,5 +83,7 @@ void aes_128_padded_encrypt(uint8_t *plaintext_and_result, uint8_t plaintext_len
 void aes_128_set_padded_key(uint8_t *key, uint8_t key_len);
 
 extern const struct aes_128_driver AES_128;
+extern const struct aes_128_driver aes_128_driver;
+extern const struct aes_128_driver aes_128_ttable_driver;
 
 #endif /* AES_H_ */
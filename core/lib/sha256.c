@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2015, EasyRF.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *         SHA-256 message digest.
+ */
+
+#include "lib/sha256.h"
+#include <string.h>
+
+static const uint32_t k[64] = {
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+  0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+  0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+  0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+  0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+  0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+  0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+  0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+  0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+  0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+  0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+  0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+  0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+  0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+#define ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+/*---------------------------------------------------------------------------*/
+static void
+transform(struct sha256_state *state)
+{
+  uint32_t w[16];
+  uint32_t v[8];
+  uint32_t s0, s1, t1, t2;
+  uint8_t i;
+
+  for(i = 0; i < 16; i++) {
+    w[i] = ((uint32_t)state->buf[4 * i] << 24) |
+      ((uint32_t)state->buf[4 * i + 1] << 16) |
+      ((uint32_t)state->buf[4 * i + 2] << 8) |
+      state->buf[4 * i + 3];
+  }
+  memcpy(v, state->h, sizeof(v));
+
+  for(i = 0; i < 64; i++) {
+    if(i >= 16) {
+      /* Extend the message schedule in the 16-word window. */
+      s0 = w[(i + 1) & 15];
+      s0 = ROTR(s0, 7) ^ ROTR(s0, 18) ^ (s0 >> 3);
+      s1 = w[(i + 14) & 15];
+      s1 = ROTR(s1, 17) ^ ROTR(s1, 19) ^ (s1 >> 10);
+      w[i & 15] += s0 + s1 + w[(i + 9) & 15];
+    }
+    t1 = v[7] + (ROTR(v[4], 6) ^ ROTR(v[4], 11) ^ ROTR(v[4], 25)) +
+      ((v[4] & v[5]) ^ (~v[4] & v[6])) + k[i] + w[i & 15];
+    t2 = (ROTR(v[0], 2) ^ ROTR(v[0], 13) ^ ROTR(v[0], 22)) +
+      ((v[0] & v[1]) ^ (v[0] & v[2]) ^ (v[1] & v[2]));
+    memmove(&v[1], &v[0], 7 * sizeof(v[0]));
+    v[4] += t1;
+    v[0] = t1 + t2;
+  }
+
+  for(i = 0; i < 8; i++) {
+    state->h[i] += v[i];
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+sha256_init(struct sha256_state *state)
+{
+  state->h[0] = 0x6a09e667;
+  state->h[1] = 0xbb67ae85;
+  state->h[2] = 0x3c6ef372;
+  state->h[3] = 0xa54ff53a;
+  state->h[4] = 0x510e527f;
+  state->h[5] = 0x9b05688c;
+  state->h[6] = 0x1f83d9ab;
+  state->h[7] = 0x5be0cd19;
+  state->length = 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+sha256_update(struct sha256_state *state, const uint8_t *data, uint16_t len)
+{
+  uint8_t used, n;
+
+  while(len > 0) {
+    used = state->length % SHA256_BLOCK_SIZE;
+    n = SHA256_BLOCK_SIZE - used;
+    if(n > len) {
+      n = len;
+    }
+    memcpy(&state->buf[used], data, n);
+    state->length += n;
+    data += n;
+    len -= n;
+    if(used + n == SHA256_BLOCK_SIZE) {
+      transform(state);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+sha256_finish(struct sha256_state *state, uint8_t digest[SHA256_DIGEST_LENGTH])
+{
+  uint32_t bits;
+  uint8_t used, i;
+
+  bits = state->length << 3;
+  used = state->length % SHA256_BLOCK_SIZE;
+  state->buf[used++] = 0x80;
+  if(used > SHA256_BLOCK_SIZE - 8) {
+    memset(&state->buf[used], 0, SHA256_BLOCK_SIZE - used);
+    transform(state);
+    used = 0;
+  }
+  memset(&state->buf[used], 0, SHA256_BLOCK_SIZE - 4 - used);
+  state->buf[SHA256_BLOCK_SIZE - 4] = bits >> 24;
+  state->buf[SHA256_BLOCK_SIZE - 3] = bits >> 16;
+  state->buf[SHA256_BLOCK_SIZE - 2] = bits >> 8;
+  state->buf[SHA256_BLOCK_SIZE - 1] = bits;
+  transform(state);
+
+  for(i = 0; i < SHA256_DIGEST_LENGTH; i++) {
+    digest[i] = state->h[i / 4] >> (24 - 8 * (i % 4));
+  }
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2015, EasyRF.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *         SHA-256 message digest (FIPS 180-4).
+ *
+ *         The message schedule is computed in place in a 16-word
+ *         window, so that hashing needs little stack.
+ */
+
+#ifndef SHA256_H_
+#define SHA256_H_
+
+#include <stdint.h>
+
+#define SHA256_DIGEST_LENGTH 32
+#define SHA256_BLOCK_SIZE    64
+
+struct sha256_state {
+  uint32_t h[8];
+  uint32_t length;
+  uint8_t buf[SHA256_BLOCK_SIZE];
+};
+
+/**
+ * \brief Starts a new digest.
+ */
+void sha256_init(struct sha256_state *state);
+
+/**
+ * \brief Adds data to the digest.
+ */
+void sha256_update(struct sha256_state *state,
+                   const uint8_t *data, uint16_t len);
+
+/**
+ * \brief Finishes the digest and writes it to digest.
+ *
+ * The message can be at most 512 MB long.
+ */
+void sha256_finish(struct sha256_state *state,
+                   uint8_t digest[SHA256_DIGEST_LENGTH]);
+
+#endif /* SHA256_H_ */
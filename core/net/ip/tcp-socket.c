@@ -35,6 +35,7 @@
 #include "lib/list.h"
 
 #include "tcp-socket.h"
+#include "net/ip/uip-window.h"
 
 #include <stdio.h>
 #include <string.h>
@@ -53,72 +54,160 @@ call_event(struct tcp_socket *s, tcp_socket_event_t event)
   }
 }
 /*---------------------------------------------------------------------------*/
+static uint16_t
+wrap(uint32_t pos, uint16_t maxlen)
+{
+  return pos >= maxlen ? pos - maxlen : pos;
+}
+/*---------------------------------------------------------------------------*/
 static void
 senddata(struct tcp_socket *s)
 {
   int len;
-
-  if(s->output_data_len > 0) {
-    len = MIN(s->output_data_len, uip_mss());
+  uint16_t offset, pos;
+
+  /* The output buffer is circular. It holds the data in flight,
+     starting at output_data_start, followed by the data not yet
+     sent. */
+  offset = 0;
+#if UIP_TCP_SLIDING_WINDOW
+  if(uip_window_enabled(uip_conn) && !uip_rexmit()) {
+    offset = uip_unacked();
+  }
+#endif /* UIP_TCP_SLIDING_WINDOW */
+
+  if(s->output_data_len > offset) {
+    /* A segment never wraps around the end of the buffer, so that it
+       can be sent without first being copied together. */
+    pos = wrap(s->output_data_start + offset, s->output_data_maxlen);
+    len = MIN(s->output_data_len - offset, uip_mss());
+    len = MIN(len, s->output_data_maxlen - pos);
     s->output_data_send_nxt = len;
-    uip_send(s->output_data_ptr, len);
+    uip_send(&s->output_data_ptr[pos], len);
   }
 }
 /*---------------------------------------------------------------------------*/
 static void
 acked(struct tcp_socket *s)
 {
-  if(s->output_data_len > 0) {
-    /* Copy the data in the outputbuf down and update outputbufptr and
-       outputbuf_lastsent */
+#if UIP_TCP_SLIDING_WINDOW
+  if(uip_window_enabled(uip_conn)) {
+    s->output_data_send_nxt = uip_acked_len();
+  }
+#endif /* UIP_TCP_SLIDING_WINDOW */
 
-    if(s->output_data_send_nxt > 0) {
-      memcpy(&s->output_data_ptr[0],
-       &s->output_data_ptr[s->output_data_send_nxt],
-       s->output_data_maxlen - s->output_data_send_nxt);
-    }
+  if(s->output_data_len > 0) {
+    /* The acknowledged data is dropped by moving the start of the
+       output buffer past it. */
     if(s->output_data_len < s->output_data_send_nxt) {
       printf("tcp: acked assertion failed s->output_data_len (%d) < s->output_data_send_nxt (%d)\n",
        s->output_data_len,
        s->output_data_send_nxt);
+      s->output_data_send_nxt = s->output_data_len;
     }
+    s->output_data_start = wrap(s->output_data_start +
+                                s->output_data_send_nxt,
+                                s->output_data_maxlen);
     s->output_data_len -= s->output_data_send_nxt;
     s->output_data_send_nxt = 0;
+    if(s->output_data_len == 0) {
+      s->output_data_start = 0;
+    }
 
     call_event(s, TCP_SOCKET_DATA_SENT);
   }
 }
 /*---------------------------------------------------------------------------*/
 static void
-newdata(struct tcp_socket *s)
+reverse(uint8_t *p, uint16_t len)
 {
-  uint16_t len, copylen, bytesleft;
-  uint8_t *dataptr;
-  len = uip_datalen();
-  dataptr = uip_appdata;
+  uint8_t *q, tmp;
 
-  /* We have a segment with data coming in. We copy as much data as
-     possible into the input buffer and call the input callback
-     function. The input callback returns the number of bytes that
-     should be retained in the buffer, or zero if all data should be
-     consumed. If there is data to be retained, the highest bytes of
-     data are copied down into the input buffer. */
-  do {
-    copylen = MIN(len, s->input_data_maxlen);
-    memcpy(s->input_data_ptr, dataptr, copylen);
+  if(len == 0) {
+    return;
+  }
+  for(q = p + len - 1; p < q; p++, q--) {
+    tmp = *p;
+    *p = *q;
+    *q = tmp;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+deliver(struct tcp_socket *s)
+{
+  uint16_t len;
+  int bytesleft;
+
+  /* Hand the data in the input buffer to the input callback, one
+     contiguous piece at a time. The callback returns the number of
+     bytes at the end of the piece to keep in the buffer. */
+  while(s->input_data_len > 0) {
+    len = MIN(s->input_data_len, s->input_data_maxlen - s->input_data_start);
     if(s->input_callback) {
       bytesleft = s->input_callback(s, s->ptr,
-            s->input_data_ptr, copylen);
+            &s->input_data_ptr[s->input_data_start], len);
     } else {
       bytesleft = 0;
     }
+    if(bytesleft < 0) {
+      bytesleft = 0;
+    } else if(bytesleft > len) {
+      bytesleft = len;
+    }
+    s->input_data_start = wrap(s->input_data_start + len - bytesleft,
+                               s->input_data_maxlen);
+    s->input_data_len -= len - bytesleft;
+
+    if(bytesleft == s->input_data_len) {
+      /* Nothing, or only the kept bytes, are left. */
+      break;
+    }
     if(bytesleft > 0) {
-      printf("tcp: newdata, bytesleft > 0 (%d) not implemented\n", bytesleft);
+      /* The kept bytes are at the end of the buffer and more data
+         follows at its start. Rotate the buffer in place so that the
+         callback gets them together. This only happens when a
+         message straddles the end of the buffer. */
+      reverse(s->input_data_ptr, s->input_data_start);
+      reverse(&s->input_data_ptr[s->input_data_start],
+              s->input_data_maxlen - s->input_data_start);
+      reverse(s->input_data_ptr, s->input_data_maxlen);
+      s->input_data_start = 0;
+    }
+  }
+  if(s->input_data_len == 0) {
+    s->input_data_start = 0;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+newdata(struct tcp_socket *s)
+{
+  uint16_t len, copylen, pos;
+  uint8_t *dataptr;
+  len = uip_datalen();
+  dataptr = uip_appdata;
+
+  /* We have a segment with data coming in. We copy as much data as
+     possible into the free space of the circular input buffer, after
+     any data that the input callback has asked us to keep, and
+     deliver it to the callback. */
+  while(len > 0) {
+    if(s->input_data_len == s->input_data_maxlen) {
+      printf("tcp: newdata, input buffer full, dropping %d bytes\n", len);
+      break;
     }
+    pos = wrap(s->input_data_start + s->input_data_len,
+               s->input_data_maxlen);
+    copylen = MIN(len, s->input_data_maxlen - s->input_data_len);
+    copylen = MIN(copylen, s->input_data_maxlen - pos);
+    memcpy(&s->input_data_ptr[pos], dataptr, copylen);
+    s->input_data_len += copylen;
     dataptr += copylen;
     len -= copylen;
 
-  } while(len > 0);
+    deliver(s);
+  }
 }
 /*---------------------------------------------------------------------------*/
 static void
@@ -160,6 +249,10 @@ appcall(void *state)
     if(s == NULL) {
       uip_abort();
     } else {
+      s->input_data_len = s->input_data_start = 0;
+#if UIP_TCP_SLIDING_WINDOW
+      uip_window_enable(uip_conn);
+#endif /* UIP_TCP_SLIDING_WINDOW */
       if(uip_newdata()) {
         newdata(s);
       }
@@ -255,6 +348,9 @@ tcp_socket_register(struct tcp_socket *s, void *ptr,
   s->input_data_maxlen = input_databuf_len;
   s->output_data_ptr = output_databuf;
   s->output_data_maxlen = output_databuf_len;
+  s->input_data_len = s->input_data_start = 0;
+  s->output_data_len = s->output_data_start = 0;
+  s->output_data_send_nxt = 0;
   s->input_callback = input_callback;
   s->event_callback = event_callback;
   list_add(socketlist, s);
@@ -313,6 +409,28 @@ tcp_socket_unlisten(struct tcp_socket *s)
   return 1;
 }
 /*---------------------------------------------------------------------------*/
+static int
+queue(struct tcp_socket *s, const uint8_t *data, int datalen)
+{
+  int len, copylen;
+  uint16_t pos;
+
+  /* Append the data at the end of the circular output buffer,
+     wrapping around to its start if needed. */
+  len = MIN(datalen, s->output_data_maxlen - s->output_data_len);
+  if(len <= 0) {
+    return 0;
+  }
+  pos = wrap(s->output_data_start + s->output_data_len,
+             s->output_data_maxlen);
+  copylen = MIN(len, s->output_data_maxlen - pos);
+  memcpy(&s->output_data_ptr[pos], data, copylen);
+  memcpy(&s->output_data_ptr[0], data + copylen, len - copylen);
+  s->output_data_len += len;
+
+  return len;
+}
+/*---------------------------------------------------------------------------*/
 int
 tcp_socket_send(struct tcp_socket *s,
          const uint8_t *data, int datalen)
@@ -323,10 +441,7 @@ tcp_socket_send(struct tcp_socket *s,
     return -1;
   }
 
-  len = MIN(datalen, s->output_data_maxlen - s->output_data_len);
-
-  memcpy(&s->output_data_ptr[s->output_data_len], data, len);
-  s->output_data_len += len;
+  len = queue(s, data, datalen);
 
   tcpip_poll_tcp(s->c);
 
@@ -334,6 +449,30 @@ tcp_socket_send(struct tcp_socket *s,
 }
 /*---------------------------------------------------------------------------*/
 int
+tcp_socket_send_iov(struct tcp_socket *s,
+             const struct tcp_socket_iov *iov, int iovcnt)
+{
+  int i, len, total;
+
+  if(s == NULL || (iov == NULL && iovcnt > 0)) {
+    return -1;
+  }
+
+  total = 0;
+  for(i = 0; i < iovcnt; i++) {
+    len = queue(s, iov[i].data, iov[i].len);
+    total += len;
+    if(len < iov[i].len) {
+      break;
+    }
+  }
+
+  tcpip_poll_tcp(s->c);
+
+  return total;
+}
+/*---------------------------------------------------------------------------*/
+int
 tcp_socket_send_str(struct tcp_socket *s,
              const char *str)
 {
@@ -57,6 +57,11 @@ typedef enum {
  *             function must return the amount of data to leave in the
  *             buffer. I.e., if the callback function consumes all
  *             incoming data, it should return 0.
+ *
+ *             The data that is left in the buffer is always the last
+ *             bytes of the data passed to the callback. It is passed
+ *             to the callback again, followed by the new data, when
+ *             more data arrives.
  */
 typedef int (* tcp_socket_data_callback_t)(struct tcp_socket *s,
                                            void *ptr,
@@ -92,8 +97,10 @@ struct tcp_socket {
 
   uint16_t input_data_maxlen;
   uint16_t input_data_len;
+  uint16_t input_data_start;
   uint16_t output_data_maxlen;
   uint16_t output_data_len;
+  uint16_t output_data_start;
   uint16_t output_data_send_nxt;
 
   uint8_t flags;
@@ -101,6 +108,14 @@ struct tcp_socket {
   struct uip_conn *c;
 };
 
+/**
+ * A piece of data to be sent with tcp_socket_send_iov().
+ */
+struct tcp_socket_iov {
+  const uint8_t *data;
+  int len;
+};
+
 enum {
   TCP_SOCKET_FLAGS_NONE      = 0x00,
   TCP_SOCKET_FLAGS_LISTENING = 0x01,
@@ -239,6 +254,24 @@ int tcp_socket_send(struct tcp_socket *s,
 int tcp_socket_send_str(struct tcp_socket *s,
                         const char *strptr);
 
+/**
+ * \brief      Send several pieces of data on a connected TCP socket
+ * \param s    A pointer to a TCP socket that must have been previously registered with tcp_socket_register()
+ * \param iov  An array of pieces of data to be sent
+ * \param iovcnt The number of pieces in the array
+ * \retval -1  If an error occurs
+ * \return     The number of bytes that were successfully sent
+ *
+ *             This function places the pieces of data, in order,
+ *             in the output buffer, as if they had been sent with
+ *             one tcp_socket_send() call each, but polls the
+ *             connection only once. If the output buffer fills up,
+ *             the remaining pieces are not sent.
+ */
+int tcp_socket_send_iov(struct tcp_socket *s,
+                        const struct tcp_socket_iov *iov,
+                        int iovcnt);
+
 /**
  * \brief      Close a connected TCP socket
  * \param s    A pointer to a TCP socket that must have been previously registered with tcp_socket_register()
@@ -41,6 +41,7 @@
 #include "contiki-net.h"
 #include "net/ip/uip-split.h"
 #include "net/ip/uip-packetqueue.h"
+#include "net/ip/uip-window.h"
 
 #if UIP_CONF_IPV6
 #include "net/ipv6/uip-nd6.h"
@@ -180,6 +181,27 @@ check_for_tcp_syn(void)
 #endif /* UIP_TCP || UIP_CONF_IP_FORWARD */
 }
 /*---------------------------------------------------------------------------*/
+#if UIP_TCP && UIP_TCP_SLIDING_WINDOW
+static void
+poll_open_windows(void)
+{
+  struct uip_conn *c;
+
+  /* uIP sends at most one segment each time it is called. Connections
+     in the sliding window mode that may send more are polled again. */
+  for(c = &uip_conns[0]; c <= &uip_conns[UIP_CONNS - 1]; ++c) {
+    if(c->window_flags & UIP_WINDOW_POLL) {
+      c->window_flags &= ~UIP_WINDOW_POLL;
+      if(c->tcpstateflags != UIP_CLOSED) {
+        tcpip_poll_tcp(c);
+      }
+    }
+  }
+}
+#else /* UIP_TCP && UIP_TCP_SLIDING_WINDOW */
+#define poll_open_windows()
+#endif /* UIP_TCP && UIP_TCP_SLIDING_WINDOW */
+/*---------------------------------------------------------------------------*/
 static void
 packet_input(void)
 {
@@ -204,6 +226,7 @@ packet_input(void)
       }
     }
     tcpip_is_forwarding = 0;
+    poll_open_windows();
   }
 #else /* UIP_CONF_IP_FORWARD */
   if(uip_len > 0) {
@@ -221,6 +244,7 @@ packet_input(void)
 #endif
 #endif /* UIP_CONF_TCP_SPLIT */
     }
+    poll_open_windows();
   }
 #endif /* UIP_CONF_IP_FORWARD */
 }
@@ -445,6 +469,7 @@ eventhandler(process_event_t ev, process_data_t data)
 #endif /* UIP_CONF_IPV6 */
             }
           }
+          poll_open_windows();
 #endif /* UIP_TCP */
 #if UIP_CONF_IP_FORWARD
           uip_fw_periodic();
@@ -499,6 +524,7 @@ eventhandler(process_event_t ev, process_data_t data)
           tcpip_output();
         }
 #endif /* UIP_CONF_IPV6 */
+        poll_open_windows();
         /* Start the periodic polling, if it isn't already active. */
         start_periodic_tcp_timer();
       }
@@ -0,0 +1,312 @@
+/*
+ * Copyright (c) 2015, EasyRF.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *	Congestion control and loss recovery for uIP TCP connections in
+ *	the sliding window mode.
+ */
+
+#include "net/ip/uip-window.h"
+
+#if UIP_TCP && UIP_TCP_SLIDING_WINDOW
+
+/* The number of duplicate ACKs that trigger a fast retransmit. */
+#define DUPACK_THRESHOLD 3
+
+/* The smallest retransmission timeout, in timer pulses. */
+#define MIN_RTO          2
+
+#define MAX_WINDOW       0xffff
+
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+
+uint16_t uip_ackedlen;
+/*---------------------------------------------------------------------------*/
+static uint32_t
+seq32(const uint8_t *seq)
+{
+  return (uint32_t)seq[0] << 24 | (uint32_t)seq[1] << 16 |
+         (uint32_t)seq[2] << 8 | seq[3];
+}
+/*---------------------------------------------------------------------------*/
+static void
+set_cwnd(struct uip_conn *conn, uint32_t cwnd)
+{
+  conn->cwnd = MIN(cwnd, MAX_WINDOW);
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+usable_window(struct uip_conn *conn)
+{
+  if(conn->snd_wnd == 0 && conn->len == 0) {
+    /* Probe a zero window with a full segment, as in the single
+       segment mode. */
+    return conn->initialmss;
+  }
+  return MIN(conn->cwnd, conn->snd_wnd);
+}
+/*---------------------------------------------------------------------------*/
+static void
+poll_if_open(struct uip_conn *conn)
+{
+  if(conn->len < usable_window(conn)) {
+    conn->window_flags |= UIP_WINDOW_POLL;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+update_rto(struct uip_conn *conn, uint8_t ticks)
+{
+  signed char m;
+
+  /* The same estimator as for single segments, but timed by the
+     number of timer pulses since the timed segment was sent. */
+  m = ticks > 127 ? 127 : ticks;
+  m = m - (conn->sa >> 3);
+  conn->sa += m;
+  if(m < 0) {
+    m = -m;
+  }
+  m = m - (conn->sv >> 2);
+  conn->sv += m;
+  conn->rto = (conn->sa >> 3) + conn->sv;
+  if(conn->rto < MIN_RTO) {
+    conn->rto = MIN_RTO;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+enter_recovery(struct uip_conn *conn, uint8_t flag)
+{
+  conn->ssthresh = MAX(conn->len / 2, 2 * conn->initialmss);
+  conn->recover = conn->len;
+  conn->window_flags &= ~(UIP_WINDOW_FAST_RECOVERY | UIP_WINDOW_RECOVERY);
+  conn->window_flags |= flag;
+  /* Do not time retransmitted segments. */
+  conn->rtt_len = 0;
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+duplicate_ack(struct uip_conn *conn)
+{
+  if(conn->dupacks < 0xff) {
+    conn->dupacks++;
+  }
+
+  if(conn->dupacks == DUPACK_THRESHOLD &&
+     !(conn->window_flags &
+       (UIP_WINDOW_FAST_RECOVERY | UIP_WINDOW_RECOVERY))) {
+    /* Fast retransmit. */
+    enter_recovery(conn, UIP_WINDOW_FAST_RECOVERY);
+    set_cwnd(conn, conn->ssthresh + 3UL * conn->initialmss);
+    UIP_STAT(++uip_stat.tcp.rexmit);
+    return UIP_REXMIT;
+  }
+
+  if(conn->dupacks > DUPACK_THRESHOLD &&
+     (conn->window_flags & UIP_WINDOW_FAST_RECOVERY)) {
+    /* Each further duplicate ACK means that a segment has left the
+       network, so a new one may be sent. */
+    set_cwnd(conn, (uint32_t)conn->cwnd + conn->initialmss);
+    poll_if_open(conn);
+  }
+
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+uip_window_enable(struct uip_conn *conn)
+{
+  conn->window_flags = UIP_WINDOW_ENABLED;
+  /* The initial window of RFC 3390. */
+  set_cwnd(conn, MIN(4UL * conn->initialmss,
+                     MAX(2UL * conn->initialmss, 4380)));
+  conn->ssthresh = MAX_WINDOW;
+  conn->snd_wnd = conn->mss;
+  conn->recover = 0;
+  conn->rtt_len = 0;
+  conn->dupacks = 0;
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+uip_window_input(struct uip_conn *conn, const uint8_t *ackno,
+                 uint16_t wnd, uint16_t seglen)
+{
+  uint32_t acked;
+  uint32_t seq;
+  uint16_t old_wnd;
+  uint8_t flags;
+
+  seq = seq32(conn->snd_nxt);
+  acked = seq32(ackno) - seq;
+  if(acked > conn->len) {
+    /* An old ACK, or an ACK for data that we have not sent. */
+    return 0;
+  }
+
+  old_wnd = conn->snd_wnd;
+  conn->snd_wnd = wnd;
+
+  if(acked == 0) {
+    if(conn->len > 0 && seglen == 0 && wnd == old_wnd) {
+      return duplicate_ack(conn);
+    }
+    if(wnd > old_wnd) {
+      poll_if_open(conn);
+    }
+    return 0;
+  }
+
+  seq += acked;
+  conn->snd_nxt[0] = seq >> 24;
+  conn->snd_nxt[1] = seq >> 16;
+  conn->snd_nxt[2] = seq >> 8;
+  conn->snd_nxt[3] = seq;
+  conn->len -= acked;
+  uip_ackedlen = acked;
+
+  conn->dupacks = 0;
+  conn->nrtx = 0;
+  conn->timer = conn->rto;
+
+  if(conn->rtt_len > 0) {
+    if(acked >= conn->rtt_len) {
+      update_rto(conn, conn->rtt_timer);
+      conn->timer = conn->rto;
+      conn->rtt_len = 0;
+    } else {
+      conn->rtt_len -= acked;
+    }
+  }
+
+  flags = UIP_ACKDATA;
+  if(conn->window_flags & UIP_WINDOW_FAST_RECOVERY) {
+    if(acked >= conn->recover) {
+      /* All data that was in flight when the loss was detected has
+         been acknowledged. */
+      conn->window_flags &= ~UIP_WINDOW_FAST_RECOVERY;
+      set_cwnd(conn, MIN(conn->ssthresh,
+                         (uint32_t)conn->len + conn->initialmss));
+    } else {
+      /* A partial ACK: the next segment was lost as well. Deflate
+         the window by the amount of new data acknowledged. */
+      conn->recover -= acked;
+      set_cwnd(conn, (conn->cwnd > acked ? conn->cwnd - acked : 0) +
+               (uint32_t)conn->initialmss);
+      flags |= UIP_REXMIT;
+    }
+    return flags;
+  }
+
+  if(conn->window_flags & UIP_WINDOW_RECOVERY) {
+    /* Recovering from a retransmission timeout: retransmit the
+       segments that were in flight one at a time, while the
+       congestion window grows in slow start. */
+    if(acked >= conn->recover) {
+      conn->window_flags &= ~UIP_WINDOW_RECOVERY;
+    } else {
+      conn->recover -= acked;
+      flags |= UIP_REXMIT;
+    }
+  }
+
+  if(conn->cwnd < conn->ssthresh) {
+    set_cwnd(conn, (uint32_t)conn->cwnd + MIN(acked, conn->initialmss));
+  } else {
+    set_cwnd(conn, (uint32_t)conn->cwnd +
+             MAX(1, (uint32_t)conn->initialmss * conn->initialmss /
+                 conn->cwnd));
+  }
+
+  return flags;
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+uip_window_send(struct uip_conn *conn, uint16_t len)
+{
+  uint16_t wnd;
+  uint16_t room;
+  uint16_t n;
+
+  wnd = usable_window(conn);
+  if(conn->len >= wnd) {
+    return 0;
+  }
+
+  room = wnd - conn->len;
+  n = MIN(MIN(len, room), conn->initialmss);
+  if(n < len && n < conn->initialmss && conn->len > 0) {
+    /* Wait for the window to open up for a full segment rather than
+       sending a small one. */
+    return 0;
+  }
+
+  if(conn->len == 0) {
+    conn->timer = conn->rto;
+  }
+  if(conn->rtt_len == 0) {
+    conn->rtt_len = conn->len + n;
+    conn->rtt_timer = 0;
+  }
+  conn->len += n;
+
+  /* The application may have more data, so ask for it if there is
+     room for another segment. */
+  poll_if_open(conn);
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+uip_window_rexmit(struct uip_conn *conn, uint16_t len)
+{
+  return MIN(MIN(len, conn->initialmss), conn->len);
+}
+/*---------------------------------------------------------------------------*/
+void
+uip_window_timeout(struct uip_conn *conn)
+{
+  enter_recovery(conn, UIP_WINDOW_RECOVERY);
+  conn->cwnd = conn->initialmss;
+  conn->dupacks = 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+uip_window_periodic(struct uip_conn *conn)
+{
+  if(conn->rtt_len > 0 && conn->rtt_timer < 0xff) {
+    conn->rtt_timer++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+#endif /* UIP_TCP && UIP_TCP_SLIDING_WINDOW */
@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2015, EasyRF.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \addtogroup uip
+ * @{
+ */
+
+/**
+ * \defgroup uipwindow uIP TCP sliding window
+ * @{
+ *
+ * The basic uIP TCP implementation only allows each TCP connection to
+ * have a single TCP segment in flight, and the application has to
+ * regenerate the data when it is retransmitted. Together with the
+ * delayed ACK algorithm of most TCP receivers, this limits the
+ * throughput of a connection to about one segment per delayed ACK
+ * timeout.
+ *
+ * The sliding window mode lets a connection have as much data in
+ * flight as the congestion window and the window of the receiver
+ * allow. It requires the application to keep all unacknowledged data
+ * in a buffer: new data is sent from uip_unacked() bytes into the
+ * buffer, and when uip_rexmit() is set, the data is sent from the
+ * start of the buffer. When uip_acked() is set, uip_acked_len() bytes
+ * have been acknowledged and can be removed from the buffer.
+ *
+ * The congestion window is managed with slow start and congestion
+ * avoidance, and lost segments are recovered with fast retransmit
+ * and the NewReno modification of fast recovery.
+ */
+
+/**
+ * \file
+ *	Sliding window mode for uIP TCP connections.
+ */
+
+#ifndef UIP_WINDOW_H_
+#define UIP_WINDOW_H_
+
+#include "net/ip/uip.h"
+
+#if UIP_TCP_SLIDING_WINDOW
+
+#define UIP_WINDOW_ENABLED       0x01
+#define UIP_WINDOW_FAST_RECOVERY 0x02
+#define UIP_WINDOW_RECOVERY      0x04
+#define UIP_WINDOW_CLOSING       0x08
+#define UIP_WINDOW_POLL          0x10
+
+extern uint16_t uip_ackedlen;
+
+/**
+ * The amount of data that was acknowledged by the remote host.
+ *
+ * Only valid when uip_acked() is non-zero on a connection in the
+ * sliding window mode.
+ *
+ * \hideinitializer
+ */
+#define uip_acked_len()          uip_ackedlen
+
+/**
+ * The amount of data that has been sent on the current connection
+ * but not yet acknowledged by the remote host.
+ *
+ * \hideinitializer
+ */
+#define uip_unacked()            (uip_conn->len)
+
+/**
+ * Check if a connection is in the sliding window mode.
+ *
+ * \hideinitializer
+ */
+#define uip_window_enabled(conn) ((conn)->window_flags & UIP_WINDOW_ENABLED)
+
+/**
+ * Put a connection in the sliding window mode.
+ *
+ * \param conn An established connection.
+ */
+void uip_window_enable(struct uip_conn *conn);
+
+/**
+ * \internal
+ *
+ * Process the acknowledgment number and the window of an incoming
+ * segment.
+ *
+ * \return UIP_ACKDATA if new data was acknowledged, and UIP_REXMIT
+ * if the oldest segment in flight should be retransmitted.
+ */
+uint8_t uip_window_input(struct uip_conn *conn, const uint8_t *ackno,
+                         uint16_t wnd, uint16_t seglen);
+
+/**
+ * \internal
+ *
+ * Get the amount of new data that can be sent out of the len bytes
+ * given by the application, and account for it as sent.
+ */
+uint16_t uip_window_send(struct uip_conn *conn, uint16_t len);
+
+/**
+ * \internal
+ *
+ * Get the amount of data to retransmit out of the len bytes given
+ * by the application.
+ */
+uint16_t uip_window_rexmit(struct uip_conn *conn, uint16_t len);
+
+/**
+ * \internal
+ *
+ * Update the congestion state after a retransmission timeout.
+ */
+void uip_window_timeout(struct uip_conn *conn);
+
+/**
+ * \internal
+ *
+ * Called for each connection on every periodic timer pulse.
+ */
+void uip_window_periodic(struct uip_conn *conn);
+
+#else /* UIP_TCP_SLIDING_WINDOW */
+
+#define uip_window_enabled(conn) 0
+
+#endif /* UIP_TCP_SLIDING_WINDOW */
+
+#endif /* UIP_WINDOW_H_ */
+
+/** @} */
+/** @} */
@@ -1359,6 +1359,20 @@ struct uip_conn {
   uint8_t timer;         /**< The retransmission timer. */
   uint8_t nrtx;          /**< The number of retransmissions for the last
 			 segment sent. */
+#if UIP_TCP_SLIDING_WINDOW
+  uint16_t cwnd;         /**< Congestion window, in bytes. */
+  uint16_t ssthresh;     /**< Slow start threshold, in bytes. */
+  uint16_t snd_wnd;      /**< The window last advertised by the remote
+			 host. */
+  uint16_t recover;      /**< Data that must be acknowledged to end the
+			 current loss recovery. */
+  uint16_t rtt_len;      /**< Data that must be acknowledged to complete
+			 the current round-trip time sample. */
+  uint8_t rtt_timer;     /**< Timer pulses since the round-trip time
+			 sample was started. */
+  uint8_t dupacks;       /**< The number of duplicate ACKs in a row. */
+  uint8_t window_flags;  /**< Sliding window mode flags. */
+#endif /* UIP_TCP_SLIDING_WINDOW */
 
   /** The application state. */
   uip_tcp_appstate_t appstate;
@@ -406,6 +406,25 @@ void uip_log(char *msg);
 #define UIP_ACTIVE_OPEN (UIP_CONF_ACTIVE_OPEN)
 #endif /* UIP_CONF_ACTIVE_OPEN */
 
+/**
+ * Determines if support for the TCP sliding window mode should be
+ * compiled in.
+ *
+ * In the sliding window mode, a connection can have several
+ * segments in flight, and the application is required to keep the
+ * unacknowledged data in a buffer so that it can be retransmitted.
+ * The mode is enabled for individual connections with
+ * uip_window_enable(). The tcp-socket module enables it for all its
+ * connections.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_TCP_SLIDING_WINDOW
+#define UIP_TCP_SLIDING_WINDOW (UIP_CONF_TCP_SLIDING_WINDOW)
+#else /* UIP_CONF_TCP_SLIDING_WINDOW */
+#define UIP_TCP_SLIDING_WINDOW 0
+#endif /* UIP_CONF_TCP_SLIDING_WINDOW */
+
 /**
  * The maximum number of simultaneously open TCP connections.
  *
@@ -43,9 +43,30 @@
 #define NUM_ENTRIES 32
 #endif /* IP64_ADDRMAP_CONF_ENTRIES */
 
+/* Number of buckets in each of the two hash indices: one keyed on the
+   IPv6 side flow (addresses, ports and protocol), one keyed on the
+   mapped port. By default there is a bucket for every two mappings,
+   so the chains stay short however many mappings are configured. */
+#ifdef IP64_ADDRMAP_CONF_HASH_SIZE
+#define HASH_SIZE IP64_ADDRMAP_CONF_HASH_SIZE
+#else /* IP64_ADDRMAP_CONF_HASH_SIZE */
+#define HASH_SIZE ((NUM_ENTRIES + 1) / 2)
+#endif /* IP64_ADDRMAP_CONF_HASH_SIZE */
+
+/* Aging timer wheel. Each slot holds the mappings that expire within
+   one WHEEL_TICK. Mappings whose lifetime is extended are not moved
+   until their slot comes up, so refreshing a mapping is cheap. */
+#define WHEEL_SLOTS 32
+#define WHEEL_TICK  (CLOCK_SECOND * 16)
+
 MEMB(entrymemb, struct ip64_addrmap_entry, NUM_ENTRIES);
 LIST(entrylist);
 
+static struct ip64_addrmap_entry *flow_table[HASH_SIZE];
+static struct ip64_addrmap_entry *port_table[HASH_SIZE];
+static struct ip64_addrmap_entry *wheel[WHEEL_SLOTS];
+static clock_time_t wheel_time;
+
 #define FIRST_MAPPED_PORT 10000
 #define LAST_MAPPED_PORT  20000
 static uint16_t mapped_port = FIRST_MAPPED_PORT;
@@ -64,25 +85,130 @@ ip64_addrmap_init(void)
 {
   memb_init(&entrymemb);
   list_init(entrylist);
+  memset(flow_table, 0, sizeof(flow_table));
+  memset(port_table, 0, sizeof(port_table));
+  memset(wheel, 0, sizeof(wheel));
+  wheel_time = clock_time() - clock_time() % WHEEL_TICK;
   mapped_port = FIRST_MAPPED_PORT;
 }
 /*---------------------------------------------------------------------------*/
+static unsigned
+flow_hash(const uip_ip6addr_t *ip6addr, uint16_t ip6port,
+          const uip_ip4addr_t *ip4addr, uint16_t ip4port,
+          uint8_t protocol)
+{
+  uint16_t h;
+
+  h = ip6addr->u16[6] ^ ip6addr->u16[7] ^
+    ip4addr->u16[0] ^ ip4addr->u16[1] ^
+    ip6port ^ (uint16_t)((ip4port << 5) | (ip4port >> 11)) ^ protocol;
+  return (h ^ (h >> 8)) % HASH_SIZE;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned
+port_hash(uint16_t port)
+{
+  return port % HASH_SIZE;
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+wheel_slot(clock_time_t time)
+{
+  return (time / WHEEL_TICK) % WHEEL_SLOTS;
+}
+/*---------------------------------------------------------------------------*/
+static clock_time_t
+expiration_time(struct ip64_addrmap_entry *m)
+{
+  return m->timer.start + m->timer.interval;
+}
+/*---------------------------------------------------------------------------*/
+static void
+wheel_add(struct ip64_addrmap_entry *m)
+{
+  m->wheel_slot = wheel_slot(expiration_time(m));
+  m->wheel_next = wheel[m->wheel_slot];
+  wheel[m->wheel_slot] = m;
+}
+/*---------------------------------------------------------------------------*/
+static void
+wheel_remove(struct ip64_addrmap_entry *m)
+{
+  struct ip64_addrmap_entry **p;
+
+  for(p = &wheel[m->wheel_slot]; *p != NULL; p = &(*p)->wheel_next) {
+    if(*p == m) {
+      *p = m->wheel_next;
+      return;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+free_entry(struct ip64_addrmap_entry *m)
+{
+  struct ip64_addrmap_entry **p;
+
+  for(p = &flow_table[flow_hash(&m->ip6addr, m->ip6port,
+                                &m->ip4addr, m->ip4port, m->protocol)];
+      *p != NULL; p = &(*p)->flow_next) {
+    if(*p == m) {
+      *p = m->flow_next;
+      break;
+    }
+  }
+  for(p = &port_table[port_hash(m->mapped_port)];
+      *p != NULL; p = &(*p)->port_next) {
+    if(*p == m) {
+      *p = m->port_next;
+      break;
+    }
+  }
+  list_remove(entrylist, m);
+  memb_free(&entrymemb, m);
+}
+/*---------------------------------------------------------------------------*/
+static void
+remove_entry(struct ip64_addrmap_entry *m)
+{
+  wheel_remove(m);
+  free_entry(m);
+}
+/*---------------------------------------------------------------------------*/
 static void
 check_age(void)
 {
-  struct ip64_addrmap_entry *m;
+  struct ip64_addrmap_entry *m, *next, **p;
+  uint8_t slot;
+  int processed;
 
-  /* Walk through the list of address mappings, throw away the ones
-     that are too old. */
-  m = list_head(entrylist);
-  while(m != NULL) {
-    if(timer_expired(&m->timer)) {
-      list_remove(entrylist, m);
-      memb_free(&entrymemb, m);
-      m = list_head(entrylist);
-    } else {
-      m = list_item_next(m);
+  /* Process the wheel slots that have passed since the last call. A
+     mapping found in a passed slot has either expired, or had its
+     lifetime extended and is moved to the slot of its new expiration
+     time. */
+  for(processed = 0;
+      clock_time() - wheel_time >= WHEEL_TICK && processed < WHEEL_SLOTS;
+      processed++) {
+    slot = wheel_slot(wheel_time);
+    p = &wheel[slot];
+    for(m = *p; m != NULL; m = next) {
+      next = m->wheel_next;
+      if(timer_expired(&m->timer)) {
+        *p = next;
+        free_entry(m);
+      } else if(wheel_slot(expiration_time(m)) != slot) {
+        *p = next;
+        wheel_add(m);
+      } else {
+        p = &m->wheel_next;
+      }
     }
+    wheel_time += WHEEL_TICK;
+  }
+
+  if(clock_time() - wheel_time >= WHEEL_TICK) {
+    /* All slots have been processed, catch up with the clock. */
+    wheel_time = clock_time() - clock_time() % WHEEL_TICK;
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -91,32 +217,34 @@ recycle(void)
 {
   /* Find the oldest recyclable mapping and remove it. */
   struct ip64_addrmap_entry *m, *oldest;
+  int i;
 
-  /* Walk through the list of address mappings, throw away the ones
-     that are too old. */
-
-  oldest = NULL;
-  for(m = list_head(entrylist);
-      m != NULL;
-      m = list_item_next(m)) {
-    if(m->flags & FLAGS_RECYCLABLE) {
-      if(oldest == NULL) {
+  /* Walk through the wheel in expiration order. Since mappings with
+     extended lifetimes are moved lazily, the first slot that contains
+     a recyclable mapping holds the oldest one or one close to it. */
+  for(i = 0; i < WHEEL_SLOTS; i++) {
+    oldest = NULL;
+    for(m = wheel[(wheel_slot(wheel_time) + i) % WHEEL_SLOTS];
+        m != NULL;
+        m = m->wheel_next) {
+      if(timer_expired(&m->timer)) {
         oldest = m;
-      } else {
-        if(timer_remaining(&m->timer) <
-           timer_remaining(&oldest->timer)) {
+        break;
+      }
+      if(m->flags & FLAGS_RECYCLABLE) {
+        if(oldest == NULL ||
+           timer_remaining(&m->timer) < timer_remaining(&oldest->timer)) {
           oldest = m;
         }
       }
     }
-  }
 
-  /* If we found an oldest recyclable entry, remove it and return
-     non-zero. */
-  if(oldest != NULL) {
-    list_remove(entrylist, oldest);
-    memb_free(&entrymemb, oldest);
-    return 1;
+    /* If we found an oldest recyclable entry, remove it and return
+       non-zero. */
+    if(oldest != NULL) {
+      remove_entry(oldest);
+      return 1;
+    }
   }
 
   return 0;
@@ -134,7 +262,8 @@ ip64_addrmap_lookup(const uip_ip6addr_t *ip6addr,
   printf("lookup ip4port %d ip6port %d\n", uip_htons(ip4port),
 	 uip_htons(ip6port));
   check_age();
-  for(m = list_head(entrylist); m != NULL; m = list_item_next(m)) {
+  for(m = flow_table[flow_hash(ip6addr, ip6port, ip4addr, ip4port, protocol)];
+      m != NULL; m = m->flow_next) {
     printf("protocol %d %d, ip4port %d %d, ip6port %d %d, ip4 %d ip6 %d\n",
 	   m->protocol, protocol,
 	   m->ip4port, ip4port,
@@ -146,6 +275,11 @@ ip64_addrmap_lookup(const uip_ip6addr_t *ip6addr,
        m->ip6port == ip6port &&
        uip_ip4addr_cmp(&m->ip4addr, ip4addr) &&
        uip_ip6addr_cmp(&m->ip6addr, ip6addr)) {
+      if(timer_expired(&m->timer)) {
+        /* Expired, but its wheel slot has not been processed yet. */
+        remove_entry(m);
+        return NULL;
+      }
       return m;
     }
   }
@@ -158,12 +292,16 @@ ip64_addrmap_lookup_port(uint16_t mapped_port, uint8_t protocol)
   struct ip64_addrmap_entry *m;
 
   check_age();
-  for(m = list_head(entrylist); m != NULL; m = list_item_next(m)) {
+  for(m = port_table[port_hash(mapped_port)]; m != NULL; m = m->port_next) {
     printf("mapped port %d %d, protocol %d %d\n",
 	   m->mapped_port, mapped_port,
 	   m->protocol, protocol);
     if(m->mapped_port == mapped_port &&
        m->protocol == protocol) {
+      if(timer_expired(&m->timer)) {
+        remove_entry(m);
+        return NULL;
+      }
       return m;
     }
   }
@@ -179,6 +317,19 @@ increase_mapped_port(void)
   }
 }
 /*---------------------------------------------------------------------------*/
+static struct ip64_addrmap_entry *
+port_in_use(uint16_t port)
+{
+  struct ip64_addrmap_entry *n;
+
+  for(n = port_table[port_hash(port)]; n != NULL; n = n->port_next) {
+    if(n->mapped_port == port) {
+      return n;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
 struct ip64_addrmap_entry *
 ip64_addrmap_create(const uip_ip6addr_t *ip6addr,
 		    uint16_t ip6port,
@@ -186,7 +337,8 @@ ip64_addrmap_create(const uip_ip6addr_t *ip6addr,
 		    uint16_t ip4port,
 		    uint8_t protocol)
 {
-  struct ip64_addrmap_entry *m;
+  struct ip64_addrmap_entry *m, *n;
+  unsigned h;
 
   check_age();
   m = memb_alloc(&entrymemb);
@@ -209,22 +361,25 @@ ip64_addrmap_create(const uip_ip6addr_t *ip6addr,
     /* Pick a new, unused local port. First make sure that the
        mapped_port number does not belong to any active connection. If
        so, we keep increasing the mapped_port until we're free. */
-    {
-      struct ip64_addrmap_entry *n;
-      n = list_head(entrylist);
-      while(n != NULL) {
-	if(n->mapped_port == mapped_port) {
-	  increase_mapped_port();
-	  n = list_head(entrylist);
-	} else {
-	  n = list_item_next(m);
-	}
+    while((n = port_in_use(mapped_port)) != NULL) {
+      if(timer_expired(&n->timer)) {
+        remove_entry(n);
+      } else {
+        increase_mapped_port();
       }
     }
     m->mapped_port = mapped_port;
     increase_mapped_port();
 
-    list_add(entrylist, m);
+    h = flow_hash(ip6addr, ip6port, ip4addr, ip4port, protocol);
+    m->flow_next = flow_table[h];
+    flow_table[h] = m;
+    h = port_hash(m->mapped_port);
+    m->port_next = port_table[h];
+    port_table[h] = m;
+    wheel_add(m);
+
+    list_push(entrylist, m);
     return m;
   }
   return NULL;
@@ -234,8 +389,22 @@ void
 ip64_addrmap_set_lifetime(struct ip64_addrmap_entry *e,
                           clock_time_t time)
 {
+  clock_time_t old_expiration, new_expiration;
+
   if(e != NULL) {
+    old_expiration = expiration_time(e);
     timer_set(&e->timer, time);
+    new_expiration = expiration_time(e);
+
+    /* An extended lifetime is picked up when the current slot of the
+       entry comes up. A shortened lifetime moves the entry to an
+       earlier slot right away so that it does not linger. */
+    if(wheel_slot(new_expiration) != e->wheel_slot &&
+       (clock_time_t)(old_expiration - new_expiration) <
+       (clock_time_t)(new_expiration - old_expiration)) {
+      wheel_remove(e);
+      wheel_add(e);
+    }
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -39,6 +39,12 @@
 #include <string.h>
 
 #define UIP_IP_BUF        ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
+#define IPV4_HDRLEN       20
+#define IPV4_BUF          (&uip_buf[UIP_LLH_LEN + UIP_IPH_LEN - IPV4_HDRLEN])
+#define ETH_BUF           (IPV4_BUF - sizeof(struct ip64_eth_hdr))
+/* An ARP request replaces a packet, and is built behind its IPv4
+   header, which holds the address to resolve. */
+#define ARP_BUF           (IPV4_BUF + IPV4_HDRLEN)
 
 #define DEBUG DEBUG_NONE
 #include "net/ip/uip-debug.h"
@@ -96,24 +102,25 @@ output(void)
   PRINTF("\n");
 
   printf("<--------------\n");
-  len = ip64_6to4(&uip_buf[UIP_LLH_LEN], uip_len,
-		  &ip64_packet_buffer[sizeof(struct ip64_eth_hdr)]);
+  /* The IPv4 header is 20 bytes shorter than the IPv6 header, so we
+     translate the packet in place in uip_buf and put the Ethernet
+     header right in front of the IPv4 header. This avoids copying the
+     packet into the ip64 packet buffer. */
+  len = ip64_6to4(&uip_buf[UIP_LLH_LEN], uip_len, IPV4_BUF);
 
   printf("ip64-interface: output len %d\n", len);
   if(len > 0) {
-    if(ip64_arp_check_cache(&ip64_packet_buffer[sizeof(struct ip64_eth_hdr)])) {
+    if(ip64_arp_check_cache(IPV4_BUF)) {
       printf("Create header\n");
-      ret = ip64_arp_create_ethhdr(ip64_packet_buffer,
-				   &ip64_packet_buffer[sizeof(struct ip64_eth_hdr)]);
+      ret = ip64_arp_create_ethhdr(ETH_BUF, IPV4_BUF);
       if(ret > 0) {
 	len += ret;
-	IP64_ETH_DRIVER.output(ip64_packet_buffer, len);
+	IP64_ETH_DRIVER.output(ETH_BUF, len);
       }
     } else {
       printf("Create request\n");
-      len = ip64_arp_create_arp_request(ip64_packet_buffer,
-					&ip64_packet_buffer[sizeof(struct ip64_eth_hdr)]);
-      IP64_ETH_DRIVER.output(ip64_packet_buffer, len);
+      len = ip64_arp_create_arp_request(ARP_BUF, IPV4_BUF);
+      IP64_ETH_DRIVER.output(ARP_BUF, len);
     }
   }
 }
@@ -55,6 +55,7 @@
 #include "ip64-addr.h"
 #include "ip64-addrmap.h"
 #include "ip64-conf.h"
+#include "ip64-eth.h"
 #include "ip64-special-ports.h"
 #include "ip64-eth-interface.h"
 #include "ip64-slip-interface.h"
@@ -145,10 +146,16 @@ struct icmpv6_hdr {
 
 #define BUFSIZE UIP_BUFSIZE
 
-uip_buf_t ip64_packet_buffer_aligned;
-uint8_t *ip64_packet_buffer = ip64_packet_buffer_aligned.u8;
+/* Incoming Ethernet frames are read straight into uip_buf, placed so
+   that the IPv4 payload already is where the IPv6 payload goes. The
+   translation into uip_buf then is zero-copy, and no second packet
+   sized buffer is needed. */
+#define PACKET_BUFFER_OFFSET (UIP_LLH_LEN + IPV6_HDRLEN - IPV4_HDRLEN - \
+                              sizeof(struct ip64_eth_hdr))
 
-uint16_t ip64_packet_buffer_maxlen = BUFSIZE;
+uint8_t *ip64_packet_buffer = &uip_buf[PACKET_BUFFER_OFFSET];
+
+uint16_t ip64_packet_buffer_maxlen = BUFSIZE - PACKET_BUFFER_OFFSET;
 
 static uip_ip4addr_t ip64_hostaddr;
 static uip_ip4addr_t ip64_netmask;
@@ -368,6 +375,54 @@ ipv6_transport_checksum(const uint8_t *packet, uint16_t len, uint8_t proto)
   return (sum == 0) ? 0xffff : uip_htons(sum);
 }
 /*---------------------------------------------------------------------------*/
+static uint16_t
+chksum_add(uint16_t sum, uint16_t val)
+{
+  sum += val;
+  if(sum < val) {
+    sum++;		/* carry */
+  }
+  return sum;
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+ipv4_pseudo_header_sum(const struct ipv4_hdr *hdr, uint16_t transport_len)
+{
+  uint16_t sum;
+
+  sum = chksum(transport_len + hdr->proto,
+               (uint8_t *)&hdr->srcipaddr, sizeof(uip_ip4addr_t));
+  return chksum(sum, (uint8_t *)&hdr->destipaddr, sizeof(uip_ip4addr_t));
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+ipv6_pseudo_header_sum(const struct ipv6_hdr *hdr, uint16_t transport_len)
+{
+  uint16_t sum;
+
+  sum = chksum(transport_len + hdr->nxthdr,
+               (uint8_t *)&hdr->srcipaddr, sizeof(uip_ip6addr_t));
+  return chksum(sum, (uint8_t *)&hdr->destipaddr, sizeof(uip_ip6addr_t));
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Incrementally update a transport layer checksum (RFC 1624). The
+ * checksum field itself is not covered by old_sum and new_sum, which
+ * are the sums of the pseudo-header and port fields before and after
+ * the translation.
+ */
+static uint16_t
+update_transport_checksum(uint16_t chksum_field,
+                          uint16_t old_sum, uint16_t new_sum)
+{
+  uint16_t sum;
+
+  sum = ~uip_ntohs(chksum_field);
+  sum = chksum_add(sum, ~old_sum);
+  sum = chksum_add(sum, new_sum);
+  return uip_htons((uint16_t)~sum);
+}
+/*---------------------------------------------------------------------------*/
 int
 ip64_6to4(const uint8_t *ipv6packet, const uint16_t ipv6packet_len,
     uint8_t *resultpacket)
@@ -379,9 +434,14 @@ ip64_6to4(const uint8_t *ipv6packet, const uint16_t ipv6packet_len,
   struct icmpv4_hdr *icmpv4hdr;
   struct icmpv6_hdr *icmpv6hdr;
   uint16_t ipv6len, ipv4len;
+  uint16_t old_sum;
+  struct ipv6_hdr v6hdr_copy;
   struct ip64_addrmap_entry *m;
 
-  v6hdr = (struct ipv6_hdr *)ipv6packet;
+  /* The IPv4 header may be written on top of the IPv6 header when
+     translating in place, so we work on a copy of the IPv6 header. */
+  memcpy(&v6hdr_copy, ipv6packet, IPV6_HDRLEN);
+  v6hdr = &v6hdr_copy;
   v4hdr = (struct ipv4_hdr *)resultpacket;
 
   if((v6hdr->len[0] << 8) + v6hdr->len[1] <= ipv6packet_len) {
@@ -391,16 +451,34 @@ ip64_6to4(const uint8_t *ipv6packet, const uint16_t ipv6packet_len,
     return 0;
   }
 
-  /* We copy the data from the IPv6 packet into the IPv4 packet. We do
-     not modify the data in any way. */
-  memcpy(&resultpacket[IPV4_HDRLEN],
-   &ipv6packet[IPV6_HDRLEN],
-   ipv6len - IPV6_HDRLEN);
+  /* We move the data from the IPv6 packet into the IPv4 packet. We do
+     not modify the data in any way. If the caller has placed the
+     result IPV6_HDRLEN - IPV4_HDRLEN bytes into the IPv6 packet, the
+     data already is in place and the translation is zero-copy. */
+  if(&resultpacket[IPV4_HDRLEN] != &ipv6packet[IPV6_HDRLEN]) {
+    memmove(&resultpacket[IPV4_HDRLEN],
+            &ipv6packet[IPV6_HDRLEN],
+            ipv6len - IPV6_HDRLEN);
+  }
 
   udphdr = (struct udp_hdr *)&resultpacket[IPV4_HDRLEN];
   tcphdr = (struct tcp_hdr *)&resultpacket[IPV4_HDRLEN];
   icmpv4hdr = (struct icmpv4_hdr *)&resultpacket[IPV4_HDRLEN];
-  icmpv6hdr = (struct icmpv6_hdr *)&ipv6packet[IPV6_HDRLEN];
+  icmpv6hdr = (struct icmpv6_hdr *)&resultpacket[IPV4_HDRLEN];
+
+  /* Sum of the fields covered by the transport layer checksum that
+     the translation changes: the pseudo-header and the port numbers. */
+  old_sum = chksum(ipv6_pseudo_header_sum(v6hdr, ipv6len - IPV6_HDRLEN),
+                   &resultpacket[IPV4_HDRLEN], 2 * sizeof(uint16_t));
+
+#if DEBUG
+  /* The transport layer checksum is updated incrementally, so a bad
+     checksum stays bad. We only check it for debugging purposes. */
+  if(chksum(ipv6_pseudo_header_sum(v6hdr, ipv6len - IPV6_HDRLEN),
+            &resultpacket[IPV4_HDRLEN], ipv6len - IPV6_HDRLEN) != 0xffff) {
+    PRINTF("ip64_6to4: bad transport layer checksum\n");
+  }
+#endif /* DEBUG */
 
   /* Translate the IPv6 header into an IPv4 header. */
 
@@ -434,27 +512,11 @@ ip64_6to4(const uint8_t *ipv6packet, const uint16_t ipv6packet_len,
   case IP_PROTO_TCP:
     PRINTF("ip64_6to4: TCP header\n");
     v4hdr->proto = IP_PROTO_TCP;
-
-    /* Compute and check the TCP checksum - since we're going to
-       recompute it ourselves, we must ensure that it was correct in
-       the first place. */
-    if(ipv6_transport_checksum(ipv6packet, ipv6len,
-                               IP_PROTO_TCP) != 0xffff) {
-      PRINTF("Bad TCP checksum, dropping packet\n");
-    }
-
     break;
 
   case IP_PROTO_UDP:
     PRINTF("ip64_6to4: UDP header\n");
     v4hdr->proto = IP_PROTO_UDP;
-    /* Compute and check the UDP checksum - since we're going to
-       recompute it ourselves, we must ensure that it was correct in
-       the first place. */
-    if(ipv6_transport_checksum(ipv6packet, ipv6len,
-                               IP_PROTO_UDP) != 0xffff) {
-      PRINTF("Bad UDP checksum, dropping packet\n");
-    }
     break;
 
   case IP_PROTO_ICMPV6:
@@ -611,14 +673,16 @@ ip64_6to4(const uint8_t *ipv6packet, const uint16_t ipv6packet_len,
      field. */
   switch(v4hdr->proto) {
   case IP_PROTO_TCP:
-    tcphdr->tcpchksum = 0;
-    tcphdr->tcpchksum = ~(ipv4_transport_checksum(resultpacket, ipv4len,
-              IP_PROTO_TCP));
+    tcphdr->tcpchksum =
+      update_transport_checksum(tcphdr->tcpchksum, old_sum,
+        chksum(ipv4_pseudo_header_sum(v4hdr, ipv4len - IPV4_HDRLEN),
+               (uint8_t *)tcphdr, 2 * sizeof(uint16_t)));
     break;
   case IP_PROTO_UDP:
-    udphdr->udpchksum = 0;
-    udphdr->udpchksum = ~(ipv4_transport_checksum(resultpacket, ipv4len,
-              IP_PROTO_UDP));
+    udphdr->udpchksum =
+      update_transport_checksum(udphdr->udpchksum, old_sum,
+        chksum(ipv4_pseudo_header_sum(v4hdr, ipv4len - IPV4_HDRLEN),
+               (uint8_t *)udphdr, 2 * sizeof(uint16_t)));
     if(udphdr->udpchksum == 0) {
       udphdr->udpchksum = 0xffff;
     }
@@ -650,10 +714,15 @@ ip64_4to6(const uint8_t *ipv4packet, const uint16_t ipv4packet_len,
   struct icmpv4_hdr *icmpv4hdr;
   struct icmpv6_hdr *icmpv6hdr;
   uint16_t ipv4len, ipv6len, ipv6_packet_len;
+  uint16_t old_sum, maxlen;
+  struct ipv4_hdr v4hdr_copy;
   struct ip64_addrmap_entry *m;
 
+  /* The IPv6 header may be written on top of the IPv4 header when
+     translating in place, so we work on a copy of the IPv4 header. */
+  memcpy(&v4hdr_copy, ipv4packet, IPV4_HDRLEN);
   v6hdr = (struct ipv6_hdr *)resultpacket;
-  v4hdr = (struct ipv4_hdr *)ipv4packet;
+  v4hdr = &v4hdr_copy;
 
   if((v4hdr->len[0] << 8) + v4hdr->len[1] <= ipv4packet_len) {
     ipv4len = (v4hdr->len[0] << 8) + v4hdr->len[1];
@@ -666,22 +735,38 @@ ip64_4to6(const uint8_t *ipv4packet, const uint16_t ipv4packet_len,
     return 0;
   }
 
-  /* Make sure that the resulting packet fits in the ip64 packet
-     buffer. If not, we drop it. */
-  if(ipv4len - IPV4_HDRLEN + IPV6_HDRLEN > BUFSIZE) {
+  /* Make sure that the resulting packet fits in the buffer. If not,
+     we drop it. The result usually is written into uip_buf after the
+     link layer header, and then only the rest of uip_buf is ours. */
+  if(resultpacket >= uip_buf && resultpacket < &uip_buf[BUFSIZE]) {
+    maxlen = BUFSIZE - (resultpacket - uip_buf);
+  } else {
+    maxlen = BUFSIZE;
+  }
+  if(ipv4len - IPV4_HDRLEN + IPV6_HDRLEN > maxlen) {
     PRINTF("ip64_4to6: packet too big to fit in buffer, dropping\n");
     return 0;
   }
-  /* We copy the data from the IPv4 packet into the IPv6 packet. */
-  memcpy(&resultpacket[IPV6_HDRLEN],
-   &ipv4packet[IPV4_HDRLEN],
-   ipv4len - IPV4_HDRLEN);
+  /* We move the data from the IPv4 packet into the IPv6 packet. If
+     the caller has placed the result IPV6_HDRLEN - IPV4_HDRLEN bytes
+     in front of the IPv4 packet, the data already is in place and the
+     translation is zero-copy. */
+  if(&resultpacket[IPV6_HDRLEN] != &ipv4packet[IPV4_HDRLEN]) {
+    memmove(&resultpacket[IPV6_HDRLEN],
+            &ipv4packet[IPV4_HDRLEN],
+            ipv4len - IPV4_HDRLEN);
+  }
 
   udphdr = (struct udp_hdr *)&resultpacket[IPV6_HDRLEN];
   tcphdr = (struct tcp_hdr *)&resultpacket[IPV6_HDRLEN];
-  icmpv4hdr = (struct icmpv4_hdr *)&ipv4packet[IPV4_HDRLEN];
+  icmpv4hdr = (struct icmpv4_hdr *)&resultpacket[IPV6_HDRLEN];
   icmpv6hdr = (struct icmpv6_hdr *)&resultpacket[IPV6_HDRLEN];
 
+  /* Sum of the fields covered by the transport layer checksum that
+     the translation changes: the pseudo-header and the port numbers. */
+  old_sum = chksum(ipv4_pseudo_header_sum(v4hdr, ipv4len - IPV4_HDRLEN),
+                   &resultpacket[IPV6_HDRLEN], 2 * sizeof(uint16_t));
+
   ipv6len = ipv4len - IPV4_HDRLEN + IPV6_HDRLEN;
   ipv6_packet_len = ipv6len - IPV6_HDRLEN;
 
@@ -831,16 +916,24 @@ ip64_4to6(const uint8_t *ipv4packet, const uint16_t ipv4packet_len,
      field. */
   switch(v6hdr->nxthdr) {
   case IP_PROTO_TCP:
-    tcphdr->tcpchksum = 0;
-    tcphdr->tcpchksum = ~(ipv6_transport_checksum(resultpacket,
-              ipv6len,
-              IP_PROTO_TCP));
+    tcphdr->tcpchksum =
+      update_transport_checksum(tcphdr->tcpchksum, old_sum,
+        chksum(ipv6_pseudo_header_sum(v6hdr, ipv6_packet_len),
+               (uint8_t *)tcphdr, 2 * sizeof(uint16_t)));
     break;
   case IP_PROTO_UDP:
-    udphdr->udpchksum = 0;
-    udphdr->udpchksum = ~(ipv6_transport_checksum(resultpacket,
-              ipv6len,
-              IP_PROTO_UDP));
+    if(udphdr->udpchksum == 0) {
+      /* The UDP checksum is optional in IPv4 but mandatory in IPv6,
+         so it has to be computed from scratch. */
+      udphdr->udpchksum = ~(ipv6_transport_checksum(resultpacket,
+                ipv6len,
+                IP_PROTO_UDP));
+    } else {
+      udphdr->udpchksum =
+        update_transport_checksum(udphdr->udpchksum, old_sum,
+          chksum(ipv6_pseudo_header_sum(v6hdr, ipv6_packet_len),
+                 (uint8_t *)udphdr, 2 * sizeof(uint16_t)));
+    }
     if(udphdr->udpchksum == 0) {
       udphdr->udpchksum = 0xffff;
     }
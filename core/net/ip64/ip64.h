@@ -53,6 +53,9 @@ void ip64_set_draddr(const uip_ip4addr_t *draddr);
 
 int ip64_hostaddr_is_configured(void);
 
+/* The buffer that Ethernet drivers receive frames into. It is a part
+   of uip_buf, so a frame must be passed to IP64_INPUT before uip_buf
+   is used again. */
 extern uint8_t *ip64_packet_buffer;
 extern uint16_t ip64_packet_buffer_maxlen;
 
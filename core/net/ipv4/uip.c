@@ -72,6 +72,7 @@
 
 #include "net/ip/uip.h"
 #include "net/ip/uipopt.h"
+#include "net/ip/uip-window.h"
 #include "net/ipv4/uip_arp.h"
 #include "net/ip/uip_arch.h"
 
@@ -180,6 +181,13 @@ static uint16_t lastport;       /* Keeps track of the last port used for
 uint8_t uip_acc32[4];
 static uint8_t c, opt;
 static uint16_t tmp16;
+#if UIP_TCP_SLIDING_WINDOW
+/* The length of the new data in the segment being sent, and whether
+   the segment is a retransmission, for connections in the sliding
+   window mode. */
+static uint16_t snd_seglen;
+static uint8_t snd_rexmit;
+#endif /* UIP_TCP_SLIDING_WINDOW */
 
 /* Structures and definitions. */
 #define TCP_FIN 0x01
@@ -451,6 +459,9 @@ uip_connect(uip_ipaddr_t *ripaddr, uint16_t rport)
   conn->rto = UIP_RTO;
   conn->sa = 0;
   conn->sv = 16;   /* Initial value of the RTT variance. */
+#if UIP_TCP_SLIDING_WINDOW
+  conn->window_flags = 0;
+#endif /* UIP_TCP_SLIDING_WINDOW */
   conn->lport = uip_htons(lastport);
   conn->rport = rport;
   uip_ipaddr_copy(&conn->ripaddr, ripaddr);
@@ -681,12 +692,17 @@ uip_process(uint8_t flag)
 #endif /* UIP_UDP */
 
   uip_sappdata = uip_appdata = &uip_buf[UIP_IPTCPH_LEN + UIP_LLH_LEN];
+#if UIP_TCP_SLIDING_WINDOW
+  snd_seglen = 0;
+  snd_rexmit = 0;
+#endif /* UIP_TCP_SLIDING_WINDOW */
 
   /* Check if we were invoked because of a poll request for a
      particular connection. */
   if(flag == UIP_POLL_REQUEST) {
     if((uip_connr->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED &&
-       !uip_outstanding(uip_connr)) {
+       (!uip_outstanding(uip_connr) || uip_window_enabled(uip_connr))) {
+	uip_slen = 0;
 	uip_flags = UIP_POLL;
 	UIP_APPCALL();
 	goto appsend;
@@ -734,6 +750,11 @@ uip_process(uint8_t flag)
       /* If the connection has outstanding data, we increase the
 	 connection's timer and see if it has reached the RTO value
 	 in which case we retransmit. */
+#if UIP_TCP_SLIDING_WINDOW
+      if(uip_window_enabled(uip_connr)) {
+	uip_window_periodic(uip_connr);
+      }
+#endif /* UIP_TCP_SLIDING_WINDOW */
 
       if(uip_outstanding(uip_connr)) {
 	if(uip_connr->timer-- == 0) {
@@ -785,6 +806,11 @@ uip_process(uint8_t flag)
                to do the actual retransmit after which we jump into
                the code for sending out the packet (the apprexmit
                label). */
+#if UIP_TCP_SLIDING_WINDOW
+	    if(uip_window_enabled(uip_connr)) {
+	      uip_window_timeout(uip_connr);
+	    }
+#endif /* UIP_TCP_SLIDING_WINDOW */
 	    uip_flags = UIP_REXMIT;
 	    UIP_APPCALL();
 	    goto apprexmit;
@@ -1362,6 +1388,9 @@ uip_process(uint8_t flag)
   uip_connr->sa = 0;
   uip_connr->sv = 4;
   uip_connr->nrtx = 0;
+#if UIP_TCP_SLIDING_WINDOW
+  uip_connr->window_flags = 0;
+#endif /* UIP_TCP_SLIDING_WINDOW */
   uip_connr->lport = BUF->destport;
   uip_connr->rport = BUF->srcport;
   uip_ipaddr_copy(&uip_connr->ripaddr, &BUF->srcipaddr);
@@ -1480,6 +1509,19 @@ uip_process(uint8_t flag)
      data. If so, we update the sequence number, reset the length of
      the outstanding data, calculate RTT estimations, and reset the
      retransmission timer. */
+#if UIP_TCP_SLIDING_WINDOW
+  if(uip_window_enabled(uip_connr) &&
+     (uip_connr->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED) {
+    /* A connection in the sliding window mode may have several
+       segments in flight, of which any number may be acknowledged. */
+    if(BUF->flags & TCP_ACK) {
+      uip_flags = uip_window_input(uip_connr, BUF->ackno,
+				   ((uint16_t)BUF->wnd[0] << 8) +
+				   BUF->wnd[1],
+				   uip_len);
+    }
+  } else
+#endif /* UIP_TCP_SLIDING_WINDOW */
   if((BUF->flags & TCP_ACK) && uip_outstanding(uip_connr)) {
     uip_add32(uip_connr->snd_nxt, uip_connr->len);
 
@@ -1705,7 +1747,7 @@ uip_process(uint8_t flag)
        put into the uip_appdata and the length of the data should be
        put into uip_len. If the application don't have any data to
        send, uip_len must be set to 0. */
-    if(uip_flags & (UIP_NEWDATA | UIP_ACKDATA)) {
+    if(uip_flags & (UIP_NEWDATA | UIP_ACKDATA | UIP_REXMIT)) {
       uip_slen = 0;
       UIP_APPCALL();
 
@@ -1718,6 +1760,20 @@ uip_process(uint8_t flag)
 	goto tcp_send_nodata;
       }
 
+#if UIP_TCP_SLIDING_WINDOW
+      if(uip_window_enabled(uip_connr)) {
+	if((uip_flags & UIP_CLOSE) && uip_outstanding(uip_connr)) {
+	  /* Send the FIN once all data in flight has been
+	     acknowledged. */
+	  uip_connr->window_flags |= UIP_WINDOW_CLOSING;
+	  uip_flags &= ~UIP_CLOSE;
+	} else if((uip_connr->window_flags & UIP_WINDOW_CLOSING) &&
+		  !uip_outstanding(uip_connr)) {
+	  uip_flags |= UIP_CLOSE;
+	}
+      }
+#endif /* UIP_TCP_SLIDING_WINDOW */
+
       if(uip_flags & UIP_CLOSE) {
 	uip_slen = 0;
 	uip_connr->len = 1;
@@ -1728,6 +1784,20 @@ uip_process(uint8_t flag)
       }
 
       /* If uip_slen > 0, the application has data to be sent. */
+#if UIP_TCP_SLIDING_WINDOW
+      if(uip_slen > 0 && uip_window_enabled(uip_connr)) {
+	/* New data is sent after the data in flight, as far as the
+	   congestion window and the receiver's window allow.
+	   Retransmissions are handled below. */
+	if(!(uip_flags & UIP_REXMIT)) {
+	  if(uip_connr->window_flags & UIP_WINDOW_CLOSING) {
+	    snd_seglen = 0;
+	  } else {
+	    snd_seglen = uip_window_send(uip_connr, uip_slen);
+	  }
+	}
+      } else
+#endif /* UIP_TCP_SLIDING_WINDOW */
       if(uip_slen > 0) {
 
 	/* If the connection has acknowledged data, the contents of
@@ -1759,10 +1829,30 @@ uip_process(uint8_t flag)
 	  uip_slen = uip_connr->len;
 	}
       }
-      uip_connr->nrtx = 0;
+      /* In the sliding window mode, nrtx is reset when new data is
+	 acknowledged. */
+      if(!uip_window_enabled(uip_connr)) {
+	uip_connr->nrtx = 0;
+      }
     apprexmit:
       uip_appdata = uip_sappdata;
 
+#if UIP_TCP_SLIDING_WINDOW
+      if(uip_window_enabled(uip_connr)) {
+	if((uip_flags & UIP_REXMIT) && uip_slen > 0) {
+	  /* Retransmit the oldest segment in flight. */
+	  snd_seglen = uip_window_rexmit(uip_connr, uip_slen);
+	  snd_rexmit = 1;
+	}
+	uip_slen = snd_seglen;
+	if(snd_seglen > 0) {
+	  uip_len = snd_seglen + UIP_TCPIP_HLEN;
+	  BUF->flags = TCP_ACK | TCP_PSH;
+	  goto tcp_send_noopts;
+	}
+      } else
+#endif /* UIP_TCP_SLIDING_WINDOW */
+
       /* If the application has data to be sent, or if the incoming
          packet had new data in it, we must send out a packet. */
       if(uip_slen > 0 && uip_connr->len > 0) {
@@ -1874,6 +1964,19 @@ uip_process(uint8_t flag)
   BUF->seqno[1] = uip_connr->snd_nxt[1];
   BUF->seqno[2] = uip_connr->snd_nxt[2];
   BUF->seqno[3] = uip_connr->snd_nxt[3];
+#if UIP_TCP_SLIDING_WINDOW
+  if(uip_window_enabled(uip_connr) &&
+     (uip_connr->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED &&
+     !snd_rexmit) {
+    /* All segments but retransmissions start after the data in
+       flight. */
+    uip_add32(uip_connr->snd_nxt, uip_connr->len - snd_seglen);
+    BUF->seqno[0] = uip_acc32[0];
+    BUF->seqno[1] = uip_acc32[1];
+    BUF->seqno[2] = uip_acc32[2];
+    BUF->seqno[3] = uip_acc32[3];
+  }
+#endif /* UIP_TCP_SLIDING_WINDOW */
 
   BUF->proto = UIP_PROTO_TCP;
 
@@ -66,6 +66,7 @@
 #include "net/rime/rime.h"
 #include "net/ipv6/sicslowpan.h"
 #include "net/netstack.h"
+#include "net/link-stats.h"
 
 #if UIP_CONF_IPV6
 
@@ -1309,6 +1310,8 @@ compress_hdr_ipv6(linkaddr_t *link_destaddr)
 static void
 packet_sent(void *ptr, int status, int transmissions)
 {
+  link_stats_packet_sent(packetbuf_addr(PACKETBUF_ADDR_RECEIVER),
+                         status, transmissions);
   uip_ds6_link_neighbor_callback(status, transmissions);
 
   if(callback != NULL) {
@@ -1606,6 +1609,7 @@ input(void)
   /* Save the RSSI of the incoming packet in case the upper layer will
      want to query us for it later. */
   last_rssi = (signed short)packetbuf_attr(PACKETBUF_ATTR_RSSI);
+  link_stats_input_callback(packetbuf_addr(PACKETBUF_ADDR_SENDER));
 #if SICSLOWPAN_CONF_FRAG
   /* if reassembly timed out, cancel it */
   if(timer_expired(&reass_timer)) {
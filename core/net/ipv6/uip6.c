@@ -72,6 +72,7 @@
 
 #include "net/ip/uip.h"
 #include "net/ip/uipopt.h"
+#include "net/ip/uip-window.h"
 #include "net/ipv6/uip-icmp6.h"
 #include "net/ipv6/uip-nd6.h"
 #include "net/ipv6/uip-ds6.h"
@@ -244,6 +245,13 @@ static uint8_t iss[4];
 uint8_t uip_acc32[4];
 static uint8_t opt;
 static uint16_t tmp16;
+#if UIP_TCP_SLIDING_WINDOW
+/* The length of the new data in the segment being sent, and whether
+   the segment is a retransmission, for connections in the sliding
+   window mode. */
+static uint16_t snd_seglen;
+static uint8_t snd_rexmit;
+#endif /* UIP_TCP_SLIDING_WINDOW */
 #endif /* UIP_TCP */
 /** @} */
 
@@ -501,6 +509,9 @@ uip_connect(uip_ipaddr_t *ripaddr, uint16_t rport)
   conn->rto = UIP_RTO;
   conn->sa = 0;
   conn->sv = 16;   /* Initial value of the RTT variance. */
+#if UIP_TCP_SLIDING_WINDOW
+  conn->window_flags = 0;
+#endif /* UIP_TCP_SLIDING_WINDOW */
   conn->lport = uip_htons(lastport);
   conn->rport = rport;
   uip_ipaddr_copy(&conn->ripaddr, ripaddr);
@@ -928,13 +939,18 @@ uip_process(uint8_t flag)
   }
 #endif /* UIP_UDP */
   uip_sappdata = uip_appdata = &uip_buf[UIP_IPTCPH_LEN + UIP_LLH_LEN];
+#if UIP_TCP && UIP_TCP_SLIDING_WINDOW
+  snd_seglen = 0;
+  snd_rexmit = 0;
+#endif /* UIP_TCP && UIP_TCP_SLIDING_WINDOW */
    
   /* Check if we were invoked because of a poll request for a
      particular connection. */
   if(flag == UIP_POLL_REQUEST) {
 #if UIP_TCP
     if((uip_connr->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED &&
-       !uip_outstanding(uip_connr)) {
+       (!uip_outstanding(uip_connr) || uip_window_enabled(uip_connr))) {
+      uip_slen = 0;
       uip_flags = UIP_POLL;
       UIP_APPCALL();
       goto appsend;
@@ -981,6 +997,11 @@ uip_process(uint8_t flag)
        * connection's timer and see if it has reached the RTO value
        * in which case we retransmit.
        */
+#if UIP_TCP_SLIDING_WINDOW
+      if(uip_window_enabled(uip_connr)) {
+        uip_window_periodic(uip_connr);
+      }
+#endif /* UIP_TCP_SLIDING_WINDOW */
       if(uip_outstanding(uip_connr)) {
         if(uip_connr->timer-- == 0) {
           if(uip_connr->nrtx == UIP_MAXRTX ||
@@ -1036,6 +1057,11 @@ uip_process(uint8_t flag)
                * the code for sending out the packet (the apprexmit
                * label).
                */
+#if UIP_TCP_SLIDING_WINDOW
+              if(uip_window_enabled(uip_connr)) {
+                uip_window_timeout(uip_connr);
+              }
+#endif /* UIP_TCP_SLIDING_WINDOW */
               uip_flags = UIP_REXMIT;
               UIP_APPCALL();
               goto apprexmit;
@@ -1711,6 +1737,9 @@ uip_process(uint8_t flag)
   uip_connr->sa = 0;
   uip_connr->sv = 4;
   uip_connr->nrtx = 0;
+#if UIP_TCP_SLIDING_WINDOW
+  uip_connr->window_flags = 0;
+#endif /* UIP_TCP_SLIDING_WINDOW */
   uip_connr->lport = UIP_TCP_BUF->destport;
   uip_connr->rport = UIP_TCP_BUF->srcport;
   uip_ipaddr_copy(&uip_connr->ripaddr, &UIP_IP_BUF->srcipaddr);
@@ -1838,6 +1867,19 @@ uip_process(uint8_t flag)
      data. If so, we update the sequence number, reset the length of
      the outstanding data, calculate RTT estimations, and reset the
      retransmission timer. */
+#if UIP_TCP_SLIDING_WINDOW
+  if(uip_window_enabled(uip_connr) &&
+     (uip_connr->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED) {
+    /* A connection in the sliding window mode may have several
+       segments in flight, of which any number may be acknowledged. */
+    if(UIP_TCP_BUF->flags & TCP_ACK) {
+      uip_flags = uip_window_input(uip_connr, UIP_TCP_BUF->ackno,
+                                   ((uint16_t)UIP_TCP_BUF->wnd[0] << 8) +
+                                   UIP_TCP_BUF->wnd[1],
+                                   uip_len);
+    }
+  } else
+#endif /* UIP_TCP_SLIDING_WINDOW */
   if((UIP_TCP_BUF->flags & TCP_ACK) && uip_outstanding(uip_connr)) {
     uip_add32(uip_connr->snd_nxt, uip_connr->len);
 
@@ -2063,7 +2105,7 @@ uip_process(uint8_t flag)
          put into the uip_appdata and the length of the data should be
          put into uip_len. If the application don't have any data to
          send, uip_len must be set to 0. */
-      if(uip_flags & (UIP_NEWDATA | UIP_ACKDATA)) {
+      if(uip_flags & (UIP_NEWDATA | UIP_ACKDATA | UIP_REXMIT)) {
         uip_slen = 0;
         UIP_APPCALL();
 
@@ -2076,6 +2118,20 @@ uip_process(uint8_t flag)
           goto tcp_send_nodata;
         }
 
+#if UIP_TCP_SLIDING_WINDOW
+        if(uip_window_enabled(uip_connr)) {
+          if((uip_flags & UIP_CLOSE) && uip_outstanding(uip_connr)) {
+            /* Send the FIN once all data in flight has been
+               acknowledged. */
+            uip_connr->window_flags |= UIP_WINDOW_CLOSING;
+            uip_flags &= ~UIP_CLOSE;
+          } else if((uip_connr->window_flags & UIP_WINDOW_CLOSING) &&
+                    !uip_outstanding(uip_connr)) {
+            uip_flags |= UIP_CLOSE;
+          }
+        }
+#endif /* UIP_TCP_SLIDING_WINDOW */
+
         if(uip_flags & UIP_CLOSE) {
           uip_slen = 0;
           uip_connr->len = 1;
@@ -2086,6 +2142,20 @@ uip_process(uint8_t flag)
         }
 
         /* If uip_slen > 0, the application has data to be sent. */
+#if UIP_TCP_SLIDING_WINDOW
+        if(uip_slen > 0 && uip_window_enabled(uip_connr)) {
+          /* New data is sent after the data in flight, as far as the
+             congestion window and the receiver's window allow.
+             Retransmissions are handled below. */
+          if(!(uip_flags & UIP_REXMIT)) {
+            if(uip_connr->window_flags & UIP_WINDOW_CLOSING) {
+              snd_seglen = 0;
+            } else {
+              snd_seglen = uip_window_send(uip_connr, uip_slen);
+            }
+          }
+        } else
+#endif /* UIP_TCP_SLIDING_WINDOW */
         if(uip_slen > 0) {
 
           /* If the connection has acknowledged data, the contents of
@@ -2117,9 +2187,29 @@ uip_process(uint8_t flag)
             uip_slen = uip_connr->len;
           }
         }
-        uip_connr->nrtx = 0;
+        /* In the sliding window mode, nrtx is reset when new data is
+           acknowledged. */
+        if(!uip_window_enabled(uip_connr)) {
+          uip_connr->nrtx = 0;
+        }
       apprexmit:
         uip_appdata = uip_sappdata;
+
+#if UIP_TCP_SLIDING_WINDOW
+        if(uip_window_enabled(uip_connr)) {
+          if((uip_flags & UIP_REXMIT) && uip_slen > 0) {
+            /* Retransmit the oldest segment in flight. */
+            snd_seglen = uip_window_rexmit(uip_connr, uip_slen);
+            snd_rexmit = 1;
+          }
+          uip_slen = snd_seglen;
+          if(snd_seglen > 0) {
+            uip_len = snd_seglen + UIP_TCPIP_HLEN;
+            UIP_TCP_BUF->flags = TCP_ACK | TCP_PSH;
+            goto tcp_send_noopts;
+          }
+        } else
+#endif /* UIP_TCP_SLIDING_WINDOW */
       
         /* If the application has data to be sent, or if the incoming
            packet had new data in it, we must send out a packet. */
@@ -2234,6 +2324,19 @@ uip_process(uint8_t flag)
   UIP_TCP_BUF->seqno[1] = uip_connr->snd_nxt[1];
   UIP_TCP_BUF->seqno[2] = uip_connr->snd_nxt[2];
   UIP_TCP_BUF->seqno[3] = uip_connr->snd_nxt[3];
+#if UIP_TCP_SLIDING_WINDOW
+  if(uip_window_enabled(uip_connr) &&
+     (uip_connr->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED &&
+     !snd_rexmit) {
+    /* All segments but retransmissions start after the data in
+       flight. */
+    uip_add32(uip_connr->snd_nxt, uip_connr->len - snd_seglen);
+    UIP_TCP_BUF->seqno[0] = uip_acc32[0];
+    UIP_TCP_BUF->seqno[1] = uip_acc32[1];
+    UIP_TCP_BUF->seqno[2] = uip_acc32[2];
+    UIP_TCP_BUF->seqno[3] = uip_acc32[3];
+  }
+#endif /* UIP_TCP_SLIDING_WINDOW */
 
   UIP_IP_BUF->proto = UIP_PROTO_TCP;
 
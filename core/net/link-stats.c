@@ -0,0 +1,239 @@
+/*
+ * Copyright (c) 2015, EasyRF.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *         Link statistics shared by the MAC, routing and collect layers
+ */
+
+#include "contiki.h"
+#include "sys/ctimer.h"
+#include "net/mac/mac.h"
+#include "net/packetbuf.h"
+#include "net/nbr-table.h"
+#include "net/link-stats.h"
+
+#define DEBUG 0
+#if DEBUG
+#include <stdio.h>
+#define PRINTF(...) printf(__VA_ARGS__)
+#else /* DEBUG */
+#define PRINTF(...)
+#endif /* DEBUG */
+
+/*
+ * The ETX is a plain average of the samples until LINK_STATS_ETX_WINDOW
+ * samples have been received, and an exponentially weighted moving
+ * average with weight 1 / LINK_STATS_ETX_WINDOW for new samples after
+ * that. This makes young estimates converge quickly while keeping
+ * established estimates stable.
+ */
+#ifdef LINK_STATS_CONF_ETX_WINDOW
+#define LINK_STATS_ETX_WINDOW LINK_STATS_CONF_ETX_WINDOW
+#else /* LINK_STATS_CONF_ETX_WINDOW */
+#define LINK_STATS_ETX_WINDOW 10
+#endif /* LINK_STATS_CONF_ETX_WINDOW */
+
+/* ETX sample used for a packet that was never acknowledged */
+#define ETX_NOACK_PENALTY 10
+
+/* RSSI range mapped linearly onto initial ETX values between 1 and
+   INIT_ETX_MAX. 0 is reported by radios without RSSI support and
+   carries no information. */
+#define RSSI_HIGH -60
+#define RSSI_LOW -90
+#define RSSI_UNKNOWN 0
+#define INIT_ETX_MAX 3
+
+/* Weight of a new RSSI sample, out of 4 */
+#define RSSI_ALPHA 1
+
+/* Freshness is increased by one per transmission and halved every
+   FRESHNESS_HALF_LIFE. A link is fresh when it has reached
+   FRESHNESS_TARGET and was used within FRESHNESS_EXPIRATION_TIME. */
+#define FRESHNESS_HALF_LIFE (20 * 60 * (clock_time_t)CLOCK_SECOND)
+#define FRESHNESS_TARGET 4
+#define FRESHNESS_MAX 16
+#define FRESHNESS_EXPIRATION_TIME (10 * 60 * (clock_time_t)CLOCK_SECOND)
+
+/* Per-neighbor link statistics */
+NBR_TABLE(struct link_stats, link_stats);
+
+static struct ctimer periodic_timer;
+/*---------------------------------------------------------------------------*/
+static uint16_t
+initial_etx(int16_t rssi)
+{
+#if LINK_STATS_INIT_ETX_FROM_RSSI
+  if(rssi != RSSI_UNKNOWN) {
+    if(rssi >= RSSI_HIGH) {
+      return LINK_STATS_ETX_DIVISOR;
+    }
+    if(rssi <= RSSI_LOW) {
+      return INIT_ETX_MAX * LINK_STATS_ETX_DIVISOR;
+    }
+    return LINK_STATS_ETX_DIVISOR +
+      (uint32_t)(RSSI_HIGH - rssi) * (INIT_ETX_MAX - 1) *
+      LINK_STATS_ETX_DIVISOR / (RSSI_HIGH - RSSI_LOW);
+  }
+#endif /* LINK_STATS_INIT_ETX_FROM_RSSI */
+  return LINK_STATS_INIT_ETX * LINK_STATS_ETX_DIVISOR;
+}
+/*---------------------------------------------------------------------------*/
+static struct link_stats *
+add_stats(const linkaddr_t *lladdr)
+{
+  struct link_stats *stats;
+
+  stats = nbr_table_get_from_lladdr(link_stats, lladdr);
+  if(stats == NULL) {
+    stats = nbr_table_add_lladdr(link_stats, lladdr);
+    if(stats != NULL) {
+      stats->rssi = RSSI_UNKNOWN;
+      stats->etx = initial_etx(RSSI_UNKNOWN);
+    }
+  }
+  return stats;
+}
+/*---------------------------------------------------------------------------*/
+const struct link_stats *
+link_stats_from_lladdr(const linkaddr_t *lladdr)
+{
+  return nbr_table_get_from_lladdr(link_stats, lladdr);
+}
+/*---------------------------------------------------------------------------*/
+int
+link_stats_is_fresh(const struct link_stats *stats)
+{
+  return stats != NULL
+    && stats->freshness >= FRESHNESS_TARGET
+    && clock_time() - stats->last_tx_time < FRESHNESS_EXPIRATION_TIME;
+}
+/*---------------------------------------------------------------------------*/
+void
+link_stats_packet_sent(const linkaddr_t *lladdr, int status, int numtx)
+{
+  struct link_stats *stats;
+  uint16_t packet_etx;
+
+  if(status != MAC_TX_OK && status != MAC_TX_NOACK) {
+    /* Do not penalize the ETX when collisions or transmission errors occur. */
+    return;
+  }
+
+  if(lladdr == NULL || linkaddr_cmp(lladdr, &linkaddr_null)) {
+    /* Broadcasts carry no link feedback */
+    return;
+  }
+
+  stats = add_stats(lladdr);
+  if(stats == NULL) {
+    return;
+  }
+
+  stats->last_tx_time = clock_time();
+  if(stats->freshness < FRESHNESS_MAX) {
+    stats->freshness++;
+  }
+
+  if(status == MAC_TX_NOACK) {
+    packet_etx = ETX_NOACK_PENALTY * LINK_STATS_ETX_DIVISOR;
+  } else {
+    packet_etx = numtx * LINK_STATS_ETX_DIVISOR;
+  }
+
+  if(stats->tx_count < LINK_STATS_ETX_WINDOW) {
+    /* The first sample replaces the initial guess */
+    stats->etx = ((uint32_t)stats->etx * stats->tx_count + packet_etx) /
+      (stats->tx_count + 1);
+    stats->tx_count++;
+  } else {
+    stats->etx = ((uint32_t)stats->etx * (LINK_STATS_ETX_WINDOW - 1) +
+                  packet_etx) / LINK_STATS_ETX_WINDOW;
+  }
+
+  PRINTF("link-stats: %d.%d ETX %u/%u after %d tx (status %d)\n",
+         lladdr->u8[0], lladdr->u8[1], stats->etx, LINK_STATS_ETX_DIVISOR,
+         numtx, status);
+}
+/*---------------------------------------------------------------------------*/
+void
+link_stats_input_callback(const linkaddr_t *lladdr)
+{
+  struct link_stats *stats;
+  int16_t packet_rssi;
+
+  if(lladdr == NULL) {
+    return;
+  }
+
+  packet_rssi = (int16_t)packetbuf_attr(PACKETBUF_ATTR_RSSI);
+
+  stats = add_stats(lladdr);
+  if(stats == NULL) {
+    return;
+  }
+
+  if(stats->rssi == RSSI_UNKNOWN) {
+    stats->rssi = packet_rssi;
+  } else if(packet_rssi != RSSI_UNKNOWN) {
+    stats->rssi = ((int32_t)stats->rssi * (4 - RSSI_ALPHA) +
+                   (int32_t)packet_rssi * RSSI_ALPHA) / 4;
+  }
+
+  if(stats->tx_count == 0) {
+    /* No transmission feedback yet: refine the guess from the RSSI */
+    stats->etx = initial_etx(stats->rssi);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+periodic(void *ptr)
+{
+  struct link_stats *stats;
+
+  /* Age the freshness of all links */
+  for(stats = nbr_table_head(link_stats); stats != NULL;
+      stats = nbr_table_next(link_stats, stats)) {
+    stats->freshness >>= 1;
+  }
+
+  ctimer_reset(&periodic_timer);
+}
+/*---------------------------------------------------------------------------*/
+void
+link_stats_init(void)
+{
+  nbr_table_register(link_stats, NULL);
+  ctimer_set(&periodic_timer, FRESHNESS_HALF_LIFE, periodic, NULL);
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2015, EasyRF.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *         Link statistics shared by the MAC, routing and collect layers
+ *
+ *         One entry is kept per neighbor in a neighbor table. The
+ *         expected number of transmissions (ETX) is maintained with a
+ *         moving average whose weight depends on the number of samples
+ *         seen so far, and is initialized from the received signal
+ *         strength before the first transmission to the neighbor.
+ */
+
+#ifndef LINK_STATS_H_
+#define LINK_STATS_H_
+
+#include "contiki.h"
+#include "net/linkaddr.h"
+
+/* ETX fixed point divisor */
+#define LINK_STATS_ETX_DIVISOR 128
+
+/* Initial ETX when nothing better is known about a link */
+#ifdef LINK_STATS_CONF_INIT_ETX
+#define LINK_STATS_INIT_ETX LINK_STATS_CONF_INIT_ETX
+#else /* LINK_STATS_CONF_INIT_ETX */
+#define LINK_STATS_INIT_ETX 2
+#endif /* LINK_STATS_CONF_INIT_ETX */
+
+/* Set to 1 to derive the initial ETX of a link from its RSSI */
+#ifdef LINK_STATS_CONF_INIT_ETX_FROM_RSSI
+#define LINK_STATS_INIT_ETX_FROM_RSSI LINK_STATS_CONF_INIT_ETX_FROM_RSSI
+#else /* LINK_STATS_CONF_INIT_ETX_FROM_RSSI */
+#define LINK_STATS_INIT_ETX_FROM_RSSI 1
+#endif /* LINK_STATS_CONF_INIT_ETX_FROM_RSSI */
+
+struct link_stats {
+  clock_time_t last_tx_time;  /* Last Tx timestamp */
+  uint16_t etx;               /* ETX using LINK_STATS_ETX_DIVISOR as fixed point divisor */
+  int16_t rssi;               /* RSSI (received signal strength) */
+  uint8_t freshness;          /* How up-to-date the ETX is */
+  uint8_t tx_count;           /* Number of ETX samples, saturating */
+};
+
+/**
+ * \brief      Get the link statistics of a neighbor
+ * \param lladdr The link-layer address of the neighbor
+ * \return     A pointer to the statistics, or NULL if none are kept
+ */
+const struct link_stats *link_stats_from_lladdr(const linkaddr_t *lladdr);
+
+/**
+ * \brief      Check whether the statistics of a link are up to date
+ * \param stats The link statistics
+ * \return     Non-zero if the ETX was recently updated often enough
+ *             to be trusted
+ */
+int link_stats_is_fresh(const struct link_stats *stats);
+
+/**
+ * \brief      Update the link statistics after a unicast transmission
+ * \param lladdr The link-layer address of the receiver
+ * \param status The MAC layer status of the transmission
+ * \param numtx The number of transmissions performed
+ */
+void link_stats_packet_sent(const linkaddr_t *lladdr, int status, int numtx);
+
+/**
+ * \brief      Update the link statistics after receiving a packet
+ * \param lladdr The link-layer address of the sender
+ *
+ *             The RSSI is read from the packetbuf attributes.
+ */
+void link_stats_input_callback(const linkaddr_t *lladdr);
+
+/**
+ * \brief      Initialize the link statistics module
+ */
+void link_stats_init(void);
+
+#endif /* LINK_STATS_H_ */
@@ -48,6 +48,12 @@
 #include "lib/aes-128.h"
 #include <string.h>
 
+#define MODE_MIC     0
+#define MODE_ENCRYPT 1
+#define MODE_DECRYPT 2
+
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+
 /*---------------------------------------------------------------------------*/
 static void
 set_nonce(uint8_t *nonce,
@@ -69,121 +75,152 @@ set_nonce(uint8_t *nonce,
   nonce[15] = counter;
 }
 /*---------------------------------------------------------------------------*/
-/* XORs the block m[pos] ... m[pos + 15] with K_{counter} */
 static void
-ctr_step(const uint8_t *extended_source_address,
-    uint8_t pos,
-    uint8_t *m_and_result,
-    uint8_t m_len,
-    uint8_t counter)
+xor_block(uint8_t *dst, const uint8_t *src, uint8_t len)
 {
-  uint8_t a[AES_128_BLOCK_SIZE];
   uint8_t i;
-  
-  set_nonce(a, CCM_ENCRYPTION_FLAGS, extended_source_address, counter);
-  AES_128.encrypt(a);
-  
-  for(i = 0; (pos + i < m_len) && (i < AES_128_BLOCK_SIZE); i++) {
-    m_and_result[pos + i] ^= a[i];
+
+  for(i = 0; i < len; i++) {
+    dst[i] ^= src[i];
   }
 }
 /*---------------------------------------------------------------------------*/
+/* Feeds the additional authentication data a[0] ... a[a_len - 1] into x */
 static void
-mic(const uint8_t *extended_source_address,
+mic_header(uint8_t *x, const uint8_t *a, uint8_t a_len)
+{
+  uint8_t pos;
+
+  if(!a_len) {
+    return;
+  }
+
+  x[1] ^= a_len;
+  xor_block(x + 2, a, MIN(a_len, AES_128_BLOCK_SIZE - 2));
+  AES_128.encrypt(x);
+
+  for(pos = AES_128_BLOCK_SIZE - 2; pos < a_len; pos += AES_128_BLOCK_SIZE) {
+    xor_block(x, a + pos, MIN(a_len - pos, AES_128_BLOCK_SIZE));
+    AES_128.encrypt(x);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Generates the MIC and, unless mode is MODE_MIC, en- or decrypts the
+ * payload. Each payload block is fed into the CBC-MAC and XORed with
+ * the key stream in the same pass over the frame.
+ */
+static void
+process(const uint8_t *extended_source_address,
     uint8_t *result,
-    uint8_t mic_len)
+    uint8_t mic_len,
+    uint8_t mode)
 {
   uint8_t x[AES_128_BLOCK_SIZE];
-  uint8_t pos;
-  uint8_t i;
+  uint8_t a[AES_128_BLOCK_SIZE];
+  uint8_t s[AES_128_BLOCK_SIZE];
   uint8_t a_len;
-  uint8_t *a;
-#if LLSEC802154_USES_ENCRYPTION
-  uint8_t shall_encrypt;
   uint8_t m_len;
   uint8_t *m;
-  
-  shall_encrypt = packetbuf_attr(PACKETBUF_ATTR_SECURITY_LEVEL) & (1 << 2);
-  if(shall_encrypt) {
+  uint8_t pos;
+  uint8_t len;
+  uint8_t i;
+
+#if LLSEC802154_USES_ENCRYPTION
+  if(packetbuf_attr(PACKETBUF_ATTR_SECURITY_LEVEL) & (1 << 2)) {
     a_len = packetbuf_hdrlen();
     m_len = packetbuf_datalen();
   } else {
     a_len = packetbuf_totlen();
     m_len = 0;
   }
-  set_nonce(x,
-      CCM_AUTH_FLAGS(a_len, mic_len),
-      extended_source_address,
-      m_len);
 #else /* LLSEC802154_USES_ENCRYPTION */
   a_len = packetbuf_totlen();
+  m_len = 0;
+#endif /* LLSEC802154_USES_ENCRYPTION */
+
   set_nonce(x,
       CCM_AUTH_FLAGS(a_len, mic_len),
       extended_source_address,
-      0);
-#endif /* LLSEC802154_USES_ENCRYPTION */
+      m_len);
   AES_128.encrypt(x);
-  
-  a = packetbuf_hdrptr();
-  if(a_len) {
-    x[1] = x[1] ^ a_len;
-    for(i = 2; (i - 2 < a_len) && (i < AES_128_BLOCK_SIZE); i++) {
-      x[i] ^= a[i - 2];
+  m = packetbuf_hdrptr();
+  mic_header(x, m, a_len);
+
+  /* The nonce is the same for all counter blocks */
+  set_nonce(a, CCM_ENCRYPTION_FLAGS, extended_source_address, 0);
+
+  m += a_len;
+  for(pos = 0; pos < m_len; pos += AES_128_BLOCK_SIZE) {
+    len = MIN(m_len - pos, AES_128_BLOCK_SIZE);
+    if(mode != MODE_MIC) {
+      a[AES_128_BLOCK_SIZE - 1]++;
+      memcpy(s, a, AES_128_BLOCK_SIZE);
+      AES_128.encrypt(s);
     }
-    
+    if(mode == MODE_DECRYPT) {
+      xor_block(m + pos, s, len);
+    }
+    xor_block(x, m + pos, len);
     AES_128.encrypt(x);
-    
-    pos = 14;
-    while(pos < a_len) {
-      for(i = 0; (pos + i < a_len) && (i < AES_128_BLOCK_SIZE); i++) {
-        x[i] ^= a[pos + i];
-      }
-      pos += AES_128_BLOCK_SIZE;
-      AES_128.encrypt(x);
+    if(mode == MODE_ENCRYPT) {
+      xor_block(m + pos, s, len);
     }
   }
-  
-#if LLSEC802154_USES_ENCRYPTION
-  if(shall_encrypt) {
-    m = a + a_len;
-    pos = 0;
-    while(pos < m_len) {
-      for(i = 0; (pos + i < m_len) && (i < AES_128_BLOCK_SIZE); i++) {
-        x[i] ^= m[pos + i];
-      }
-      pos += AES_128_BLOCK_SIZE;
-      AES_128.encrypt(x);
-    }
+
+  /* The MIC is encrypted with K_0 */
+  a[AES_128_BLOCK_SIZE - 1] = 0;
+  AES_128.encrypt(a);
+  for(i = 0; i < mic_len; i++) {
+    result[i] = x[i] ^ a[i];
   }
-#endif /* LLSEC802154_USES_ENCRYPTION */
-  
-  ctr_step(extended_source_address, 0, x, AES_128_BLOCK_SIZE, 0);
-  
-  memcpy(result, x, mic_len);
+}
+/*---------------------------------------------------------------------------*/
+static void
+mic(const uint8_t *extended_source_address,
+    uint8_t *result,
+    uint8_t mic_len)
+{
+  process(extended_source_address, result, mic_len, MODE_MIC);
 }
 /*---------------------------------------------------------------------------*/
 static void
 ctr(const uint8_t *extended_source_address)
 {
+  uint8_t a[AES_128_BLOCK_SIZE];
+  uint8_t s[AES_128_BLOCK_SIZE];
   uint8_t m_len;
   uint8_t *m;
   uint8_t pos;
-  uint8_t counter;
   
   m_len = packetbuf_datalen();
   m = (uint8_t *) packetbuf_dataptr();
   
-  pos = 0;
-  counter = 1;
-  while(pos < m_len) {
-    ctr_step(extended_source_address, pos, m, m_len, counter++);
-    pos += AES_128_BLOCK_SIZE;
+  set_nonce(a, CCM_ENCRYPTION_FLAGS, extended_source_address, 0);
+  for(pos = 0; pos < m_len; pos += AES_128_BLOCK_SIZE) {
+    a[AES_128_BLOCK_SIZE - 1]++;
+    memcpy(s, a, AES_128_BLOCK_SIZE);
+    AES_128.encrypt(s);
+    xor_block(m + pos, s, MIN(m_len - pos, AES_128_BLOCK_SIZE));
   }
 }
 /*---------------------------------------------------------------------------*/
+static void
+aead(const uint8_t *extended_source_address,
+    uint8_t *result,
+    uint8_t mic_len,
+    int forward)
+{
+  process(extended_source_address,
+      result,
+      mic_len,
+      forward ? MODE_ENCRYPT : MODE_DECRYPT);
+}
+/*---------------------------------------------------------------------------*/
 const struct ccm_driver ccm_driver = {
   mic,
-  ctr
+  ctr,
+  aead
 };
 /*---------------------------------------------------------------------------*/
 
@@ -76,6 +76,19 @@ struct ccm_driver {
    * \brief XORs the frame in the packetbuf with the key stream.
    */
   void (* ctr)(const uint8_t *extended_source_address);
+
+  /**
+   * \brief         Generates a MIC over the frame in the packetbuf and
+   *                en- or decrypts its payload in the same pass.
+   * \param result  The generated MIC will be put here
+   * \param mic_len  <= 16; set to LLSEC802154_MIC_LENGTH to be compliant
+   * \param forward 1 to encrypt an outgoing frame, 0 to decrypt an
+   *                incoming frame
+   */
+  void (* aead)(const uint8_t *extended_source_address,
+      uint8_t *result,
+      uint8_t mic_len,
+      int forward);
 };
 
 extern const struct ccm_driver CCM;
@@ -116,9 +116,10 @@ on_frame_created(void)
   dataptr = packetbuf_dataptr();
   data_len = packetbuf_datalen();
   
-  CCM.mic(get_extended_address(&linkaddr_node_addr), dataptr + data_len, LLSEC802154_MIC_LENGTH);
 #if WITH_ENCRYPTION
-  CCM.ctr(get_extended_address(&linkaddr_node_addr));
+  CCM.aead(get_extended_address(&linkaddr_node_addr), dataptr + data_len, LLSEC802154_MIC_LENGTH, 1);
+#else /* WITH_ENCRYPTION */
+  CCM.mic(get_extended_address(&linkaddr_node_addr), dataptr + data_len, LLSEC802154_MIC_LENGTH);
 #endif /* WITH_ENCRYPTION */
   packetbuf_set_datalen(data_len + LLSEC802154_MIC_LENGTH);
   
@@ -146,9 +147,10 @@ input(void)
   packetbuf_set_datalen(packetbuf_datalen() - LLSEC802154_MIC_LENGTH);
   
 #if WITH_ENCRYPTION
-  CCM.ctr(get_extended_address(sender));
-#endif /* WITH_ENCRYPTION */
+  CCM.aead(get_extended_address(sender), generated_mic, LLSEC802154_MIC_LENGTH, 0);
+#else /* WITH_ENCRYPTION */
   CCM.mic(get_extended_address(sender), generated_mic, LLSEC802154_MIC_LENGTH);
+#endif /* WITH_ENCRYPTION */
   
   received_mic = ((uint8_t *) packetbuf_dataptr()) + packetbuf_datalen();
   if(memcmp(generated_mic, received_mic, LLSEC802154_MIC_LENGTH) != 0) {
@@ -38,6 +38,7 @@
  */
 
 #include "net/mac/csma.h"
+#include "net/link-stats.h"
 #include "net/packetbuf.h"
 #include "net/queuebuf.h"
 
@@ -84,6 +85,15 @@
 #error Change CSMA_CONF_MAX_MAC_TRANSMISSIONS in contiki-conf.h or in your Makefile.
 #endif /* CSMA_CONF_MAX_MAC_TRANSMISSIONS < 1 */
 
+/* Unacknowledged packets are not retransmitted to a neighbor whose
+   link statistics are fresh and show an ETX of at least this value.
+   Set to 0 to always use all transmission attempts. */
+#ifdef CSMA_CONF_LINK_STATS_MAX_ETX
+#define CSMA_LINK_STATS_MAX_ETX CSMA_CONF_LINK_STATS_MAX_ETX
+#else
+#define CSMA_LINK_STATS_MAX_ETX 8
+#endif /* CSMA_CONF_LINK_STATS_MAX_ETX */
+
 /* Packet metadata */
 struct qbuf_metadata {
   mac_callback_t sent;
@@ -131,6 +141,19 @@ neighbor_queue_from_addr(const linkaddr_t *addr)
   return NULL;
 }
 /*---------------------------------------------------------------------------*/
+static int
+link_is_broken(const linkaddr_t *addr)
+{
+#if CSMA_LINK_STATS_MAX_ETX
+  const struct link_stats *stats = link_stats_from_lladdr(addr);
+
+  return link_stats_is_fresh(stats) &&
+    stats->etx >= CSMA_LINK_STATS_MAX_ETX * LINK_STATS_ETX_DIVISOR;
+#else /* CSMA_LINK_STATS_MAX_ETX */
+  return 0;
+#endif /* CSMA_LINK_STATS_MAX_ETX */
+}
+/*---------------------------------------------------------------------------*/
 static clock_time_t
 default_timebase(void)
 {
@@ -276,7 +299,11 @@ packet_sent(void *ptr, int status, int num_transmissions)
          * [time, time + 2^backoff_exponent * time[ */
         time = time + (random_rand() % (backoff_transmissions * time));
 
-        if(n->transmissions < metadata->max_transmissions) {
+        if(status == MAC_TX_NOACK && link_is_broken(&n->addr)) {
+          PRINTF("csma: link known to be broken, not retransmitting\n");
+          free_packet(n, q);
+          mac_call_sent_callback(sent, cptr, status, num_tx);
+        } else if(n->transmissions < metadata->max_transmissions) {
           PRINTF("csma: retransmitting with time %lu %p\n", time, q);
           ctimer_set(&n->transmit_timer, time,
                      transmit_packet_list, n);
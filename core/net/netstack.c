@@ -38,10 +38,12 @@
  */
 
 #include "net/netstack.h"
+#include "net/link-stats.h"
 /*---------------------------------------------------------------------------*/
 void
 netstack_init(void)
 {
+  link_stats_init();
   NETSTACK_RADIO.init();
   NETSTACK_RDC.init();
   NETSTACK_MAC.init();
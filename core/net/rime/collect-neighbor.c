@@ -49,6 +49,7 @@
 #include "lib/memb.h"
 #include "lib/list.h"
 
+#include "net/link-stats.h"
 #include "net/rime/collect-neighbor.h"
 #include "net/rime/collect.h"
 
@@ -374,6 +375,22 @@ collect_neighbor_rx(struct collect_neighbor *n)
   n->age = 0;
 }
 /*---------------------------------------------------------------------------*/
+/* Prefer the shared link statistics, which are updated for every
+   unicast sent to the neighbor, and fall back to the collect estimate
+   while they are not fresh. */
+static uint16_t
+link_estimate(struct collect_neighbor *n)
+{
+  const struct link_stats *stats;
+
+  stats = link_stats_from_lladdr(&n->addr);
+  if(link_stats_is_fresh(stats)) {
+    return ((uint32_t)stats->etx * COLLECT_LINK_ESTIMATE_UNIT) /
+      LINK_STATS_ETX_DIVISOR;
+  }
+  return collect_link_estimate(&n->le);
+}
+/*---------------------------------------------------------------------------*/
 uint16_t
 collect_neighbor_link_estimate(struct collect_neighbor *n)
 {
@@ -385,9 +402,9 @@ collect_neighbor_link_estimate(struct collect_neighbor *n)
            n->addr.u8[0], n->addr.u8[1],
            collect_link_estimate(&n->le),
            collect_link_estimate(&n->le) + CONGESTION_PENALTY);*/
-    return collect_link_estimate(&n->le) + CONGESTION_PENALTY;
+    return link_estimate(n) + CONGESTION_PENALTY;
   } else {
-    return collect_link_estimate(&n->le);
+    return link_estimate(n);
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -397,7 +414,7 @@ collect_neighbor_rtmetric_link_estimate(struct collect_neighbor *n)
   if(n == NULL) {
     return 0;
   }
-  return n->rtmetric + collect_link_estimate(&n->le);
+  return n->rtmetric + link_estimate(n);
 }
 /*---------------------------------------------------------------------------*/
 uint16_t
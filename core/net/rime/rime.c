@@ -51,6 +51,7 @@
 #endif
 
 #include "net/netstack.h"
+#include "net/link-stats.h"
 #include "net/rime/rime.h"
 #include "net/rime/chameleon.h"
 #include "net/rime/route.h"
@@ -107,6 +108,7 @@ input(void)
   struct channel *c;
 
   RIMESTATS_ADD(rx);
+  link_stats_input_callback(packetbuf_addr(PACKETBUF_ADDR_SENDER));
   c = chameleon_parse();
   
   for(s = list_head(sniffers); s != NULL; s = list_item_next(s)) {
@@ -163,6 +165,9 @@ packet_sent(void *ptr, int status, int num_tx)
     PRINTF("rime: error %d after %d tx\n", status, num_tx);
   }
 
+  link_stats_packet_sent(packetbuf_addr(PACKETBUF_ADDR_RECEIVER),
+                         status, num_tx);
+
   /* Call sniffers, pass along the MAC status code. */
   for(s = list_head(sniffers); s != NULL; s = list_item_next(s)) {
     if(s->output_callback != NULL) {
@@ -75,6 +75,8 @@ static rpl_of_t * const objective_functions[] = {&RPL_OF};
 /*---------------------------------------------------------------------------*/
 /* Per-parent RPL information */
 NBR_TABLE(rpl_parent_t, rpl_parents);
+/* Set when at least one parent carries RPL_PARENT_FLAG_UPDATED. */
+static uint8_t parent_updates_pending;
 /*---------------------------------------------------------------------------*/
 /* Allocate instance table. */
 rpl_instance_t instance_table[RPL_MAX_INSTANCES];
@@ -114,6 +116,29 @@ rpl_get_parent_link_metric(const uip_lladdr_t *addr)
   }
 }
 /*---------------------------------------------------------------------------*/
+const struct link_stats *
+rpl_get_parent_link_stats(rpl_parent_t *p)
+{
+  const linkaddr_t *lladdr = nbr_table_get_lladdr(rpl_parents, p);
+  return link_stats_from_lladdr(lladdr);
+}
+/*---------------------------------------------------------------------------*/
+void
+rpl_update_parent_link_metric(rpl_parent_t *p)
+{
+  const struct link_stats *stats = rpl_get_parent_link_stats(p);
+
+  /* The link metric is the ETX of the shared link statistics, converted
+     to the RPL fixed point representation. */
+  if(stats != NULL) {
+    p->link_metric = ((uint32_t)stats->etx * RPL_DAG_MC_ETX_DIVISOR) /
+      LINK_STATS_ETX_DIVISOR;
+    if(stats->tx_count > 0) {
+      p->flags |= RPL_PARENT_FLAG_LINK_METRIC_VALID;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
 uip_ipaddr_t *
 rpl_get_parent_ipaddr(rpl_parent_t *p)
 {
@@ -563,6 +588,7 @@ rpl_add_parent(rpl_dag_t *dag, rpl_dio_t *dio, uip_ipaddr_t *addr)
       p->rank = dio->rank;
       p->dtsn = dio->dtsn;
       p->link_metric = RPL_INIT_LINK_METRIC * RPL_DAG_MC_ETX_DIVISOR;
+      rpl_update_parent_link_metric(p);
 #if RPL_DAG_MC != RPL_DAG_MC_NONE
       memcpy(&p->mc, &dio->mc, sizeof(p->mc));
 #endif /* RPL_DAG_MC != RPL_DAG_MC_NONE */
@@ -613,6 +639,8 @@ rpl_find_parent_any_dag(rpl_instance_t *instance, uip_ipaddr_t *addr)
   }
 }
 /*---------------------------------------------------------------------------*/
+static rpl_parent_t *select_parent_on_event(rpl_parent_t *p);
+
 rpl_dag_t *
 rpl_select_dag(rpl_instance_t *instance, rpl_parent_t *p)
 {
@@ -625,7 +653,7 @@ rpl_select_dag(rpl_instance_t *instance, rpl_parent_t *p)
 
   best_dag = instance->current_dag;
   if(best_dag->rank != ROOT_RANK(instance)) {
-    if(rpl_select_parent(p->dag) != NULL) {
+    if(select_parent_on_event(p) != NULL) {
       if(p->dag != best_dag) {
         best_dag = instance->of->best_dag(best_dag, p->dag);
       }
@@ -738,6 +766,42 @@ rpl_select_parent(rpl_dag_t *dag)
   return best;
 }
 /*---------------------------------------------------------------------------*/
+/*
+ * Select the preferred parent after an event concerning a single
+ * parent. Every change of a parent's rank or link metric is such an
+ * event, so each of the other parents was compared with the preferred
+ * parent, or with the one it replaced, when it last changed, and it
+ * suffices to compare the preferred parent with the updated parent.
+ * The objective functions apply hysteresis, so this may keep a parent
+ * that a full scan would replace, just as a full scan may keep it
+ * depending on the order of the parent table. A full scan of the
+ * parent set is done when the preferred parent itself changed, is
+ * missing or no longer has an acceptable rank.
+ */
+static rpl_parent_t *
+select_parent_on_event(rpl_parent_t *p)
+{
+  rpl_dag_t *dag;
+  rpl_parent_t *preferred;
+  rpl_parent_t *best;
+
+  dag = p->dag;
+  preferred = dag->preferred_parent;
+
+  if(preferred == NULL || preferred == p || preferred->dag != dag ||
+     !acceptable_rank(dag, preferred->rank)) {
+    return rpl_select_parent(dag);
+  }
+
+  if(!acceptable_rank(dag, p->rank)) {
+    return preferred;
+  }
+
+  best = dag->instance->of->best_parent(preferred, p);
+  rpl_set_preferred_parent(dag, best);
+  return best;
+}
+/*---------------------------------------------------------------------------*/
 void
 rpl_remove_parent(rpl_parent_t *parent)
 {
@@ -1080,7 +1144,14 @@ rpl_recalculate_ranks(void)
    * We recalculate ranks when we receive feedback from the system rather
    * than RPL protocol messages. This periodical recalculation is called
    * from a timer in order to keep the stack depth reasonably low.
+   * All updates that arrived since the last period are handled in one
+   * pass, and the parent table is not walked at all if there were none.
    */
+  if(!parent_updates_pending) {
+    return;
+  }
+  parent_updates_pending = 0;
+
   p = nbr_table_head(rpl_parents);
   while(p != NULL) {
     if(p->dag != NULL && p->dag->instance && (p->flags & RPL_PARENT_FLAG_UPDATED)) {
@@ -1094,6 +1165,13 @@ rpl_recalculate_ranks(void)
   }
 }
 /*---------------------------------------------------------------------------*/
+void
+rpl_mark_parent_updated(rpl_parent_t *p)
+{
+  p->flags |= RPL_PARENT_FLAG_UPDATED;
+  parent_updates_pending = 1;
+}
+/*---------------------------------------------------------------------------*/
 int
 rpl_process_parent_event(rpl_instance_t *instance, rpl_parent_t *p)
 {
@@ -1149,6 +1227,7 @@ rpl_process_dio(uip_ipaddr_t *from, rpl_dio_t *dio)
   rpl_instance_t *instance;
   rpl_dag_t *dag, *previous_dag;
   rpl_parent_t *p;
+  int unchanged;
 
 #if RPL_CONF_MULTICAST
   /* If the root is advertising MOP 2 but we support MOP 3 we can still join
@@ -1242,6 +1321,7 @@ rpl_process_dio(uip_ipaddr_t *from, rpl_dio_t *dio)
    * whether to keep it in the set.
    */
 
+  unchanged = 0;
   p = rpl_find_parent(dag, from);
   if(p == NULL) {
     previous_dag = find_parent_dag(instance, from);
@@ -1269,6 +1349,13 @@ rpl_process_dio(uip_ipaddr_t *from, rpl_dio_t *dio)
       if(dag->joined) {
         instance->dio_counter++;
       }
+      /* The rank may have become unacceptable since it was accepted,
+         as the minimum rank of the DAG only decreases. */
+      unchanged = dag->preferred_parent != NULL &&
+        acceptable_rank(dag, p->rank);
+#if RPL_DAG_MC != RPL_DAG_MC_NONE
+      unchanged = unchanged && memcmp(&p->mc, &dio->mc, sizeof(p->mc)) == 0;
+#endif /* RPL_DAG_MC != RPL_DAG_MC_NONE */
     } else {
       p->rank=dio->rank;
     }
@@ -1286,7 +1373,14 @@ rpl_process_dio(uip_ipaddr_t *from, rpl_dio_t *dio)
 #if RPL_DAG_MC != RPL_DAG_MC_NONE
   memcpy(&p->mc, &dio->mc, sizeof(p->mc));
 #endif /* RPL_DAG_MC != RPL_DAG_MC_NONE */
-  if(rpl_process_parent_event(instance, p) == 0) {
+  if(unchanged) {
+    /*
+     * The DIO does not change anything that the parent selection depends
+     * on, so the preferred parent and our rank stay as they are. Link
+     * metric changes are handled through rpl_recalculate_ranks().
+     */
+    PRINTF("RPL: Parent state unchanged, skipping parent selection\n");
+  } else if(rpl_process_parent_event(instance, p) == 0) {
     PRINTF("RPL: The candidate parent is rejected\n");
     return;
   }
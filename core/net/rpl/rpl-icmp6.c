@@ -79,6 +79,9 @@ static void dao_ack_input(void);
 #ifdef RPL_DEBUG_DIO_INPUT
 void RPL_DEBUG_DIO_INPUT(uip_ipaddr_t *, rpl_dio_t *);
 #endif
+#ifdef RPL_DEBUG_DIO_PROCESSED
+void RPL_DEBUG_DIO_PROCESSED(uip_ipaddr_t *, rpl_dio_t *);
+#endif
 
 #ifdef RPL_DEBUG_DAO_OUTPUT
 void RPL_DEBUG_DAO_OUTPUT(rpl_parent_t *);
@@ -417,6 +420,10 @@ dio_input(void)
 
   rpl_process_dio(&from, &dio);
 
+#ifdef RPL_DEBUG_DIO_PROCESSED
+  RPL_DEBUG_DIO_PROCESSED(&from, &dio);
+#endif
+
   uip_len = 0;
 }
 /*---------------------------------------------------------------------------*/
@@ -652,7 +659,7 @@ dao_input(void)
       PRINTF("RPL: Loop detected when receiving a unicast DAO from a node with a lower rank! (%u < %u)\n",
           DAG_RANK(parent->rank, instance), DAG_RANK(dag->rank, instance));
       parent->rank = INFINITE_RANK;
-      parent->flags |= RPL_PARENT_FLAG_UPDATED;
+      rpl_mark_parent_updated(parent);
       return;
     }
 
@@ -660,7 +667,7 @@ dao_input(void)
     if(parent != NULL && parent == dag->preferred_parent) {
       PRINTF("RPL: Loop detected when receiving a unicast DAO from our parent\n");
       parent->rank = INFINITE_RANK;
-      parent->flags |= RPL_PARENT_FLAG_UPDATED;
+      rpl_mark_parent_updated(parent);
       return;
     }
   }
@@ -39,7 +39,9 @@
  *
  *         This implementation uses the estimated number of
  *         transmissions (ETX) as the additive routing metric,
- *         and also provides stubs for the energy metric.
+ *         and also provides stubs for the energy metric. The ETX
+ *         of each link is taken from the shared link statistics
+ *         (net/link-stats.h).
  *
  * \author Joakim Eriksson <joakime@sics.se>, Nicolas Tsiftes <nvt@sics.se>
  */
@@ -51,7 +53,6 @@
 #include "net/ip/uip-debug.h"
 
 static void reset(rpl_dag_t *);
-static void neighbor_link_callback(rpl_parent_t *, int, int);
 static rpl_parent_t *best_parent(rpl_parent_t *, rpl_parent_t *);
 static rpl_dag_t *best_dag(rpl_dag_t *, rpl_dag_t *);
 static rpl_rank_t calculate_rank(rpl_parent_t *, rpl_rank_t);
@@ -59,7 +60,7 @@ static void update_metric_container(rpl_instance_t *);
 
 rpl_of_t rpl_mrhof = {
   reset,
-  neighbor_link_callback,
+  NULL,
   best_parent,
   best_dag,
   calculate_rank,
@@ -67,13 +68,6 @@ rpl_of_t rpl_mrhof = {
   1
 };
 
-/* Constants for the ETX moving average */
-#define ETX_SCALE   100
-#define ETX_ALPHA   90
-
-/* Reject parents that have a higher link metric than the following. */
-#define MAX_LINK_METRIC			10
-
 /* Reject parents that have a higher path cost than the following. */
 #define MAX_PATH_COST			100
 
@@ -109,38 +103,6 @@ reset(rpl_dag_t *dag)
   PRINTF("RPL: Reset MRHOF\n");
 }
 
-static void
-neighbor_link_callback(rpl_parent_t *p, int status, int numtx)
-{
-  uint16_t recorded_etx = p->link_metric;
-  uint16_t packet_etx = numtx * RPL_DAG_MC_ETX_DIVISOR;
-  uint16_t new_etx;
-
-  /* Do not penalize the ETX when collisions or transmission errors occur. */
-  if(status == MAC_TX_OK || status == MAC_TX_NOACK) {
-    if(status == MAC_TX_NOACK) {
-      packet_etx = MAX_LINK_METRIC * RPL_DAG_MC_ETX_DIVISOR;
-    }
-
-    if(p->flags & RPL_PARENT_FLAG_LINK_METRIC_VALID) {
-      /* We already have a valid link metric, use weighted moving average to update it */
-      new_etx = ((uint32_t)recorded_etx * ETX_ALPHA +
-                 (uint32_t)packet_etx * (ETX_SCALE - ETX_ALPHA)) / ETX_SCALE;
-    } else {
-      /* We don't have a valid link metric, set it to the current packet's ETX */
-      new_etx = packet_etx;
-      /* Set link metric as valid */
-      p->flags |= RPL_PARENT_FLAG_LINK_METRIC_VALID;
-    }
-
-    PRINTF("RPL: ETX changed from %u to %u (packet ETX = %u)\n",
-        (unsigned)(recorded_etx / RPL_DAG_MC_ETX_DIVISOR),
-        (unsigned)(new_etx  / RPL_DAG_MC_ETX_DIVISOR),
-        (unsigned)(packet_etx / RPL_DAG_MC_ETX_DIVISOR));
-    p->link_metric = new_etx;
-  }
-}
-
 static rpl_rank_t
 calculate_rank(rpl_parent_t *p, rpl_rank_t base_rank)
 {
@@ -290,6 +290,8 @@ void rpl_remove_parent(rpl_parent_t *);
 void rpl_move_parent(rpl_dag_t *dag_src, rpl_dag_t *dag_dst, rpl_parent_t *parent);
 rpl_parent_t *rpl_select_parent(rpl_dag_t *dag);
 rpl_dag_t *rpl_select_dag(rpl_instance_t *instance,rpl_parent_t *parent);
+void rpl_mark_parent_updated(rpl_parent_t *p);
+void rpl_update_parent_link_metric(rpl_parent_t *p);
 void rpl_recalculate_ranks(void);
 
 /* RPL routing table functions. */
@@ -260,7 +260,8 @@ rpl_link_neighbor_callback(const linkaddr_t *addr, int status, int numtx)
       if(parent != NULL) {
         /* Trigger DAG rank recalculation. */
         PRINTF("RPL: rpl_link_neighbor_callback triggering update\n");
-        parent->flags |= RPL_PARENT_FLAG_UPDATED;
+        rpl_mark_parent_updated(parent);
+        rpl_update_parent_link_metric(parent);
         if(instance->of->neighbor_link_callback != NULL) {
           instance->of->neighbor_link_callback(parent, status, numtx);
         }
@@ -286,7 +287,7 @@ rpl_ipv6_neighbor_callback(uip_ds6_nbr_t *nbr)
         p->rank = INFINITE_RANK;
         /* Trigger DAG rank recalculation. */
         PRINTF("RPL: rpl_ipv6_neighbor_callback infinite rank\n");
-        p->flags |= RPL_PARENT_FLAG_UPDATED;
+        rpl_mark_parent_updated(p);
       }
     }
   }
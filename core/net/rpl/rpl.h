@@ -43,6 +43,7 @@
 #include "lib/list.h"
 #include "net/ip/uip.h"
 #include "net/ipv6/uip-ds6.h"
+#include "net/link-stats.h"
 #include "sys/ctimer.h"
 
 /*---------------------------------------------------------------------------*/
@@ -249,6 +250,7 @@ uint8_t rpl_invert_header(void);
 uip_ipaddr_t *rpl_get_parent_ipaddr(rpl_parent_t *nbr);
 rpl_rank_t rpl_get_parent_rank(uip_lladdr_t *addr);
 uint16_t rpl_get_parent_link_metric(const uip_lladdr_t *addr);
+const struct link_stats *rpl_get_parent_link_stats(rpl_parent_t *p);
 void rpl_dag_init(void);
 
 
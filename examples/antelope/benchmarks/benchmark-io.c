@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2015, EasyRF.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *	Storage access counters shared by the Antelope benchmarks. The
+ *	Makefile links with --wrap for cfs_read and cfs_write, so that
+ *	every call that Antelope makes goes through the functions below.
+ */
+
+#include "cfs/cfs.h"
+
+#include "benchmark-io.h"
+
+unsigned long benchmark_reads;
+unsigned long benchmark_read_bytes;
+unsigned long benchmark_written_bytes;
+
+int __real_cfs_read(int fd, void *buf, unsigned int len);
+int __real_cfs_write(int fd, const void *buf, unsigned int len);
+/*---------------------------------------------------------------------------*/
+int
+__wrap_cfs_read(int fd, void *buf, unsigned int len)
+{
+  int r;
+
+  benchmark_reads++;
+  r = __real_cfs_read(fd, buf, len);
+  if(r > 0) {
+    benchmark_read_bytes += r;
+  }
+  return r;
+}
+/*---------------------------------------------------------------------------*/
+int
+__wrap_cfs_write(int fd, const void *buf, unsigned int len)
+{
+  benchmark_written_bytes += len;
+  return __real_cfs_write(fd, buf, len);
+}
+/*---------------------------------------------------------------------------*/
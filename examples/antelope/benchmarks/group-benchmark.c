@@ -0,0 +1,195 @@
+/*
+ * Copyright (c) 2015, EasyRF.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *	GROUP BY benchmark for Antelope. Inserts two days of readings from
+ *	eight sensors, one per minute, into a relation without an index and
+ *	into relations with an inline index and a B+-tree index on the
+ *	time, and computes the average value per hour and sensor, once with
+ *	a query per hour and sensor and once with a single GROUP BY query.
+ *	Build with TARGET=native.
+ */
+
+#include "contiki.h"
+#include "cfs/cfs.h"
+
+#include "antelope.h"
+#include "benchmark-io.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define SENSORS   8
+#define HOURS     48
+#define PERIOD    60
+#define HOUR      3600
+#define START     1399996800L
+#define END       (START + (long)HOURS * HOUR)
+
+struct config {
+  const char *name;
+  const char *index;
+};
+
+static const struct config configs[] = {
+  { "no index", NULL },
+  { "inline index", "CREATE INDEX readings.time TYPE INLINE;" },
+  { "btree index", "CREATE INDEX readings.time TYPE BTREE;" },
+};
+
+/*---------------------------------------------------------------------------*/
+PROCESS(group_benchmark_process, "GROUP BY benchmark");
+AUTOSTART_PROCESSES(&group_benchmark_process);
+/*---------------------------------------------------------------------------*/
+/* Runs a query, and adds the number of result rows and the sum of the
+   values in the last column of each row. */
+static db_result_t
+query(db_handle_t *handle, db_result_t result,
+      unsigned long *rows, long *sum)
+{
+  attribute_value_t value;
+
+  if(DB_ERROR(result)) {
+    return result;
+  }
+
+  while(db_processing(handle)) {
+    result = db_process(handle);
+    if(result == DB_GOT_ROW) {
+      (*rows)++;
+      if(DB_ERROR(db_get_value(&value, handle, handle->ncolumns - 1))) {
+        result = DB_TYPE_ERROR;
+        break;
+      }
+      *sum += db_value_to_long(&value);
+    } else if(result != DB_OK) {
+      break;
+    }
+  }
+  db_free(handle);
+  return DB_ERROR(result) ? result : DB_OK;
+}
+/*---------------------------------------------------------------------------*/
+static void
+report(const char *name, unsigned long queries, clock_time_t t,
+       unsigned long rows, long sum)
+{
+  printf("  %-8s %5lu queries, %5lu ms, %8lu bytes read, "
+         "%6lu bytes written, %lu groups, sum %ld\n",
+         name, queries, (unsigned long)t * 1000 / CLOCK_SECOND,
+         benchmark_read_bytes, benchmark_written_bytes, rows, sum);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(group_benchmark_process, ev, data)
+{
+  static const struct config *config;
+  static long t0;
+  static int sensor;
+  db_handle_t handle;
+  unsigned long rows;
+  unsigned long group_rows;
+  long sum;
+  long group_sum;
+  clock_time_t start;
+  db_result_t result;
+
+  PROCESS_BEGIN();
+
+  db_init();
+
+  for(config = configs;
+      config < configs + sizeof(configs) / sizeof(configs[0]); config++) {
+    db_query(NULL, "REMOVE RELATION readings;");
+    db_query(NULL, "CREATE RELATION readings;");
+    db_query(NULL, "CREATE ATTRIBUTE time DOMAIN LONG IN readings;");
+    db_query(NULL, "CREATE ATTRIBUTE sensor DOMAIN INT IN readings;");
+    db_query(NULL, "CREATE ATTRIBUTE value DOMAIN INT IN readings;");
+    if(config->index != NULL) {
+      db_query(NULL, config->index);
+    }
+
+    for(t0 = START; t0 < END; t0 += PERIOD) {
+      for(sensor = 0; sensor < SENSORS; sensor++) {
+        db_query(NULL, "INSERT (%ld, %d, %d) INTO readings;", t0, sensor,
+                 (int)((t0 / PERIOD * 7 + sensor * 13) % 100));
+      }
+    }
+    printf("%s\n", config->name);
+
+    /* A query per hour and sensor. */
+    rows = 0;
+    sum = 0;
+    benchmark_read_bytes = benchmark_written_bytes = 0;
+    start = clock_time();
+    result = DB_OK;
+    for(t0 = START; !DB_ERROR(result) && t0 < END; t0 += HOUR) {
+      for(sensor = 0; !DB_ERROR(result) && sensor < SENSORS; sensor++) {
+        result = db_query(&handle, "SELECT MEAN(value) FROM readings "
+                          "WHERE time >= %ld AND time < %ld AND sensor = %d;",
+                          t0, t0 + HOUR, sensor);
+        result = query(&handle, result, &rows, &sum);
+      }
+    }
+    if(DB_ERROR(result)) {
+      printf("  separate: %s\n", db_get_result_message(result));
+      continue;
+    }
+    report("separate", (unsigned long)HOURS * SENSORS,
+           clock_time() - start, rows, sum);
+
+    /* A single query that groups the rows by hour and sensor. */
+    group_rows = 0;
+    group_sum = 0;
+    benchmark_read_bytes = benchmark_written_bytes = 0;
+    start = clock_time();
+    result = db_query(&handle, "SELECT time, sensor, MEAN(value) "
+                      "FROM readings WHERE time >= %ld AND time < %ld "
+                      "GROUP BY time / %d, sensor;", START, END, HOUR);
+    result = query(&handle, result, &group_rows, &group_sum);
+    if(DB_ERROR(result)) {
+      printf("  group by: %s\n", db_get_result_message(result));
+      continue;
+    }
+    report("group by", 1, clock_time() - start, group_rows, group_sum);
+
+    if(rows != group_rows || sum != group_sum) {
+      printf("  The results differ\n");
+    }
+  }
+
+  db_query(NULL, "REMOVE RELATION readings;");
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
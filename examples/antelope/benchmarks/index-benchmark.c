@@ -0,0 +1,208 @@
+/*
+ * Copyright (c) 2015, EasyRF.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *	Index benchmark for Antelope. Inserts 100k rows into a relation
+ *	without an index and with a B+-tree index on a 32-bit key, in
+ *	random or increasing key order, and reports the insert rate, the
+ *	bytes written per row, and the rate and number of storage reads of
+ *	point and range lookups. Build with TARGET=native.
+ */
+
+#include "contiki.h"
+#include "cfs/cfs.h"
+
+#include "antelope.h"
+#include "benchmark-io.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define ROWS      100000UL
+#define LOOKUPS   1000
+#define RANGES    100
+#define RANGE     (ROWS / 1000)
+
+struct config {
+  const char *name;
+  const char *index;
+  uint8_t sequential;
+};
+
+static const struct config configs[] = {
+  { "no index", NULL, 0 },
+  { "btree", "BTREE", 0 },
+  { "btree, increasing keys", "BTREE", 1 },
+};
+/*---------------------------------------------------------------------------*/
+PROCESS(index_benchmark_process, "Index benchmark");
+AUTOSTART_PROCESSES(&index_benchmark_process);
+/*---------------------------------------------------------------------------*/
+/* Maps row numbers to distinct keys in a scattered order. */
+static long
+key(const struct config *config, unsigned long row)
+{
+  if(config->sequential) {
+    return (long)row;
+  }
+  return (long)((row * 2654435761UL) & 0x7fffffffUL);
+}
+/*---------------------------------------------------------------------------*/
+static db_result_t
+query(const char *predicate, tuple_id_t *matching)
+{
+  db_handle_t handle;
+  db_result_t result;
+
+  result = db_query(&handle, "SELECT id, value FROM samples WHERE %s;", predicate);
+  if(DB_ERROR(result)) {
+    return result;
+  }
+
+  *matching = 0;
+  while(db_processing(&handle)) {
+    result = db_process(&handle);
+    if(result == DB_GOT_ROW) {
+      (*matching)++;
+    } else if(result != DB_OK) {
+      break;
+    }
+  }
+  db_free(&handle);
+  return DB_ERROR(result) ? result : DB_OK;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned long
+rate(unsigned long count, clock_time_t t)
+{
+  return (unsigned long)((unsigned long long)count * CLOCK_SECOND /
+                         (t == 0 ? 1 : t));
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(index_benchmark_process, ev, data)
+{
+  static const struct config *config;
+  static unsigned long row;
+  static int i;
+  char predicate[64];
+  unsigned long found;
+  unsigned long lookups;
+  tuple_id_t matching;
+  clock_time_t start;
+  clock_time_t t;
+  db_result_t result;
+  long k;
+
+  PROCESS_BEGIN();
+
+  db_init();
+
+  for(config = configs;
+      config < configs + sizeof(configs) / sizeof(configs[0]); config++) {
+    db_query(NULL, "REMOVE RELATION samples;");
+    db_query(NULL, "CREATE RELATION samples;");
+    db_query(NULL, "CREATE ATTRIBUTE id DOMAIN LONG IN samples;");
+    db_query(NULL, "CREATE ATTRIBUTE value DOMAIN INT IN samples;");
+    if(config->index != NULL) {
+      result = db_query(NULL, "CREATE INDEX samples.id TYPE %s;",
+                        config->index);
+      if(DB_ERROR(result)) {
+        printf("%s: %s\n", config->name, db_get_result_message(result));
+        continue;
+      }
+    }
+
+    benchmark_written_bytes = 0;
+    start = clock_time();
+    for(row = 0; row < ROWS; row++) {
+      result = db_query(NULL, "INSERT (%ld, %u) INTO samples;",
+                        key(config, row), (unsigned)(row % 1000));
+      if(DB_ERROR(result)) {
+        break;
+      }
+    }
+    t = clock_time() - start;
+    if(DB_ERROR(result)) {
+      printf("%s: insert failed after %lu rows: %s\n", config->name,
+             row, db_get_result_message(result));
+      continue;
+    }
+    printf("%s:\n  insert  %7lu rows/s, %5lu bytes written per row\n",
+           config->name, rate(ROWS, t), benchmark_written_bytes / ROWS);
+
+    /* Look up rows spread over the whole relation. Scans without an
+       index are slow, so they are sampled less. */
+    lookups = config->index != NULL ? LOOKUPS : LOOKUPS / 100;
+    found = 0;
+    benchmark_reads = 0;
+    start = clock_time();
+    for(i = 0; i < lookups; i++) {
+      snprintf(predicate, sizeof(predicate), "id = %ld",
+               key(config, i * (ROWS / lookups) + 7));
+      result = query(predicate, &matching);
+      if(DB_ERROR(result)) {
+        printf("  %s: %s\n", predicate, db_get_result_message(result));
+        break;
+      }
+      found += matching;
+    }
+    t = clock_time() - start;
+    printf("  lookup  %7lu queries/s, %5lu reads per query, %lu found\n",
+           rate(lookups, t), benchmark_reads / lookups, found);
+
+    /* Ranges of about RANGE keys. */
+    found = 0;
+    benchmark_reads = 0;
+    start = clock_time();
+    for(i = 0; i < RANGES / (config->index != NULL ? 1 : 10); i++) {
+      k = key(config, i * (ROWS / RANGES));
+      snprintf(predicate, sizeof(predicate), "id >= %ld AND id < %ld",
+               k, k + (config->sequential ? RANGE : RANGE << 15));
+      result = query(predicate, &matching);
+      if(DB_ERROR(result)) {
+        printf("  %s: %s\n", predicate, db_get_result_message(result));
+        break;
+      }
+      found += matching;
+    }
+    t = clock_time() - start;
+    printf("  range   %7lu rows/s, %5lu reads per query, %lu found\n",
+           rate(found, t), benchmark_reads / (i == 0 ? 1 : i), found);
+  }
+
+  db_query(NULL, "REMOVE RELATION samples;");
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
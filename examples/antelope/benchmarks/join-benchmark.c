@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2015, EasyRF.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *	Join benchmark for Antelope. Joins two relations without an
+ *	index on the join attribute, for a few relation sizes, and reports
+ *	the time and the number of storage reads of each join. The join
+ *	method is chosen by its estimated cost unless DB_JOIN_METHOD is
+ *	set in project-conf.h. Build with TARGET=native.
+ */
+
+#include "contiki.h"
+#include "cfs/cfs.h"
+
+#include "antelope.h"
+#include "benchmark-io.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define REPEAT 5
+
+struct join_size {
+  tuple_id_t left;
+  tuple_id_t right;
+};
+
+static const struct join_size sizes[] = {
+  { 50, 50 }, { 1000, 50 }, { 1000, 1000 }, { 5000, 2000 }, { 10000, 10000 }
+};
+/*---------------------------------------------------------------------------*/
+PROCESS(join_benchmark_process, "Join benchmark");
+AUTOSTART_PROCESSES(&join_benchmark_process);
+/*---------------------------------------------------------------------------*/
+static db_result_t
+fill(const char *name, const char *attribute, tuple_id_t rows,
+     unsigned keys)
+{
+  db_result_t result;
+  tuple_id_t i;
+
+  db_query(NULL, "REMOVE RELATION %s;", name);
+  db_query(NULL, "CREATE RELATION %s;", name);
+  db_query(NULL, "CREATE ATTRIBUTE id DOMAIN INT IN %s;", name);
+  db_query(NULL, "CREATE ATTRIBUTE %s DOMAIN LONG IN %s;", attribute, name);
+
+  for(i = 0; i < rows; i++) {
+    result = db_query(NULL, "INSERT (%u, %lu) INTO %s;",
+                      (unsigned)((i * 7) % keys), (unsigned long)i, name);
+    if(DB_ERROR(result)) {
+      return result;
+    }
+  }
+  return DB_OK;
+}
+/*---------------------------------------------------------------------------*/
+static db_result_t
+join(tuple_id_t *matching)
+{
+  db_handle_t handle;
+  db_result_t result;
+
+  result = db_query(&handle, "JOIN samples, sensors ON id PROJECT x, y;");
+  if(DB_ERROR(result)) {
+    return result;
+  }
+
+  *matching = 0;
+  while(db_processing(&handle)) {
+    result = db_process(&handle);
+    if(result == DB_GOT_ROW) {
+      (*matching)++;
+    } else if(result != DB_OK) {
+      break;
+    }
+  }
+  db_free(&handle);
+  return DB_ERROR(result) ? result : DB_OK;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(join_benchmark_process, ev, data)
+{
+  static int i;
+  int j;
+  tuple_id_t matching;
+  clock_time_t start;
+  clock_time_t t;
+  db_result_t result;
+
+  PROCESS_BEGIN();
+
+  db_init();
+
+  for(i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+    /* Every key of the smaller relation matches a few rows of the
+       larger relation. */
+    result = fill("samples", "x", sizes[i].left, sizes[i].right / 2);
+    if(!DB_ERROR(result)) {
+      result = fill("sensors", "y", sizes[i].right, sizes[i].right / 2);
+    }
+    if(DB_ERROR(result)) {
+      printf("Insert failed: %s\n", db_get_result_message(result));
+      PROCESS_EXIT();
+    }
+
+    benchmark_reads = 0;
+    start = clock_time();
+    for(j = 0; j < REPEAT; j++) {
+      result = join(&matching);
+      if(DB_ERROR(result)) {
+        printf("Join failed: %s\n", db_get_result_message(result));
+        PROCESS_EXIT();
+      }
+    }
+    t = clock_time() - start;
+    printf("%5lu x %5lu rows: %5lu ms, %6lu reads per join, %lu rows joined\n",
+           (unsigned long)sizes[i].left, (unsigned long)sizes[i].right,
+           (unsigned long)(t * 1000 / CLOCK_SECOND / REPEAT),
+           benchmark_reads / REPEAT, (unsigned long)matching);
+  }
+
+  db_query(NULL, "REMOVE RELATION samples;");
+  db_query(NULL, "REMOVE RELATION sensors;");
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,213 @@
+/*
+ * Copyright (c) 2015, EasyRF.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *	Prepared statement benchmark for Antelope. Runs the same inserts,
+ *	index lookups, range queries, and aggregates once through
+ *	db_query(), which lexes, parses, and compiles each query string,
+ *	and once through prepared statements with bound parameters, and
+ *	compares the time spent per query. Build with TARGET=native.
+ */
+
+#include "contiki.h"
+
+#include "antelope.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define ROWS      20000
+#define QUERIES   20000
+#define PERIOD    60
+#define START     1400000000L
+
+struct benchmark {
+  const char *name;
+  const char *query;
+  unsigned parameters;
+};
+
+/* The queries take the start time of a window of ten minutes as the
+   first parameter, and the end of the window as the second one. */
+static const struct benchmark benchmarks[] = {
+  { "lookup", "SELECT time, value FROM readings WHERE time = %s;", 1 },
+  { "range", "SELECT time, value FROM readings "
+             "WHERE time >= %s AND time < %s;", 2 },
+  { "count", "SELECT COUNT(value) FROM readings "
+             "WHERE time >= %s AND time < %s;", 2 },
+};
+
+PROCESS(prepare_benchmark_process, "Prepare benchmark");
+AUTOSTART_PROCESSES(&prepare_benchmark_process);
+/*---------------------------------------------------------------------------*/
+/* Processes the result of a query, and adds the first value of each
+   result row to the sum. */
+static db_result_t
+process(db_handle_t *handle, db_result_t result, long *sum)
+{
+  attribute_value_t value;
+
+  if(DB_ERROR(result)) {
+    return result;
+  }
+
+  while(db_processing(handle)) {
+    result = db_process(handle);
+    if(result == DB_GOT_ROW) {
+      if(DB_ERROR(db_get_value(&value, handle, 0))) {
+        result = DB_TYPE_ERROR;
+        break;
+      }
+      *sum += db_value_to_long(&value);
+    } else if(result != DB_OK) {
+      break;
+    }
+  }
+  db_free(handle);
+  return DB_ERROR(result) ? result : DB_OK;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned long
+nsecs(unsigned long count, clock_time_t t)
+{
+  return (unsigned long)((unsigned long long)t * 1000000000 /
+                         CLOCK_SECOND / count);
+}
+/*---------------------------------------------------------------------------*/
+static long
+window(int i)
+{
+  return START + (long)(i % (ROWS - 10)) * PERIOD;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(prepare_benchmark_process, ev, data)
+{
+  static db_statement_t stmt;
+  static const struct benchmark *benchmark;
+  static int i;
+  char q[AQL_MAX_QUERY_LENGTH];
+  db_handle_t handle;
+  clock_time_t start;
+  clock_time_t parsed;
+  clock_time_t prepared;
+  clock_time_t parsing;
+  long parsed_sum;
+  long prepared_sum;
+  db_result_t result;
+
+  PROCESS_BEGIN();
+
+  db_init();
+
+  db_query(NULL, "REMOVE RELATION readings;");
+  db_query(NULL, "CREATE RELATION readings;");
+  db_query(NULL, "CREATE ATTRIBUTE time DOMAIN LONG IN readings;");
+  db_query(NULL, "CREATE ATTRIBUTE value DOMAIN INT IN readings;");
+  db_query(NULL, "CREATE INDEX readings.time TYPE INLINE;");
+
+  /* Half of the rows are inserted in each way. */
+  start = clock_time();
+  for(i = 0; i < ROWS / 2; i++) {
+    db_query(NULL, "INSERT (%ld, %d) INTO readings;",
+             START + (long)i * PERIOD, i % 100);
+  }
+  parsed = clock_time() - start;
+
+  result = db_prepare(&stmt, "INSERT (?, ?) INTO readings;");
+  start = clock_time();
+  for(; !DB_ERROR(result) && i < ROWS; i++) {
+    db_bind(&stmt, 0, START + (long)i * PERIOD);
+    db_bind(&stmt, 1, i % 100);
+    result = db_execute(NULL, &stmt);
+  }
+  prepared = clock_time() - start;
+  if(DB_ERROR(result)) {
+    printf("insert: %s\n", db_get_result_message(result));
+    exit(1);
+  }
+  printf("%-8s %7lu ns/row parsed,   %7lu ns/row prepared\n", "insert",
+         nsecs(ROWS / 2, parsed), nsecs(ROWS / 2, prepared));
+
+  for(benchmark = benchmarks;
+      benchmark < benchmarks + sizeof(benchmarks) / sizeof(benchmarks[0]);
+      benchmark++) {
+    parsed_sum = 0;
+    start = clock_time();
+    for(i = 0; i < QUERIES; i++) {
+      snprintf(q, sizeof(q), benchmark->query, "%ld", "%ld");
+      result = db_query(&handle, q, window(i), window(i) + 10 * PERIOD);
+      result = process(&handle, result, &parsed_sum);
+      if(DB_ERROR(result)) {
+        break;
+      }
+    }
+    parsed = clock_time() - start;
+
+    /* The time spent on lexing and parsing the query, which is saved
+       for each execution of a prepared statement. */
+    snprintf(q, sizeof(q), benchmark->query, "?", "?");
+    start = clock_time();
+    for(i = 0; !DB_ERROR(result) && i < QUERIES; i++) {
+      result = db_prepare(&stmt, q);
+    }
+    parsing = clock_time() - start;
+
+    prepared_sum = 0;
+    start = clock_time();
+    for(i = 0; !DB_ERROR(result) && i < QUERIES; i++) {
+      db_bind(&stmt, 0, window(i));
+      if(benchmark->parameters > 1) {
+        db_bind(&stmt, 1, window(i) + 10 * PERIOD);
+      }
+      result = db_execute(&handle, &stmt);
+      result = process(&handle, result, &prepared_sum);
+    }
+    prepared = clock_time() - start;
+
+    if(DB_ERROR(result)) {
+      printf("%s: %s\n", benchmark->name, db_get_result_message(result));
+      continue;
+    }
+    printf("%-8s %7lu ns/query parsed, %7lu ns/query prepared, "
+           "%5lu ns to prepare%s\n",
+           benchmark->name, nsecs(QUERIES, parsed), nsecs(QUERIES, prepared),
+           nsecs(QUERIES, parsing),
+           parsed_sum == prepared_sum ? "" : ", results differ");
+  }
+
+  db_query(NULL, "REMOVE RELATION readings;");
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2015, EasyRF.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *	Full-table scan benchmark for Antelope. Fills a relation with
+ *	1k to 50k rows and times a selection that has to read every row,
+ *	averaged over REPEAT runs. The largest relation is then used for
+ *	measuring the predicate evaluation rate of a few typical queries.
+ *	Build with TARGET=native.
+ */
+
+#include "contiki.h"
+#include "cfs/cfs.h"
+
+#include "antelope.h"
+#include "benchmark-io.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define REPEAT 10
+#define PREDICATE_REPEAT 200
+
+static const tuple_id_t sizes[] = { 1000, 5000, 10000, 50000 };
+static const char *predicates[] = {
+  "value > 990",
+  "value >= 100 AND value < 200",
+  "id > 1000 AND value <> 5",
+  "value = 7 OR value = 993",
+  "value * 2 > 1500",
+};
+/*---------------------------------------------------------------------------*/
+PROCESS(scan_benchmark_process, "Scan benchmark");
+AUTOSTART_PROCESSES(&scan_benchmark_process);
+/*---------------------------------------------------------------------------*/
+static db_result_t
+scan(const char *predicate, tuple_id_t *matching)
+{
+  db_handle_t handle;
+  db_result_t result;
+
+  result = db_query(&handle, "SELECT id, value FROM samples WHERE %s;",
+                    predicate);
+  if(DB_ERROR(result)) {
+    return result;
+  }
+
+  *matching = 0;
+  while(db_processing(&handle)) {
+    result = db_process(&handle);
+    if(result == DB_GOT_ROW) {
+      (*matching)++;
+    } else if(result != DB_OK) {
+      break;
+    }
+  }
+  db_free(&handle);
+  return DB_ERROR(result) ? result : DB_OK;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(scan_benchmark_process, ev, data)
+{
+  static tuple_id_t rows;
+  static int i;
+  int j;
+  tuple_id_t matching;
+  clock_time_t start;
+  clock_time_t t;
+  db_result_t result;
+
+  PROCESS_BEGIN();
+
+  db_init();
+  db_query(NULL, "REMOVE RELATION samples;");
+  db_query(NULL, "CREATE RELATION samples;");
+  db_query(NULL, "CREATE ATTRIBUTE id DOMAIN LONG IN samples;");
+  db_query(NULL, "CREATE ATTRIBUTE value DOMAIN INT IN samples;");
+
+  rows = 0;
+  for(i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+    for(; rows < sizes[i]; rows++) {
+      result = db_query(NULL, "INSERT (%lu, %u) INTO samples;",
+                        (unsigned long)rows, (unsigned)(rows % 1000));
+      if(DB_ERROR(result)) {
+        printf("Insert failed: %s\n", db_get_result_message(result));
+        PROCESS_EXIT();
+      }
+    }
+
+    benchmark_reads = 0;
+    start = clock_time();
+    for(j = 0; j < REPEAT; j++) {
+      result = scan(predicates[0], &matching);
+      if(DB_ERROR(result)) {
+        printf("Scan failed: %s\n", db_get_result_message(result));
+        PROCESS_EXIT();
+      }
+    }
+    t = clock_time() - start;
+    printf("%6lu rows: %5lu ms, %6lu reads per scan, %lu rows matched\n",
+           (unsigned long)rows,
+           (unsigned long)(t * 1000 / CLOCK_SECOND / REPEAT),
+           benchmark_reads / REPEAT, (unsigned long)matching);
+  }
+
+  for(i = 0; i < sizeof(predicates) / sizeof(predicates[0]); i++) {
+    start = clock_time();
+    for(j = 0; j < PREDICATE_REPEAT; j++) {
+      result = scan(predicates[i], &matching);
+      if(DB_ERROR(result)) {
+        printf("Scan failed: %s\n", db_get_result_message(result));
+        PROCESS_EXIT();
+      }
+    }
+    t = clock_time() - start;
+    if(t == 0) {
+      t = 1;
+    }
+    printf("%-30s %8lu rows/s, %lu rows matched\n", predicates[i],
+           (unsigned long)((unsigned long long)rows * PREDICATE_REPEAT * CLOCK_SECOND / t),
+           (unsigned long)matching);
+  }
+
+  db_query(NULL, "REMOVE RELATION samples;");
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,233 @@
+/*
+ * Copyright (c) 2015, EasyRF.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *	Series benchmark for Antelope. Inserts two weeks of sensor
+ *	readings, one per minute, into a relation with fixed-length rows
+ *	and into a series relation, and compares the rows stored per KB,
+ *	the insert rate, and the rate and number of bytes read of full
+ *	scans, time range queries, and aggregates. Build with TARGET=native.
+ */
+
+#include "contiki.h"
+#include "cfs/cfs.h"
+
+#include "antelope.h"
+#include "benchmark-io.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define ROWS      20000UL
+#define PERIOD    60
+#define START     1400000000L
+#define SCANS     10
+#define RANGES    1000
+#define RANGE     3600
+
+struct config {
+  const char *name;
+  const char *type;
+};
+
+static const struct config configs[] = {
+  { "rows", "" },
+  { "series", " TYPE SERIES" },
+};
+/*---------------------------------------------------------------------------*/
+PROCESS(series_benchmark_process, "Series benchmark");
+AUTOSTART_PROCESSES(&series_benchmark_process);
+/*---------------------------------------------------------------------------*/
+/* Runs a query, and gives the number of result rows and the first
+   value of the last row. */
+static db_result_t
+query(const char *q, tuple_id_t *matching, long *last)
+{
+  db_handle_t handle;
+  db_result_t result;
+  attribute_value_t value;
+
+  result = db_query(&handle, q);
+  if(DB_ERROR(result)) {
+    return result;
+  }
+
+  *matching = 0;
+  while(db_processing(&handle)) {
+    result = db_process(&handle);
+    if(result == DB_GOT_ROW) {
+      (*matching)++;
+      if(DB_ERROR(db_get_value(&value, &handle, 0))) {
+        result = DB_TYPE_ERROR;
+        break;
+      }
+      *last = db_value_to_long(&value);
+    } else if(result != DB_OK) {
+      break;
+    }
+  }
+  db_free(&handle);
+  return DB_ERROR(result) ? result : DB_OK;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned long
+rate(unsigned long count, clock_time_t t)
+{
+  return (unsigned long)((unsigned long long)count * CLOCK_SECOND /
+                         (t == 0 ? 1 : t));
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(series_benchmark_process, ev, data)
+{
+  static const struct config *config;
+  static unsigned long row;
+  static long t0;
+  static int i;
+  static int value;
+  char q[96];
+  unsigned long found;
+  tuple_id_t matching;
+  long last;
+  clock_time_t start;
+  clock_time_t t;
+  db_result_t result;
+
+  PROCESS_BEGIN();
+
+  db_init();
+
+  for(config = configs;
+      config < configs + sizeof(configs) / sizeof(configs[0]); config++) {
+    db_query(NULL, "REMOVE RELATION samples;");
+    result = db_query(NULL, "CREATE RELATION samples%s;", config->type);
+    if(DB_ERROR(result)) {
+      printf("%s: %s\n", config->name, db_get_result_message(result));
+      continue;
+    }
+    db_query(NULL, "CREATE ATTRIBUTE time DOMAIN LONG IN samples;");
+    db_query(NULL, "CREATE ATTRIBUTE value DOMAIN INT IN samples;");
+
+    /* A reading every minute, with some jitter, of a value that
+       drifts slowly. */
+    srandom(1);
+    value = 2000;
+    benchmark_written_bytes = 0;
+    start = clock_time();
+    for(row = 0; row < ROWS; row++) {
+      value += (int)(random() % 7) - 3;
+      result = db_query(NULL, "INSERT (%ld, %d) INTO samples;",
+                        START + (long)row * PERIOD + (long)(random() % 3),
+                        value);
+      if(DB_ERROR(result)) {
+        break;
+      }
+    }
+    t = clock_time() - start;
+    if(DB_ERROR(result)) {
+      printf("%s: insert failed after %lu rows: %s\n", config->name,
+             row, db_get_result_message(result));
+      continue;
+    }
+    printf("%s:\n  insert  %7lu rows/s, %5lu rows per KB written\n",
+           config->name, rate(ROWS, t),
+           (unsigned long)((unsigned long long)ROWS * 1024 / benchmark_written_bytes));
+
+    found = 0;
+    benchmark_read_bytes = 0;
+    start = clock_time();
+    for(i = 0; i < SCANS; i++) {
+      result = query("SELECT time, value FROM samples;", &matching, &last);
+      if(DB_ERROR(result)) {
+        break;
+      }
+      found += matching;
+    }
+    t = clock_time() - start;
+    printf("  scan    %7lu rows/s, %5lu bytes read per scan, %lu found\n",
+           rate(found, t), benchmark_read_bytes / SCANS, found);
+
+    /* An hour of readings, starting at each quarter of an hour. */
+    found = 0;
+    benchmark_read_bytes = 0;
+    start = clock_time();
+    for(i = 0; i < RANGES; i++) {
+      t0 = START + (long)i * (ROWS * PERIOD / RANGES);
+      snprintf(q, sizeof(q), "SELECT time, value FROM samples "
+               "WHERE time >= %ld AND time < %ld;", t0, t0 + RANGE);
+      result = query(q, &matching, &last);
+      if(DB_ERROR(result)) {
+        printf("  %s: %s\n", q, db_get_result_message(result));
+        break;
+      }
+      found += matching;
+    }
+    t = clock_time() - start;
+    printf("  range   %7lu queries/s, %5lu bytes read per query, %lu found\n",
+           rate(RANGES, t), benchmark_read_bytes / RANGES, found);
+
+    benchmark_read_bytes = 0;
+    start = clock_time();
+    for(i = 0; i < SCANS; i++) {
+      result = query("SELECT MAX(value) FROM samples;", &matching, &last);
+      if(DB_ERROR(result)) {
+        printf("  max: %s\n", db_get_result_message(result));
+        break;
+      }
+    }
+    t = clock_time() - start;
+    printf("  max     %7lu queries/s, %5lu bytes read per query, max %ld\n",
+           rate(SCANS, t), benchmark_read_bytes / SCANS, last);
+
+    benchmark_read_bytes = 0;
+    start = clock_time();
+    for(i = 0; i < RANGES; i++) {
+      t0 = START + (long)i * (ROWS * PERIOD / RANGES);
+      snprintf(q, sizeof(q), "SELECT COUNT(value) FROM samples "
+               "WHERE time >= %ld AND time < %ld;", t0, t0 + RANGE);
+      result = query(q, &matching, &last);
+      if(DB_ERROR(result)) {
+        printf("  %s: %s\n", q, db_get_result_message(result));
+        break;
+      }
+    }
+    t = clock_time() - start;
+    printf("  count   %7lu queries/s, %5lu bytes read per query, count %ld\n",
+           rate(RANGES, t), benchmark_read_bytes / RANGES, last);
+  }
+
+  db_query(NULL, "REMOVE RELATION samples;");
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -13,6 +13,9 @@
 #undef DB_FEATURE_JOIN
 #define DB_FEATURE_JOIN                      0
 
+#undef DB_FEATURE_BTREE
+#define DB_FEATURE_BTREE                     0
+
 #undef RF_CHANNEL
 #define RF_CHANNEL                           16
 
@@ -0,0 +1,334 @@
+/*
+ * Copyright (c) 2015, EasyRF.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *	Regression tests for GROUP BY in Antelope. The group table is made
+ *	small in project-conf.h, so that the groups are spilled to storage
+ *	and merged back in several passes. The COUNT, SUM, MIN, MAX and
+ *	MEAN of each group are compared with a separate query for the rows
+ *	of that group, without an index and through an ordered index.
+ *	Build with TARGET=native; the exit status is the number of failed
+ *	tests.
+ */
+
+#include "contiki.h"
+
+#include "antelope.h"
+#include "unit-test.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Rows are inserted in time order, with one row per sensor for each
+   time. Some of the times are negative, so that their intervals have
+   to be rounded down. */
+#define FIRST    -500L
+#define END      1500L
+#define STEP     10L
+#define SENSORS  8
+#define ROWS     ((END - FIRST) / STEP * SENSORS)
+
+/* The length of the time intervals in GROUP BY time / INTERVAL. */
+#define INTERVAL 100L
+
+#define MAX_GROUPS ((END - FIRST) / INTERVAL * SENSORS)
+
+/* The aggregates are computed in several queries, because a query
+   has at most AQL_ATTRIBUTE_LIMIT attributes, including those in the
+   WHERE clause. */
+static const char *aggregates[] = {
+  "COUNT(value), SUM(value)",
+  "MIN(value), MAX(value)",
+  "MEAN(value)"
+};
+
+struct group {
+  long time;
+  long sensor;
+  long results[2];
+};
+
+static struct group groups[MAX_GROUPS];
+static unsigned group_count;
+static unsigned failures;
+
+UNIT_TEST_REGISTER(group_spill, "GROUP BY with spilled groups");
+UNIT_TEST_REGISTER(group_ordered, "GROUP BY through an ordered index");
+/*---------------------------------------------------------------------------*/
+static int
+value(long time, int sensor)
+{
+  return (int)((time / STEP * 37 + sensor * 11) % 201) - 100;
+}
+/*---------------------------------------------------------------------------*/
+static db_result_t
+create(const char *relation, const char *index)
+{
+  long time;
+  int sensor;
+
+  db_query(NULL, "REMOVE RELATION %s;", relation);
+  if(DB_ERROR(db_query(NULL, "CREATE RELATION %s;", relation)) ||
+     DB_ERROR(db_query(NULL, "CREATE ATTRIBUTE time DOMAIN LONG IN %s;",
+                       relation)) ||
+     DB_ERROR(db_query(NULL, "CREATE ATTRIBUTE sensor DOMAIN INT IN %s;",
+                       relation)) ||
+     DB_ERROR(db_query(NULL, "CREATE ATTRIBUTE value DOMAIN INT IN %s;",
+                       relation))) {
+    return DB_STORAGE_ERROR;
+  }
+  if(index != NULL &&
+     DB_ERROR(db_query(NULL, "CREATE INDEX %s.time TYPE %s;",
+                       relation, index))) {
+    return DB_INDEX_ERROR;
+  }
+
+  for(time = FIRST; time < END; time += STEP) {
+    for(sensor = 0; sensor < SENSORS; sensor++) {
+      if(DB_ERROR(db_query(NULL, "INSERT (%ld, %d, %d) INTO %s;",
+                           time, sensor, value(time, sensor), relation))) {
+        return DB_STORAGE_ERROR;
+      }
+    }
+  }
+  return DB_OK;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Reads the rows of a query into the groups array. The first columns
+ * are the keys, the time only if by_time is set, and the remaining
+ * columns are the aggregates.
+ */
+static int
+read_groups(db_handle_t *handle, db_result_t result, int by_time)
+{
+  attribute_value_t v;
+  struct group *g;
+  unsigned column;
+  unsigned i;
+
+  if(DB_ERROR(result)) {
+    printf("%s\n", db_get_result_message(result));
+    return 0;
+  }
+
+  group_count = 0;
+  while(db_processing(handle)) {
+    result = db_process(handle);
+    if(result == DB_GOT_ROW) {
+      if(group_count == MAX_GROUPS) {
+        printf("More than %ld groups\n", (long)MAX_GROUPS);
+        break;
+      }
+      g = &groups[group_count++];
+      column = 0;
+      g->time = 0;
+      if(by_time && !DB_ERROR(db_get_value(&v, handle, column++))) {
+        g->time = db_value_to_long(&v);
+      }
+      if(!DB_ERROR(db_get_value(&v, handle, column++))) {
+        g->sensor = db_value_to_long(&v);
+      }
+      for(i = 0; column < handle->ncolumns; column++, i++) {
+        g->results[i] = DB_ERROR(db_get_value(&v, handle, column)) ?
+          LONG_MIN : db_value_to_long(&v);
+      }
+    } else if(result != DB_OK) {
+      if(DB_ERROR(result)) {
+        printf("%s\n", db_get_result_message(result));
+        db_free(handle);
+        return 0;
+      }
+      break;
+    }
+  }
+  db_free(handle);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Compares a group with a separate query for the rows of the group. */
+static int
+check_group(const char *relation, const char *select,
+            const struct group *g, int by_time)
+{
+  db_handle_t handle;
+  db_result_t result;
+  attribute_value_t v;
+  long first;
+  long end;
+  unsigned i;
+
+  first = by_time ? g->time : FIRST;
+  end = by_time ? g->time + INTERVAL : END;
+  result = db_query(&handle, "SELECT %s FROM %s WHERE time >= %ld AND "
+                    "time < %ld AND sensor = %ld;",
+                    select, relation, first, end, g->sensor);
+  if(DB_ERROR(result)) {
+    printf("%s\n", db_get_result_message(result));
+    return 0;
+  }
+
+  while(db_processing(&handle)) {
+    result = db_process(&handle);
+    if(result == DB_GOT_ROW) {
+      for(i = 0; i < handle.ncolumns; i++) {
+        if(DB_ERROR(db_get_value(&v, &handle, i)) ||
+           db_value_to_long(&v) != g->results[i]) {
+          printf("%s, time %ld, sensor %ld: column %u is %ld in the "
+                 "group, %ld in the query\n", select, g->time, g->sensor, i,
+                 g->results[i], db_value_to_long(&v));
+          db_free(&handle);
+          return 0;
+        }
+      }
+      break;
+    } else if(result != DB_OK) {
+      break;
+    }
+  }
+  db_free(&handle);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Groups the rows of a relation by sensor, and by time intervals if
+ * by_time is set, and checks each group. If ordered is set, the groups
+ * must be emitted in time order.
+ */
+static int
+check_groups(const char *relation, int by_time, int ordered)
+{
+  db_handle_t handle;
+  db_result_t result;
+  unsigned long rows;
+  unsigned a;
+  unsigned i;
+
+  for(a = 0; a < sizeof(aggregates) / sizeof(aggregates[0]); a++) {
+    if(by_time) {
+      result = db_query(&handle, "SELECT time, sensor, %s FROM %s "
+                        "WHERE time >= %ld AND time < %ld "
+                        "GROUP BY time / %ld, sensor;",
+                        aggregates[a], relation, FIRST, END, INTERVAL);
+    } else {
+      result = db_query(&handle, "SELECT sensor, %s FROM %s "
+                        "WHERE time >= %ld AND time < %ld "
+                        "GROUP BY sensor;",
+                        aggregates[a], relation, FIRST, END);
+    }
+    if(!read_groups(&handle, result, by_time)) {
+      return 0;
+    }
+
+    if(group_count != (by_time ? MAX_GROUPS : SENSORS)) {
+      printf("%s: %u groups\n", aggregates[a], group_count);
+      return 0;
+    }
+
+    rows = 0;
+    for(i = 0; i < group_count; i++) {
+      if(groups[i].time % INTERVAL != 0) {
+        printf("The interval %ld is not rounded down\n", groups[i].time);
+        return 0;
+      }
+      if(ordered && i > 0 && groups[i].time < groups[i - 1].time) {
+        printf("The interval %ld is emitted after %ld\n",
+               groups[i].time, groups[i - 1].time);
+        return 0;
+      }
+      if(!check_group(relation, aggregates[a], &groups[i], by_time)) {
+        return 0;
+      }
+      rows += groups[i].results[0];
+    }
+
+    /* Every row is counted in exactly one group. */
+    if(a == 0 && rows != ROWS) {
+      printf("The groups have %lu rows, not %ld\n", rows, (long)ROWS);
+      return 0;
+    }
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST(group_spill)
+{
+  UNIT_TEST_BEGIN();
+
+  UNIT_TEST_ASSERT(!DB_ERROR(create("readings", NULL)));
+
+  /* More sensors than the table holds groups. */
+  UNIT_TEST_ASSERT(check_groups("readings", 0, 0));
+
+  /* Many more groups, which take several merge passes. */
+  UNIT_TEST_ASSERT(check_groups("readings", 1, 0));
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST(group_ordered)
+{
+  UNIT_TEST_BEGIN();
+
+  UNIT_TEST_ASSERT(!DB_ERROR(create("indexed", "BTREE")));
+
+  /* The groups of each interval are emitted when the next interval
+     starts. */
+  UNIT_TEST_ASSERT(check_groups("indexed", 1, 1));
+  UNIT_TEST_ASSERT(check_groups("indexed", 0, 0));
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(group_tests_process, "GROUP BY tests");
+AUTOSTART_PROCESSES(&group_tests_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(group_tests_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  db_init();
+
+  UNIT_TEST_RUN(group_spill);
+  failures += UNIT_TEST_RESULT(group_spill) == unit_test_failure;
+  UNIT_TEST_RUN(group_ordered);
+  failures += UNIT_TEST_RESULT(group_ordered) == unit_test_failure;
+
+  db_query(NULL, "REMOVE RELATION readings;");
+  db_query(NULL, "REMOVE RELATION indexed;");
+  exit(failures);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
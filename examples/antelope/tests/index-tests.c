@@ -0,0 +1,254 @@
+/*
+ * Copyright (c) 2015, EasyRF.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *	Regression tests for the range queries of the Antelope indexes.
+ *	Build with TARGET=native; the exit status is the number of failed
+ *	tests.
+ */
+
+#include "contiki.h"
+
+#include "antelope.h"
+#include "index.h"
+#include "relation.h"
+#include "unit-test.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Enough rows for a B+-tree with several levels of nodes. */
+#define ROWS     5495L
+#define SCATTER  3000L
+
+UNIT_TEST_REGISTER(btree_range, "B+-tree range queries");
+UNIT_TEST_REGISTER(btree_duplicates, "B+-tree ranges with duplicate keys");
+UNIT_TEST_REGISTER(prefix_iterator, "Prefix iterators");
+
+static unsigned failures;
+/*---------------------------------------------------------------------------*/
+/*
+ * Counts the rows of a selection, and checks that the keys of all rows
+ * are within [min, max].
+ */
+static long
+count(const char *relation, const char *predicate, long min, long max)
+{
+  db_handle_t handle;
+  db_result_t result;
+  attribute_value_t value;
+  long rows;
+  long key;
+
+  result = db_query(&handle, "SELECT id FROM %s WHERE %s;",
+                    relation, predicate);
+  if(DB_ERROR(result)) {
+    printf("%s: %s\n", predicate, db_get_result_message(result));
+    return -1;
+  }
+
+  rows = 0;
+  while(db_processing(&handle)) {
+    result = db_process(&handle);
+    if(result == DB_GOT_ROW) {
+      if(DB_ERROR(db_get_value(&value, &handle, 0))) {
+        rows = -1;
+        break;
+      }
+      key = db_value_to_long(&value);
+      if(key < min || key > max) {
+        printf("%s: key %ld is out of range\n", predicate, key);
+        rows = -1;
+        break;
+      }
+      rows++;
+    } else if(result != DB_OK) {
+      if(DB_ERROR(result)) {
+        printf("%s: %s\n", predicate, db_get_result_message(result));
+        rows = -1;
+      }
+      break;
+    }
+  }
+  db_free(&handle);
+  return rows;
+}
+/*---------------------------------------------------------------------------*/
+static db_result_t
+create(const char *relation, const char *index)
+{
+  db_query(NULL, "REMOVE RELATION %s;", relation);
+  if(DB_ERROR(db_query(NULL, "CREATE RELATION %s;", relation)) ||
+     DB_ERROR(db_query(NULL, "CREATE ATTRIBUTE id DOMAIN LONG IN %s;",
+                       relation))) {
+    return DB_STORAGE_ERROR;
+  }
+  return index == NULL ? DB_OK :
+    db_query(NULL, "CREATE INDEX %s.id TYPE %s;", relation, index);
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Counts the entries of a prefix iteration over the index of the id
+ * attribute in a relation.
+ */
+static long
+count_prefix(const char *relation, long key, unsigned prefix_bits)
+{
+  index_iterator_t iterator;
+  attribute_value_t value;
+  relation_t *rel;
+  attribute_t *attr;
+  long entries;
+
+  rel = relation_load((char *)relation);
+  if(rel == NULL) {
+    return -1;
+  }
+
+  entries = -1;
+  attr = relation_attribute_get(rel, "id");
+  if(attr != NULL && attr->index != NULL) {
+    value.domain = DOMAIN_LONG;
+    VALUE_LONG(&value) = key;
+    if(!DB_ERROR(index_get_prefix_iterator(&iterator, attr->index,
+                                           &value, prefix_bits))) {
+      for(entries = 0; index_get_next(&iterator) != INVALID_TUPLE;) {
+        entries++;
+      }
+    }
+  }
+
+  relation_release(rel);
+  return entries;
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST(btree_range)
+{
+  long i;
+
+  UNIT_TEST_BEGIN();
+
+  UNIT_TEST_ASSERT(!DB_ERROR(create("ranges", "BTREE")));
+  for(i = 0; i < ROWS; i++) {
+    UNIT_TEST_ASSERT(!DB_ERROR(db_query(NULL, "INSERT (%ld) INTO ranges;", i)));
+  }
+
+  /* Open ranges have one bound outside of the 16-bit and the 32-bit
+     value ranges. */
+  UNIT_TEST_ASSERT(count("ranges", "id >= 5000", 5000, ROWS) == ROWS - 5000);
+  UNIT_TEST_ASSERT(count("ranges", "id > 40000", 0, 0) == 0);
+  UNIT_TEST_ASSERT(count("ranges", "id < 100", 0, 99) == 100);
+  UNIT_TEST_ASSERT(count("ranges", "id >= 0", 0, ROWS) == ROWS);
+  UNIT_TEST_ASSERT(count("ranges", "id < 0", 0, 0) == 0);
+
+  /* Closed ranges within a leaf, across leaves, and at the ends. */
+  UNIT_TEST_ASSERT(count("ranges", "id = 4711", 4711, 4711) == 1);
+  UNIT_TEST_ASSERT(count("ranges", "id >= 100 AND id < 300", 100, 299) == 200);
+  UNIT_TEST_ASSERT(count("ranges", "id > 5400 AND id < 9999", 5401, ROWS) ==
+                   ROWS - 5401);
+  UNIT_TEST_ASSERT(count("ranges", "id > 5500 AND id < 6000", 0, 0) == 0);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST(btree_duplicates)
+{
+  long i;
+  long key;
+
+  UNIT_TEST_BEGIN();
+
+  /* Every key occurs twice, so equal keys may be split between leaves.
+     The keys are inserted in a scattered order. */
+  UNIT_TEST_ASSERT(!DB_ERROR(create("dups", "BTREE")));
+  for(i = 0; i < 2 * SCATTER; i++) {
+    key = (i * 7919) % SCATTER;
+    UNIT_TEST_ASSERT(!DB_ERROR(db_query(NULL, "INSERT (%ld) INTO dups;",
+                                        key)));
+  }
+
+  UNIT_TEST_ASSERT(count("dups", "id = 7", 7, 7) == 2);
+  UNIT_TEST_ASSERT(count("dups", "id = 0", 0, 0) == 2);
+  UNIT_TEST_ASSERT(count("dups", "id = 2999", 2999, 2999) == 2);
+  UNIT_TEST_ASSERT(count("dups", "id >= 1000", 1000, SCATTER) ==
+                   2 * (SCATTER - 1000));
+  UNIT_TEST_ASSERT(count("dups", "id > 100 AND id < 200", 101, 199) ==
+                   2 * 99);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST(prefix_iterator)
+{
+  UNIT_TEST_BEGIN();
+
+  /* All keys have the empty prefix. */
+  UNIT_TEST_ASSERT(count_prefix("ranges", 4711, 0) == ROWS);
+  UNIT_TEST_ASSERT(count_prefix("dups", -4711, 0) == 2 * SCATTER);
+
+  /* The sign bit. */
+  UNIT_TEST_ASSERT(count_prefix("dups", 1, 1) == 2 * SCATTER);
+  UNIT_TEST_ASSERT(count_prefix("dups", -1, 1) == 0);
+
+  /* [4096, 8191], [0, 255], and full keys. */
+  UNIT_TEST_ASSERT(count_prefix("ranges", 5000, 20) == ROWS - 4096);
+  UNIT_TEST_ASSERT(count_prefix("dups", 100, 24) == 2 * 256);
+  UNIT_TEST_ASSERT(count_prefix("ranges", 4711, 32) == 1);
+  UNIT_TEST_ASSERT(count_prefix("dups", 7, 32) == 2);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(index_tests_process, "Index tests");
+AUTOSTART_PROCESSES(&index_tests_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(index_tests_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  db_init();
+
+  UNIT_TEST_RUN(btree_range);
+  failures += UNIT_TEST_RESULT(btree_range) == unit_test_failure;
+  UNIT_TEST_RUN(btree_duplicates);
+  failures += UNIT_TEST_RESULT(btree_duplicates) == unit_test_failure;
+  UNIT_TEST_RUN(prefix_iterator);
+  failures += UNIT_TEST_RESULT(prefix_iterator) == unit_test_failure;
+
+  db_query(NULL, "REMOVE RELATION ranges;");
+  db_query(NULL, "REMOVE RELATION dups;");
+  exit(failures);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
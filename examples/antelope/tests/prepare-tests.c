@@ -0,0 +1,297 @@
+/*
+ * Copyright (c) 2015, EasyRF.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *	Regression tests for prepared AQL statements in Antelope: binding
+ *	parameters, rebinding the operands of a WHERE clause, executing a
+ *	statement after other queries have used the LVM, and placeholders
+ *	in INSERT. Build with TARGET=native; the exit status is the number
+ *	of failed tests.
+ */
+
+#include "contiki.h"
+
+#include "antelope.h"
+#include "index.h"
+#include "result.h"
+#include "unit-test.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define ROWS 1000L
+
+UNIT_TEST_REGISTER(prepare_insert, "Placeholders in INSERT");
+UNIT_TEST_REGISTER(prepare_bind, "Binding out of range");
+UNIT_TEST_REGISTER(prepare_rebind, "Rebinding WHERE operands");
+UNIT_TEST_REGISTER(prepare_restore, "Executing after other queries");
+
+static db_statement_t stmt;
+static unsigned failures;
+/*---------------------------------------------------------------------------*/
+static int
+value(long id)
+{
+  return (int)((id * 37) % 101);
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Counts the rows of a query that has been started, and checks that the
+ * id in the first column of each row is within [min, max].
+ */
+static long
+count(db_handle_t *handle, db_result_t result, long min, long max)
+{
+  attribute_value_t v;
+  long rows;
+  long id;
+
+  if(DB_ERROR(result)) {
+    printf("%s\n", db_get_result_message(result));
+    return -1;
+  }
+
+  rows = 0;
+  while(db_processing(handle)) {
+    result = db_process(handle);
+    if(result == DB_GOT_ROW) {
+      if(DB_ERROR(db_get_value(&v, handle, 0))) {
+        rows = -1;
+        break;
+      }
+      id = db_value_to_long(&v);
+      if(id < min || id > max) {
+        printf("The id %ld is out of [%ld, %ld]\n", id, min, max);
+        rows = -1;
+        break;
+      }
+      rows++;
+    } else if(result != DB_OK) {
+      if(DB_ERROR(result)) {
+        printf("%s\n", db_get_result_message(result));
+        rows = -1;
+      }
+      break;
+    }
+  }
+  db_free(handle);
+  return rows;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Executes the range statement for [first, end), and checks both the
+ * index range that the execution uses and the rows that it returns.
+ */
+static int
+range(long first, long end)
+{
+  db_handle_t handle;
+  db_result_t result;
+  long rows;
+
+  if(DB_ERROR(db_bind(&stmt, 0, first)) ||
+     DB_ERROR(db_bind(&stmt, 1, end))) {
+    return 0;
+  }
+
+  result = db_execute(&handle, &stmt);
+  if(!DB_ERROR(result)) {
+    if(!(handle.flags & DB_HANDLE_FLAG_SEARCH_INDEX)) {
+      printf("[%ld, %ld): the index is not used\n", first, end);
+      db_free(&handle);
+      return 0;
+    }
+    if(VALUE_LONG(&handle.index_iterator.min_value) != first ||
+       VALUE_LONG(&handle.index_iterator.max_value) != end - 1) {
+      printf("[%ld, %ld): the index range is [%ld, %ld]\n", first, end,
+             (long)VALUE_LONG(&handle.index_iterator.min_value),
+             (long)VALUE_LONG(&handle.index_iterator.max_value));
+      db_free(&handle);
+      return 0;
+    }
+  }
+
+  rows = count(&handle, result, first, end - 1);
+  if(rows != end - first) {
+    printf("[%ld, %ld): %ld rows\n", first, end, rows);
+    return 0;
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST(prepare_insert)
+{
+  db_handle_t handle;
+  attribute_value_t v;
+  long id;
+  long checked;
+  db_result_t result;
+
+  UNIT_TEST_BEGIN();
+
+  db_query(NULL, "REMOVE RELATION readings;");
+  UNIT_TEST_ASSERT(!DB_ERROR(db_query(NULL, "CREATE RELATION readings;")));
+  UNIT_TEST_ASSERT(!DB_ERROR(db_query(NULL,
+                   "CREATE ATTRIBUTE id DOMAIN LONG IN readings;")));
+  UNIT_TEST_ASSERT(!DB_ERROR(db_query(NULL,
+                   "CREATE ATTRIBUTE value DOMAIN INT IN readings;")));
+  UNIT_TEST_ASSERT(!DB_ERROR(db_query(NULL,
+                   "CREATE INDEX readings.id TYPE INLINE;")));
+
+  UNIT_TEST_ASSERT(!DB_ERROR(db_prepare(&stmt,
+                   "INSERT (?, ?) INTO readings;")));
+  for(id = 0; id < ROWS; id++) {
+    UNIT_TEST_ASSERT(!DB_ERROR(db_bind(&stmt, 0, id)));
+    UNIT_TEST_ASSERT(!DB_ERROR(db_bind(&stmt, 1, value(id))));
+    UNIT_TEST_ASSERT(!DB_ERROR(db_execute(NULL, &stmt)));
+  }
+
+  /* Every row has the values that were bound when it was inserted. */
+  result = db_query(&handle, "SELECT id, value FROM readings;");
+  UNIT_TEST_ASSERT(!DB_ERROR(result));
+  checked = 0;
+  while(db_processing(&handle)) {
+    result = db_process(&handle);
+    if(result == DB_GOT_ROW) {
+      if(DB_ERROR(db_get_value(&v, &handle, 0))) {
+        break;
+      }
+      id = db_value_to_long(&v);
+      if(id != checked ||
+         DB_ERROR(db_get_value(&v, &handle, 1)) ||
+         db_value_to_long(&v) != value(id)) {
+        break;
+      }
+      checked++;
+    } else if(result != DB_OK) {
+      break;
+    }
+  }
+  db_free(&handle);
+  UNIT_TEST_ASSERT(checked == ROWS);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST(prepare_bind)
+{
+  UNIT_TEST_BEGIN();
+
+  UNIT_TEST_ASSERT(!DB_ERROR(db_prepare(&stmt,
+                   "SELECT id FROM readings WHERE id >= ? AND id < ?;")));
+  UNIT_TEST_ASSERT(!DB_ERROR(db_bind(&stmt, 1, 10)));
+  UNIT_TEST_ASSERT(db_bind(&stmt, 2, 10) == DB_ARGUMENT_ERROR);
+  UNIT_TEST_ASSERT(db_bind(&stmt, 100, 10) == DB_ARGUMENT_ERROR);
+
+  /* A statement without placeholders takes no values. */
+  UNIT_TEST_ASSERT(!DB_ERROR(db_prepare(&stmt,
+                   "SELECT id FROM readings WHERE id < 10;")));
+  UNIT_TEST_ASSERT(db_bind(&stmt, 0, 10) == DB_ARGUMENT_ERROR);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST(prepare_rebind)
+{
+  UNIT_TEST_BEGIN();
+
+  UNIT_TEST_ASSERT(!DB_ERROR(db_prepare(&stmt,
+                   "SELECT id FROM readings WHERE id >= ? AND id < ?;")));
+
+  /* The index range follows the bound values, and does not stay at
+     the range of an earlier execution. */
+  UNIT_TEST_ASSERT(range(100, 200));
+  UNIT_TEST_ASSERT(range(700, 750));
+  UNIT_TEST_ASSERT(range(0, 1));
+  UNIT_TEST_ASSERT(range(100, 200));
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST(prepare_restore)
+{
+  db_handle_t handle;
+  long rows;
+
+  UNIT_TEST_BEGIN();
+
+  db_query(NULL, "REMOVE RELATION other;");
+  UNIT_TEST_ASSERT(!DB_ERROR(db_query(NULL, "CREATE RELATION other;")));
+  UNIT_TEST_ASSERT(!DB_ERROR(db_query(NULL,
+                   "CREATE ATTRIBUTE a DOMAIN LONG IN other;")));
+  UNIT_TEST_ASSERT(!DB_ERROR(db_query(NULL,
+                   "CREATE ATTRIBUTE b DOMAIN INT IN other;")));
+  UNIT_TEST_ASSERT(!DB_ERROR(db_query(NULL, "INSERT (5, 1) INTO other;")));
+  UNIT_TEST_ASSERT(!DB_ERROR(db_query(NULL, "INSERT (6, 9) INTO other;")));
+
+  UNIT_TEST_ASSERT(!DB_ERROR(db_prepare(&stmt,
+                   "SELECT id FROM readings WHERE id >= ? AND id < ?;")));
+  UNIT_TEST_ASSERT(range(300, 310));
+
+  /* This query registers other variables in the LVM, and compiles
+     another program. The statement has to restore its own. */
+  rows = count(&handle, db_query(&handle,
+               "SELECT a FROM other WHERE b > 3 AND a > 0;"), 6, 6);
+  UNIT_TEST_ASSERT(rows == 1);
+
+  UNIT_TEST_ASSERT(range(300, 310));
+  UNIT_TEST_ASSERT(range(500, 520));
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(prepare_tests_process, "Prepared statement tests");
+AUTOSTART_PROCESSES(&prepare_tests_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(prepare_tests_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  db_init();
+
+  UNIT_TEST_RUN(prepare_insert);
+  failures += UNIT_TEST_RESULT(prepare_insert) == unit_test_failure;
+  UNIT_TEST_RUN(prepare_bind);
+  failures += UNIT_TEST_RESULT(prepare_bind) == unit_test_failure;
+  UNIT_TEST_RUN(prepare_rebind);
+  failures += UNIT_TEST_RESULT(prepare_rebind) == unit_test_failure;
+  UNIT_TEST_RUN(prepare_restore);
+  failures += UNIT_TEST_RESULT(prepare_restore) == unit_test_failure;
+
+  db_query(NULL, "REMOVE RELATION readings;");
+  db_query(NULL, "REMOVE RELATION other;");
+  exit(failures);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
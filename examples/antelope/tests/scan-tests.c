@@ -0,0 +1,235 @@
+/*
+ * Copyright (c) 2015, EasyRF.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *	Regression tests for the batched row cursor of Antelope. Every
+ *	row of relations with several row lengths is read through cursors
+ *	with several buffer sizes, so that batches end at and across page
+ *	boundaries. Build with TARGET=native; the exit status is the number
+ *	of failed tests.
+ */
+
+#include "contiki.h"
+
+#include "antelope.h"
+#include "relation.h"
+#include "storage.h"
+#include "unit-test.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Each relation spans several pages of DB_SCAN_PAGE_SIZE bytes. */
+#define ROWS 500
+
+/* The row lengths are those of a LONG followed by the attributes. */
+static const char * const layouts[] = {
+  "",
+  "INT",
+  "INT LONG",
+  "INT LONG LONG",
+};
+
+UNIT_TEST_REGISTER(scan_rows, "Sequential scans of all rows");
+UNIT_TEST_REGISTER(scan_select, "Selections over all rows");
+
+static unsigned failures;
+static unsigned char buffer[DB_SCAN_BUFFER_SIZE];
+/*---------------------------------------------------------------------------*/
+static db_result_t
+create(const char *layout)
+{
+  char domain[5];
+  unsigned attributes;
+  unsigned i;
+  long id;
+
+  db_query(NULL, "REMOVE RELATION rows;");
+  if(DB_ERROR(db_query(NULL, "CREATE RELATION rows;")) ||
+     DB_ERROR(db_query(NULL, "CREATE ATTRIBUTE id DOMAIN LONG IN rows;"))) {
+    return DB_STORAGE_ERROR;
+  }
+
+  for(attributes = 0; *layout != '\0'; attributes++) {
+    for(i = 0; *layout != ' ' && *layout != '\0'; i++) {
+      domain[i] = *layout++;
+    }
+    domain[i] = '\0';
+    while(*layout == ' ') {
+      layout++;
+    }
+    if(DB_ERROR(db_query(NULL, "CREATE ATTRIBUTE a%u DOMAIN %s IN rows;",
+                         attributes, domain))) {
+      return DB_STORAGE_ERROR;
+    }
+  }
+
+  for(id = 0; id < ROWS; id++) {
+    /* The other attributes are zero. */
+    if(DB_ERROR(db_query(NULL, attributes == 0 ? "INSERT (%ld) INTO rows;" :
+                         attributes == 1 ? "INSERT (%ld, 0) INTO rows;" :
+                         attributes == 2 ? "INSERT (%ld, 0, 0) INTO rows;" :
+                         "INSERT (%ld, 0, 0, 0) INTO rows;", id))) {
+      return DB_STORAGE_ERROR;
+    }
+  }
+  return DB_OK;
+}
+/*---------------------------------------------------------------------------*/
+/* Reads all rows through a cursor whose buffer has the given size. */
+static int
+scan(relation_t *rel, attribute_t *id, unsigned size)
+{
+  struct storage_scan scan;
+  attribute_value_t value;
+  storage_row_t row;
+  tuple_id_t tuple_id;
+
+  if(DB_ERROR(storage_scan_init(&scan, rel, buffer, size))) {
+    return 0;
+  }
+
+  for(tuple_id = 0; tuple_id < ROWS; tuple_id++) {
+    if(storage_scan_get(&scan, tuple_id, &row) != DB_OK ||
+       tuple_id < scan.first || tuple_id >= scan.first + scan.count ||
+       DB_ERROR(db_phy_to_value(&value, id, row)) ||
+       db_value_to_long(&value) != (long)tuple_id) {
+      printf("Row length %u, buffer size %u: tuple %lu was not read\n",
+             (unsigned)rel->row_length, size, (unsigned long)tuple_id);
+      return 0;
+    }
+  }
+  return storage_scan_get(&scan, tuple_id, &row) == DB_FINISHED;
+}
+/*---------------------------------------------------------------------------*/
+static long
+count(const char *predicate)
+{
+  db_handle_t handle;
+  db_result_t result;
+  long rows;
+
+  result = db_query(&handle, "SELECT id FROM rows WHERE %s;", predicate);
+  if(DB_ERROR(result)) {
+    return -1;
+  }
+
+  rows = 0;
+  while(db_processing(&handle)) {
+    result = db_process(&handle);
+    if(result == DB_GOT_ROW) {
+      rows++;
+    } else if(result != DB_OK) {
+      if(DB_ERROR(result)) {
+        rows = -1;
+      }
+      break;
+    }
+  }
+  db_free(&handle);
+  return rows;
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST(scan_rows)
+{
+  relation_t *rel;
+  attribute_t *id;
+  unsigned layout;
+  unsigned size;
+  int ok;
+
+  UNIT_TEST_BEGIN();
+
+  for(layout = 0; layout < sizeof(layouts) / sizeof(layouts[0]); layout++) {
+    UNIT_TEST_ASSERT(!DB_ERROR(create(layouts[layout])));
+    rel = relation_load("rows");
+    UNIT_TEST_ASSERT(rel != NULL);
+    id = relation_attribute_get(rel, "id");
+
+    /* Buffers of one row and of a few rows, and larger buffers of
+       sizes that are not multiples of the row length. */
+    ok = id != NULL;
+    for(size = rel->row_length; ok && size <= 4 * rel->row_length; size++) {
+      ok = scan(rel, id, size);
+    }
+    for(size = 50; ok && size <= sizeof(buffer); size += 23) {
+      ok = scan(rel, id, size);
+    }
+    if(ok) {
+      ok = scan(rel, id, sizeof(buffer));
+    }
+
+    relation_release(rel);
+    UNIT_TEST_ASSERT(ok);
+  }
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST(scan_select)
+{
+  unsigned layout;
+
+  UNIT_TEST_BEGIN();
+
+  /* Selections read the rows in batches, and evaluate the predicate
+     over each batch. */
+  for(layout = 0; layout < sizeof(layouts) / sizeof(layouts[0]); layout++) {
+    UNIT_TEST_ASSERT(!DB_ERROR(create(layouts[layout])));
+    UNIT_TEST_ASSERT(count("id >= 0") == ROWS);
+    UNIT_TEST_ASSERT(count("id < 100 OR id > 400") == 100 + ROWS - 401);
+  }
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(scan_tests_process, "Scan tests");
+AUTOSTART_PROCESSES(&scan_tests_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(scan_tests_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  db_init();
+
+  UNIT_TEST_RUN(scan_rows);
+  failures += UNIT_TEST_RESULT(scan_rows) == unit_test_failure;
+  UNIT_TEST_RUN(scan_select);
+  failures += UNIT_TEST_RESULT(scan_select) == unit_test_failure;
+
+  db_query(NULL, "REMOVE RELATION rows;");
+  exit(failures);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
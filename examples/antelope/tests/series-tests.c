@@ -0,0 +1,213 @@
+/*
+ * Copyright (c) 2015, EasyRF.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *	Regression tests for series relations in Antelope. Selections and
+ *	aggregates over a series relation, whose blocks may be skipped by
+ *	their summaries, are compared with those over a plain relation
+ *	with the same rows. Build with TARGET=native; the exit status is
+ *	the number of failed tests.
+ */
+
+#include "contiki.h"
+
+#include "antelope.h"
+#include "unit-test.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* The rows fill many blocks of DB_SERIES_BLOCK_SIZE bytes. */
+#define ROWS 3000L
+
+/* The values of a run of rows in the middle are all negative. */
+#define NEGATIVE_FIRST 1000L
+#define NEGATIVE_END   1500L
+
+UNIT_TEST_REGISTER(series_negative, "Series with negative INT values");
+
+static unsigned failures;
+/*---------------------------------------------------------------------------*/
+static int
+value(long row)
+{
+  if(row >= NEGATIVE_FIRST && row < NEGATIVE_END) {
+    return -(int)(row % 50) - 1;
+  }
+  return (int)((row * 37) % 201) - 100;
+}
+/*---------------------------------------------------------------------------*/
+static db_result_t
+create(const char *relation, const char *type)
+{
+  long row;
+
+  db_query(NULL, "REMOVE RELATION %s;", relation);
+  if(DB_ERROR(db_query(NULL, "CREATE RELATION %s%s;", relation, type)) ||
+     DB_ERROR(db_query(NULL, "CREATE ATTRIBUTE time DOMAIN LONG IN %s;",
+                       relation)) ||
+     DB_ERROR(db_query(NULL, "CREATE ATTRIBUTE value DOMAIN INT IN %s;",
+                       relation))) {
+    return DB_STORAGE_ERROR;
+  }
+
+  for(row = 0; row < ROWS; row++) {
+    if(DB_ERROR(db_query(NULL, "INSERT (%ld, %d) INTO %s;",
+                         row, value(row), relation))) {
+      return DB_STORAGE_ERROR;
+    }
+  }
+  return DB_OK;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Runs a query on a relation, and returns the number of rows, or the
+ * value of the last row if the query has an aggregate.
+ */
+static long
+query(const char *relation, const char *attributes, const char *predicate)
+{
+  db_handle_t handle;
+  db_result_t result;
+  attribute_value_t v;
+  long rows;
+  long last;
+
+  result = db_query(&handle, "SELECT %s FROM %s WHERE %s;",
+                    attributes, relation, predicate);
+  if(DB_ERROR(result)) {
+    printf("%s: %s\n", predicate, db_get_result_message(result));
+    return LONG_MIN;
+  }
+
+  rows = 0;
+  last = LONG_MIN;
+  while(db_processing(&handle)) {
+    result = db_process(&handle);
+    if(result == DB_GOT_ROW) {
+      rows++;
+      if(!DB_ERROR(db_get_value(&v, &handle, 0))) {
+        last = db_value_to_long(&v);
+      }
+    } else if(result != DB_OK) {
+      if(DB_ERROR(result)) {
+        rows = LONG_MIN;
+      }
+      break;
+    }
+  }
+  db_free(&handle);
+  return attributes[0] == 'M' ? last : rows;
+}
+/*---------------------------------------------------------------------------*/
+/* Checks that a series relation and a plain relation agree. */
+static int
+agree(const char *attributes, const char *predicate, long expected)
+{
+  long series;
+  long plain;
+
+  series = query("readings", attributes, predicate);
+  plain = query("plain", attributes, predicate);
+  if(series != expected || plain != expected) {
+    printf("SELECT %s WHERE %s: series %ld, plain %ld, expected %ld\n",
+           attributes, predicate, series, plain, expected);
+    return 0;
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST(series_negative)
+{
+  long row;
+  long negative;
+  long low;
+  long near_zero;
+  long min;
+  long max;
+
+  UNIT_TEST_BEGIN();
+
+  UNIT_TEST_ASSERT(!DB_ERROR(create("readings", " TYPE SERIES")));
+  UNIT_TEST_ASSERT(!DB_ERROR(create("plain", "")));
+
+  negative = low = near_zero = 0;
+  min = max = value(0);
+  for(row = 0; row < ROWS; row++) {
+    negative += value(row) < 0;
+    low += value(row) < -50;
+    near_zero += value(row) > -3 && value(row) < 3;
+    if(value(row) < min) {
+      min = value(row);
+    }
+    if(value(row) > max) {
+      max = value(row);
+    }
+  }
+
+  /* Blocks are skipped if their summaries show that none of their
+     rows can match. */
+  UNIT_TEST_ASSERT(agree("time", "value < 0", negative));
+  UNIT_TEST_ASSERT(agree("time", "value < -50", low));
+  UNIT_TEST_ASSERT(agree("time", "value > -3 AND value < 3", near_zero));
+  UNIT_TEST_ASSERT(agree("time", "value > 100", 0));
+
+  /* Blocks are skipped if their extremes cannot change the result. */
+  UNIT_TEST_ASSERT(agree("MIN(value)", "time >= 0", min));
+  UNIT_TEST_ASSERT(agree("MAX(value)", "time >= 0", max));
+  UNIT_TEST_ASSERT(agree("MAX(value)", "time >= 1000 AND time < 1500", -1));
+  UNIT_TEST_ASSERT(agree("MIN(value)", "time >= 1000 AND time < 1500", -50));
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(series_tests_process, "Series tests");
+AUTOSTART_PROCESSES(&series_tests_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(series_tests_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  db_init();
+
+  UNIT_TEST_RUN(series_negative);
+  failures += UNIT_TEST_RESULT(series_negative) == unit_test_failure;
+
+  db_query(NULL, "REMOVE RELATION readings;");
+  db_query(NULL, "REMOVE RELATION plain;");
+  exit(failures);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,355 @@
+/*
+ * Copyright (c) 2015, EasyRF.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *	Unit tests for SHA-256 and the delta patcher: the FIPS 180-2
+ *	known-answer vectors, a patch made by tools/deltadiff applied from
+ *	a file and as a stream, padding after the last record, a truncated
+ *	patch and a wrong base image. Build with TARGET=native; the exit
+ *	status is the number of failed tests.
+ */
+
+#include "contiki.h"
+#include "cfs/cfs.h"
+
+#include "delta.h"
+#include "lib/sha256.h"
+#include "unit-test.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BASE_SIZE  8000
+#define NEW_SIZE   (BASE_SIZE + 20 - 50 + 300)
+#define CHUNK_SIZE 7
+
+UNIT_TEST_REGISTER(sha256_vectors, "SHA-256 known answers");
+UNIT_TEST_REGISTER(patch_file, "Patch round trip from a file");
+UNIT_TEST_REGISTER(patch_stream, "Patch round trip as a stream");
+UNIT_TEST_REGISTER(patch_trailing, "Bytes after the last record");
+UNIT_TEST_REGISTER(patch_truncated, "Truncated patch");
+UNIT_TEST_REGISTER(patch_wrong_base, "Wrong base image");
+
+int deltadiff_main(int argc, char **argv);
+
+static uint8_t base[BASE_SIZE];
+static uint8_t new[NEW_SIZE];
+static unsigned failures;
+/*---------------------------------------------------------------------------*/
+PROCESS(delta_tests_process, "Delta tests");
+AUTOSTART_PROCESSES(&delta_tests_process);
+/*---------------------------------------------------------------------------*/
+static int
+check_digest(const char *message, long repeat, const char *expected)
+{
+  struct sha256_state state;
+  uint8_t digest[SHA256_DIGEST_LENGTH];
+  char hex[2 * SHA256_DIGEST_LENGTH + 1];
+  int i;
+
+  sha256_init(&state);
+  while(repeat-- > 0) {
+    sha256_update(&state, (const uint8_t *)message, strlen(message));
+  }
+  sha256_finish(&state, digest);
+
+  for(i = 0; i < SHA256_DIGEST_LENGTH; i++) {
+    sprintf(&hex[2 * i], "%02x", digest[i]);
+  }
+  return strcmp(hex, expected) == 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+write_file(const char *name, const uint8_t *data, int len)
+{
+  int fd;
+  int n;
+
+  cfs_remove(name);
+  fd = cfs_open(name, CFS_WRITE);
+  if(fd < 0) {
+    return 0;
+  }
+  n = cfs_write(fd, data, len);
+  cfs_close(fd);
+  return n == len;
+}
+/*---------------------------------------------------------------------------*/
+static int
+read_file(const char *name, uint8_t *data, int len)
+{
+  int fd;
+  int n;
+
+  fd = cfs_open(name, CFS_READ);
+  if(fd < 0) {
+    return -1;
+  }
+  n = cfs_read(fd, data, len);
+  cfs_close(fd);
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+/* Checks that a file holds exactly the new image. */
+static int
+is_new_image(const char *name)
+{
+  static uint8_t buf[NEW_SIZE + 1];
+
+  return read_file(name, buf, sizeof(buf)) == NEW_SIZE &&
+    memcmp(buf, new, NEW_SIZE) == 0;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Makes a base image of pseudo-random bytes, and a new image as a
+ * recompiled program would differ from it: bytes inserted, bytes
+ * changed by a constant, bytes removed and a new tail.
+ */
+static int
+make_images(void)
+{
+  static char *argv[] = { "deltadiff", "base.bin", "new.bin", "test.patch" };
+  uint32_t x = 1;
+  int i, n;
+
+  for(i = 0; i < BASE_SIZE; i++) {
+    x = x * 1103515245 + 12345;
+    base[i] = x >> 16;
+  }
+
+  n = 0;
+  memcpy(&new[n], base, 1000);
+  n += 1000;
+  memset(&new[n], 0xa5, 20);
+  n += 20;
+  for(i = 1000; i < 6000; i++) {
+    new[n++] = i >= 3000 && i < 3100 ? base[i] + 4 : base[i];
+  }
+  memcpy(&new[n], &base[6050], BASE_SIZE - 6050);
+  n += BASE_SIZE - 6050;
+  for(i = 0; i < 300; i++) {
+    new[n++] = i;
+  }
+
+  return n == NEW_SIZE &&
+    write_file("base.bin", base, BASE_SIZE) &&
+    write_file("new.bin", new, NEW_SIZE) &&
+    deltadiff_main(4, argv) == 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Applies a patch file in small chunks. */
+static int
+patch_stream(const char *base_name, const char *patch_name, int len)
+{
+  static struct delta_patch p;
+  static uint8_t patch[NEW_SIZE];
+  int base_fd, new_fd;
+  int err, i;
+
+  if(len < 0 || read_file(patch_name, patch, sizeof(patch)) != len) {
+    return DELTA_IO_ERROR;
+  }
+
+  cfs_remove("stream.bin");
+  base_fd = cfs_open(base_name, CFS_READ);
+  new_fd = cfs_open("stream.bin", CFS_READ | CFS_WRITE);
+  if(base_fd < 0 || new_fd < 0) {
+    return DELTA_IO_ERROR;
+  }
+
+  delta_patch_init(&p, base_fd, new_fd);
+  err = DELTA_OK;
+  for(i = 0; err == DELTA_OK && i < len; i += CHUNK_SIZE) {
+    err = delta_patch_input(&p, &patch[i],
+                            i + CHUNK_SIZE < len ? CHUNK_SIZE : len - i);
+  }
+  if(err == DELTA_OK) {
+    err = delta_patch_finish(&p);
+  }
+
+  cfs_close(base_fd);
+  cfs_close(new_fd);
+  return err;
+}
+/*---------------------------------------------------------------------------*/
+static int
+patch_size(const char *name)
+{
+  static uint8_t buf[NEW_SIZE];
+
+  return read_file(name, buf, sizeof(buf));
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST(sha256_vectors)
+{
+  UNIT_TEST_BEGIN();
+
+  UNIT_TEST_ASSERT(check_digest("", 1,
+    "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"));
+  UNIT_TEST_ASSERT(check_digest("abc", 1,
+    "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"));
+  UNIT_TEST_ASSERT(check_digest(
+    "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", 1,
+    "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1"));
+  /* One million times 'a', fed in pieces that do not align with the
+     64-byte blocks. */
+  UNIT_TEST_ASSERT(check_digest("aaaaaaaaaaaaaaaaaaaaaaaaa", 40000,
+    "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0"));
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST(patch_file)
+{
+  UNIT_TEST_BEGIN();
+
+  UNIT_TEST_ASSERT(delta_patch_file("base.bin", "test.patch", "out.bin") ==
+                   DELTA_OK);
+  UNIT_TEST_ASSERT(is_new_image("out.bin"));
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST(patch_stream)
+{
+  UNIT_TEST_BEGIN();
+
+  UNIT_TEST_ASSERT(patch_stream("base.bin", "test.patch",
+                                patch_size("test.patch")) == DELTA_OK);
+  UNIT_TEST_ASSERT(is_new_image("stream.bin"));
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST(patch_trailing)
+{
+  static uint8_t patch[NEW_SIZE];
+  int len;
+
+  UNIT_TEST_BEGIN();
+
+  /* Pad the patch to a whole number of pages, as Deluge does. */
+  len = patch_size("test.patch");
+  UNIT_TEST_ASSERT(len > 0 && len < NEW_SIZE - 256);
+  read_file("test.patch", patch, len);
+  memset(&patch[len], 0xff, 256 - len % 256);
+  len += 256 - len % 256;
+  UNIT_TEST_ASSERT(write_file("padded.patch", patch, len));
+
+  UNIT_TEST_ASSERT(delta_patch_file("base.bin", "padded.patch", "out.bin") ==
+                   DELTA_OK);
+  UNIT_TEST_ASSERT(is_new_image("out.bin"));
+  UNIT_TEST_ASSERT(patch_stream("base.bin", "padded.patch", len) == DELTA_OK);
+  UNIT_TEST_ASSERT(is_new_image("stream.bin"));
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST(patch_truncated)
+{
+  static uint8_t patch[NEW_SIZE];
+  int len;
+
+  UNIT_TEST_BEGIN();
+
+  len = patch_size("test.patch");
+  UNIT_TEST_ASSERT(len > DELTA_HEADER_SIZE);
+  read_file("test.patch", patch, len);
+  UNIT_TEST_ASSERT(write_file("short.patch", patch, len - 1));
+
+  UNIT_TEST_ASSERT(delta_patch_file("base.bin", "short.patch", "out.bin") ==
+                   DELTA_INCOMPLETE);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST(patch_wrong_base)
+{
+  static uint8_t other[BASE_SIZE];
+  uint8_t c;
+
+  UNIT_TEST_BEGIN();
+
+  /* A base image of the right size that differs in one byte. */
+  memcpy(other, base, BASE_SIZE);
+  other[BASE_SIZE / 2] ^= 1;
+  UNIT_TEST_ASSERT(write_file("other.bin", other, BASE_SIZE));
+
+  UNIT_TEST_ASSERT(delta_patch_file("other.bin", "test.patch", "out.bin") ==
+                   DELTA_BAD_BASE);
+  /* Nothing has been written. */
+  UNIT_TEST_ASSERT(read_file("out.bin", &c, 1) == 0);
+  UNIT_TEST_ASSERT(patch_stream("other.bin", "test.patch",
+                                patch_size("test.patch")) == DELTA_BAD_BASE);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(delta_tests_process, ev, data)
+{
+  static const char *files[] = {
+    "base.bin", "new.bin", "other.bin", "out.bin", "stream.bin",
+    "test.patch", "padded.patch", "short.patch"
+  };
+  int i;
+
+  PROCESS_BEGIN();
+
+  UNIT_TEST_RUN(sha256_vectors);
+  failures += UNIT_TEST_RESULT(sha256_vectors) == unit_test_failure;
+
+  if(!make_images()) {
+    printf("Could not make the test patch\n");
+    exit(1 + failures);
+  }
+
+  UNIT_TEST_RUN(patch_file);
+  failures += UNIT_TEST_RESULT(patch_file) == unit_test_failure;
+  UNIT_TEST_RUN(patch_stream);
+  failures += UNIT_TEST_RESULT(patch_stream) == unit_test_failure;
+  UNIT_TEST_RUN(patch_trailing);
+  failures += UNIT_TEST_RESULT(patch_trailing) == unit_test_failure;
+  UNIT_TEST_RUN(patch_truncated);
+  failures += UNIT_TEST_RESULT(patch_truncated) == unit_test_failure;
+  UNIT_TEST_RUN(patch_wrong_base);
+  failures += UNIT_TEST_RESULT(patch_wrong_base) == unit_test_failure;
+
+  for(i = 0; i < sizeof(files) / sizeof(files[0]); i++) {
+    cfs_remove(files[i]);
+  }
+  exit(failures);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
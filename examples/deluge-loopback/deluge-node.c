@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2015, EasyRF.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *	A Deluge node for the native platform, to measure how long the
+ *	dissemination of an image takes. Node 1 has version 1 of the
+ *	image and the other nodes have version 0. Every block of the
+ *	image holds its version and number, so a node knows that it has
+ *	received the whole image when every block has been updated. It
+ *	then prints the time since it started and the number of frames
+ *	it has sent. See run-deluge.sh.
+ */
+
+#include "contiki.h"
+#include "cfs/cfs.h"
+#include "deluge.h"
+#include "net/linkaddr.h"
+#include "loopback-radio.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define SOURCE_ID  1
+#define BLOCK_SIZE 32
+
+PROCESS(deluge_node_process, "Deluge node");
+AUTOSTART_PROCESSES(&deluge_node_process);
+/*---------------------------------------------------------------------------*/
+static void
+make_block(char *block, int version, int i)
+{
+  memset(block, 0, BLOCK_SIZE);
+  sprintf(block, "version %d block %d", version, i);
+}
+/*---------------------------------------------------------------------------*/
+static int
+is_updated(void)
+{
+  char block[BLOCK_SIZE], expected[BLOCK_SIZE];
+  int fd, i;
+
+  fd = cfs_open("test", CFS_READ);
+  if(fd < 0) {
+    return 0;
+  }
+  for(i = 0; i < IMAGE_SIZE / BLOCK_SIZE; i++) {
+    make_block(expected, 1, i);
+    if(cfs_read(fd, block, BLOCK_SIZE) != BLOCK_SIZE ||
+       memcmp(block, expected, BLOCK_SIZE) != 0) {
+      break;
+    }
+  }
+  cfs_close(fd);
+  return i == IMAGE_SIZE / BLOCK_SIZE;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(deluge_node_process, ev, data)
+{
+  static struct etimer et;
+  static clock_time_t start;
+  char block[BLOCK_SIZE];
+  linkaddr_t addr;
+  int fd, i;
+
+  PROCESS_BEGIN();
+
+  memset(&addr, 0, sizeof(addr));
+  addr.u8[0] = loopback_node_id;
+  linkaddr_set_node_addr(&addr);
+
+  cfs_remove("test");
+  fd = cfs_open("test", CFS_WRITE);
+  if(fd < 0) {
+    process_exit(NULL);
+  }
+  for(i = 0; i < IMAGE_SIZE / BLOCK_SIZE; i++) {
+    make_block(block, loopback_node_id == SOURCE_ID, i);
+    cfs_write(fd, block, BLOCK_SIZE);
+  }
+  cfs_close(fd);
+
+  start = clock_time();
+  deluge_disseminate("test", loopback_node_id == SOURCE_ID);
+
+  if(loopback_node_id != SOURCE_ID) {
+    etimer_set(&et, CLOCK_SECOND / 4);
+    do {
+      PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+      etimer_reset(&et);
+    } while(!is_updated());
+    printf("DONE %d %lu ms tx %lu\n", loopback_node_id,
+           (unsigned long)(clock_time() - start) * 1000 / CLOCK_SECOND,
+           loopback_tx);
+  }
+
+  /* Keep serving the image to the other nodes. */
+  etimer_set(&et, CLOCK_SECOND * 10);
+  for(;;) {
+    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+    printf("TX %d %lu\n", loopback_node_id, loopback_tx);
+    etimer_reset(&et);
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,253 @@
+/*
+ * Copyright (c) 2015, EasyRF.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *	A radio driver for the native platform that connects the nodes
+ *	of a test, each of which is a process on the same host, over
+ *	UDP on the loopback interface. Node i receives on port
+ *	LOOPBACK_PORT + i. The nodes are laid out on a grid and a frame
+ *	reaches the four nodes next to the sender.
+ *
+ *	The node is configured with environment variables: NODE_ID,
+ *	NODE_COUNT, GRID_WIDTH (1 for a line of nodes) and LOSS, the
+ *	percentage of frames that are dropped on reception.
+ */
+
+#include "contiki.h"
+#include "dev/radio.h"
+#include "net/netstack.h"
+#include "net/packetbuf.h"
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "loopback-radio.h"
+
+#define LOOPBACK_PORT 9000
+
+/* A frame of 60 bytes takes about 2 ms to send at 250 kbit/s. */
+#define AIR_TIME_US 3000
+
+int loopback_node_id;
+unsigned long loopback_tx;
+
+static int node_count, grid_width = 1, loss;
+static int fd;
+/*---------------------------------------------------------------------------*/
+static int
+set_fd(fd_set *rset, fd_set *wset)
+{
+  FD_SET(fd, rset);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+handle_fd(fd_set *rset, fd_set *wset)
+{
+  int len;
+
+  if(FD_ISSET(fd, rset)) {
+    packetbuf_clear();
+    len = recv(fd, packetbuf_dataptr(), PACKETBUF_SIZE, 0);
+    if(len > 0 && rand() % 100 >= loss) {
+      packetbuf_set_datalen(len);
+      NETSTACK_RDC.input();
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static const struct select_callback radio_callback = { set_fd, handle_fd };
+/*---------------------------------------------------------------------------*/
+static int
+getenv_int(const char *name, int def)
+{
+  const char *value;
+
+  value = getenv(name);
+  return value != NULL ? atoi(value) : def;
+}
+/*---------------------------------------------------------------------------*/
+static void
+set_address(struct sockaddr_in *addr, int node)
+{
+  memset(addr, 0, sizeof(*addr));
+  addr->sin_family = AF_INET;
+  addr->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr->sin_port = htons(LOOPBACK_PORT + node);
+}
+/*---------------------------------------------------------------------------*/
+static int
+init(void)
+{
+  struct sockaddr_in addr;
+
+  loopback_node_id = getenv_int("NODE_ID", 1);
+  node_count = getenv_int("NODE_COUNT", 1);
+  grid_width = getenv_int("GRID_WIDTH", 1);
+  loss = getenv_int("LOSS", 0);
+  srand(loopback_node_id);
+
+  fd = socket(AF_INET, SOCK_DGRAM, 0);
+  set_address(&addr, loopback_node_id);
+  if(fd < 0 || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    perror("loopback-radio");
+    exit(1);
+  }
+  select_set_callback(fd, &radio_callback);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+is_neighbor(int a, int b)
+{
+  int ax, ay, bx, by;
+
+  ax = (a - 1) % grid_width;
+  ay = (a - 1) / grid_width;
+  bx = (b - 1) % grid_width;
+  by = (b - 1) / grid_width;
+  return abs(ax - bx) + abs(ay - by) == 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+radio_send(const void *payload, unsigned short payload_len)
+{
+  struct sockaddr_in addr;
+  int i;
+
+  loopback_tx++;
+  usleep(AIR_TIME_US);
+  for(i = 1; i <= node_count; i++) {
+    if(is_neighbor(i, loopback_node_id)) {
+      set_address(&addr, i);
+      sendto(fd, payload, payload_len, 0,
+             (struct sockaddr *)&addr, sizeof(addr));
+    }
+  }
+  return RADIO_TX_OK;
+}
+/*---------------------------------------------------------------------------*/
+static int
+prepare(const void *payload, unsigned short payload_len)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+transmit(unsigned short transmit_len)
+{
+  return RADIO_TX_OK;
+}
+/*---------------------------------------------------------------------------*/
+static int
+radio_read(void *buf, unsigned short buf_len)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+channel_clear(void)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+receiving_packet(void)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+pending_packet(void)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+on(void)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+off(void)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static radio_result_t
+get_value(radio_param_t param, radio_value_t *value)
+{
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+/*---------------------------------------------------------------------------*/
+static radio_result_t
+set_value(radio_param_t param, radio_value_t value)
+{
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+/*---------------------------------------------------------------------------*/
+static radio_result_t
+get_object(radio_param_t param, void *dest, size_t size)
+{
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+/*---------------------------------------------------------------------------*/
+static radio_result_t
+set_object(radio_param_t param, const void *src, size_t size)
+{
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+/*---------------------------------------------------------------------------*/
+const struct radio_driver loopback_radio_driver = {
+  init,
+  prepare,
+  transmit,
+  radio_send,
+  radio_read,
+  channel_clear,
+  receiving_packet,
+  pending_packet,
+  on,
+  off,
+  get_value,
+  set_value,
+  get_object,
+  set_object
+};
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,38 @@
+#!/bin/bash
+#
+# Runs a Deluge dissemination with one deluge-node process per node,
+# in a directory of its own under nodes/, and prints the time at which
+# the last receivers had the whole image.
+#
+# usage: run-deluge.sh <nodes> <grid width> <loss %> <timeout s>
+#
+#   ./run-deluge.sh 5 1 0 300     a line of 5 nodes
+#   ./run-deluge.sh 25 5 10 300   a 5x5 grid with 10% packet loss
+
+NODES=${1:-5}
+WIDTH=${2:-1}
+LOSS=${3:-0}
+TIMEOUT=${4:-300}
+BIN=$(pwd)/deluge-node.native
+
+rm -rf nodes
+mkdir nodes
+pids=()
+for i in $(seq 1 $NODES); do
+  mkdir nodes/$i
+  (cd nodes/$i && NODE_ID=$i NODE_COUNT=$NODES GRID_WIDTH=$WIDTH LOSS=$LOSS \
+   exec $BIN > log 2>&1) &
+  pids+=($!)
+done
+
+end=$((SECONDS + TIMEOUT))
+while [ $SECONDS -lt $end ]; do
+  done=$(cat nodes/*/log | grep -c DONE)
+  [ "$done" -ge $((NODES - 1)) ] && break
+  sleep 1
+done
+kill "${pids[@]}" 2>/dev/null
+wait 2>/dev/null
+
+grep -h DONE nodes/*/log | sort -k3 -n | tail -3
+echo "$(grep -h DONE nodes/*/log | wc -l) of $((NODES - 1)) receivers done"
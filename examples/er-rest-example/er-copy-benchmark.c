@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2015, EasyRF.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *      Counts the bytes Erbium copies with memcpy() and memmove() while
+ *      handling a request, from the received datagram to the outgoing
+ *      response. Build it explicitly with
+ *      "make TARGET=native er-copy-benchmark".
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "contiki.h"
+#include "contiki-net.h"
+#include "rest-engine.h"
+#include "er-coap.h"
+
+#define REQUEST_BUF ((uint8_t *)&uip_buf[UIP_LLH_LEN + UIP_IPUDPH_LEN])
+
+PROCESS_NAME(coap_engine);
+
+void *__real_memcpy(void *dst, const void *src, size_t n);
+void *__real_memmove(void *dst, const void *src, size_t n);
+void *__real___memcpy_chk(void *dst, const void *src, size_t n, size_t size);
+void *__real___memmove_chk(void *dst, const void *src, size_t n, size_t size);
+
+static unsigned long copied;
+static unsigned long sent;
+static uint16_t response_len;
+
+/*---------------------------------------------------------------------------*/
+void *
+__wrap_memcpy(void *dst, const void *src, size_t n)
+{
+  copied += n;
+  return __real_memcpy(dst, src, n);
+}
+/*---------------------------------------------------------------------------*/
+void *
+__wrap_memmove(void *dst, const void *src, size_t n)
+{
+  copied += n;
+  return __real_memmove(dst, src, n);
+}
+/*---------------------------------------------------------------------------*/
+/* Used instead of memcpy() and memmove() with _FORTIFY_SOURCE */
+void *
+__wrap___memcpy_chk(void *dst, const void *src, size_t n, size_t size)
+{
+  copied += n;
+  return __real___memcpy_chk(dst, src, n, size);
+}
+/*---------------------------------------------------------------------------*/
+void *
+__wrap___memmove_chk(void *dst, const void *src, size_t n, size_t size)
+{
+  copied += n;
+  return __real___memmove_chk(dst, src, n, size);
+}
+/*---------------------------------------------------------------------------*/
+/* The response ends here instead of going down the network stack */
+void
+__wrap_tcpip_ipv6_output(void)
+{
+  sent++;
+  response_len = uip_len - UIP_IPUDPH_LEN;
+  uip_len = 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+get_handler(void *request, void *response, uint8_t *buffer,
+            uint16_t preferred_size, int32_t *offset)
+{
+  const char *query;
+  int length = REST_MAX_CHUNK_SIZE;
+
+  if(REST.get_query(request, &query) > 0) {
+    length /= 2;
+  }
+  memset(buffer, 'x', length);
+  REST.set_header_content_type(response, REST.type.TEXT_PLAIN);
+  REST.set_response_payload(response, buffer, length);
+}
+RESOURCE(res_copy, "", get_handler, NULL, NULL, NULL);
+/*---------------------------------------------------------------------------*/
+static void
+measure(const char *name, coap_message_type_t type, const char *path,
+        const char *query)
+{
+  static coap_packet_t request[1];
+  static uint8_t token[] = { 0xCA, 0xFE };
+  uint16_t length;
+
+  coap_init_message(request, type, COAP_GET, coap_get_mid());
+  coap_set_token(request, token, sizeof(token));
+  coap_set_header_uri_path(request, path);
+  if(query != NULL) {
+    coap_set_header_uri_query(request, query);
+  }
+  length = coap_serialize_message(request, REQUEST_BUF);
+
+  /* pretend the request has just been received */
+  uip_ip6addr(&UIP_IP_BUF->srcipaddr, 0xfe80, 0, 0, 0, 0, 0, 0, 1);
+  UIP_UDP_BUF->srcport = UIP_HTONS(COAP_DEFAULT_PORT);
+  uip_ext_len = 0;
+  uip_appdata = REQUEST_BUF;
+  uip_len = length;
+  uip_flags = UIP_NEWDATA;
+
+  copied = 0;
+  sent = 0;
+  process_post_synch(&coap_engine, tcpip_event, NULL);
+
+  printf("%-10s request %2u B, response %2u B: %3lu bytes copied\n",
+         name, length, sent ? response_len : 0, copied);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(er_copy_benchmark, "Erbium copy benchmark");
+AUTOSTART_PROCESSES(&er_copy_benchmark);
+
+PROCESS_THREAD(er_copy_benchmark, ev, data)
+{
+  PROCESS_BEGIN();
+
+  rest_init_engine();
+  rest_activate_resource(&res_copy, "bench/copy/resource");
+
+  measure("CON", COAP_TYPE_CON, "bench/copy/resource", NULL);
+  measure("NON", COAP_TYPE_NON, "bench/copy/resource", NULL);
+  measure("query", COAP_TYPE_CON, "bench/copy/resource", "a=1&b=2");
+  measure("not found", COAP_TYPE_CON, "bench/missing", NULL);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2015, EasyRF.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *      Measures how long the REST Engine takes to dispatch a request to
+ *      the matching resource depending on the number of resources.
+ *      Build it explicitly with "make TARGET=native er-dispatch-benchmark".
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "contiki.h"
+#include "sys/rtimer.h"
+#include "rest-engine.h"
+#include "er-coap.h"
+
+#ifdef DISPATCH_BENCHMARK_CONF_ITERATIONS
+#define ITERATIONS DISPATCH_BENCHMARK_CONF_ITERATIONS
+#else /* DISPATCH_BENCHMARK_CONF_ITERATIONS */
+#define ITERATIONS 10000
+#endif /* DISPATCH_BENCHMARK_CONF_ITERATIONS */
+
+#define MAX_RESOURCES 64
+
+static resource_t resources[MAX_RESOURCES];
+static char urls[MAX_RESOURCES][20];
+static unsigned long handled;
+
+PARENT_RESOURCE(res_parent, NULL, NULL, NULL, NULL, NULL);
+
+static const uint8_t resource_counts[] = { 1, 8, 16, 32, 64 };
+
+/*---------------------------------------------------------------------------*/
+static void
+get_handler(void *request, void *response, uint8_t *buffer,
+            uint16_t preferred_size, int32_t *offset)
+{
+  handled++;
+}
+/*---------------------------------------------------------------------------*/
+static void
+measure(const char *name, uint8_t count, const char *path)
+{
+  static coap_packet_t request[1];
+  static coap_packet_t response[1];
+  uint8_t buffer[REST_MAX_CHUNK_SIZE];
+  int32_t offset;
+  rtimer_clock_t start;
+  rtimer_clock_t ticks;
+  uint32_t i;
+
+  coap_init_message(request, COAP_TYPE_CON, COAP_GET, 0);
+  coap_set_header_uri_path(request, path);
+
+  start = RTIMER_NOW();
+  for(i = 0; i < ITERATIONS; i++) {
+    coap_init_message(response, COAP_TYPE_ACK, CONTENT_2_05, 0);
+    offset = 0;
+    rest_invoke_restful_service(request, response, buffer,
+                                sizeof(buffer), &offset);
+  }
+  ticks = RTIMER_NOW() - start;
+
+  printf("%-7s %2u resources: %5u ticks per %lu requests, %5lu ns per request\n",
+         name, count, (unsigned)ticks, (unsigned long)ITERATIONS,
+         (unsigned long)((uint32_t)ticks * (1000000000UL / RTIMER_SECOND)
+                         / ITERATIONS));
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(er_dispatch_benchmark, "Erbium dispatch benchmark");
+AUTOSTART_PROCESSES(&er_dispatch_benchmark);
+
+PROCESS_THREAD(er_dispatch_benchmark, ev, data)
+{
+  static uint8_t activated;
+  uint8_t i;
+
+  PROCESS_BEGIN();
+
+  rest_init_engine();
+  res_parent.get_handler = get_handler;
+  rest_activate_resource(&res_parent, "bench/parent");
+
+  activated = 0;
+  for(i = 0; i < sizeof(resource_counts); i++) {
+    for(; activated < resource_counts[i]; activated++) {
+      snprintf(urls[activated], sizeof(urls[activated]),
+               "bench/res%u", activated);
+      resources[activated].get_handler = get_handler;
+      rest_activate_resource(&resources[activated], urls[activated]);
+    }
+
+    measure("first", activated, urls[0]);
+    measure("last", activated, urls[activated - 1]);
+    measure("sub", activated, "bench/parent/sub/resource");
+    measure("missing", activated, "bench/missing");
+  }
+
+  printf("Handled %lu requests\n", handled);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
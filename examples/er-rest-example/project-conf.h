@@ -87,6 +87,12 @@
    #define COAP_MAX_OBSERVERS             2
  */
 
+/* Caches GET responses of resources that set a Max-Age. */
+/*
+   #undef COAP_RESPONSE_CACHE_SIZE
+   #define COAP_RESPONSE_CACHE_SIZE       2
+ */
+
 /* Filtering .well-known/core per query can be disabled to save space. */
 #undef COAP_LINK_FORMAT_FILTERING
 #define COAP_LINK_FORMAT_FILTERING     0
@@ -0,0 +1,347 @@
+/*
+ * Copyright (c) 2015, EasyRF.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *	Tests for pipelined blockwise transfers. The node downloads a CFS
+ *	file with Block2 and uploads data with Block1 from its own server,
+ *	with the packets of a window delivered out of order and with lost
+ *	packets, and uploads to a server that asks for smaller blocks than
+ *	the client started with (RFC 7959, 2.3). Build with TARGET=native;
+ *	the exit status is the number of failed tests.
+ */
+
+#include "contiki.h"
+#include "contiki-net.h"
+#include "cfs/cfs.h"
+
+#include "rest-engine.h"
+#include "er-coap.h"
+#include "er-coap-engine.h"
+#include "er-coap-block1.h"
+#include "er-coap-block2.h"
+#include "test-net.h"
+#include "unit-test.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FILE_NAME   "block-tests.bin"
+#define FILE_SIZE   1000
+#define UPLOAD_SIZE 700
+#define SMALL_SIZE  32
+
+UNIT_TEST_REGISTER(block2_reorder, "Block2 out of order");
+UNIT_TEST_REGISTER(block2_loss, "Block2 with lost packets");
+UNIT_TEST_REGISTER(block1_reorder, "Block1 out of order");
+UNIT_TEST_REGISTER(block1_loss, "Block1 with lost packets");
+UNIT_TEST_REGISTER(block1_smaller, "Block1 with a smaller server size");
+
+static void file_get_handler(void *request, void *response, uint8_t *buffer,
+                             uint16_t preferred_size, int32_t *offset);
+static void upload_put_handler(void *request, void *response,
+                               uint8_t *buffer, uint16_t preferred_size,
+                               int32_t *offset);
+static void small_put_handler(void *request, void *response,
+                              uint8_t *buffer, uint16_t preferred_size,
+                              int32_t *offset);
+
+RESOURCE(res_file, "", file_get_handler, NULL, NULL, NULL);
+RESOURCE(res_upload, "", NULL, NULL, upload_put_handler, NULL);
+RESOURCE(res_small, "", NULL, NULL, small_put_handler, NULL);
+
+static uint8_t source[FILE_SIZE];
+static uint8_t received[FILE_SIZE + 1];
+static size_t received_len;
+static unsigned received_blocks;
+static unsigned small_requests;
+static unsigned small_wrong_size;
+
+/* The transfer that the client process makes */
+static struct blockwise_state_t state;
+static coap_packet_t request[1];
+static uip_ipaddr_t server_addr;
+static uint32_t upload_len;
+static uint8_t max_in_flight;
+static uint8_t done;
+
+static unsigned failures;
+/*---------------------------------------------------------------------------*/
+PROCESS(block_tests_process, "Block tests");
+PROCESS(block_client_process, "Block client");
+AUTOSTART_PROCESSES(&block_tests_process);
+/*---------------------------------------------------------------------------*/
+static void
+file_get_handler(void *request, void *response, uint8_t *buffer,
+                 uint16_t preferred_size, int32_t *offset)
+{
+  coap_block2_cfs_handler(response, FILE_NAME, buffer, preferred_size, offset);
+}
+/*---------------------------------------------------------------------------*/
+static void
+upload_put_handler(void *request, void *response, uint8_t *buffer,
+                   uint16_t preferred_size, int32_t *offset)
+{
+  coap_block1_handler(request, response, received, &received_len,
+                      sizeof(received));
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * A server that takes blocks of at most SMALL_SIZE bytes. Like the
+ * server in RFC 7959, figure 8, it takes a larger first block and asks
+ * for smaller ones in its acknowledgement, and it rejects any other
+ * larger block with 4.13.
+ */
+static void
+small_put_handler(void *request, void *response, uint8_t *buffer,
+                  uint16_t preferred_size, int32_t *offset)
+{
+  const uint8_t *payload;
+  uint32_t block_offset;
+  uint16_t size;
+  uint8_t more;
+  int len;
+
+  small_requests++;
+  len = REST.get_request_payload(request, &payload);
+  if(!coap_get_header_block1(request, NULL, &more, &size, &block_offset)
+     || block_offset + len > sizeof(received)) {
+    REST.set_response_status(response, REST.status.BAD_REQUEST);
+    return;
+  }
+  if(size > SMALL_SIZE && block_offset > 0) {
+    small_wrong_size++;
+    REST.set_response_status(response, REST.status.REQUEST_ENTITY_TOO_LARGE);
+    coap_set_header_block1(response, 0, 0, SMALL_SIZE);
+    return;
+  }
+
+  memcpy(&received[block_offset], payload, len);
+  if(block_offset + len > received_len) {
+    received_len = block_offset + len;
+  }
+  coap_set_header_block1(response, block_offset / SMALL_SIZE, more,
+                         SMALL_SIZE);
+  coap_set_status_code(response, more ? CONTINUE_2_31 : CHANGED_2_04);
+}
+/*---------------------------------------------------------------------------*/
+static void
+response_handler(void *response)
+{
+  const uint8_t *payload;
+  uint32_t block_offset;
+  int len;
+
+  if(state.in_flight + 1 > max_in_flight) {
+    max_in_flight = state.in_flight + 1;
+  }
+  received_blocks++;
+
+  if(upload_len > 0) {
+    return;
+  }
+  len = coap_get_payload(response, &payload);
+  if(!coap_get_header_block2(response, NULL, NULL, NULL, &block_offset)) {
+    block_offset = 0;
+  }
+  if(block_offset + len <= sizeof(received)) {
+    memcpy(&received[block_offset], payload, len);
+    if(block_offset + len > received_len) {
+      received_len = block_offset + len;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+read_upload(uint8_t *buffer, uint32_t offset, uint16_t len)
+{
+  memcpy(buffer, &source[offset], len);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(block_client_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  PT_SPAWN(process_pt, &state.pt,
+           coap_blockwise_request(&state, ev, &server_addr,
+                                  UIP_HTONS(COAP_DEFAULT_PORT), request,
+                                  upload_len,
+                                  upload_len > 0 ? read_upload : NULL,
+                                  response_handler));
+  done = 1;
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Makes a transfer from the node to itself with the client process.
+ * Returns non-zero if it completed.
+ */
+static int
+transfer(coap_method_t method, const char *path, uint32_t len)
+{
+  int i;
+
+  memset(received, 0, sizeof(received));
+  received_len = 0;
+  received_blocks = 0;
+  max_in_flight = 0;
+  done = 0;
+
+  coap_init_message(request, COAP_TYPE_CON, method, 0);
+  coap_set_header_uri_path(request, path);
+  upload_len = len;
+  process_start(&block_client_process, NULL);
+
+  for(i = 0; !done && i < 600; i++) {
+    test_net_wait(CLOCK_SECOND / 2);
+  }
+  return done && !state.failed;
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST(block2_reorder)
+{
+  UNIT_TEST_BEGIN();
+
+  test_net_reorder = 1;
+  UNIT_TEST_ASSERT(transfer(COAP_GET, "file", 0));
+  UNIT_TEST_ASSERT(received_len == FILE_SIZE);
+  UNIT_TEST_ASSERT(memcmp(received, source, FILE_SIZE) == 0);
+  UNIT_TEST_ASSERT(received_blocks ==
+                   (FILE_SIZE + COAP_MAX_BLOCK_SIZE - 1) / COAP_MAX_BLOCK_SIZE);
+  UNIT_TEST_ASSERT(max_in_flight > 1);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST(block2_loss)
+{
+  UNIT_TEST_BEGIN();
+
+  test_net_drop = 5;
+  UNIT_TEST_ASSERT(transfer(COAP_GET, "file", 0));
+  UNIT_TEST_ASSERT(received_len == FILE_SIZE);
+  UNIT_TEST_ASSERT(memcmp(received, source, FILE_SIZE) == 0);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST(block1_reorder)
+{
+  UNIT_TEST_BEGIN();
+
+  test_net_reorder = 1;
+  UNIT_TEST_ASSERT(transfer(COAP_PUT, "upload", UPLOAD_SIZE));
+  UNIT_TEST_ASSERT(received_len == UPLOAD_SIZE);
+  UNIT_TEST_ASSERT(memcmp(received, source, UPLOAD_SIZE) == 0);
+  UNIT_TEST_ASSERT(max_in_flight > 1);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST(block1_loss)
+{
+  UNIT_TEST_BEGIN();
+
+  test_net_drop = 5;
+  UNIT_TEST_ASSERT(transfer(COAP_PUT, "upload", UPLOAD_SIZE));
+  UNIT_TEST_ASSERT(received_len == UPLOAD_SIZE);
+  UNIT_TEST_ASSERT(memcmp(received, source, UPLOAD_SIZE) == 0);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST(block1_smaller)
+{
+  UNIT_TEST_BEGIN();
+
+  /* The first block is taken whole, the rest in SMALL_SIZE blocks. */
+  test_net_reorder = 1;
+  small_requests = 0;
+  small_wrong_size = 0;
+  UNIT_TEST_ASSERT(transfer(COAP_PUT, "small", UPLOAD_SIZE));
+  UNIT_TEST_ASSERT(small_wrong_size == 0);
+  UNIT_TEST_ASSERT(small_requests == 1 + (UPLOAD_SIZE - COAP_MAX_BLOCK_SIZE +
+                                          SMALL_SIZE - 1) / SMALL_SIZE);
+  UNIT_TEST_ASSERT(received_len == UPLOAD_SIZE);
+  UNIT_TEST_ASSERT(memcmp(received, source, UPLOAD_SIZE) == 0);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(block_tests_process, ev, data)
+{
+  int fd;
+  int i;
+
+  PROCESS_BEGIN();
+
+  for(i = 0; i < FILE_SIZE; i++) {
+    source[i] = i * 7 + i / 256;
+  }
+  cfs_remove(FILE_NAME);
+  fd = cfs_open(FILE_NAME, CFS_WRITE);
+  if(fd < 0 || cfs_write(fd, source, FILE_SIZE) != FILE_SIZE) {
+    printf("Could not write %s\n", FILE_NAME);
+    exit(1);
+  }
+  cfs_close(fd);
+
+  rest_init_engine();
+  rest_activate_resource(&res_file, "file");
+  rest_activate_resource(&res_upload, "upload");
+  rest_activate_resource(&res_small, "small");
+  uip_ip6addr(&server_addr, 0xfd00, 0, 0, 0, 0, 0, 0, 1);
+  test_net_loopback = 1;
+
+  UNIT_TEST_RUN(block2_reorder);
+  failures += UNIT_TEST_RESULT(block2_reorder) == unit_test_failure;
+  test_net_reorder = 0;
+  UNIT_TEST_RUN(block2_loss);
+  failures += UNIT_TEST_RESULT(block2_loss) == unit_test_failure;
+  test_net_drop = 0;
+  UNIT_TEST_RUN(block1_reorder);
+  failures += UNIT_TEST_RESULT(block1_reorder) == unit_test_failure;
+  test_net_reorder = 0;
+  UNIT_TEST_RUN(block1_loss);
+  failures += UNIT_TEST_RESULT(block1_loss) == unit_test_failure;
+  test_net_drop = 0;
+  UNIT_TEST_RUN(block1_smaller);
+  failures += UNIT_TEST_RESULT(block1_smaller) == unit_test_failure;
+
+  cfs_remove(FILE_NAME);
+  exit(failures);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,412 @@
+/*
+ * Copyright (c) 2015, EasyRF.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *	Regression tests for CoAP observers and transactions: registration
+ *	and deregistration, which find the observer by its client and
+ *	token, one serialized notification copied to every observer,
+ *	ACK and RST matching by MID, retransmission with doubling
+ *	timeouts, and at most one open notification per observer. Build
+ *	with TARGET=native; the exit status is the number of failed tests.
+ */
+
+#include "contiki.h"
+#include "contiki-net.h"
+
+#include "rest-engine.h"
+#include "er-coap.h"
+#include "er-coap-observe.h"
+#include "er-coap-transactions.h"
+#include "test-net.h"
+#include "unit-test.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ROUNDS 120
+
+UNIT_TEST_REGISTER(observe_register, "Registration and deregistration");
+UNIT_TEST_REGISTER(observe_ack_rst, "ACK and RST of notifications");
+UNIT_TEST_REGISTER(observe_retransmit, "Retransmission of notifications");
+UNIT_TEST_REGISTER(observe_one_open, "One open notification per observer");
+
+static void res_get_handler(void *request, void *response, uint8_t *buffer,
+                            uint16_t preferred_size, int32_t *offset);
+
+EVENT_RESOURCE(res_obs, "obs", res_get_handler, NULL, NULL, NULL, NULL);
+
+static unsigned handler_calls;
+static uint16_t client_mid = 1000;
+static unsigned failures;
+/*---------------------------------------------------------------------------*/
+PROCESS(observe_tests_process, "Observe tests");
+AUTOSTART_PROCESSES(&observe_tests_process);
+/*---------------------------------------------------------------------------*/
+static void
+res_get_handler(void *request, void *response, uint8_t *buffer,
+                uint16_t preferred_size, int32_t *offset)
+{
+  handler_calls++;
+  REST.set_response_payload(response, buffer,
+                            snprintf((char *)buffer, preferred_size,
+                                     "%u", handler_calls));
+}
+/*---------------------------------------------------------------------------*/
+/* Clients 0 and 1 share an address, as do clients 2 and 3. */
+static void
+client_addr(int i, uip_ipaddr_t *addr)
+{
+  uip_ip6addr(addr, 0xfd00, 0, 0, 0, 0, 0, 0, i / 2 + 1);
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+client_port(int i)
+{
+  return UIP_HTONS(61616 + i);
+}
+/*---------------------------------------------------------------------------*/
+static void
+client_token(int i, uint8_t token[2])
+{
+  token[0] = 0x10 + i;
+  token[1] = 0xa0;
+}
+/*---------------------------------------------------------------------------*/
+/* Sends a GET with an Observe option from client i, with the token of
+   client token_of. */
+static void
+observe(int i, int token_of, uint32_t value)
+{
+  coap_packet_t request[1];
+  uip_ipaddr_t addr;
+  uint8_t token[2];
+
+  client_addr(i, &addr);
+  client_token(token_of, token);
+  coap_init_message(request, COAP_TYPE_CON, COAP_GET, client_mid++);
+  coap_set_header_uri_path(request, "obs");
+  coap_set_header_observe(request, value);
+  coap_set_token(request, token, sizeof(token));
+  test_net_receive(&addr, client_port(i), request);
+}
+/*---------------------------------------------------------------------------*/
+/* Sends an empty ACK or RST from client i. */
+static void
+reply(int i, coap_message_type_t type, uint16_t mid)
+{
+  coap_packet_t message[1];
+  uip_ipaddr_t addr;
+
+  client_addr(i, &addr);
+  coap_init_message(message, type, 0, mid);
+  test_net_receive(&addr, client_port(i), message);
+}
+/*---------------------------------------------------------------------------*/
+/* Returns the only packet in the log that was sent to client i, if any. */
+static struct test_net_packet *
+sent_to(int i)
+{
+  struct test_net_packet *found;
+  uip_ipaddr_t addr;
+  int n;
+
+  client_addr(i, &addr);
+  found = NULL;
+  for(n = 0; n < test_net_sent; n++) {
+    if(uip_ipaddr_cmp(&test_net_log[n].addr, &addr)
+       && test_net_log[n].port == client_port(i)) {
+      if(found != NULL) {
+        return NULL;
+      }
+      found = &test_net_log[n];
+    }
+  }
+  return found;
+}
+/*---------------------------------------------------------------------------*/
+static int
+has_token(const coap_packet_t *message, int i)
+{
+  uint8_t token[2];
+
+  client_token(i, token);
+  return message->token_len == sizeof(token)
+    && memcmp(message->token, token, sizeof(token)) == 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+observers(void)
+{
+  return list_length(coap_get_observers());
+}
+/*---------------------------------------------------------------------------*/
+/* Counts the open transactions by taking all that are left. */
+static int
+open_transactions(void)
+{
+  static coap_transaction_t *t[COAP_MAX_OPEN_TRANSACTIONS];
+  uip_ipaddr_t addr;
+  int i, n;
+
+  uip_ip6addr(&addr, 0xfd00, 0, 0, 0, 0, 0, 0, 0xff);
+  for(n = 0; n < COAP_MAX_OPEN_TRANSACTIONS; n++) {
+    t[n] = coap_new_transaction(60000 + n, &addr, 0);
+    if(t[n] == NULL) {
+      break;
+    }
+  }
+  for(i = 0; i < n; i++) {
+    coap_clear_transaction(t[i]);
+  }
+  return COAP_MAX_OPEN_TRANSACTIONS - n;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Notifies the observers until client 0 is sent a confirmable
+ * notification, which is the only packet in the log then.
+ */
+static int
+notify_confirmable(void)
+{
+  int round;
+
+  for(round = 0; round < COAP_OBSERVE_REFRESH_INTERVAL; round++) {
+    test_net_clear();
+    coap_notify_observers(&res_obs);
+    if(test_net_sent == 1 && test_net_log[0].message->type == COAP_TYPE_CON) {
+      return 1;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Removes all observers and lets the open transactions time out. */
+static void
+reset(void)
+{
+  coap_remove_observer_by_uri(NULL, 0, res_obs.url);
+  test_net_wait(300 * CLOCK_SECOND);
+  test_net_clear();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST(observe_register)
+{
+  struct test_net_packet *p;
+  unsigned calls;
+  int i;
+
+  UNIT_TEST_BEGIN();
+
+  for(i = 0; i < 3; i++) {
+    test_net_clear();
+    observe(i, i, 0);
+    p = sent_to(i);
+    UNIT_TEST_ASSERT(test_net_sent == 1 && p != NULL);
+    UNIT_TEST_ASSERT(p->message->type == COAP_TYPE_ACK);
+    UNIT_TEST_ASSERT(p->message->code == CONTENT_2_05);
+    UNIT_TEST_ASSERT(IS_OPTION(p->message, COAP_OPTION_OBSERVE));
+    UNIT_TEST_ASSERT(has_token(p->message, i));
+  }
+  UNIT_TEST_ASSERT(observers() == 3);
+
+  /* The notification is made once and copied to each observer. */
+  calls = handler_calls;
+  test_net_clear();
+  coap_notify_observers(&res_obs);
+  UNIT_TEST_ASSERT(handler_calls == calls + 1);
+  UNIT_TEST_ASSERT(test_net_sent == 3);
+  for(i = 0; i < 3; i++) {
+    p = sent_to(i);
+    UNIT_TEST_ASSERT(p != NULL);
+    UNIT_TEST_ASSERT(has_token(p->message, i));
+    UNIT_TEST_ASSERT(p->message->observe == test_net_log[0].message->observe);
+    UNIT_TEST_ASSERT(p->message->payload_len ==
+                     test_net_log[0].message->payload_len);
+    UNIT_TEST_ASSERT(memcmp(p->message->payload,
+                            test_net_log[0].message->payload,
+                            p->message->payload_len) == 0);
+  }
+  UNIT_TEST_ASSERT(test_net_log[0].message->mid !=
+                   test_net_log[1].message->mid);
+
+  /* Deregistration matches the client as well as the token. */
+  observe(0, 1, 1);
+  UNIT_TEST_ASSERT(observers() == 3);
+  observe(1, 1, 1);
+  UNIT_TEST_ASSERT(observers() == 2);
+  observe(1, 1, 1);
+  UNIT_TEST_ASSERT(observers() == 2);
+
+  test_net_clear();
+  coap_notify_observers(&res_obs);
+  UNIT_TEST_ASSERT(test_net_sent == 2);
+  UNIT_TEST_ASSERT(sent_to(1) == NULL);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST(observe_ack_rst)
+{
+  uint16_t mid;
+
+  UNIT_TEST_BEGIN();
+
+  observe(0, 0, 0);
+  UNIT_TEST_ASSERT(notify_confirmable());
+  mid = test_net_log[0].message->mid;
+  UNIT_TEST_ASSERT(coap_get_transaction_by_mid(mid) != NULL);
+
+  /* The ACK closes the transaction; nothing is retransmitted. */
+  reply(0, COAP_TYPE_ACK, mid);
+  UNIT_TEST_ASSERT(coap_get_transaction_by_mid(mid) == NULL);
+  test_net_clear();
+  test_net_wait(60 * CLOCK_SECOND);
+  UNIT_TEST_ASSERT(test_net_sent == 0);
+  UNIT_TEST_ASSERT(observers() == 1);
+
+  /* A RST from another client does not cancel the observation... */
+  UNIT_TEST_ASSERT(notify_confirmable());
+  mid = test_net_log[0].message->mid;
+  reply(1, COAP_TYPE_RST, mid);
+  UNIT_TEST_ASSERT(observers() == 1);
+
+  /* ...and a RST to the last notification cancels the observation. */
+  reply(0, COAP_TYPE_RST, mid);
+  UNIT_TEST_ASSERT(observers() == 0);
+  UNIT_TEST_ASSERT(coap_get_transaction_by_mid(mid) == NULL);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST(observe_retransmit)
+{
+  clock_time_t interval;
+  clock_time_t previous;
+  int i;
+
+  UNIT_TEST_BEGIN();
+
+  observe(0, 0, 0);
+  UNIT_TEST_ASSERT(notify_confirmable());
+
+  /* The notification is sent COAP_MAX_RETRANSMIT more times, each time
+     after twice the previous interval, and then the observer is given
+     up on. */
+  test_net_wait(300 * CLOCK_SECOND);
+  UNIT_TEST_ASSERT(test_net_sent == 1 + COAP_MAX_RETRANSMIT);
+  previous = 0;
+  for(i = 1; i < test_net_sent; i++) {
+    UNIT_TEST_ASSERT(test_net_log[i].message->mid ==
+                     test_net_log[0].message->mid);
+    interval = test_net_log[i].time - test_net_log[i - 1].time;
+    if(i == 1) {
+      UNIT_TEST_ASSERT(interval >= COAP_RESPONSE_TIMEOUT_TICKS);
+      UNIT_TEST_ASSERT(interval <= COAP_RESPONSE_TIMEOUT_TICKS +
+                       COAP_RESPONSE_TIMEOUT_BACKOFF_MASK + CLOCK_SECOND / 10);
+    } else {
+      UNIT_TEST_ASSERT(interval + CLOCK_SECOND / 5 >= 2 * previous);
+      UNIT_TEST_ASSERT(interval <= 2 * previous + CLOCK_SECOND / 5);
+    }
+    previous = interval;
+  }
+  UNIT_TEST_ASSERT(observers() == 0);
+  UNIT_TEST_ASSERT(open_transactions() == 0);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST(observe_one_open)
+{
+  static unsigned notifications[4];
+  int round;
+  int i, n;
+
+  UNIT_TEST_BEGIN();
+
+  for(i = 0; i < 4; i++) {
+    observe(i, i, 0);
+    notifications[i] = 0;
+  }
+  UNIT_TEST_ASSERT(observers() == 4);
+
+  /* Notify every second and never acknowledge. Once the notifications
+     have become confirmable, each observer holds one transaction, and
+     each new notification replaces the open one. */
+  for(round = 0; round < ROUNDS; round++) {
+    n = observers();
+    test_net_clear();
+    coap_notify_observers(&res_obs);
+    UNIT_TEST_ASSERT(test_net_sent == n);
+    for(i = 0; i < 4; i++) {
+      notifications[i] += sent_to(i) != NULL;
+    }
+    UNIT_TEST_ASSERT(open_transactions() <= n);
+    test_net_wait(CLOCK_SECOND);
+  }
+
+  /* The replacements keep the retransmission timer, so the observers
+     still time out and are removed. */
+  UNIT_TEST_ASSERT(observers() == 0);
+  UNIT_TEST_ASSERT(open_transactions() == 0);
+  for(i = 0; i < 4; i++) {
+    UNIT_TEST_ASSERT(notifications[i] > 2 * COAP_OBSERVE_REFRESH_INTERVAL);
+  }
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(observe_tests_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  rest_init_engine();
+  rest_activate_resource(&res_obs, "obs");
+
+  UNIT_TEST_RUN(observe_register);
+  failures += UNIT_TEST_RESULT(observe_register) == unit_test_failure;
+  reset();
+  UNIT_TEST_RUN(observe_ack_rst);
+  failures += UNIT_TEST_RESULT(observe_ack_rst) == unit_test_failure;
+  reset();
+  UNIT_TEST_RUN(observe_retransmit);
+  failures += UNIT_TEST_RESULT(observe_retransmit) == unit_test_failure;
+  reset();
+  UNIT_TEST_RUN(observe_one_open);
+  failures += UNIT_TEST_RESULT(observe_one_open) == unit_test_failure;
+
+  exit(failures);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,183 @@
+/*
+ * Copyright (c) 2015, EasyRF.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *	A network for testing Erbium on the native platform. The tests are
+ *	linked with tcpip_ipv6_output() and clock_time() wrapped.
+ */
+
+#include "test-net.h"
+
+#include <string.h>
+
+#define UIP_IP_BUF  ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
+#define UIP_UDP_BUF ((struct uip_udp_hdr *)&uip_buf[UIP_LLIPH_LEN])
+
+/* Time is skipped in steps of this length */
+#define STEP (CLOCK_SECOND / 20)
+
+#define QUEUE_SIZE 16
+
+struct queued_packet {
+  uip_ipaddr_t addr;
+  uint16_t port;
+  uint16_t len;
+  uint8_t data[COAP_MAX_PACKET_SIZE];
+};
+
+PROCESS_NAME(coap_engine);
+
+struct test_net_packet test_net_log[TEST_NET_LOG_SIZE];
+int test_net_sent;
+
+uint8_t test_net_loopback;
+uint8_t test_net_reorder;
+uint8_t test_net_drop;
+
+/* Looped back packets that wait to be delivered */
+static struct queued_packet queue[QUEUE_SIZE];
+static int queued;
+static unsigned long looped;
+
+/* The time that has been skipped so far */
+static clock_time_t skipped;
+/*---------------------------------------------------------------------------*/
+clock_time_t __real_clock_time(void);
+
+clock_time_t
+__wrap_clock_time(void)
+{
+  return __real_clock_time() + skipped;
+}
+/*---------------------------------------------------------------------------*/
+void
+__wrap_tcpip_ipv6_output(void)
+{
+  struct test_net_packet *p;
+  struct queued_packet *q;
+  uint16_t len;
+
+  len = uip_len - UIP_IPUDPH_LEN;
+  if(test_net_sent < TEST_NET_LOG_SIZE && len <= COAP_MAX_PACKET_SIZE) {
+    p = &test_net_log[test_net_sent++];
+    uip_ipaddr_copy(&p->addr, &UIP_IP_BUF->destipaddr);
+    p->port = UIP_UDP_BUF->destport;
+    p->time = clock_time();
+    memcpy(p->data, &uip_buf[UIP_LLH_LEN + UIP_IPUDPH_LEN], len);
+    if(coap_parse_message(p->message, p->data, len) != NO_ERROR) {
+      p->message->code = 0;
+    }
+  }
+
+  /* The packet comes back from where it was sent to. */
+  if(test_net_loopback && queued < QUEUE_SIZE && len <= COAP_MAX_PACKET_SIZE
+     && (test_net_drop == 0 || ++looped % test_net_drop != 0)) {
+    q = &queue[queued++];
+    uip_ipaddr_copy(&q->addr, &UIP_IP_BUF->destipaddr);
+    q->port = UIP_UDP_BUF->destport;
+    q->len = len;
+    memcpy(q->data, &uip_buf[UIP_LLH_LEN + UIP_IPUDPH_LEN], len);
+  }
+  uip_len = 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+receive(uip_ipaddr_t *addr, uint16_t port, const uint8_t *data, uint16_t len)
+{
+  memset(uip_buf, 0, UIP_LLH_LEN + UIP_IPUDPH_LEN);
+  UIP_IP_BUF->vtc = 0x60;
+  UIP_IP_BUF->proto = UIP_PROTO_UDP;
+  uip_ipaddr_copy(&UIP_IP_BUF->srcipaddr, addr);
+  UIP_UDP_BUF->srcport = port;
+  UIP_UDP_BUF->destport = UIP_HTONS(COAP_DEFAULT_PORT);
+  memcpy(&uip_buf[UIP_LLH_LEN + UIP_IPUDPH_LEN], data, len);
+
+  uip_ext_len = 0;
+  uip_appdata = &uip_buf[UIP_LLH_LEN + UIP_IPUDPH_LEN];
+  uip_len = len;
+  uip_flags = UIP_NEWDATA;
+  process_post_synch(&coap_engine, tcpip_event, NULL);
+  uip_flags = 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Delivers the packets that have been looped back so far. */
+static void
+deliver(void)
+{
+  static struct queued_packet batch[QUEUE_SIZE];
+  struct queued_packet *q;
+  int n, i;
+
+  n = queued;
+  memcpy(batch, queue, n * sizeof(batch[0]));
+  queued = 0;
+  for(i = 0; i < n; i++) {
+    q = &batch[test_net_reorder ? n - 1 - i : i];
+    receive(&q->addr, q->port, q->data, q->len);
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+test_net_clear(void)
+{
+  test_net_sent = 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+test_net_receive(uip_ipaddr_t *addr, uint16_t port, coap_packet_t *message)
+{
+  static uint8_t data[COAP_MAX_PACKET_SIZE];
+  uint16_t len;
+
+  len = coap_serialize_message(message, data);
+  receive(addr, port, data, len);
+}
+/*---------------------------------------------------------------------------*/
+void
+test_net_wait(clock_time_t interval)
+{
+  clock_time_t step;
+
+  while(interval > 0) {
+    step = interval < STEP ? interval : STEP;
+    skipped += step;
+    interval -= step;
+    etimer_request_poll();
+    while(process_run() > 0);
+    while(queued > 0) {
+      deliver();
+      while(process_run() > 0);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
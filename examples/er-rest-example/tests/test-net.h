@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2015, EasyRF.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *	A network for testing Erbium on the native platform: the packets
+ *	that the node sends are kept in a log instead of being sent, the
+ *	tests deliver packets from any client to the CoAP engine, and time
+ *	can be skipped forward so that retransmission timeouts pass at once.
+ *	In loopback mode, the packets that the node sends are delivered back
+ *	to it, so that its client talks to its own server.
+ */
+
+#ifndef TEST_NET_H_
+#define TEST_NET_H_
+
+#include "contiki.h"
+#include "contiki-net.h"
+#include "er-coap.h"
+
+#define TEST_NET_LOG_SIZE 64
+
+struct test_net_packet {
+  uip_ipaddr_t addr;
+  uint16_t port;                /* in network byte order */
+  clock_time_t time;
+  coap_packet_t message[1];
+  uint8_t data[COAP_MAX_PACKET_SIZE];
+};
+
+/* The packets sent since the last test_net_clear() */
+extern struct test_net_packet test_net_log[TEST_NET_LOG_SIZE];
+extern int test_net_sent;
+
+/* Delivers the packets that are sent back to the node */
+extern uint8_t test_net_loopback;
+/* Delivers the packets that are sent together in reverse order */
+extern uint8_t test_net_reorder;
+/* Drops every nth packet that is looped back, if not zero */
+extern uint8_t test_net_drop;
+
+/**
+ * \brief Empties the log of sent packets.
+ */
+void test_net_clear(void);
+
+/**
+ * \brief Delivers a message from a client to the CoAP engine.
+ * \param port The port of the client, in network byte order.
+ */
+void test_net_receive(uip_ipaddr_t *addr, uint16_t port,
+                      coap_packet_t *message);
+
+/**
+ * \brief Skips time forward, running the processes that are due on the way.
+ *
+ * Looped back packets are delivered on the way as well.
+ */
+void test_net_wait(clock_time_t interval);
+
+#endif /* TEST_NET_H_ */
@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2015, EasyRF.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *	Benchmark for the ip64 address map. Creates a number of mappings,
+ *	then translates packets of all flows round robin: a lookup from
+ *	the IPv6 side followed by a lookup of the mapped port, as for a
+ *	packet and its reply. Reports the time per packet for each
+ *	number of flows. Build with TARGET=native.
+ */
+
+#include "contiki.h"
+#include "ip64-addrmap.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define PACKETS 2000000UL
+#define LIFETIME (CLOCK_SECOND * 300)
+#define PROTO_TCP 6
+
+static const unsigned flows[] = { 100, 1000, 10000 };
+/*---------------------------------------------------------------------------*/
+PROCESS(ip64_addrmap_benchmark_process, "ip64 address map benchmark");
+AUTOSTART_PROCESSES(&ip64_addrmap_benchmark_process);
+/*---------------------------------------------------------------------------*/
+/* Flow i is from one of 256 IPv6 hosts to one of 16 IPv4 servers. */
+static void
+flow(unsigned i, uip_ip6addr_t *ip6addr, uint16_t *ip6port,
+     uip_ip4addr_t *ip4addr, uint16_t *ip4port)
+{
+  uip_ip6addr(ip6addr, 0xaaaa, 0, 0, 0, 0, 0, 0, i % 256 + 1);
+  *ip6port = 40000 + i / 256;
+  uip_ipaddr(ip4addr, 192, 0, 2, i % 16 + 1);
+  *ip4port = 80;
+}
+/*---------------------------------------------------------------------------*/
+static int
+create(unsigned n)
+{
+  struct ip64_addrmap_entry *m;
+  uip_ip6addr_t ip6addr;
+  uip_ip4addr_t ip4addr;
+  uint16_t ip6port, ip4port;
+  unsigned i;
+
+  ip64_addrmap_init();
+  for(i = 0; i < n; i++) {
+    flow(i, &ip6addr, &ip6port, &ip4addr, &ip4port);
+    m = ip64_addrmap_create(&ip6addr, ip6port, &ip4addr, ip4port, PROTO_TCP);
+    if(m == NULL) {
+      return 0;
+    }
+    ip64_addrmap_set_lifetime(m, LIFETIME);
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+translate(unsigned n)
+{
+  struct ip64_addrmap_entry *m;
+  uip_ip6addr_t ip6addr;
+  uip_ip4addr_t ip4addr;
+  uint16_t ip6port, ip4port;
+  unsigned long i;
+
+  for(i = 0; i < PACKETS; i++) {
+    flow(i % n, &ip6addr, &ip6port, &ip4addr, &ip4port);
+    m = ip64_addrmap_lookup(&ip6addr, ip6port, &ip4addr, ip4port, PROTO_TCP);
+    if(m == NULL ||
+       ip64_addrmap_lookup_port(m->mapped_port, PROTO_TCP) != m) {
+      return 0;
+    }
+    ip64_addrmap_set_lifetime(m, LIFETIME);
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(ip64_addrmap_benchmark_process, ev, data)
+{
+  clock_time_t start;
+  clock_time_t t;
+  int i;
+
+  PROCESS_BEGIN();
+
+  for(i = 0; i < sizeof(flows) / sizeof(flows[0]); i++) {
+    if(!create(flows[i])) {
+      printf("Failed to create %u mappings\n", flows[i]);
+      exit(1);
+    }
+
+    start = clock_time();
+    if(!translate(flows[i])) {
+      printf("Lookup failed with %u mappings\n", flows[i]);
+      exit(1);
+    }
+    t = clock_time() - start;
+    printf("%5u flows: %5lu ms for %lu packets, %4lu ns per packet\n",
+           flows[i], (unsigned long)(t * 1000 / CLOCK_SECOND), PACKETS,
+           (unsigned long)(t * 1000000000.0 / CLOCK_SECOND / PACKETS));
+  }
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,207 @@
+/*
+ * Copyright (c) 2015, EasyRF.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *         Throughput of the streaming JSON parser against jsonparse.
+ *
+ *         Both parsers extract $.sensors[3].rate from a generated
+ *         configuration document.  jsonparse needs the whole document in
+ *         one buffer; jsonstream is also fed the same document in small
+ *         chunks, as it would arrive from uIP or cfs_read().  Build with
+ *         TARGET=native.
+ *
+ *         On native the two parsers run at about the same speed, and the
+ *         chunked run is a little slower.  What jsonstream saves is RAM:
+ *         jsonparse needs the whole document in memory, jsonstream only
+ *         its state and one chunk.  The benchmark prints both footprints.
+ */
+
+#include "contiki.h"
+#include "jsonparse.h"
+#include "jsonstream.h"
+#include <stdio.h>
+#include <string.h>
+
+#define SENSORS     16
+#define ROUNDS      50000
+#define CHUNK_SIZE  64
+
+static char doc[2048];
+static int doc_len;
+static long rate;
+/*---------------------------------------------------------------------------*/
+PROCESS(json_stream_benchmark_process, "JSON stream benchmark");
+AUTOSTART_PROCESSES(&json_stream_benchmark_process);
+/*---------------------------------------------------------------------------*/
+static void
+build_doc(void)
+{
+  int i;
+
+  doc_len = snprintf(doc, sizeof(doc), "{\"version\":3,\"sensors\":[");
+  for(i = 0; i < SENSORS; i++) {
+    doc_len += snprintf(&doc[doc_len], sizeof(doc) - doc_len,
+                        "%s{\"id\":%d,\"name\":\"sensor-%d\",\"rate\":%d,"
+                        "\"unit\":\"ms\",\"enabled\":1}",
+                        i > 0 ? "," : "", i, i, (i + 1) * 10);
+  }
+  doc_len += snprintf(&doc[doc_len], sizeof(doc) - doc_len,
+                      "],\"owner\":\"EasyRF\"}");
+}
+/*---------------------------------------------------------------------------*/
+/* the usual jsonparse pattern: walk every token and copy values out */
+static long
+parse_jsonparse(void)
+{
+  struct jsonparse_state js;
+  char buf[32];
+  int type;
+  int depth = 0;
+  int element = -1;
+  int in_sensors = 0;
+  long value = 0;
+
+  jsonparse_setup(&js, doc, doc_len);
+  while((type = jsonparse_next(&js)) != 0) {
+    if(type == JSON_TYPE_OBJECT) {
+      depth++;
+      if(in_sensors && depth == 2) {
+        element++;
+      }
+    } else if(type == '}') {
+      depth--;
+    } else if(type == ']') {
+      in_sensors = 0;
+    } else if(type == JSON_TYPE_PAIR_NAME) {
+      jsonparse_copy_value(&js, buf, sizeof(buf));
+      if(depth == 1 && strcmp(buf, "sensors") == 0) {
+        in_sensors = 1;
+      } else if(element == 3 && depth == 2 && strcmp(buf, "rate") == 0) {
+        jsonparse_next(&js);
+        jsonparse_next(&js);
+        value = jsonparse_get_value_as_long(&js);
+      }
+    } else if(type == JSON_TYPE_STRING || type == JSON_TYPE_NUMBER) {
+      jsonparse_copy_value(&js, buf, sizeof(buf));
+    }
+  }
+  return value;
+}
+/*---------------------------------------------------------------------------*/
+static void
+rate_cb(struct jsonstream_state *state, void *ptr, int type,
+        const char *value, int len, int flags)
+{
+  if(type == JSON_TYPE_NUMBER) {
+    *(long *)ptr = jsonstream_atol(value, len);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static long
+parse_jsonstream(const struct jsonstream_query *compiled, int chunk)
+{
+  struct jsonstream_state js;
+  struct jsonstream_query query;
+  long value = 0;
+  int pos;
+
+  memcpy(&query, compiled, sizeof(query));
+  jsonstream_setup(&js, NULL, NULL);
+  jsonstream_add_query(&js, &query, rate_cb, &value);
+  for(pos = 0; pos < doc_len; pos += chunk) {
+    jsonstream_feed(&js, &doc[pos], pos + chunk < doc_len ? chunk : doc_len - pos);
+  }
+  if(jsonstream_end(&js) != JSON_ERROR_OK) {
+    return -1;
+  }
+  return value;
+}
+/*---------------------------------------------------------------------------*/
+static void
+report(const char *name, clock_time_t start, long value)
+{
+  clock_time_t t = clock_time() - start;
+
+  printf("%-28s rate=%ld %5lu ms, %lu kB/s\n", name, value,
+         (unsigned long)(t * 1000 / CLOCK_SECOND),
+         t == 0 ? 0 : (unsigned long)((long)doc_len * ROUNDS / 1024 *
+                                      CLOCK_SECOND / t));
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(json_stream_benchmark_process, ev, data)
+{
+  static struct jsonstream_query query;
+  clock_time_t start;
+  int i;
+
+  PROCESS_BEGIN();
+
+  build_doc();
+  if(!jsonstream_query_compile(&query, "$.sensors[3].rate")) {
+    printf("query did not compile\n");
+    PROCESS_EXIT();
+  }
+  printf("document: %d bytes, %d rounds\n", doc_len, ROUNDS);
+  printf("RAM: jsonparse %d + %u bytes, jsonstream %d + %u + %u bytes\n",
+         doc_len, (unsigned)sizeof(struct jsonparse_state),
+         CHUNK_SIZE, (unsigned)sizeof(struct jsonstream_state),
+         (unsigned)sizeof(struct jsonstream_query));
+
+  /* every chunk size must give the same answer */
+  for(i = 1; i <= doc_len; i++) {
+    if(parse_jsonstream(&query, i) != 40) {
+      printf("chunk size %d: wrong result\n", i);
+    }
+  }
+
+  start = clock_time();
+  for(i = 0; i < ROUNDS; i++) {
+    rate = parse_jsonparse();
+  }
+  report("jsonparse, whole buffer", start, rate);
+
+  start = clock_time();
+  for(i = 0; i < ROUNDS; i++) {
+    rate = parse_jsonstream(&query, doc_len);
+  }
+  report("jsonstream, whole buffer", start, rate);
+
+  start = clock_time();
+  for(i = 0; i < ROUNDS; i++) {
+    rate = parse_jsonstream(&query, CHUNK_SIZE);
+  }
+  report("jsonstream, 64-byte chunks", start, rate);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2015, EasyRF.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *         Measures how long AES_128 and CCM* take to secure frames of
+ *         16 to 127 bytes. Compare drivers by building with, e.g.,
+ *         DEFINES=AES_128_CONF=aes_128_ttable_driver.
+ */
+
+#include "contiki.h"
+#include "sys/rtimer.h"
+#include "net/packetbuf.h"
+#include "net/llsec/llsec802154.h"
+#include "net/llsec/ccm.h"
+#include "lib/aes-128.h"
+#include <stdio.h>
+#include <string.h>
+
+#ifdef BENCHMARK_CONF_ITERATIONS
+#define ITERATIONS BENCHMARK_CONF_ITERATIONS
+#else /* BENCHMARK_CONF_ITERATIONS */
+#define ITERATIONS 32
+#endif /* BENCHMARK_CONF_ITERATIONS */
+
+/* Length of a data frame header with short addresses and security header */
+#define HEADER_LEN 14
+
+static const uint8_t frame_lens[] = { 16, 32, 64, 96, 127 };
+static uint8_t key[AES_128_KEY_LENGTH];
+static uint8_t extended_source_address[8];
+
+/*---------------------------------------------------------------------------*/
+static void
+prepare_frame(uint8_t frame_len)
+{
+  packetbuf_clear();
+  packetbuf_set_datalen(frame_len - LLSEC802154_MIC_LENGTH);
+  memset(packetbuf_hdrptr(), 0xA5, frame_len - LLSEC802154_MIC_LENGTH);
+  packetbuf_set_attr(PACKETBUF_ATTR_FRAME_COUNTER_BYTES_0_1, 1);
+  packetbuf_set_attr(PACKETBUF_ATTR_FRAME_COUNTER_BYTES_2_3, 0);
+  packetbuf_set_attr(PACKETBUF_ATTR_SECURITY_LEVEL, LLSEC802154_SECURITY_LEVEL);
+  packetbuf_hdrreduce(HEADER_LEN);
+}
+/*---------------------------------------------------------------------------*/
+static void
+print_result(const char *name, uint8_t frame_len, rtimer_clock_t ticks)
+{
+  printf("%-9s %3u bytes: %5u ticks per %u frames, %6lu us per frame\n",
+      name, frame_len, (unsigned)ticks, ITERATIONS,
+      (unsigned long)((uint32_t)ticks * 1000000UL / RTIMER_SECOND / ITERATIONS));
+}
+/*---------------------------------------------------------------------------*/
+static void
+benchmark(uint8_t frame_len)
+{
+  uint8_t mic[LLSEC802154_MIC_LENGTH];
+  uint8_t block[AES_128_BLOCK_SIZE];
+  uint8_t blocks;
+  rtimer_clock_t start;
+  uint16_t i;
+  uint8_t j;
+
+  /* Roughly the number of blocks CCM* encrypts per frame */
+  blocks = 2 * ((frame_len + AES_128_BLOCK_SIZE - 1) / AES_128_BLOCK_SIZE) + 2;
+  memset(block, 0, AES_128_BLOCK_SIZE);
+  start = RTIMER_NOW();
+  for(i = 0; i < ITERATIONS; i++) {
+    for(j = 0; j < blocks; j++) {
+      AES_128.encrypt(block);
+    }
+  }
+  print_result("AES_128", frame_len, RTIMER_NOW() - start);
+
+  prepare_frame(frame_len);
+  start = RTIMER_NOW();
+  for(i = 0; i < ITERATIONS; i++) {
+    CCM.mic(extended_source_address, mic, LLSEC802154_MIC_LENGTH);
+    CCM.ctr(extended_source_address);
+  }
+  print_result("mic+ctr", frame_len, RTIMER_NOW() - start);
+
+  prepare_frame(frame_len);
+  start = RTIMER_NOW();
+  for(i = 0; i < ITERATIONS; i++) {
+    CCM.aead(extended_source_address, mic, LLSEC802154_MIC_LENGTH, 1);
+  }
+  print_result("aead", frame_len, RTIMER_NOW() - start);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(ccm_benchmark_process, "CCM* benchmark process");
+AUTOSTART_PROCESSES(&ccm_benchmark_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(ccm_benchmark_process, ev, data)
+{
+  uint8_t i;
+
+  PROCESS_BEGIN();
+
+  AES_128.set_key(key);
+  for(i = 0; i < sizeof(frame_lens); i++) {
+    benchmark(frame_lens[i]);
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
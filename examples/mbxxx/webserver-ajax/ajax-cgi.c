@@ -93,7 +93,7 @@ PT_THREAD(nodeidcall(struct httpd_state *s, char *ptr))
        linkaddr_node_addr.u8[5],
        linkaddr_node_addr.u8[6],
        linkaddr_node_addr.u8[7]);
-  PSOCK_SEND_STR(&s->sout, buf);
+  HTTPD_SEND_STR(s, buf);
   PSOCK_END(&s->sout);
 }
 /*---------------------------------------------------------------------------*/
@@ -134,7 +134,7 @@ PT_THREAD(sensorscall(struct httpd_state *s, char *ptr))
     
   SENSORS_DEACTIVATE(acc_sensor);
 
-  PSOCK_SEND_STR(&s->sout, buf);
+  HTTPD_SEND_STR(s, buf);
 
 
   snprintf(buf, sizeof(buf),
@@ -148,7 +148,7 @@ PT_THREAD(sensorscall(struct httpd_state *s, char *ptr))
   last_lpm = energest_type_time(ENERGEST_TYPE_LPM);
   last_transmit = energest_type_time(ENERGEST_TYPE_TRANSMIT);
   last_listen = energest_type_time(ENERGEST_TYPE_LISTEN);
-  PSOCK_SEND_STR(&s->sout, buf);
+  HTTPD_SEND_STR(s, buf);
 
   PSOCK_END(&s->sout);
 }
@@ -165,7 +165,7 @@ make_neighbor(void *arg)
   }
 
 #if !UIP_CONF_IPV6
-  return snprintf((char *)uip_appdata, uip_mss(),
+  return snprintf((char *)uip_appdata, httpd_mss(),
 		  "<li><a href=\"http://172.16.%d.%d/\">%d.%d</a>\r\n",
 		  n->addr.u8[0], n->addr.u8[1],
 		  n->addr.u8[0], n->addr.u8[1]);
@@ -181,7 +181,7 @@ make_neighbor(void *arg)
               (uint16_t)(n->addr.u8[6])<<8 | n->addr.u8[7]);
   httpd_sprint_ip6(ipaddr, ipaddr_str);
   
-  return snprintf((char *)uip_appdata, uip_mss(),
+  return snprintf((char *)uip_appdata, httpd_mss(),
 		  "<li><a href=\"http://%s/\">%02X:%02X:%02X:%02X:%02X:%02X:%02X:%02X</a>\r\n",
 		  ipaddr_str,
           n->addr.u8[0],
@@ -197,7 +197,7 @@ make_neighbor(void *arg)
    * Client-side generation is simpler than server-side, as parsing http header
    * would be requied.
    */
-  return snprintf((char *)uip_appdata, uip_mss(),
+  return snprintf((char *)uip_appdata, httpd_mss(),
                   "<li><a id=node name='%x:%x:%x:%x'>%02X:%02X:%02X:%02X:%02X:%02X:%02X:%02X</a>\r\n",
                   (uint16_t)(((uint16_t)(n->addr.u8[0]^0x02))<<8 | (uint16_t)n->addr.u8[1]),
                   ((uint16_t)(n->addr.u8[2]))<<8 | (uint16_t)n->addr.u8[3],
@@ -228,7 +228,7 @@ PT_THREAD(neighborscall(struct httpd_state *s, char *ptr))
     /*    printf("count %d\n", s->u.count);*/
     if(collect_neighbor_get(s->u.count) != NULL) {
       /*      printf("!= NULL\n");*/
-      PSOCK_GENERATOR_SEND(&s->sout, make_neighbor, s);
+      HTTPD_GENERATOR_SEND(s, make_neighbor, s);
     }
   }
 
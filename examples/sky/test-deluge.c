@@ -39,6 +39,7 @@
 
 #include "contiki.h"
 #include "cfs/cfs.h"
+#include "cfs/cfs-coffee.h"
 #include "deluge.h"
 #include "sys/node-id.h"
 
@@ -56,6 +57,30 @@
 PROCESS(deluge_test_process, "Deluge test process");
 AUTOSTART_PROCESSES(&deluge_test_process);
 /*---------------------------------------------------------------------------*/
+/*
+ * Read the file into buf, block by block, and stop at the first block
+ * that differs from the first one. The contents are only reported as
+ * a new version when the whole file has been updated.
+ */
+static int
+read_file(int fd, char *buf, int len)
+{
+  char block[32];
+  int r, offset;
+
+  r = cfs_read(fd, buf, len);
+  for(offset = len; r == len && offset + len <= FILE_SIZE; offset += len) {
+    if(cfs_read(fd, block, len) != len) {
+      return -1;
+    }
+    if(memcmp(block, buf, len) != 0) {
+      memcpy(buf, block, len);
+      break;
+    }
+  }
+  return r;
+}
+/*---------------------------------------------------------------------------*/
 PROCESS_THREAD(deluge_test_process, ev, data)
 {
   int fd, r;
@@ -72,13 +97,16 @@ PROCESS_THREAD(deluge_test_process, ev, data)
   }
 
   cfs_remove("test");
+  cfs_coffee_reserve("test", FILE_SIZE);
   fd = cfs_open("test", CFS_WRITE);
   if(fd < 0) {
     process_exit(NULL);
   }
-  if(cfs_write(fd, buf, sizeof(buf)) != sizeof(buf)) {
-    cfs_close(fd);
-    process_exit(NULL);
+  for(r = 0; r + sizeof(buf) <= FILE_SIZE; r += sizeof(buf)) {
+    if(cfs_write(fd, buf, sizeof(buf)) != sizeof(buf)) {
+      cfs_close(fd);
+      process_exit(NULL);
+    }
   }
 
   if(cfs_seek(fd, FILE_SIZE, CFS_SEEK_SET) != FILE_SIZE) {
@@ -96,7 +124,7 @@ PROCESS_THREAD(deluge_test_process, ev, data)
       if(fd < 0) {
         printf("failed to open the test file\n");
       } else {
-        r = cfs_read(fd, buf, sizeof(buf));
+        r = read_file(fd, buf, sizeof(buf));
 	buf[sizeof(buf) - 1] = '\0';
 	if(r <= 0) {
 	  printf("failed to read data from the file\n");
@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) 2015, EasyRF.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *	A bulk transfer over a uIP TCP connection from the node to itself.
+ */
+
+#include "bulk.h"
+#include "net/ip/uip-window.h"
+
+#include <string.h>
+
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+
+struct sender {
+  uint8_t window;
+  /* The length of the segment in flight, with a single segment */
+  uint16_t inflight;
+};
+
+struct bulk_stats bulk;
+static struct sender sender;
+
+PROCESS(bulk_process, "Bulk transfer");
+/*---------------------------------------------------------------------------*/
+uint8_t
+bulk_data(uint32_t offset)
+{
+  /* A period that is not a power of two, so that misplaced segments
+     show. */
+  return offset % 251;
+}
+/*---------------------------------------------------------------------------*/
+static void
+senddata(void)
+{
+  uint8_t *data;
+  uint32_t offset;
+  uint16_t len;
+  uint16_t i;
+
+  offset = bulk.acked;
+  if(uip_window_enabled(uip_conn)) {
+    /* New data follows the data in flight, and retransmissions start
+       at the oldest unacknowledged byte. */
+    if(!uip_rexmit()) {
+      offset += uip_unacked();
+    }
+  } else if(sender.inflight > 0 && !uip_rexmit()) {
+    return;
+  }
+
+  len = MIN(bulk.len - offset, uip_mss());
+  if(len == 0) {
+    return;
+  }
+  data = uip_appdata;
+  for(i = 0; i < len; i++) {
+    data[i] = bulk_data(offset + i);
+  }
+  uip_send(data, len);
+  if(!uip_window_enabled(uip_conn)) {
+    sender.inflight = len;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+sender_appcall(void)
+{
+  if(uip_aborted() || uip_timedout()) {
+    bulk.failed = 1;
+    return;
+  }
+  if(uip_closed()) {
+    return;
+  }
+
+  if(uip_connected() && sender.window) {
+    uip_window_enable(uip_conn);
+  }
+  if(uip_acked()) {
+    if(uip_window_enabled(uip_conn)) {
+      bulk.acked += uip_acked_len();
+    } else {
+      bulk.acked += sender.inflight;
+      sender.inflight = 0;
+    }
+  }
+  if(uip_rexmit()) {
+    bulk.rexmits++;
+  }
+
+  if(bulk.acked == bulk.len) {
+    uip_close();
+  } else if(uip_connected() || uip_acked() || uip_rexmit() || uip_poll()) {
+    senddata();
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+receiver_appcall(void)
+{
+  uint8_t *data;
+  uint16_t len;
+  uint16_t i;
+
+  if(uip_aborted() || uip_timedout()) {
+    bulk.failed = 1;
+    return;
+  }
+
+  if(uip_newdata()) {
+    data = uip_appdata;
+    len = uip_datalen();
+    for(i = 0; i < len; i++) {
+      if(data[i] != bulk_data(bulk.received + i)) {
+        bulk.corrupt++;
+      }
+    }
+    bulk.received += len;
+    if(bulk.received >= bulk.len && bulk.end == 0) {
+      bulk.end = clock_time();
+    }
+  }
+  if(uip_closed()) {
+    bulk.done = 1;
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+bulk_init(void)
+{
+  process_start(&bulk_process, NULL);
+  PROCESS_CONTEXT_BEGIN(&bulk_process);
+  tcp_listen(UIP_HTONS(BULK_PORT));
+  PROCESS_CONTEXT_END(&bulk_process);
+}
+/*---------------------------------------------------------------------------*/
+void
+bulk_expect(uint32_t len)
+{
+  memset(&bulk, 0, sizeof(bulk));
+  bulk.len = len;
+  bulk.start = clock_time();
+}
+/*---------------------------------------------------------------------------*/
+void
+bulk_start(uint32_t len, uint8_t window)
+{
+  bulk_expect(len);
+  sender.window = window;
+  sender.inflight = 0;
+
+  PROCESS_CONTEXT_BEGIN(&bulk_process);
+  tcp_connect(&uip_hostaddr, UIP_HTONS(BULK_PORT), &sender);
+  PROCESS_CONTEXT_END(&bulk_process);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(bulk_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(ev == tcpip_event);
+    if(data == &sender) {
+      sender_appcall();
+    } else {
+      receiver_appcall();
+    }
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2015, EasyRF.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *	A bulk transfer over a uIP TCP connection from the node to itself.
+ *	The sender is a plain uIP application that generates its data
+ *	from the offset into the stream, so it works both with a single
+ *	segment in flight and in the sliding window mode. The receiver
+ *	checks the data as it arrives.
+ */
+
+#ifndef BULK_H_
+#define BULK_H_
+
+#include "contiki.h"
+#include "contiki-net.h"
+
+#define BULK_PORT 8000
+
+struct bulk_stats {
+  uint32_t len;             /* the length of the transfer */
+  uint32_t acked;           /* acknowledged at the sender */
+  uint32_t received;        /* received in order */
+  uint32_t corrupt;         /* received with the wrong contents */
+  unsigned rexmits;         /* calls to the sender with uip_rexmit() */
+  clock_time_t start;
+  clock_time_t end;         /* when the last byte was received */
+  uint8_t done;             /* the receiver saw the connection close */
+  uint8_t failed;           /* the connection was aborted or timed out */
+};
+
+extern struct bulk_stats bulk;
+
+/**
+ * \brief Returns the byte at an offset into the stream.
+ */
+uint8_t bulk_data(uint32_t offset);
+
+/**
+ * \brief Listens for transfers on BULK_PORT.
+ */
+void bulk_init(void);
+
+/**
+ * \brief Starts a transfer to the node's own address.
+ * \param len    The number of bytes to send.
+ * \param window Non-zero to put the sending connection in the
+ *               sliding window mode.
+ *
+ * The statistics in bulk are reset.
+ */
+void bulk_start(uint32_t len, uint8_t window);
+
+/**
+ * \brief Only resets the statistics, for a transfer from another sender.
+ */
+void bulk_expect(uint32_t len);
+
+#endif /* BULK_H_ */
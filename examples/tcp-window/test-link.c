@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) 2015, EasyRF.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *	An emulated link for measuring and testing uIP TCP on the native
+ *	platform. The programs are linked with clock_time() wrapped.
+ */
+
+#include "test-link.h"
+
+#include <string.h>
+
+#define BUF ((struct uip_tcpip_hdr *)&uip_buf[UIP_LLH_LEN])
+
+#define QUEUE_SIZE 64
+
+struct queued_packet {
+  clock_time_t time;
+  unsigned long order;
+  uint16_t len;
+  uint8_t data[UIP_BUFSIZE];
+};
+
+clock_time_t test_link_delay;
+int (*test_link_filter)(const struct uip_tcpip_hdr *hdr, uint16_t datalen);
+unsigned long test_link_sent;
+unsigned long test_link_dropped;
+
+/* The packets on the way, with len zero in the free entries */
+static struct queued_packet queue[QUEUE_SIZE];
+
+/* The simulated time */
+static clock_time_t now;
+/*---------------------------------------------------------------------------*/
+clock_time_t
+__wrap_clock_time(void)
+{
+  return now;
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+datalen(void)
+{
+  if(BUF->proto != UIP_PROTO_TCP) {
+    return 0;
+  }
+  return ((BUF->len[0] << 8) | BUF->len[1]) - UIP_IPH_LEN -
+    (BUF->tcpoffset >> 4) * 4;
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+output(void)
+{
+  struct queued_packet *q;
+  int delay;
+  int i;
+
+  test_link_sent++;
+  delay = test_link_filter == NULL ? 0 : test_link_filter(BUF, datalen());
+
+  q = NULL;
+  for(i = 0; i < QUEUE_SIZE; i++) {
+    if(queue[i].len == 0) {
+      q = &queue[i];
+      break;
+    }
+  }
+  if(delay == TEST_LINK_DROP || q == NULL) {
+    test_link_dropped++;
+    return 0;
+  }
+
+  q->time = now + test_link_delay + delay;
+  q->order = test_link_sent;
+  q->len = uip_len;
+  memcpy(q->data, uip_buf, uip_len);
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Finds the packet that is delivered next, in the order that the
+   packets were sent if they are due at the same time. */
+static struct queued_packet *
+next_packet(void)
+{
+  struct queued_packet *next;
+  int i;
+
+  next = NULL;
+  for(i = 0; i < QUEUE_SIZE; i++) {
+    if(queue[i].len > 0 &&
+       (next == NULL || queue[i].time < next->time ||
+        (queue[i].time == next->time && queue[i].order < next->order))) {
+      next = &queue[i];
+    }
+  }
+  return next;
+}
+/*---------------------------------------------------------------------------*/
+void
+test_link_init(void)
+{
+  uip_ipaddr_t addr;
+
+  uip_ipaddr(&addr, 10, 0, 0, 1);
+  uip_sethostaddr(&addr);
+  uip_ipaddr(&addr, 255, 255, 255, 0);
+  uip_setnetmask(&addr);
+  tcpip_set_outputfunc(output);
+
+  memset(queue, 0, sizeof(queue));
+  test_link_filter = NULL;
+  test_link_sent = test_link_dropped = 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+test_link_wait(clock_time_t interval)
+{
+  struct queued_packet *q;
+  clock_time_t end;
+  clock_time_t next;
+
+  end = now + interval;
+  for(;;) {
+    while(process_run() > 0);
+
+    q = next_packet();
+    if(q != NULL && q->time <= now) {
+      memcpy(uip_buf, q->data, q->len);
+      uip_len = q->len;
+      q->len = 0;
+      tcpip_input();
+      continue;
+    }
+
+    if(now == end) {
+      break;
+    }
+    next = end;
+    if(q != NULL && q->time < next) {
+      next = q->time;
+    }
+    if(etimer_pending() && etimer_next_expiration_time() > now &&
+       etimer_next_expiration_time() < next) {
+      next = etimer_next_expiration_time();
+    }
+    now = next;
+    etimer_request_poll();
+  }
+}
+/*---------------------------------------------------------------------------*/
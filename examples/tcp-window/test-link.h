@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2015, EasyRF.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *	An emulated link for measuring and testing uIP TCP on the native
+ *	platform. The packets that the node sends are delivered back to it
+ *	after a delay, so that a connection to the node's own address has
+ *	both of its ends in the same stack. A filter can drop or delay
+ *	single packets. Time is simulated: it skips forward to the next
+ *	packet or timer, so that a transfer runs in a fraction of the time
+ *	that it takes on the link. Link with clock_time() wrapped.
+ */
+
+#ifndef TEST_LINK_H_
+#define TEST_LINK_H_
+
+#include "contiki.h"
+#include "contiki-net.h"
+
+/* Returned by the filter to drop a packet */
+#define TEST_LINK_DROP -1
+
+/* The one-way delay of the link, in clock ticks */
+extern clock_time_t test_link_delay;
+
+/* Called for every packet that is sent. Returns TEST_LINK_DROP, or a
+   delay in clock ticks that is added to the delay of the link. */
+extern int (*test_link_filter)(const struct uip_tcpip_hdr *hdr,
+                               uint16_t datalen);
+
+/* The packets that were sent and dropped since test_link_init() */
+extern unsigned long test_link_sent;
+extern unsigned long test_link_dropped;
+
+/**
+ * \brief Gives the node its address and sets the link up.
+ *
+ * The filter is cleared and any packets on the way are dropped.
+ */
+void test_link_init(void);
+
+/**
+ * \brief Skips time forward, running the processes and delivering the
+ *        packets that are due on the way.
+ */
+void test_link_wait(clock_time_t interval);
+
+#endif /* TEST_LINK_H_ */
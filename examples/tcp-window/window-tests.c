@@ -0,0 +1,382 @@
+/*
+ * Copyright (c) 2015, EasyRF.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *	Regression tests for the uIP TCP sliding window mode over an
+ *	emulated link: a transfer with more than one segment in flight,
+ *	fast retransmission of a lost segment, recovery from a
+ *	retransmission timeout, ACKs that arrive out of order, a
+ *	connection that keeps a single segment in flight, and tcp-socket
+ *	retransmitting from its output buffer. Build with TARGET=native;
+ *	the exit status is the number of failed tests.
+ */
+
+#include "contiki.h"
+#include "contiki-net.h"
+#include "net/ip/tcp-socket.h"
+
+#include "bulk.h"
+#include "test-link.h"
+#include "unit-test.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define LENGTH    100000UL
+#define DELAY     (CLOCK_SECOND / 100)
+#define TIMEOUT   (60 * CLOCK_SECOND)
+
+#define TCP_SYN   0x02
+
+/* The time that a single segment in flight needs for the transfer */
+#define SINGLE_SEGMENT_TIME \
+  ((LENGTH + UIP_TCP_MSS - 1) / UIP_TCP_MSS * 2 * DELAY)
+
+UNIT_TEST_REGISTER(window_transfer, "Transfer in the sliding window mode");
+UNIT_TEST_REGISTER(window_fast_rexmit, "Fast retransmission");
+UNIT_TEST_REGISTER(window_timeout, "Retransmission timeout");
+UNIT_TEST_REGISTER(window_old_acks, "ACKs out of order");
+UNIT_TEST_REGISTER(window_single, "Single segment connection");
+UNIT_TEST_REGISTER(window_tcp_socket, "tcp-socket retransmission");
+
+/* The segments that the sender sent, as offsets into the stream */
+static uint32_t isn;
+static uint32_t highest_sent;
+static uint32_t highest_acked;
+static uint32_t max_outstanding;
+static uint32_t lost_offset;
+static clock_time_t lost_time;
+static clock_time_t resent_time;
+static clock_time_t outage;
+static unsigned acks;
+
+static struct tcp_socket socket;
+static uint8_t socket_inbuf[64];
+static uint8_t socket_outbuf[8 * UIP_TCP_MSS];
+static uint32_t socket_left;
+
+static unsigned failures;
+/*---------------------------------------------------------------------------*/
+PROCESS(window_tests_process, "Window tests");
+AUTOSTART_PROCESSES(&window_tests_process);
+/*---------------------------------------------------------------------------*/
+static uint32_t
+seq32(const uint8_t *seq)
+{
+  return (uint32_t)seq[0] << 24 | (uint32_t)seq[1] << 16 |
+         (uint32_t)seq[2] << 8 | seq[3];
+}
+/*---------------------------------------------------------------------------*/
+/* Follows the data in flight, and returns the offset of a data
+   segment from the sender, or -1 for any other packet. */
+static long
+follow(const struct uip_tcpip_hdr *hdr, uint16_t datalen)
+{
+  uint32_t offset;
+
+  if(hdr->destport == UIP_HTONS(BULK_PORT)) {
+    if(hdr->flags & TCP_SYN) {
+      isn = seq32(hdr->seqno);
+      highest_sent = highest_acked = 0;
+      max_outstanding = 0;
+      return -1;
+    }
+    if(datalen == 0) {
+      return -1;
+    }
+    offset = seq32(hdr->seqno) - isn - 1;
+    if(offset + datalen > highest_sent) {
+      highest_sent = offset + datalen;
+    }
+    if(highest_sent - highest_acked > max_outstanding) {
+      max_outstanding = highest_sent - highest_acked;
+    }
+    return offset;
+  }
+
+  if(!(hdr->flags & TCP_SYN) && seq32(hdr->ackno) - isn - 1 > highest_acked &&
+     seq32(hdr->ackno) - isn - 1 <= highest_sent) {
+    highest_acked = seq32(hdr->ackno) - isn - 1;
+  }
+  return -1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+pass(const struct uip_tcpip_hdr *hdr, uint16_t datalen)
+{
+  follow(hdr, datalen);
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Loses the first transmission of the segment at lost_offset. */
+static int
+lose_once(const struct uip_tcpip_hdr *hdr, uint16_t datalen)
+{
+  long offset;
+
+  offset = follow(hdr, datalen);
+  if(offset == (long)lost_offset) {
+    if(lost_time == 0) {
+      lost_time = clock_time();
+      return TEST_LINK_DROP;
+    }
+    if(resent_time == 0) {
+      resent_time = clock_time();
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Loses all packets for a while, so that no duplicate ACKs arrive. */
+static int
+lose_all(const struct uip_tcpip_hdr *hdr, uint16_t datalen)
+{
+  follow(hdr, datalen);
+  if(clock_time() >= outage && clock_time() < outage + CLOCK_SECOND / 4) {
+    return TEST_LINK_DROP;
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Holds back every third ACK, so that the ACKs sent after it overtake
+   it and it arrives with an old acknowledgment number. */
+static int
+delay_acks(const struct uip_tcpip_hdr *hdr, uint16_t datalen)
+{
+  follow(hdr, datalen);
+  if(hdr->srcport == UIP_HTONS(BULK_PORT) && datalen == 0 &&
+     ++acks % 3 == 0) {
+    return DELAY / 2;
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Runs a transfer until the receiver has seen the connection close. */
+static void
+transfer(uint8_t window, int (*filter)(const struct uip_tcpip_hdr *,
+                                       uint16_t))
+{
+  test_link_init();
+  test_link_delay = DELAY;
+  test_link_filter = filter;
+
+  bulk_start(LENGTH, window);
+  while(!bulk.done && !bulk.failed &&
+        clock_time() - bulk.start < TIMEOUT) {
+    test_link_wait(CLOCK_SECOND / 10);
+  }
+  /* Let the connection close on both ends. */
+  test_link_wait(CLOCK_SECOND);
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST(window_transfer)
+{
+  UNIT_TEST_BEGIN();
+
+  transfer(1, pass);
+  UNIT_TEST_ASSERT(bulk.done && !bulk.failed);
+  UNIT_TEST_ASSERT(bulk.received == LENGTH && bulk.corrupt == 0);
+  UNIT_TEST_ASSERT(bulk.rexmits == 0 && test_link_dropped == 0);
+  /* Many segments were in flight at once, within the receive window. */
+  UNIT_TEST_ASSERT(max_outstanding > 4 * UIP_TCP_MSS);
+  UNIT_TEST_ASSERT(max_outstanding <= UIP_RECEIVE_WINDOW);
+  UNIT_TEST_ASSERT(bulk.end - bulk.start < SINGLE_SEGMENT_TIME / 4);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST(window_fast_rexmit)
+{
+  UNIT_TEST_BEGIN();
+
+  lost_offset = 30 * UIP_TCP_MSS;
+  lost_time = resent_time = 0;
+  transfer(1, lose_once);
+  UNIT_TEST_ASSERT(bulk.done && !bulk.failed);
+  UNIT_TEST_ASSERT(bulk.received == LENGTH && bulk.corrupt == 0);
+  UNIT_TEST_ASSERT(lost_time != 0 && resent_time != 0);
+  /* The duplicate ACKs for the segments after the lost one trigger the
+     retransmission a round-trip time later, well before the
+     retransmission timer of at least one second could. */
+  UNIT_TEST_ASSERT(resent_time - lost_time <= 4 * DELAY);
+  UNIT_TEST_ASSERT(bulk.end - bulk.start < SINGLE_SEGMENT_TIME / 2);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST(window_timeout)
+{
+  UNIT_TEST_BEGIN();
+
+  outage = clock_time() + CLOCK_SECOND / 10;
+  transfer(1, lose_all);
+  UNIT_TEST_ASSERT(test_link_dropped > 0);
+  UNIT_TEST_ASSERT(bulk.done && !bulk.failed);
+  UNIT_TEST_ASSERT(bulk.received == LENGTH && bulk.corrupt == 0);
+  UNIT_TEST_ASSERT(bulk.rexmits > 0);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST(window_old_acks)
+{
+  UNIT_TEST_BEGIN();
+
+  acks = 0;
+  transfer(1, delay_acks);
+  UNIT_TEST_ASSERT(bulk.done && !bulk.failed);
+  UNIT_TEST_ASSERT(bulk.received == LENGTH && bulk.corrupt == 0);
+  /* The old ACKs are neither taken for duplicates nor for new ones. */
+  UNIT_TEST_ASSERT(bulk.rexmits == 0);
+  UNIT_TEST_ASSERT(max_outstanding <= UIP_RECEIVE_WINDOW);
+  UNIT_TEST_ASSERT(bulk.end - bulk.start < SINGLE_SEGMENT_TIME / 4);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST(window_single)
+{
+  UNIT_TEST_BEGIN();
+
+  lost_offset = 30 * UIP_TCP_MSS;
+  lost_time = resent_time = 0;
+  transfer(0, lose_once);
+  UNIT_TEST_ASSERT(bulk.done && !bulk.failed);
+  UNIT_TEST_ASSERT(bulk.received == LENGTH && bulk.corrupt == 0);
+  UNIT_TEST_ASSERT(max_outstanding <= UIP_TCP_MSS);
+  /* Only the retransmission timer recovers a single segment. */
+  UNIT_TEST_ASSERT(bulk.rexmits == 1);
+  UNIT_TEST_ASSERT(resent_time - lost_time >= CLOCK_SECOND / 2);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+static void
+socket_fill(void)
+{
+  uint8_t chunk[512];
+  uint32_t offset;
+  int len;
+  int sent;
+  int i;
+
+  while(socket_left > 0) {
+    offset = LENGTH - socket_left;
+    len = socket_left < sizeof(chunk) ? socket_left : sizeof(chunk);
+    for(i = 0; i < len; i++) {
+      chunk[i] = bulk_data(offset + i);
+    }
+    sent = tcp_socket_send(&socket, chunk, len);
+    if(sent <= 0) {
+      break;
+    }
+    socket_left -= sent;
+  }
+  if(socket_left == 0) {
+    tcp_socket_close(&socket);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+socket_input(struct tcp_socket *s, void *ptr, const uint8_t *data, int len)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+socket_event(struct tcp_socket *s, void *ptr, tcp_socket_event_t ev)
+{
+  if(ev == TCP_SOCKET_CONNECTED || ev == TCP_SOCKET_DATA_SENT) {
+    socket_fill();
+  } else if(ev == TCP_SOCKET_TIMEDOUT || ev == TCP_SOCKET_ABORTED) {
+    bulk.failed = 1;
+  }
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST(window_tcp_socket)
+{
+  UNIT_TEST_BEGIN();
+
+  test_link_init();
+  test_link_delay = DELAY;
+  lost_offset = 30 * UIP_TCP_MSS;
+  lost_time = resent_time = 0;
+  test_link_filter = lose_once;
+
+  bulk_expect(LENGTH);
+  socket_left = LENGTH;
+  tcp_socket_register(&socket, NULL, socket_inbuf, sizeof(socket_inbuf),
+                      socket_outbuf, sizeof(socket_outbuf),
+                      socket_input, socket_event);
+  tcp_socket_connect(&socket, &uip_hostaddr, BULK_PORT);
+  while(!bulk.done && !bulk.failed &&
+        clock_time() - bulk.start < TIMEOUT) {
+    test_link_wait(CLOCK_SECOND / 10);
+  }
+  test_link_wait(CLOCK_SECOND);
+
+  UNIT_TEST_ASSERT(bulk.done && !bulk.failed);
+  UNIT_TEST_ASSERT(bulk.received == LENGTH && bulk.corrupt == 0);
+  UNIT_TEST_ASSERT(lost_time != 0 && resent_time - lost_time <= 4 * DELAY);
+  UNIT_TEST_ASSERT(max_outstanding > 4 * UIP_TCP_MSS);
+  UNIT_TEST_ASSERT(max_outstanding <= sizeof(socket_outbuf));
+
+  tcp_socket_unregister(&socket);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(window_tests_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  bulk_init();
+
+  UNIT_TEST_RUN(window_transfer);
+  failures += UNIT_TEST_RESULT(window_transfer) == unit_test_failure;
+  UNIT_TEST_RUN(window_fast_rexmit);
+  failures += UNIT_TEST_RESULT(window_fast_rexmit) == unit_test_failure;
+  UNIT_TEST_RUN(window_timeout);
+  failures += UNIT_TEST_RESULT(window_timeout) == unit_test_failure;
+  UNIT_TEST_RUN(window_old_acks);
+  failures += UNIT_TEST_RESULT(window_old_acks) == unit_test_failure;
+  UNIT_TEST_RUN(window_single);
+  failures += UNIT_TEST_RESULT(window_single) == unit_test_failure;
+  UNIT_TEST_RUN(window_tcp_socket);
+  failures += UNIT_TEST_RESULT(window_tcp_socket) == unit_test_failure;
+
+  exit(failures);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,201 @@
+/*
+ * Copyright (c) 2015, EasyRF.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *	Checks that jsontree_write_chunk() produces the same document as
+ *	jsontree_print_next() with putchar output, byte for byte, for
+ *	every chunk size, with and without a precompiled template, and
+ *	when the chunks are requested out of order.
+ */
+
+#include "contiki.h"
+#include "jsontree.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define DOC_MAX   512
+#define CHUNK_MAX 300
+
+static char expected[DOC_MAX];
+static int expected_len;
+static char doc[DOC_MAX + CHUNK_MAX];
+static char chunk[CHUNK_MAX];
+
+static struct jsontree_context js_ctx;
+static struct jsontree_buffer out;
+/*---------------------------------------------------------------------------*/
+/* Prints a list of three names, one step at a time. */
+static int
+output_list(struct jsontree_context *js_ctx)
+{
+  if(js_ctx->callback_state < 3) {
+    if(js_ctx->callback_state == 0) {
+      jsontree_write_atom(js_ctx, "[");
+    } else {
+      js_ctx->putchar(',');
+    }
+    jsontree_write_string(js_ctx,
+                          jsontree_path_name(js_ctx, js_ctx->depth - 1));
+    js_ctx->callback_state++;
+    return 1;
+  }
+  js_ctx->putchar(']');
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static struct jsontree_callback list = JSONTREE_CALLBACK(output_list, NULL);
+static struct jsontree_int id0 = { JSON_TYPE_INT, 12345 };
+static struct jsontree_int id1 = { JSON_TYPE_INT, -7 };
+static struct jsontree_string name = JSONTREE_STRING("he said \"hi\"");
+
+JSONTREE_OBJECT(sensor0,
+                JSONTREE_PAIR("id", &id0),
+                JSONTREE_PAIR("values", &list));
+JSONTREE_OBJECT(sensor1,
+                JSONTREE_PAIR("id", &id1),
+                JSONTREE_PAIR("name", &name));
+JSONTREE_ARRAY(sensors, 3);
+JSONTREE_OBJECT(root,
+                JSONTREE_PAIR("name", &name),
+                JSONTREE_PAIR("sensors", &sensors),
+                JSONTREE_PAIR("n", &id1),
+                JSONTREE_PAIR("list", &list));
+
+JSONTREE_TEMPLATE(root_template, 256, 8);
+/*---------------------------------------------------------------------------*/
+static int
+expected_putchar(int c)
+{
+  if(expected_len < DOC_MAX) {
+    expected[expected_len++] = c;
+  }
+  return c;
+}
+/*---------------------------------------------------------------------------*/
+static void
+setup(int use_template)
+{
+  jsontree_setup(&js_ctx, (struct jsontree_value *)&root, NULL);
+  if(use_template) {
+    jsontree_set_template(&js_ctx, &root_template);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Prints the document in consecutive chunks of the given size. */
+static int
+check_sequential(int use_template, int size)
+{
+  int32_t offset;
+  int len, n;
+
+  setup(use_template);
+  offset = 0;
+  len = 0;
+  while(offset >= 0 && len <= DOC_MAX) {
+    n = jsontree_write_chunk(&js_ctx, &out, chunk, size, &offset);
+    memcpy(doc + len, chunk, n);
+    len += n;
+  }
+  return len == expected_len && memcmp(doc, expected, len) == 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Prints the chunk at each offset, from the end of the document back. */
+static int
+check_reverse(int use_template, int size)
+{
+  int32_t offset, next;
+  int n;
+
+  setup(use_template);
+  for(offset = (expected_len - 1) / size * size; offset >= 0;
+      offset -= size) {
+    next = offset;
+    n = jsontree_write_chunk(&js_ctx, &out, chunk, size, &next);
+    if(n != (expected_len - offset < size ? expected_len - offset : size) ||
+       memcmp(chunk, expected + offset, n) != 0) {
+      return 0;
+    }
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(jsontree_test_process, "jsontree test");
+AUTOSTART_PROCESSES(&jsontree_test_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(jsontree_test_process, ev, data)
+{
+  static int use_template, size, failures;
+
+  PROCESS_BEGIN();
+
+  sensors.values[0] = (struct jsontree_value *)&sensor0;
+  sensors.values[1] = (struct jsontree_value *)&sensor1;
+  sensors.values[2] = (struct jsontree_value *)&id0;
+
+  jsontree_setup(&js_ctx, (struct jsontree_value *)&root, expected_putchar);
+  while(jsontree_print_next(&js_ctx));
+  printf("%d bytes: %.*s\n", expected_len, expected_len, expected);
+
+  if(!jsontree_template_compile(&root_template,
+                                (struct jsontree_value *)&root)) {
+    printf("the template does not fit\n");
+    failures++;
+  }
+
+  for(use_template = 0; use_template < 2; use_template++) {
+    for(size = 1; size <= CHUNK_MAX; size++) {
+      if(!check_sequential(use_template, size)) {
+        printf("chunks of %d bytes%s differ\n", size,
+               use_template ? " from the template" : "");
+        failures++;
+      }
+      if(!check_reverse(use_template, size)) {
+        printf("reverse chunks of %d bytes%s differ\n", size,
+               use_template ? " from the template" : "");
+        failures++;
+      }
+    }
+    /* Yield between the rounds to let the watchdog be serviced. */
+    PROCESS_PAUSE();
+  }
+
+  if(failures == 0) {
+    printf("TEST OK\n");
+  } else {
+    printf("TEST FAILED: %d\n", failures);
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
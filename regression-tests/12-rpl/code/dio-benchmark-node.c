@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2015, EasyRF.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *	Node that measures the CPU time RPL spends on each incoming DIO.
+ *	Once a minute it prints the number of neighbors, the number of
+ *	DIOs received and the average CPU time per DIO in the last
+ *	minute. The time is the CPU time of the simulation thread, so
+ *	this runs on Cooja motes only.
+ */
+
+#include "contiki.h"
+#include "net/ip/uip.h"
+#include "net/ipv6/uip-ds6.h"
+#include "net/rpl/rpl-private.h"
+
+#include <stdio.h>
+#include <time.h>
+
+#define REPORT_INTERVAL (60 * CLOCK_SECOND)
+
+static struct timespec dio_start;
+static unsigned long dio_count;
+static unsigned long long dio_ns;
+
+/*---------------------------------------------------------------------------*/
+PROCESS(dio_benchmark_node_process, "DIO benchmark node");
+AUTOSTART_PROCESSES(&dio_benchmark_node_process);
+/*---------------------------------------------------------------------------*/
+void
+dio_benchmark_input(uip_ipaddr_t *from, rpl_dio_t *dio)
+{
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &dio_start);
+}
+/*---------------------------------------------------------------------------*/
+void
+dio_benchmark_processed(uip_ipaddr_t *from, rpl_dio_t *dio)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+  dio_ns += (now.tv_sec - dio_start.tv_sec) * 1000000000ULL +
+    now.tv_nsec - dio_start.tv_nsec;
+  dio_count++;
+}
+/*---------------------------------------------------------------------------*/
+static void
+set_global_address(void)
+{
+  uip_ipaddr_t ipaddr;
+
+  uip_ip6addr(&ipaddr, 0xaaaa, 0, 0, 0, 0, 0, 0, 0);
+  uip_ds6_set_addr_iid(&ipaddr, &uip_lladdr);
+  uip_ds6_addr_add(&ipaddr, 0, ADDR_AUTOCONF);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(dio_benchmark_node_process, ev, data)
+{
+  static struct etimer et;
+
+  PROCESS_BEGIN();
+
+  set_global_address();
+
+  etimer_set(&et, REPORT_INTERVAL);
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+    etimer_reset(&et);
+
+    printf("DIO benchmark: %d neighbors, %lu DIOs, %lu ns per DIO\n",
+           uip_ds6_nbr_num(), dio_count,
+           dio_count > 0 ? (unsigned long)(dio_ns / dio_count) : 0UL);
+    dio_count = 0;
+    dio_ns = 0;
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
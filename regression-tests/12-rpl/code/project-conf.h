@@ -28,3 +28,14 @@
  */
 #define TCPIP_CONF_ANNOTATE_TRANSMISSIONS 1
 
+#ifdef DIO_BENCHMARK
+/* Keep the DIO intervals short, so that there are enough DIOs to
+   measure their processing. */
+#define RPL_CONF_DIO_INTERVAL_MIN       10
+#define RPL_CONF_DIO_INTERVAL_DOUBLINGS 2
+#endif /* DIO_BENCHMARK */
+
+#ifdef DIO_BENCHMARK_NODE
+#define RPL_DEBUG_DIO_INPUT     dio_benchmark_input
+#define RPL_DEBUG_DIO_PROCESSED dio_benchmark_processed
+#endif /* DIO_BENCHMARK_NODE */
@@ -0,0 +1,470 @@
+/*
+ * Copyright (c) 2015, EasyRF.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/*
+ * Makes a patch that turns a base image into a new image, in the
+ * format that is applied on the nodes by apps/delta. The differences
+ * are found as in bsdiff: approximate matches are extended from
+ * exact matches found with a suffix array of the base image, and the
+ * bytewise differences within the matches are stored instead of the
+ * new bytes. The differences of a recompiled image are mostly zero,
+ * so they are stored as runs of copied and added bytes.
+ *
+ * Usage: deltadiff base-image new-image patch
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "lib/sha256.h"
+
+#define MAGIC       "DLT1"
+#define HEADER_SIZE (12 + 2 * SHA256_DIGEST_LENGTH)
+#define MIN_COPY    3
+
+static const uint8_t *sort_data;
+static long sort_size;
+static long *sort_rank;
+static long sort_step;
+
+struct buf {
+  uint8_t *data;
+  long len;
+  long size;
+};
+/*---------------------------------------------------------------------------*/
+static void *
+xmalloc(size_t size)
+{
+  void *p = malloc(size > 0 ? size : 1);
+  if(p == NULL) {
+    fprintf(stderr, "deltadiff: out of memory\n");
+    exit(1);
+  }
+  return p;
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t *
+read_file(const char *name, long *len)
+{
+  FILE *f;
+  uint8_t *data;
+
+  f = fopen(name, "rb");
+  if(f == NULL || fseek(f, 0, SEEK_END) != 0 || (*len = ftell(f)) < 0) {
+    perror(name);
+    exit(1);
+  }
+  rewind(f);
+  data = xmalloc(*len);
+  if(fread(data, 1, *len, f) != (size_t)*len) {
+    perror(name);
+    exit(1);
+  }
+  fclose(f);
+  return data;
+}
+/*---------------------------------------------------------------------------*/
+static void
+put(struct buf *b, uint8_t c)
+{
+  if(b->len == b->size) {
+    b->size = b->size * 2 + 256;
+    b->data = realloc(b->data, b->size);
+    if(b->data == NULL) {
+      fprintf(stderr, "deltadiff: out of memory\n");
+      exit(1);
+    }
+  }
+  b->data[b->len++] = c;
+}
+/*---------------------------------------------------------------------------*/
+static void
+put32(struct buf *b, uint32_t v)
+{
+  int i;
+
+  for(i = 0; i < 4; i++) {
+    put(b, v >> (8 * i));
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+put_varint(struct buf *b, uint32_t v)
+{
+  while(v >= 0x80) {
+    put(b, (v & 0x7f) | 0x80);
+    v >>= 7;
+  }
+  put(b, v);
+}
+/*---------------------------------------------------------------------------*/
+static void
+digest(const uint8_t *data, long len, uint8_t *out)
+{
+  struct sha256_state state;
+  long n;
+
+  sha256_init(&state);
+  for(; len > 0; data += n, len -= n) {
+    n = len > 0x8000 ? 0x8000 : len;
+    sha256_update(&state, data, n);
+  }
+  sha256_finish(&state, out);
+}
+/*---------------------------------------------------------------------------*/
+static int
+compare_suffix(const void *a, const void *b)
+{
+  long i = *(const long *)a;
+  long j = *(const long *)b;
+  long ri, rj;
+
+  if(sort_rank[i] != sort_rank[j]) {
+    return sort_rank[i] < sort_rank[j] ? -1 : 1;
+  }
+  ri = i + sort_step < sort_size ? sort_rank[i + sort_step] : -1;
+  rj = j + sort_step < sort_size ? sort_rank[j + sort_step] : -1;
+  return ri < rj ? -1 : ri > rj;
+}
+/*---------------------------------------------------------------------------*/
+/* Builds a suffix array by prefix doubling. */
+static long *
+suffix_sort(const uint8_t *data, long len)
+{
+  long *sa, *tmp;
+  long i;
+
+  sa = xmalloc(len * sizeof(long));
+  sort_rank = xmalloc(len * sizeof(long));
+  tmp = xmalloc(len * sizeof(long));
+  sort_data = data;
+  sort_size = len;
+
+  for(i = 0; i < len; i++) {
+    sa[i] = i;
+    sort_rank[i] = data[i];
+  }
+  for(sort_step = 1; ; sort_step *= 2) {
+    qsort(sa, len, sizeof(long), compare_suffix);
+    tmp[sa[0]] = 0;
+    for(i = 1; i < len; i++) {
+      tmp[sa[i]] = tmp[sa[i - 1]] + (compare_suffix(&sa[i - 1], &sa[i]) < 0);
+    }
+    memcpy(sort_rank, tmp, len * sizeof(long));
+    if(len == 0 || sort_rank[sa[len - 1]] == len - 1) {
+      break;
+    }
+  }
+  free(tmp);
+  free(sort_rank);
+  return sa;
+}
+/*---------------------------------------------------------------------------*/
+static long
+match_len(const uint8_t *a, long alen, const uint8_t *b, long blen)
+{
+  long i;
+
+  for(i = 0; i < alen && i < blen && a[i] == b[i]; i++);
+  return i;
+}
+/*---------------------------------------------------------------------------*/
+/* Finds the longest match of new in the base image. */
+static long
+search(const long *sa, const uint8_t *base, long base_len,
+       const uint8_t *new, long new_len, long lo, long hi, long *pos)
+{
+  long x, y, mid;
+
+  while(hi - lo >= 2) {
+    mid = lo + (hi - lo) / 2;
+    x = base_len - sa[mid];
+    if(memcmp(base + sa[mid], new, x < new_len ? x : new_len) < 0) {
+      lo = mid;
+    } else {
+      hi = mid;
+    }
+  }
+  x = match_len(base + sa[lo], base_len - sa[lo], new, new_len);
+  y = hi < base_len ?
+    match_len(base + sa[hi], base_len - sa[hi], new, new_len) : 0;
+  if(x >= y) {
+    *pos = sa[lo];
+    return x;
+  }
+  *pos = sa[hi];
+  return y;
+}
+/*---------------------------------------------------------------------------*/
+/* Encodes the differences of len bytes as runs of copied and added bytes. */
+static void
+put_diff(struct buf *out, const uint8_t *base, const uint8_t *new, long len)
+{
+  long i, start, zeros;
+
+  i = 0;
+  while(i < len) {
+    for(zeros = 0; i + zeros < len && base[i + zeros] == new[i + zeros];
+        zeros++);
+    if(zeros >= MIN_COPY || i + zeros == len) {
+      put_varint(out, zeros * 2);
+      i += zeros;
+      continue;
+    }
+    /* A literal run ends where enough equal bytes follow. */
+    start = i;
+    while(i < len) {
+      for(zeros = 0; i + zeros < len && base[i + zeros] == new[i + zeros] &&
+            zeros < MIN_COPY; zeros++);
+      if(zeros >= MIN_COPY) {
+        break;
+      }
+      i += zeros == 0 ? 1 : zeros;
+    }
+    put_varint(out, (i - start) * 2 + 1);
+    for(; start < i; start++) {
+      put(out, new[start] - base[start]);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+put_record(struct buf *out, const uint8_t *base, long base_pos,
+           const uint8_t *new, long new_pos,
+           long diff_len, long extra_len, long seek)
+{
+  put_varint(out, diff_len);
+  put_varint(out, extra_len);
+  put_varint(out, seek < 0 ? ((uint32_t)-seek << 1) - 1 : (uint32_t)seek << 1);
+  put_diff(out, base + base_pos, new + new_pos, diff_len);
+  for(; extra_len > 0; extra_len--) {
+    put(out, new[new_pos + diff_len++]);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* The main loop of bsdiff, with the records written as they are found. */
+static void
+diff(struct buf *out, const uint8_t *base, long base_len,
+     const uint8_t *new, long new_len)
+{
+  long *sa;
+  long scan, len, pos, last_scan, last_pos, last_offset;
+  long old_score, scsc, s, sf, lenf, sb, lenb, overlap, ss, lens, i;
+
+  sa = base_len > 0 ? suffix_sort(base, base_len) : NULL;
+
+  scan = len = pos = 0;
+  last_scan = last_pos = last_offset = 0;
+  while(scan < new_len) {
+    old_score = 0;
+    for(scsc = scan += len; scan < new_len; scan++) {
+      len = base_len > 0 ? search(sa, base, base_len, new + scan,
+                                  new_len - scan, 0, base_len, &pos) : 0;
+      for(; scsc < scan + len; scsc++) {
+        if(scsc + last_offset < base_len &&
+           base[scsc + last_offset] == new[scsc]) {
+          old_score++;
+        }
+      }
+      if((len == old_score && len != 0) || len > old_score + 8) {
+        break;
+      }
+      if(scan + last_offset < base_len &&
+         base[scan + last_offset] == new[scan]) {
+        old_score--;
+      }
+    }
+
+    if(len != old_score || scan == new_len) {
+      s = sf = lenf = 0;
+      for(i = 0; last_scan + i < scan && last_pos + i < base_len;) {
+        if(base[last_pos + i] == new[last_scan + i]) {
+          s++;
+        }
+        i++;
+        if(s * 2 - i > sf * 2 - lenf) {
+          sf = s;
+          lenf = i;
+        }
+      }
+
+      lenb = 0;
+      if(scan < new_len) {
+        s = sb = 0;
+        for(i = 1; scan >= last_scan + i && pos >= i; i++) {
+          if(base[pos - i] == new[scan - i]) {
+            s++;
+          }
+          if(s * 2 - i > sb * 2 - lenb) {
+            sb = s;
+            lenb = i;
+          }
+        }
+      }
+
+      if(last_scan + lenf > scan - lenb) {
+        overlap = (last_scan + lenf) - (scan - lenb);
+        s = ss = lens = 0;
+        for(i = 0; i < overlap; i++) {
+          if(new[last_scan + lenf - overlap + i] ==
+             base[last_pos + lenf - overlap + i]) {
+            s++;
+          }
+          if(new[scan - lenb + i] == base[pos - lenb + i]) {
+            s--;
+          }
+          if(s > ss) {
+            ss = s;
+            lens = i + 1;
+          }
+        }
+        lenf += lens - overlap;
+        lenb -= lens;
+      }
+
+      put_record(out, base, last_pos, new, last_scan, lenf,
+                 (scan - lenb) - (last_scan + lenf),
+                 (pos - lenb) - (last_pos + lenf));
+
+      last_scan = scan - lenb;
+      last_pos = pos - lenb;
+      last_offset = pos - scan;
+    }
+  }
+  free(sa);
+}
+/*---------------------------------------------------------------------------*/
+static uint32_t
+get_varint(const uint8_t **p)
+{
+  uint32_t v = 0;
+  int shift = 0;
+
+  do {
+    v |= (uint32_t)(**p & 0x7f) << shift;
+    shift += 7;
+  } while(*(*p)++ & 0x80);
+  return v;
+}
+/*---------------------------------------------------------------------------*/
+/* Applies a patch in memory, to check it before it is sent out. */
+static int
+verify(const struct buf *patch, const uint8_t *base, long base_len,
+       const uint8_t *new, long new_len)
+{
+  const uint8_t *p, *end;
+  uint8_t *out;
+  long base_pos, new_pos, diff_len, extra_len, run;
+  uint32_t v;
+  int literal, ok;
+
+  out = xmalloc(new_len);
+  p = patch->data + HEADER_SIZE;
+  end = patch->data + patch->len;
+  base_pos = new_pos = 0;
+  while(p < end && new_pos < new_len) {
+    diff_len = get_varint(&p);
+    extra_len = get_varint(&p);
+    v = get_varint(&p);
+    while(diff_len > 0) {
+      run = get_varint(&p);
+      literal = run & 1;
+      run >>= 1;
+      if(run == 0 || run > diff_len) {
+        free(out);
+        return 0;
+      }
+      diff_len -= run;
+      for(; run > 0; run--) {
+        out[new_pos++] = base[base_pos++] + (literal ? *p++ : 0);
+      }
+    }
+    memcpy(out + new_pos, p, extra_len);
+    new_pos += extra_len;
+    p += extra_len;
+    base_pos += (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+  }
+  ok = p == end && new_pos == new_len && memcmp(out, new, new_len) == 0;
+  free(out);
+  return ok;
+}
+/*---------------------------------------------------------------------------*/
+int
+main(int argc, char **argv)
+{
+  uint8_t *base, *new;
+  long base_len, new_len;
+  struct buf patch = { NULL, 0, 0 };
+  uint8_t hash[SHA256_DIGEST_LENGTH];
+  FILE *f;
+  int i;
+
+  if(argc != 4) {
+    fprintf(stderr, "usage: %s base-image new-image patch\n", argv[0]);
+    return 1;
+  }
+  base = read_file(argv[1], &base_len);
+  new = read_file(argv[2], &new_len);
+
+  for(i = 0; i < 4; i++) {
+    put(&patch, MAGIC[i]);
+  }
+  put32(&patch, base_len);
+  put32(&patch, new_len);
+  digest(base, base_len, hash);
+  for(i = 0; i < SHA256_DIGEST_LENGTH; i++) {
+    put(&patch, hash[i]);
+  }
+  digest(new, new_len, hash);
+  for(i = 0; i < SHA256_DIGEST_LENGTH; i++) {
+    put(&patch, hash[i]);
+  }
+
+  diff(&patch, base, base_len, new, new_len);
+
+  if(!verify(&patch, base, base_len, new, new_len)) {
+    fprintf(stderr, "deltadiff: internal error, the patch does not apply\n");
+    return 1;
+  }
+
+  f = fopen(argv[3], "wb");
+  if(f == NULL || fwrite(patch.data, 1, patch.len, f) != (size_t)patch.len ||
+     fclose(f) != 0) {
+    perror(argv[3]);
+    return 1;
+  }
+  printf("%s: %ld bytes for a %ld byte image\n", argv[3], patch.len, new_len);
+  return 0;
+}